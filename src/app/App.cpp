@@ -1,5 +1,13 @@
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <fstream>
+#include <future>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
 #include <wx/filename.h>
 #include <wx/cmdline.h>
@@ -7,12 +15,18 @@
 #include "App.hpp"
 #include "../device/AudioDeviceManager.hpp"
 #include "../device/MidiDeviceManager.hpp"
+#include "../device/MidiTimestampScheduler.hpp"
 #include "../plugin/vst3/Vst3Plugin.hpp"
 #include "../plugin/vst3/Vst3PluginFactory.hpp"
+#include "../plugin/vst3/StateSnapshotStore.hpp"
 #include "../misc/StrCnv.hpp"
 #include "../misc/MathUtil.hpp"
 #include "../misc/TransitionalVolume.hpp"
 #include "../misc/LockFactory.hpp"
+#include "../misc/DelayLine.hpp"
+#include "../misc/RcuPointer.hpp"
+#include "../misc/RealtimeWorkerPool.hpp"
+#include "../misc/TripleBuffer.hpp"
 #include "../misc/Algorithm.hpp"
 #include "../resource/ResourceHelper.hpp"
 #include "../gui/Gui.hpp"
@@ -25,8 +39,16 @@
 #include "../file/ProjectFile.hpp"
 #include "../log/LoggingSupport.hpp"
 #include "../log/LoggingStrategy.hpp"
+#include "../log/RealtimeLogger.hpp"
 #include "./NoteStatus.hpp"
 #include "./TestSynth.hpp"
+#include "./OfflineRenderer.hpp"
+#include "./PluginChain.hpp"
+#include "./PluginHostProcess.hpp"
+#include "./PluginHostProtocol.hpp"
+#include "./PluginScanner.hpp"
+#include "./PluginScanProcess.hpp"
+#include "./Vst3PluginLoadTask.hpp"
 
 NS_HWM_BEGIN
 
@@ -34,6 +56,13 @@ double const kAudioOutputLevelMinDB = -48.0;
 double const kAudioOutputLevelMaxDB = 0.0;
 Int32 kAudioOutputLevelTransientMillisec = 30;
 double const kLevelMeterReleaseSpeed = 24.0;
+double const kLevelMeterPeakHoldSeconds = 1.0;
+//! A/B比較とUndoのために保持する、プラグインの状態のスナップショットの合計サイズの上限
+size_t const kPluginStateStoreCapacity = 256 * 1024 * 1024;
+//! UndoPluginStateChange() で戻せる回数
+size_t const kMaxNumPluginStateUndos = 32;
+//! 別プロセスのプラグインの応答を待つ時間の合計の上限（ブロックの長さに対する割合）
+double const kRemotePluginResponseTimeRatio = 0.5;
 
 bool OpenAudioDevice(Config const &conf)
 {
@@ -92,6 +121,34 @@ bool OpenAudioDevice(Config const &conf)
     return true;
 }
 
+//! サウンドカードを使用しないヌルデバイスをオープンする
+bool OpenNullAudioDevice(Config const &conf)
+{
+    auto adm = AudioDeviceManager::GetInstance();
+    
+    adm->Close();
+    
+    auto const audio_device_infos = adm->Enumerate();
+    auto find_entry = [&list = audio_device_infos](auto io_type) -> AudioDeviceInfo const * {
+        auto found = std::find_if(list.begin(), list.end(), [&](auto const &x) {
+            return x.io_type_ == io_type && x.driver_ == AudioDriverType::kNull;
+        });
+        if(found == list.end()) { return nullptr; }
+        else { return &*found; }
+    };
+    
+    auto result = adm->Open(find_entry(DeviceIOType::kInput),
+                            find_entry(DeviceIOType::kOutput),
+                            conf.sample_rate_,
+                            conf.block_size_);
+    if(result.is_right() == false) {
+        HWM_ERROR_LOG(L"failed to open the null device: " + result.left().error_msg_);
+        return false;
+    }
+    
+    return true;
+}
+
 std::vector<IMidiDevice *> OpenMidiDevices()
 {
     auto mdm = MidiDeviceManager::GetInstance();
@@ -125,11 +182,11 @@ std::vector<IMidiDevice *> OpenMidiDevices()
 
 struct App::Impl
 :   IAudioDeviceCallback
+,   IVst3PluginListener
 {
     Impl()
     {
         input_event_buffers_.SetNumBuffers(1);
-        output_event_buffers_.SetNumBuffers(1);
         
         for(int i = 0; i < 128; ++i) {
             requested_[i] = NoteStatus::CreateNull();
@@ -143,20 +200,693 @@ struct App::Impl
     TransitionalVolume output_level_;
     PCKeyboardInput keyinput_;
     std::atomic<bool> enable_audio_input_ = { false };
+    //! Appの入力を、プラグインのレイテンシーに合わせて遅らせて出力にも合成するかどうか
+    std::atomic<bool> enable_input_monitoring_ = { false };
+    //! 遅延補正後の、プラグインのグラフ全体のレイテンシー
+    std::atomic<SampleCount> graph_latency_ = { 0 };
     AudioDeviceManager adm_;
     MidiDeviceManager mdm_;
     std::vector<IMidiDevice *> midi_ins_; //!< オープンしたMIDI入力デバイス
-    std::vector<DeviceMidiMessage> device_midi_messages_;
+    //! MIDI入力のタイムスタンプを、ブロック内のサンプル位置に変換する
+    MidiTimestampScheduler midi_scheduler_;
     wxFrame *frame_;
     std::shared_ptr<Vst3PluginFactoryList> factory_list_;
     std::shared_ptr<Vst3PluginFactory> factory_;
-    std::shared_ptr<Vst3Plugin> plugin_;
+    //! GUIスレッドから参照するプラグインチェイン
+    std::vector<PluginChainNodePtr> chain_;
+    //! LoadVst3Plugin() でロードしたプラグイン。 chain_ のいずれかのノードを指す
+    PluginChainNodePtr main_node_;
+    //! SetChainedPluginInputs() で入力を指定したノードと、その入力のノード。
+    //! 含まれないノードは、 chain_ の直前のノードを入力とする
+    std::map<PluginChainNode const *, std::vector<PluginChainNode const *>> explicit_inputs_;
+    
+    //! 経路ごとのレイテンシーの差を補正するためのディレイライン
+    template<class T>
+    struct LatencyDelays
+    {
+        //! input_delays_[i][j] は inputs_[i][j] の出力を、 nodes_[i] の入力のうち最もレイテンシーが大きいものに揃える
+        std::vector<std::vector<DelayLine<T>>> input_delays_;
+        //! nodes_[i] をバイパスしているときに、プラグインのレイテンシー分だけ遅らせる
+        std::vector<DelayLine<T>> bypass_delays_;
+        //! sinks_[i] の出力を、最もレイテンシーが大きいsinkに揃える
+        std::vector<DelayLine<T>> sink_delays_;
+        //! 入力モニターで、Appの入力をグラフ全体のレイテンシー分だけ遅らせる
+        DelayLine<T> dry_delay_;
+    };
+    
+    //! オーディオスレッドから参照するプラグインのグラフ
+    struct PlaybackState
+    {
+        std::vector<PluginChainNodePtr> nodes_;
+        //! nodes_[i] の入力となるノードのインデックス。空の場合はAppの入力（テスト波形やオーディオ入力、MIDI入力）を使う
+        std::vector<std::vector<UInt32>> inputs_;
+        //! どのノードの入力にもなっていないノード。これらの出力を合成してデバイスに出力する
+        std::vector<UInt32> sinks_;
+        //! nodes_[i] の処理を i 番目のタスクとして、 inputs_ の依存関係を持たせたもの
+        std::unique_ptr<TaskGraph> graph_;
+        
+        //! ノード間で受け渡すバッファの精度に合わせて、 use_double_precision_ に応じたどちらか一方だけを使用する
+        LatencyDelays<AudioSample> delays_;
+        LatencyDelays<double> delays64_;
+        //! グラフ全体のレイテンシー
+        SampleCount latency_ = 0;
+        
+        template<class T>
+        LatencyDelays<T> & GetDelays()
+        {
+            if constexpr(std::is_same_v<T, double>) { return delays64_; }
+            else { return delays_; }
+        }
+    };
+    
+    //! chain_ の内容をPlaybackStateとして、オーディオスレッドにロックなしで公開する。
+    /*! 差し替え前のPlaybackStateは、オーディオスレッドから参照されなくなるまで待機してから、
+     *  このメンバ関数を呼び出したスレッドで解放される。
+     *  ノードの挿入や並べ替え、接続の変更はここで作成したコピーに対して行われるので、
+     *  オーディオスレッドではメモリの確保もロックも行わない。
+     */
+    void PublishPlaybackState()
+    {
+        std::shared_ptr<PlaybackState> new_state;
+        if(chain_.empty() == false) {
+            new_state = std::make_shared<PlaybackState>();
+            new_state->nodes_ = chain_;
+            
+            auto const num_nodes = chain_.size();
+            std::vector<bool> has_consumer(num_nodes);
+            new_state->inputs_.resize(num_nodes);
+            new_state->graph_ = std::make_unique<TaskGraph>(num_nodes);
+            
+            for(UInt32 i = 0; i < num_nodes; ++i) {
+                auto &inputs = new_state->inputs_[i];
+                auto found = explicit_inputs_.find(chain_[i].get());
+                if(found == explicit_inputs_.end()) {
+                    if(i > 0) { inputs.push_back(i - 1); }
+                } else {
+                    // チェインで前にあるノードだけを入力にできる。（並べ替えで後ろになったものは無視する）
+                    for(auto input: found->second) {
+                        auto const index = GetNodeIndex(input);
+                        if(index < i) { inputs.push_back(index); }
+                    }
+                }
+                
+                for(auto input: inputs) {
+                    has_consumer[input] = true;
+                    new_state->graph_->AddDependency(input, i);
+                }
+            }
+            
+            for(UInt32 i = 0; i < num_nodes; ++i) {
+                if(has_consumer[i] == false) { new_state->sinks_.push_back(i); }
+            }
+            
+            [[maybe_unused]] bool const built = new_state->graph_->Build();
+            assert(built);
+            
+            CompensateLatencies(*new_state);
+            AssignRemotePluginResponseTimes(*new_state);
+        }
+        
+        auto const latency = (new_state ? new_state->latency_ : 0);
+        playback_state_.Exchange(std::move(new_state));
+        
+        if(graph_latency_.exchange(latency) != latency) {
+            pocls_.Invoke([](auto *li) { li->OnLatencyChanged(); });
+        }
+    }
+    
+    //! 別プロセスのプラグインが応答を待つ時間を決める。
+    /*! 直列につながった別プロセスのプラグインが、それぞれブロックの長さいっぱいまで待つと
+     *  オーディオコールバックが間に合わなくなる。
+     *  kRemotePluginResponseTimeRatio の時間を、最も多くの別プロセスのプラグインを通る経路のノード数で分け合う。
+     *  （並列の経路のノードは別々のスレッドで同時に処理されるので、同じ時間を使ってよい）
+     */
+    void AssignRemotePluginResponseTimes(PlaybackState const &state) const
+    {
+        auto const num_nodes = state.nodes_.size();
+        std::vector<UInt32> num_remotes_on_path(num_nodes);
+        UInt32 max_num_remotes = 0;
+        for(UInt32 i = 0; i < num_nodes; ++i) {
+            UInt32 n = 0;
+            for(auto input: state.inputs_[i]) { n = std::max(n, num_remotes_on_path[input]); }
+            if(state.nodes_[i]->GetRemotePlugin()) { n += 1; }
+            num_remotes_on_path[i] = n;
+            max_num_remotes = std::max(max_num_remotes, n);
+        }
+        
+        if(max_num_remotes == 0) { return; }
+        
+        for(auto const &node: state.nodes_) {
+            if(auto remote = node->GetRemotePlugin()) {
+                remote->SetResponseTimeRatio(kRemotePluginResponseTimeRatio / max_num_remotes);
+            }
+        }
+    }
+    
+    //! 各ノードのプラグインのレイテンシーから、経路ごとの遅延補正用のディレイラインを作成する。
+    /*! inputs_ はチェインで前にあるノードだけを指しているので、先頭から順に計算すればよい。
+     */
+    void CompensateLatencies(PlaybackState &state) const
+    {
+        if(use_double_precision_) { CompensateLatencies(state, state.delays64_); }
+        else { CompensateLatencies(state, state.delays_); }
+    }
+    
+    template<class T>
+    void CompensateLatencies(PlaybackState &state, LatencyDelays<T> &delays) const
+    {
+        auto const num_nodes = state.nodes_.size();
+        auto const num_channels = GetNumChainChannels();
+        
+        //! nodes_[i] の出力が、Appの入力から遅れているサンプル数
+        std::vector<SampleCount> output_latencies(num_nodes);
+        delays.input_delays_.resize(num_nodes);
+        delays.bypass_delays_.resize(num_nodes);
+        
+        for(UInt32 i = 0; i < num_nodes; ++i) {
+            auto const &inputs = state.inputs_[i];
+            
+            SampleCount input_latency = 0;
+            for(auto input: inputs) {
+                input_latency = std::max(input_latency, output_latencies[input]);
+            }
+            
+            // 入力がひとつだけの場合は、そのまま入力バッファとして参照するので補正しない
+            if(inputs.size() > 1) {
+                for(auto input: inputs) {
+                    delays.input_delays_[i].emplace_back(num_channels, input_latency - output_latencies[input]);
+                }
+            }
+            
+            SampleCount const plugin_latency = state.nodes_[i]->GetLatencySamples();
+            delays.bypass_delays_[i].Reset(num_channels, plugin_latency);
+            output_latencies[i] = input_latency + plugin_latency;
+        }
+        
+        for(auto sink: state.sinks_) {
+            state.latency_ = std::max(state.latency_, output_latencies[sink]);
+        }
+        for(auto sink: state.sinks_) {
+            delays.sink_delays_.emplace_back(num_channels, state.latency_ - output_latencies[sink]);
+        }
+        delays.dry_delay_.Reset(num_channels, state.latency_);
+    }
+    
+    void OnRestartComponent(Vst3Plugin *plugin, Steinberg::int32 flags) override
+    {
+        // プラグインのレイテンシーは Vst3Plugin 側で取得し直されているので、遅延補正をやり直す
+        if((flags & Steinberg::Vst::RestartFlags::kLatencyChanged)) {
+            if(wxThread::IsMain() == false) {
+                // PublishPlaybackState() は待機するので、オーディオスレッドなどから通知された場合はGUIスレッドで処理する
+                wxTheApp->CallAfter([this] { PublishPlaybackState(); });
+                return;
+            }
+            HWM_INFO_LOG(L"Latency changed [" << plugin->GetPluginName() << L"]: " << plugin->GetLatencySamples() << L" samples");
+            PublishPlaybackState();
+        }
+    }
+    
+    //! プラグインチェインのノード間で受け渡すバッファのチャンネル数
+    UInt32 GetNumChainChannels() const
+    {
+        return std::max<UInt32>(input_buffer_.channels(), std::max(num_output_channels_, 2));
+    }
+    
+    //! ロードしたプラグインのバスを有効にして、現在の再生設定を適用する
+    bool SetUpPlugin(Vst3Plugin *plugin)
+    {
+        plugin->SetSamplingRate(sample_rate_);
+        plugin->SetBlockSize(block_size_);
+        
+        try {
+            ActivateAllBuses(plugin);
+        } catch(std::exception &e) {
+            HWM_ERROR_LOG(L"Failed to setup Vst3Plugin buses: " << to_wstr(e.what()));
+            return false;
+        }
+        
+        plugin->SetSamplingRate(sample_rate_);
+        plugin->SetBlockSize(block_size_);
+        if(use_double_precision_) {
+            plugin->SetSymbolicSampleSize(Steinberg::Vst::SymbolicSampleSizes::kSample64);
+        }
+        return true;
+    }
+    
+    //! ノードのバッファを確保してプラグインを開始し、プラグインチェインの index 番目に挿入する
+    void InsertNode(UInt32 index, PluginChainNodePtr node)
+    {
+        assert(index <= chain_.size());
+        node->PrepareBuffers(GetNumChainChannels(), block_size_, use_double_precision_);
+        // PluginLoaderでロードしたプラグインは、挿入する前に開始されている。
+        // 別プロセスのプラグインは挿入する前に起動され、開始は CheckRemotePlugins() で確認する
+        if(auto plugin = node->GetPlugin()) {
+            if(plugin->IsResumed() == false) { plugin->Resume(); }
+            plugin->GetVst3PluginListenerService().AddListener(this);
+        }
+        chain_.insert(chain_.begin() + index, std::move(node));
+        PublishPlaybackState();
+    }
+    
+    //! プラグインチェインの index 番目のノードを node に差し替えて、差し替え前のノードのプラグインを停止する。
+    /*! 差し替え前のノードの接続は node に引き継ぐ。
+     *  オーディオスレッドは、差し替えの直前まで差し替え前のノードを処理し続ける。
+     */
+    PluginChainNodePtr ReplaceNode(UInt32 index, PluginChainNodePtr node)
+    {
+        assert(index < chain_.size());
+        auto old_node = chain_[index];
+        
+        node->PrepareBuffers(GetNumChainChannels(), block_size_, use_double_precision_);
+        if(auto plugin = node->GetPlugin()) {
+            if(plugin->IsResumed() == false) { plugin->Resume(); }
+            plugin->GetVst3PluginListenerService().AddListener(this);
+        }
+        chain_[index] = node;
+        
+        auto found = explicit_inputs_.find(old_node.get());
+        if(found != explicit_inputs_.end()) {
+            auto inputs = std::move(found->second);
+            explicit_inputs_.erase(found);
+            explicit_inputs_[node.get()] = std::move(inputs);
+        }
+        for(auto &entry: explicit_inputs_) {
+            std::replace(entry.second.begin(), entry.second.end(),
+                         (PluginChainNode const *)old_node.get(), (PluginChainNode const *)node.get());
+        }
+        
+        // オーディオスレッドが差し替え前のプラグインを参照しなくなるまで待機する。
+        PublishPlaybackState();
+        
+        if(auto plugin = old_node->GetPlugin()) {
+            plugin->GetVst3PluginListenerService().RemoveListener(this);
+            plugin->Suspend();
+        } else {
+            old_node->GetRemotePlugin()->Stop();
+        }
+        return old_node;
+    }
+    
+    //! PluginLoaderのロードの進捗を、GUIスレッドでリスナーに通知する
+    void NotifyPluginLoadProgress(UInt64 id, PluginLoader::Stage stage)
+    {
+        if(id != plugin_load_id_ || !loading_cid_) { return; }
+        plls_.Invoke([cid = *loading_cid_, stage](auto *li) { li->OnPluginLoadProgress(cid, stage); });
+    }
+    
+    //! PluginLoaderでロードするプラグインを設定する。ロードの完了時に確認するために、設定した値を記録する
+    bool SetUpLoadingPlugin(Vst3Plugin *plugin)
+    {
+        loading_sample_rate_ = sample_rate_;
+        loading_block_size_ = block_size_;
+        return SetUpPlugin(plugin);
+    }
+    
+    //! PluginLoaderでロードが完了したプラグインを、ロード済みのプラグインと差し替える。GUIスレッドから呼び出す
+    void FinishPluginLoad(UInt64 id)
+    {
+        auto result = plugin_loader_->TakeResult(id);
+        if(!result || !loading_cid_) { return; }
+        
+        auto const cid = *loading_cid_;
+        loading_cid_.reset();
+        auto notify_failure = [&](String const &error_msg) {
+            HWM_ERROR_LOG(L"Failed to load Vst3Plugin: " << error_msg);
+            pending_editor_type_.reset();
+            plls_.Invoke([&](auto *li) { li->OnPluginLoadFailed(cid, error_msg); });
+        };
+        
+        if(!result->task_) {
+            notify_failure(result->error_msg_);
+            return;
+        }
+        
+        // LoadVst3PluginAsync() では Vst3PluginLoadTask だけを使用する
+        auto *task = static_cast<Vst3PluginLoadTask *>(result->task_.get());
+        auto factory = task->GetFactory();
+        auto plugin = task->ReleasePlugin();
+        auto discard = [&plugin] {
+            plugin->Suspend();
+            plugin.reset();
+        };
+        
+        if(factory != factory_) {
+            // ロード中にモジュールが差し替えられた
+            discard();
+            return;
+        }
+        
+        if(!main_node_ && chain_.size() >= kMaxNumChainedPlugins) {
+            discard();
+            notify_failure(L"the plugin chain is full.");
+            return;
+        }
+        
+        // ロード中にデバイスの設定が変わった場合は、現在の設定で開始し直す
+        if(loading_sample_rate_ != sample_rate_ || loading_block_size_ != block_size_) {
+            try {
+                plugin->Suspend();
+                plugin->SetSamplingRate(sample_rate_);
+                plugin->SetBlockSize(block_size_);
+                plugin->Resume();
+            } catch(std::exception &e) {
+                discard();
+                notify_failure(to_wstr(e.what()));
+                return;
+            }
+        }
+        
+        auto node = std::make_shared<PluginChainNode>(std::move(factory), std::move(plugin));
+        if(main_node_) {
+            auto *old_plugin = main_node_->GetPlugin();
+            plls_.Invoke([old_plugin](auto *li) { li->OnBeforePluginUnloaded(old_plugin); });
+            ClearPluginStates();
+            
+            auto const index = GetNodeIndex(main_node_.get());
+            main_node_ = node;
+            // 差し替え前のプラグインは、ここで停止・解放される。
+            ReplaceNode(index, std::move(node));
+        } else {
+            main_node_ = node;
+            InsertNode(0, std::move(node));
+        }
+        
+        plls_.Invoke([plugin = main_node_->GetPlugin()](auto *li) { li->OnAfterPluginLoaded(plugin); });
+        
+        if(pending_editor_type_) {
+            auto const editor_type = *pending_editor_type_;
+            pending_editor_type_.reset();
+            
+            auto frame = IMainFrame::GetInstance();
+            wxCommandEvent ev(wxEVT_COMMAND_MENU_SELECTED);
+            ev.SetId(IMainFrame::kID_View_PluginEditor);
+            ev.SetEventObject(frame);
+            frame->ProcessWindowEvent(ev);
+            
+            auto editor = IPluginEditorFrame::GetInstance();
+            editor->SetViewType(editor_type);
+        }
+    }
+    
+    //! プラグインチェインの index 番目のノードを取り除いて、プラグインを停止する
+    PluginChainNodePtr RemoveNode(UInt32 index)
+    {
+        assert(index < chain_.size());
+        auto node = chain_[index];
+        chain_.erase(chain_.begin() + index);
+        
+        explicit_inputs_.erase(node.get());
+        for(auto &entry: explicit_inputs_) {
+            auto &inputs = entry.second;
+            inputs.erase(std::remove(inputs.begin(), inputs.end(), node.get()), inputs.end());
+        }
+        
+        // オーディオスレッドがプラグインを参照しなくなるまで待機する。
+        PublishPlaybackState();
+        
+        // プラグインはオーディオスレッドではなく、ここで停止される。
+        if(auto plugin = node->GetPlugin()) {
+            plugin->GetVst3PluginListenerService().RemoveListener(this);
+            plugin->Suspend();
+        } else {
+            node->GetRemotePlugin()->Stop();
+        }
+        return node;
+    }
+    
+    UInt32 GetNodeIndex(PluginChainNode const *node) const
+    {
+        auto found = std::find_if(chain_.begin(), chain_.end(), [node](auto const &x) { return x.get() == node; });
+        assert(found != chain_.end());
+        return found - chain_.begin();
+    }
+    
+    //! メインのプラグインの状態を plugin_states_ に保存する。GUIスレッドから呼び出す
+    StateSnapshotStore::SnapshotID CapturePluginState(String name)
+    {
+        auto plugin = (main_node_ ? main_node_->GetPlugin() : nullptr);
+        if(!plugin) { return 0; }
+        
+        auto dump = plugin->SaveData();
+        if(!dump) { return 0; }
+        
+        return plugin_states_.Add(std::move(name),
+                                  ArrayRef<char const>(dump->processor_data_),
+                                  ArrayRef<char const>(dump->edit_controller_data_));
+    }
+    
+    //! UndoPluginStateChange() で戻すための、変更する前の状態
+    /*! RedoPluginStateChange() でやり直すための、Undoで戻す前の状態にも使用する。
+     */
+    struct PluginStateUndo
+    {
+        StateSnapshotStore::SnapshotID id_ = 0;
+        //! 変更する前に選択していたA/B比較のスロット
+        UInt32 slot_ = 0;
+    };
+    
+    //! スナップショットを復元するためのストリームを、別スレッドで準備し始める
+    void PreparePluginState(StateSnapshotStore::SnapshotID id)
+    {
+        PruneRetiredPluginStates();
+        if(prepared_plugin_states_.count(id)) { return; }
+        
+        auto found = plugin_states_.Get(id);
+        if(!found) { return; }
+        
+        // スナップショットのデータは変更されないので、別スレッドから参照できる
+        prepared_plugin_states_[id] = std::async(std::launch::async, [snapshot = std::move(*found)] {
+            return Vst3Plugin::PrepareData(Vst3Plugin::DumpDataRef(ArrayRef<char const>(snapshot.processor_data_->data_),
+                                                                   ArrayRef<char const>(snapshot.edit_controller_data_->data_)));
+        }).share();
+        
+        // 次に復元する可能性のないストリームは破棄する
+        auto const undo_id = plugin_state_undo_stack_.empty() ? 0 : plugin_state_undo_stack_.back().id_;
+        auto const redo_id = plugin_state_redo_stack_.empty() ? 0 : plugin_state_redo_stack_.back().id_;
+        for(auto it = prepared_plugin_states_.begin(); it != prepared_plugin_states_.end(); ) {
+            auto const key = it->first;
+            bool const is_used = (key == undo_id
+                                  || key == redo_id
+                                  || key == plugin_state_slots_[0]
+                                  || key == plugin_state_slots_[1]);
+            if(is_used) {
+                ++it;
+            } else {
+                RetirePreparedPluginState(std::move(it->second));
+                it = prepared_plugin_states_.erase(it);
+            }
+        }
+    }
+    
+    //! 不要になった準備中のストリームを、準備が終わるまで保持する。
+    /*! std::async() で作成した shared_future は、最後の参照を破棄するときに処理の完了を待機するので、
+     *  そのまま破棄すると、大きな状態のコピーが終わるまでGUIスレッドがブロックされる。
+     *  アプリケーションの終了時に準備が終わっていないものだけは、終了処理の中で完了を待機する。
+     */
+    void RetirePreparedPluginState(std::shared_future<std::shared_ptr<Vst3Plugin::PreparedDumpData const>> future)
+    {
+        if(future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) { return; }
+        retired_plugin_states_.push_back(std::move(future));
+    }
+    
+    //! 準備が終わったものを retired_plugin_states_ から破棄する。待機はしない
+    void PruneRetiredPluginStates()
+    {
+        auto &list = retired_plugin_states_;
+        list.erase(std::remove_if(list.begin(), list.end(), [](auto const &future) {
+            return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }), list.end());
+    }
+    
+    //! スナップショットがUndo/Redoでも、A/B比較のスロットでも使用されていなければ、削除する
+    void RemovePluginStateIfUnused(StateSnapshotStore::SnapshotID id)
+    {
+        if(id == plugin_state_slots_[0] || id == plugin_state_slots_[1]) { return; }
+        
+        auto const is_referenced = [id](auto const &stack) {
+            return std::any_of(stack.begin(), stack.end(), [id](auto const &entry) { return entry.id_ == id; });
+        };
+        if(is_referenced(plugin_state_undo_stack_) || is_referenced(plugin_state_redo_stack_)) { return; }
+        
+        plugin_states_.Remove(id);
+    }
+    
+    //! スナップショットの状態をメインのプラグインに復元する。GUIスレッドから呼び出す
+    bool LoadPluginState(StateSnapshotStore::SnapshotID id)
+    {
+        auto plugin = (main_node_ ? main_node_->GetPlugin() : nullptr);
+        if(!plugin) { return false; }
+        
+        std::shared_ptr<Vst3Plugin::PreparedDumpData const> prepared;
+        
+        auto found = prepared_plugin_states_.find(id);
+        if(found != prepared_plugin_states_.end()) {
+            // 準備が終わっていない場合は、残りのコピーが終わるまで待機する
+            prepared = found->second.get();
+        } else {
+            auto snapshot = plugin_states_.Get(id);
+            if(!snapshot) { return false; }
+            prepared = Vst3Plugin::PrepareData(Vst3Plugin::DumpDataRef(ArrayRef<char const>(snapshot->processor_data_->data_),
+                                                                       ArrayRef<char const>(snapshot->edit_controller_data_->data_)));
+        }
+        
+        plugin->LoadData(*prepared);
+        return true;
+    }
+    
+    //! 変更する前の状態として CapturePluginState() で保存したスナップショットを、Undoで戻せるようにする
+    void PushPluginStateUndo(StateSnapshotStore::SnapshotID id)
+    {
+        PushPluginStateHistory(plugin_state_undo_stack_, id);
+    }
+    
+    //! Undoで戻す前の状態として CapturePluginState() で保存したスナップショットを、Redoでやり直せるようにする
+    void PushPluginStateRedo(StateSnapshotStore::SnapshotID id)
+    {
+        PushPluginStateHistory(plugin_state_redo_stack_, id);
+    }
+    
+    //! 上限を超えた古いものは、スナップショットごと破棄する
+    void PushPluginStateHistory(std::vector<PluginStateUndo> &stack, StateSnapshotStore::SnapshotID id)
+    {
+        stack.push_back({ id, active_plugin_state_slot_ });
+        if(stack.size() > kMaxNumPluginStateUndos) {
+            auto const oldest = stack.front().id_;
+            stack.erase(stack.begin());
+            RemovePluginStateIfUnused(oldest);
+        }
+        
+        PreparePluginState(id);
+    }
+    
+    //! 新しく状態を変更したときに、やり直せる状態を破棄する
+    void ClearPluginStateRedo()
+    {
+        auto redo_stack = std::move(plugin_state_redo_stack_);
+        plugin_state_redo_stack_.clear();
+        for(auto const &entry: redo_stack) { RemovePluginStateIfUnused(entry.id_); }
+    }
+    
+    //! プラグインを差し替えたときに、前のプラグインの状態を破棄する
+    void ClearPluginStates()
+    {
+        for(auto &entry: prepared_plugin_states_) { RetirePreparedPluginState(std::move(entry.second)); }
+        prepared_plugin_states_.clear();
+        PruneRetiredPluginStates();
+        plugin_state_undo_stack_.clear();
+        plugin_state_redo_stack_.clear();
+        plugin_state_slots_ = {};
+        active_plugin_state_slot_ = 0;
+        plugin_states_.Clear();
+    }
+    
+    //! ProjectSaverの書き出しの進捗を、GUIスレッドでリスナーに通知する
+    void NotifyProjectSaveProgress(String const &path, ProjectSaver::Stage stage)
+    {
+        psvls_.Invoke([&](auto *li) { li->OnProjectSaveProgress(path, stage); });
+    }
+    
+    //! ProjectSaverの書き出しの結果を、GUIスレッドでリスナーに通知する
+    void NotifyProjectSaveFinished(ProjectSaver::Result const &result)
+    {
+        if(result.succeeded_) {
+            HWM_INFO_LOG(L"Saved the project file: " << result.path_);
+            psvls_.Invoke([&](auto *li) { li->OnProjectSaved(result.path_); });
+        } else {
+            psvls_.Invoke([&](auto *li) { li->OnProjectSaveFailed(result.path_, result.error_msg_); });
+        }
+    }
+    
+    //! 別プロセスのプラグインを監視して、開始されたものを有効にし、クラッシュしたものを起動し直す。GUIスレッドから定期的に呼び出す
+    /*! 別プロセスのプラグインはGUIスレッドをブロックせずに起動するので、開始はここで確認する。
+     *  開始されたときや、プラグインホストプロセスからレイテンシーの変更が報告されたときは、遅延補正をやり直す。
+     */
+    void CheckRemotePlugins()
+    {
+        bool started = false;
+        std::vector<UInt32> latencies;
+        for(auto const &node: chain_) {
+            if(auto remote = node->GetRemotePlugin()) {
+                started |= remote->Update();
+                latencies.push_back(remote->GetLatencySamples());
+            }
+        }
+        
+        if(started || latencies != remote_latencies_) {
+            remote_latencies_ = std::move(latencies);
+            PublishPlaybackState();
+        }
+    }
     
     ListenerService<IModuleLoadListener> mlls_;
     ListenerService<IPluginLoadListener> plls_;
     ListenerService<IPlaybackOptionChangeListener> pocls_;
+    ListenerService<IPluginScanListener> psls_;
+    ListenerService<IProjectSaveListener> psvls_;
+    //! プラグインモジュールをバックグラウンドでスキャンする。GUIを使用するときだけ作成する
+    std::unique_ptr<PluginScanner> plugin_scanner_;
     TestSynth test_synth_;
     IAboutDialog *about_dialog_ = nullptr;
+    //! 有効な場合は、オーディオデバイスとGUIを使用せずにオフラインレンダリングを行って終了する
+    std::optional<OfflineRenderOptions> offline_render_options_;
+    //! 有効な場合は、コンフィグファイルの設定に関わらずヌルデバイスを使用する
+    std::optional<AudioDeviceManager::NullDeviceMode> null_device_mode_;
+    //! サウンドカードをノンインターリーブのバッファでオープンするかどうか
+    bool use_non_interleaved_stream_ = false;
+    //! 倍精度での処理に対応したプラグインを、倍精度で処理するかどうか。
+    /*! 有効な場合は、プラグインのグラフのノード間も倍精度のバッファで受け渡し、
+     *  単精度への変換はデバイスの出力に書き込むときにだけ行う。
+     */
+    bool use_double_precision_ = false;
+    //! 起動時にプラグインチェインへ挿入するモジュールファイル(*.vst3)のパス。
+    //! 先頭が'+'のものは、Appの入力から分岐する新しい経路の先頭に挿入する
+    std::vector<String> insert_module_paths_;
+    //! プラグインのグラフを並列に処理するワーカースレッドの数。無効な場合はCPUのコア数から決める
+    std::optional<UInt32> num_worker_threads_;
+    //! オーディオスレッドやMIDIのスレッドから、ブロックせずにログを出力するためのロガー
+    std::unique_ptr<RealtimeLogger> rt_logger_;
+    //! 有効な場合は、GUIを使用せずにプラグインホストプロセスとして動作する。親プロセスが作成した共有メモリの名前
+    std::optional<String> plugin_host_shared_memory_name_;
+    //! 有効な場合は、GUIを使用せずにプラグインスキャンプロセスとして動作する。スキャンするモジュールのパス
+    std::optional<String> plugin_scan_module_path_;
+    //! プラグインスキャンプロセスで、スキャン結果を書き出すファイルのパス
+    String plugin_scan_output_path_;
+    //! 起動時にプラグインチェインへ挿入するプラグインを、別プロセスで動作させるかどうか
+    bool isolate_inserts_ = false;
+    //! LoadVst3PluginAsync() で、別スレッドでプラグインをロードする。GUIを使用するときだけ作成する
+    std::unique_ptr<PluginLoader> plugin_loader_;
+    //! 最後に開始したロードのIDと、ロード中のプラグインのcid
+    UInt64 plugin_load_id_ = 0;
+    std::optional<ClassInfo::CID> loading_cid_;
+    //! ロード中のプラグインの設定に使用した値
+    double loading_sample_rate_ = 0;
+    int loading_block_size_ = 0;
+    //! LoadProjectFile() で、ロードの完了後に開くエディタの種類
+    std::optional<PluginViewType> pending_editor_type_;
+    //! メインのプラグインの状態のスナップショット。A/B比較とUndoに使用する
+    StateSnapshotStore plugin_states_ { kPluginStateStoreCapacity };
+    //! UndoPluginStateChange() で戻すための状態。末尾が最新
+    std::vector<PluginStateUndo> plugin_state_undo_stack_;
+    //! 末尾が最新。新しく状態を変更したときに破棄する
+    std::vector<PluginStateUndo> plugin_state_redo_stack_;
+    //! A/B比較の各スロットの状態。0はまだ保存していないことを表す
+    std::array<StateSnapshotStore::SnapshotID, 2> plugin_state_slots_ = {};
+    UInt32 active_plugin_state_slot_ = 0;
+    //! 次に復元する可能性の高いスナップショットについて、別スレッドで準備している復元用のストリーム
+    std::map<StateSnapshotStore::SnapshotID,
+             std::shared_future<std::shared_ptr<Vst3Plugin::PreparedDumpData const>>> prepared_plugin_states_;
+    //! 破棄したが、まだ準備が終わっていないストリーム。 RetirePreparedPluginState() を参照
+    std::vector<std::shared_future<std::shared_ptr<Vst3Plugin::PreparedDumpData const>>> retired_plugin_states_;
+    //! SaveProjectFile() で、別スレッドでプロジェクトファイルを書き出す。GUIを使用するときだけ作成する
+    std::unique_ptr<ProjectSaver> project_saver_;
+    //! 有効な場合は、この間隔（秒）でプロジェクトを自動保存する
+    std::optional<UInt32> autosave_interval_sec_;
+    //! Autosave() を呼び出すタイマー
+    wxTimer autosave_timer_;
+    //! CheckRemotePlugins() を呼び出すタイマー
+    wxTimer remote_plugin_watchdog_;
+    //! 前回の CheckRemotePlugins() で取得した、別プロセスのプラグインのレイテンシー
+    std::vector<UInt32> remote_latencies_;
     
     class Result {
     public:
@@ -257,9 +987,21 @@ struct App::Impl
         
         // App内部では、モノラル入力も必ずステレオにして扱う
         input_buffer_.resize(std::max(num_input_channels, 2), max_block_size);
-        output_buffer_.resize(std::max(num_output_channels, 2), max_block_size);
-        level_meters_.resize(num_output_channels_, kAudioOutputLevelMinDB);
-        level_meters_tmp_.resize(num_output_channels_, kAudioOutputLevelMinDB);
+        if(use_double_precision_) {
+            input_buffer64_.resize(input_buffer_.channels(), max_block_size);
+            output_buffer64_.resize(GetNumChainChannels(), max_block_size);
+            output_buffer_.resize(0, 0);
+        } else {
+            input_buffer64_.resize(0, 0);
+            output_buffer64_.resize(0, 0);
+            output_buffer_.resize(GetNumChainChannels(), max_block_size);
+        }
+        level_meter_.Reset(num_output_channels_, sample_rate);
+        {
+            // オーディオスレッドはまだ動いていないので、GUIスレッドの読み込みだけを排除すればよい
+            auto lock = level_meter_lf_.make_lock();
+            level_meter_buffer_.ForEachBuffer([this](auto &buf) { buf = level_meter_.GetValues(); });
+        }
         
         output_level_ = TransitionalVolume(sample_rate_,
                                            kAudioOutputLevelTransientMillisec,
@@ -267,16 +1009,29 @@ struct App::Impl
                                            kAudioOutputLevelMaxDB);
         output_level_.set_target_db_immediately(-10.0);
 
-        if(plugin_) {
-            plugin_->SetSamplingRate(sample_rate_);
-            plugin_->SetBlockSize(block_size_);
-            plugin_->Resume();
+        // ノード間のバッファはここで確保し、オーディオスレッドでは確保しない
+        for(auto const &node: chain_) {
+            if(auto plugin = node->GetPlugin()) {
+                plugin->SetSamplingRate(sample_rate_);
+                plugin->SetBlockSize(block_size_);
+                node->PrepareBuffers(GetNumChainChannels(), block_size_, use_double_precision_);
+                plugin->Resume();
+            } else {
+                // プラグインホストプロセスを新しい設定で起動し直す。開始は CheckRemotePlugins() で確認し、それまでは無音を出力する
+                node->PrepareBuffers(GetNumChainChannels(), block_size_, use_double_precision_);
+                node->GetRemotePlugin()->Start(sample_rate_, block_size_, GetNumChainChannels(), use_double_precision_);
+            }
         }
         
+        // チャンネル数やプラグインのレイテンシーが変わっている可能性があるので、ディレイラインを作り直す。
+        // （まだオーディオスレッドは動いていないので、ここで待機することはない）
+        PublishPlaybackState();
+        
         test_synth_.SetSampleRate(sample_rate);
+        midi_scheduler_.Reset(sample_rate, max_block_size);
     }
     
-    void ProcessMidiEvents(SampleCount block_size)
+    void ProcessMidiEvents(SampleCount block_size, AudioDeviceTimeInfo const &time_info)
     {
         assert(input_event_buffers_.GetNumBuffers() >= 1);
         auto &buf0 = *input_event_buffers_.GetBuffer(0);
@@ -293,16 +1048,25 @@ struct App::Impl
             buf0.AddEvent(msg);
         }
         
-        auto mdm = MidiDeviceManager::GetInstance();
-        double const now = mdm->GetMessages(device_midi_messages_);
-        
-        double const frame_begin_sec = now - (block_size / sample_rate_);
-        for(auto const &dev_msg: device_midi_messages_) {
+        auto add_device_message = [&buf0](DeviceMidiMessage const &dev_msg, SampleCount offset) {
             ProcessInfo::MidiMessage msg;
             msg.data_ = dev_msg.data_;
-            msg.offset_ = std::round(dev_msg.time_stamp_ - frame_begin_sec) * sample_rate_;
+            msg.offset_ = offset;
+            msg.channel_ = dev_msg.channel_;
             buf0.AddEvent(msg);
-        }
+        };
+        
+        // 受信した時刻から一定のレイテンシーだけ遅らせた位置に配置して、ブロック単位の揺れを取り除く
+        midi_scheduler_.BeginBlock(time_info, block_size);
+        midi_scheduler_.PopEvents(add_device_message);
+        
+        // MIDIデバイスのリングバッファから、コピーせずにイベントバッファへ書き込む
+        auto mdm = MidiDeviceManager::GetInstance();
+        mdm->DrainMessages([&](ArrayRef<DeviceMidiMessage const> ms) {
+            for(auto const &dev_msg: ms) {
+                midi_scheduler_.Schedule(dev_msg, add_device_message);
+            }
+        });
         buf0.Sort();
         
         // playing_変数の更新はここでのみ行う。
@@ -318,69 +1082,206 @@ struct App::Impl
         }
     }
     
-    void ProcessPlugin(SampleCount block_size, AudioSample **output)
+    //! src の内容をデバイスの出力バッファに書き込む。 src が倍精度の場合は、ここで単精度に変換する
+    template<class T>
+    void WriteToDevice(Buffer<T> const &src, SampleCount block_size, AudioSample **output)
     {
-        ProcessInfo pi;
-        
-        pi.input_audio_buffer_ = BufferRef<AudioSample const>(input_buffer_, 0, input_buffer_.channels(), 0, block_size);
-        pi.output_audio_buffer_ = BufferRef<AudioSample>(output_buffer_, 0, output_buffer_.channels(), 0, block_size);
-        pi.time_info_.is_playing_ = true;
-        pi.time_info_.sample_length_ = block_size;
-        pi.time_info_.sample_rate_ = sample_rate_;
-        pi.time_info_.sample_pos_ = continuous_sample_count_;
-        pi.time_info_.ppq_pos_ = (continuous_sample_count_ / sample_rate_) * pi.time_info_.tempo_ / 60.0;
-        continuous_sample_count_ += block_size;
-        
-        pi.input_event_buffers_ = &input_event_buffers_;
-        pi.output_event_buffers_ = &output_event_buffers_;
-        
-        plugin_->Process(pi);
-        
-        int const num_po = plugin_->GetNumAudioOutputs();
-        if(num_po >= 2 && num_output_channels_ == 1) {
+        if(num_output_channels_ == 1) {
             // mixdown stereo channels to mono
-            auto const srcL = output_buffer_.data()[0];
-            auto const srcR = output_buffer_.data()[1];
+            auto const srcL = src.data()[0];
+            auto const srcR = src.data()[1];
             auto dest = output[0];
             for(int smp = 0; smp < block_size; ++smp) {
                 dest[smp] += (srcL[smp] + srcR[smp]) / 2.0;
             }
-        } else if(num_po == 1 && num_output_channels_ >= 2) {
-            // spread mono channel to stereo
-            auto const src = output_buffer_.data()[0];
-            auto destL = output[0];
-            auto destR = output[1];
-            for(int smp = 0; smp < block_size; ++smp) {
-                destL[smp] = src[smp];
-                destR[smp] = src[smp];
-            }
         } else {
-            auto const num_channels_to_copy = std::min(num_po, num_output_channels_);
+            auto const num_channels_to_copy = std::min<int>(src.channels(), num_output_channels_);
             for(int ch = 0; ch < num_channels_to_copy; ++ch) {
-                auto const src = output_buffer_.data()[ch];
-                auto dest = output[ch];
-                for(int smp = 0; smp < block_size; ++smp) {
-                    dest[smp] = src[smp];
-                }
+                std::copy_n(src.data()[ch], block_size, output[ch]);
             }
         }
+    }
+    
+    //! Process() の間だけ有効な、ノードの処理に使う値。
+    //! worker_pool_->Run() の前に書き込み、タスクの実行中は読み込みだけを行う
+    struct GraphContext
+    {
+        //! ディレイラインの状態を更新するので const にはしない。（各ディレイラインは1つのタスクからだけ使う）
+        PlaybackState *state_ = nullptr;
+        ProcessInfo::TimeInfo time_info_;
+        SampleCount block_size_ = 0;
+        //! デバイスの出力バッファ
+        AudioSample **output_ = nullptr;
+        //! 出力を output_ に直接書き込むノードのインデックス。該当するノードがない場合は kNoNode
+        UInt32 direct_output_node_ = kNoNode;
         
-        input_event_buffers_.Clear();
-        output_event_buffers_.Clear();
+        static constexpr UInt32 kNoNode = (UInt32)-1;
+    };
+    GraphContext graph_context_;
+    //! 直前のブロックで入力モニターが有効だったかどうか
+    bool was_monitoring_input_ = false;
+    
+    //! グラフに渡すAppの入力。 T は、ノード間で受け渡すバッファの精度
+    template<class T>
+    Buffer<T> & GetGraphInputBuffer()
+    {
+        if constexpr(std::is_same_v<T, double>) { return input_buffer64_; }
+        else { return input_buffer_; }
+    }
+    
+    //! 複数のsinkの出力を合成するバッファ。 T は、ノード間で受け渡すバッファの精度
+    template<class T>
+    Buffer<T> & GetGraphOutputBuffer()
+    {
+        if constexpr(std::is_same_v<T, double>) { return output_buffer64_; }
+        else { return output_buffer_; }
+    }
+    
+    //! nodes_[index] のノードを処理する。
+    /*! 入力となるノードの処理はすでに完了している。
+     *  入力が複数ある場合は、それらの出力とイベントを合成してから処理する。
+     *  @tparam T ノード間で受け渡すバッファの精度
+     */
+    template<class T>
+    void ProcessNode(UInt32 index)
+    {
+        auto const &ctx = graph_context_;
+        auto const &nodes = ctx.state_->nodes_;
+        auto const &inputs = ctx.state_->inputs_[index];
+        auto const block_size = ctx.block_size_;
+        auto &delays = ctx.state_->GetDelays<T>();
+        auto &node = *nodes[index];
+        
+        auto &events = node.GetInputEventBuffers();
+        events.Clear();
+        
+        Buffer<T> *src = nullptr;
+        if(inputs.empty()) {
+            src = &GetGraphInputBuffer<T>();
+            events.GetBuffer(0)->AddEvents(input_event_buffers_.GetRef(0));
+        } else if(inputs.size() == 1) {
+            auto &input_node = *nodes[inputs[0]];
+            src = &input_node.GetOutputBuffer<T>();
+            events.GetBuffer(0)->AddEvents(input_node.GetOutputEventBuffers().GetRef(0));
+        } else {
+            src = &node.GetMixBuffer<T>();
+            for(UInt32 ch = 0; ch < src->channels(); ++ch) {
+                std::fill_n(src->data()[ch], block_size, T(0));
+            }
+            auto &input_delays = delays.input_delays_[index];
+            for(UInt32 i = 0; i < inputs.size(); ++i) {
+                auto &input_node = *nodes[inputs[i]];
+                auto &buf = input_node.GetOutputBuffer<T>();
+                // 経路ごとのレイテンシーの差を揃えてから合成する
+                input_delays[i].ProcessAdd(BufferRef<T const>(buf, 0, src->channels(), 0, block_size),
+                                           BufferRef<T>(*src, 0, src->channels(), 0, block_size));
+                events.GetBuffer(0)->AddEvents(input_node.GetOutputEventBuffers().GetRef(0));
+            }
+            events.Sort();
+        }
+        
+        BufferRef<T const> const input(*src, 0, src->channels(), 0, block_size);
+        auto &bypass_delay = delays.bypass_delays_[index];
+        if constexpr(std::is_same_v<T, AudioSample>) {
+            if(index == ctx.direct_output_node_) {
+                // チャンネル構成の変換が不要な場合は、最後のプラグインからデバイスの出力バッファに直接書き込ませる
+                node.Process(ctx.time_info_, input, BufferRef<AudioSample>(ctx.output_, 0, num_output_channels_, 0, block_size), bypass_delay);
+                return;
+            }
+        }
+        
+        auto &buf = node.GetOutputBuffer<T>();
+        node.Process(ctx.time_info_, input, BufferRef<T>(buf, 0, buf.channels(), 0, block_size), bypass_delay);
+    }
+    
+    //! プラグインのグラフを処理して、デバイスの出力バッファに書き込む
+    /*! 依存関係のないノードは worker_pool_ のスレッドで並列に処理する。
+     *  直列につながったノードだけの場合は、ワーカースレッドを起こさずにこのスレッドで処理する。
+     *  @tparam T ノード間で受け渡すバッファの精度。倍精度の場合は、デバイスの出力に書き込むときにだけ単精度に変換する
+     */
+    template<class T>
+    void ProcessGraph(PlaybackState &state, SampleCount block_size, AudioSample **output)
+    {
+        auto &ctx = graph_context_;
+        ctx.state_ = &state;
+        ctx.block_size_ = block_size;
+        
+        auto &ti = ctx.time_info_;
+        ti = ProcessInfo::TimeInfo{};
+        ti.is_playing_ = true;
+        ti.sample_length_ = block_size;
+        ti.sample_rate_ = sample_rate_;
+        ti.sample_pos_ = continuous_sample_count_;
+        ti.ppq_pos_ = (continuous_sample_count_ / sample_rate_) * ti.tempo_ / 60.0;
+        
+        // sinkが1つだけなら、出力を合成する必要はない。（そのノードの出力を読むノードはない）
+        bool const monitors_input = enable_input_monitoring_.load();
+        bool const has_single_sink = (state.sinks_.size() == 1 && !monitors_input);
+        // 単精度の場合は、さらにデバイスに直接書き込む
+        bool const writes_directly = (has_single_sink && num_output_channels_ >= 2 && std::is_same_v<T, AudioSample>);
+        bool const was_monitoring_input = std::exchange(was_monitoring_input_, monitors_input);
+        ctx.output_ = output;
+        ctx.direct_output_node_ = (writes_directly ? state.sinks_[0] : GraphContext::kNoNode);
+        
+        worker_pool_->Run(*state.graph_, [this](UInt32 index) { ProcessNode<T>(index); });
+        
+        continuous_sample_count_ += block_size;
+        
+        if(writes_directly) { return; }
+        
+        if(has_single_sink) {
+            WriteToDevice(state.nodes_[state.sinks_[0]]->GetOutputBuffer<T>(), block_size, output);
+            return;
+        }
+        
+        // 複数のsinkの出力を、レイテンシーを揃えて合成する
+        auto &delays = state.GetDelays<T>();
+        auto &mix = GetGraphOutputBuffer<T>();
+        auto const num_channels = mix.channels();
+        BufferRef<T> dest(mix, 0, num_channels, 0, block_size);
+        dest.fill(0);
+        for(UInt32 i = 0; i < state.sinks_.size(); ++i) {
+            auto &buf = state.nodes_[state.sinks_[i]]->GetOutputBuffer<T>();
+            delays.sink_delays_[i].ProcessAdd(BufferRef<T const>(buf, 0, num_channels, 0, block_size), dest);
+        }
+        
+        if(monitors_input) {
+            if(!was_monitoring_input) {
+                // 入力モニターを再開したときに、以前の信号が出力されないようにする
+                delays.dry_delay_.Clear();
+            }
+            auto &input = GetGraphInputBuffer<T>();
+            auto const num_input_channels = std::min(input.channels(), num_channels);
+            delays.dry_delay_.ProcessAdd(BufferRef<T const>(input, 0, num_input_channels, 0, block_size),
+                                         BufferRef<T>(mix, 0, num_input_channels, 0, block_size));
+        }
+        
+        WriteToDevice(mix, block_size, output);
     }
     
     void Process(SampleCount block_size,
                  float const * const * input,
-                 float **output) override
+                 float **output,
+                 AudioDeviceTimeInfo const &time_info) override
     {
         assert(block_size > 0);
         
-        auto lock = lf_playback_.make_lock();
+        // GUIスレッドでプラグインのロード／アンロードや並べ替えが行われていても、ここではブロックしない。
+        auto state = playback_state_.Read();
         
-        input_buffer_.fill(0.0);
-        output_buffer_.fill(0.0);
+        // Appの入力を受け取るノードに、バイパスされていないインストゥルメントがなければテスト波形を鳴らす
+        bool use_dummy_synth = true;
+        if(state) {
+            for(UInt32 i = 0; i < state->nodes_.size(); ++i) {
+                auto const &node = *state->nodes_[i];
+                if(state->inputs_[i].empty() && node.IsBypassed() == false && node.IsEffect() == false) {
+                    use_dummy_synth = false;
+                    break;
+                }
+            }
+        }
         
-        bool const use_dummy_synth = (!plugin_ || plugin_->GetComponentInfo().IsEffect());
+        input_buffer_.fill(0.0);
 
         if(use_dummy_synth) {
             test_synth_.Process(input_buffer_.data()[0], block_size);
@@ -402,26 +1303,22 @@ struct App::Impl
             }
         }
         
-        ProcessMidiEvents(block_size);
+        ProcessMidiEvents(block_size, time_info);
         
-        if(plugin_) {
-            ProcessPlugin(block_size, output);
-        } else {
-            if(num_output_channels_ == 1) {
-                auto const srcL = input_buffer_.data()[0];
-                auto const srcR = input_buffer_.data()[1];
-                auto dest = output[0];
-                for(int smp = 0; smp < block_size; ++smp) {
-                    dest[smp] += (srcL[smp] + srcR[smp]) / 2.0;
-                }
-            } else {
-                auto const num_channels_to_copy = std::min<int>(input_buffer_.channels(), num_output_channels_);
-                for(int ch = 0; ch < num_channels_to_copy; ++ch) {
-                    std::copy_n(input_buffer_.data()[ch], block_size, output[ch]);
-                }
+        if(state == nullptr) {
+            WriteToDevice(input_buffer_, block_size, output);
+        } else if(use_double_precision_) {
+            // Appの入力は、グラフに渡す前に一度だけ倍精度に変換する
+            for(UInt32 ch = 0; ch < input_buffer64_.channels(); ++ch) {
+                std::copy_n(input_buffer_.data()[ch], block_size, input_buffer64_.data()[ch]);
             }
+            ProcessGraph<double>(*state, block_size, output);
+        } else {
+            ProcessGraph<AudioSample>(*state, block_size, output);
         }
         
+        input_event_buffers_.Clear();
+        
         output_level_.update_transition(block_size);
         double const gain = output_level_.get_current_linear_gain();
         
@@ -430,51 +1327,64 @@ struct App::Impl
             std::for_each_n(ch_data, block_size,
                             [gain](auto &elem) { elem *= gain; }
                             );
-            
-            auto const it = std::max_element(ch_data, ch_data + block_size);
-            auto const new_db = LinearToDB(*it);
-            auto const last = level_meters_tmp_[ch] - (kLevelMeterReleaseSpeed * block_size / sample_rate_);
-            level_meters_tmp_[ch] = std::max(new_db, last);
         }
         
-        {
-            auto lock = lf_level_meter_.make_lock();
-            assert(level_meters_tmp_.size() == level_meters_.size());
-            std::copy(level_meters_tmp_.begin(), level_meters_tmp_.end(), level_meters_.begin());
-        }
+        level_meter_.Process(output, num_output_channels_, block_size);
+        
+        // 値の受け渡しはバッファの交換だけで行い、GUIスレッドとの間でロックはしない。
+        auto &dest = level_meter_buffer_.GetWriteBuffer();
+        auto const &values = level_meter_.GetValues();
+        assert(dest.size() == values.size());
+        std::copy(values.begin(), values.end(), dest.begin());
+        level_meter_buffer_.Publish();
     }
     
     void StopProcessing() override
     {
-        if(plugin_) {
-            plugin_->Suspend();
+        for(auto const &node: chain_) {
+            if(auto plugin = node->GetPlugin()) {
+                plugin->Suspend();
+            } else {
+                node->GetRemotePlugin()->Stop();
+            }
         }
     }
     
-    void GetLevelMeter(std::vector<double> &dest)
+    void GetLevelMeter(std::vector<LevelMeterValue> &dest)
     {
-        auto lock = lf_level_meter_.make_lock();
-        if(dest.size() != level_meters_.size()) {
-            std::fill(dest.begin(), dest.end(), kAudioOutputLevelMinDB);
+        auto lock = level_meter_lf_.make_lock();
+        level_meter_buffer_.Update();
+        auto const &src = level_meter_buffer_.GetReadBuffer();
+        if(dest.size() != src.size()) {
+            LevelMeterValue silent;
+            silent.peak_db_ = silent.rms_db_ = silent.peak_hold_db_ = kAudioOutputLevelMinDB;
+            std::fill(dest.begin(), dest.end(), silent);
         } else {
-            std::copy(level_meters_.begin(), level_meters_.end(), dest.begin());
+            std::copy(src.begin(), src.end(), dest.begin());
         }
     }
 
     Buffer<AudioSample> input_buffer_;
+    //! 複数のノードの出力を合成するバッファ
     Buffer<AudioSample> output_buffer_;
-    
-    LockFactory lf_level_meter_;
-    std::vector<double> level_meters_tmp_;
-    std::vector<double> level_meters_;
+    //! use_double_precision_ が有効な場合に、 input_buffer_ と output_buffer_ の代わりにグラフで使用するバッファ
+    Buffer<double> input_buffer64_;
+    Buffer<double> output_buffer64_;
+    std::unique_ptr<RealtimeWorkerPool> worker_pool_;
+    
+    LevelMeter level_meter_ { kAudioOutputLevelMinDB, kLevelMeterReleaseSpeed, kLevelMeterPeakHoldSeconds };
+    TripleBuffer<std::vector<LevelMeterValue>> level_meter_buffer_;
+    //! StartProcessing() で level_meter_buffer_ を初期化する間、 GetLevelMeter() の読み込みを排除するためのロック。
+    /*! オーディオスレッドからは使用しない。
+     */
+    LockFactory level_meter_lf_;
     int num_input_channels_ = 0;
     int num_output_channels_ = 0;
     int block_size_ = 0;
     int continuous_sample_count_ = 0;
     double sample_rate_ = 0;
-    LockFactory lf_playback_;
+    RcuPointer<PlaybackState> playback_state_;
     EventBufferList input_event_buffers_;
-    EventBufferList output_event_buffers_;
 };
 
 App::App()
@@ -496,6 +1406,15 @@ bool App::OnInit()
     wxInitAllImageHandlers();
     
     auto logger = GetGlobalLogger();
+    
+    if(pimpl_->plugin_host_shared_memory_name_ || pimpl_->plugin_scan_module_path_) {
+        // 親プロセスのログファイルは開かず、GUIも作成しない。OnRun()でリクエストの処理やスキャンを行う
+        logger->SetStrategy(std::make_shared<DebugConsoleLoggingStrategy>());
+        logger->StartLogging(true);
+        pimpl_->factory_list_ = std::make_shared<Vst3PluginFactoryList>();
+        return true;
+    }
+    
     auto st = std::make_shared<FileLoggingStrategy>(GetLogFilePath());
     auto err = st->OpenPermanently();
     if(err) {
@@ -506,12 +1425,27 @@ bool App::OnInit()
     logger->SetStrategy(st);
     logger->StartLogging(true);
     
+    pimpl_->rt_logger_ = std::make_unique<RealtimeLogger>();
+    pimpl_->rt_logger_->Start();
+    
     EnableErrorCheckAssertionForLoggingMacros(true);
     
     HWM_INFO_LOG(L"Start " << kAppName << L" version " << kAppVersion << L" (" << kAppCommitID << L").");
     HWM_INFO_LOG(L"Start logging");
     
     pimpl_->factory_list_ = std::make_shared<Vst3PluginFactoryList>();
+    
+    if(pimpl_->offline_render_options_) {
+        // オーディオデバイスのオープンとメインフレームの作成は行わず、OnRun()でレンダリングする
+        return true;
+    }
+    
+    // オフラインレンダリングでは使用しないので、ここで作成する
+    RealtimeWorkerPool::Options pool_opts;
+    pool_opts.num_workers_ = pimpl_->num_worker_threads_.value_or(std::max<UInt32>(std::thread::hardware_concurrency(), 1) - 1);
+    pool_opts.max_num_tasks_ = kMaxNumChainedPlugins;
+    pimpl_->worker_pool_ = std::make_unique<RealtimeWorkerPool>(pool_opts);
+    HWM_INFO_LOG(L"Worker threads: " << pool_opts.num_workers_);
 
     auto adm = AudioDeviceManager::GetInstance();
     adm->AddCallback(pimpl_.get());
@@ -523,7 +1457,34 @@ bool App::OnInit()
         return false;
     }
 
-    if(OpenAudioDevice(pimpl_->config_) == false) {
+    // 前回のスキャン結果をすぐに使えるようにしてから、変更のあったモジュールをバックグラウンドでスキャンする
+    pimpl_->plugin_loader_ = std::make_unique<PluginLoader>(
+        [this](std::function<void()> f) { CallAfter(std::move(f)); },
+        [this](UInt64 id, PluginLoader::Stage stage) { pimpl_->NotifyPluginLoadProgress(id, stage); },
+        [this](UInt64 id) { pimpl_->FinishPluginLoad(id); });
+    
+    pimpl_->project_saver_ = std::make_unique<ProjectSaver>(
+        [this](UInt64 id, String const &path, ProjectSaver::Stage stage) {
+            // 書き出し用のスレッドから呼ばれるので、GUIスレッドでリスナーに通知する
+            CallAfter([this, path, stage] { pimpl_->NotifyProjectSaveProgress(path, stage); });
+        },
+        [this](ProjectSaver::Result const &result) {
+            CallAfter([this, result] { pimpl_->NotifyProjectSaveFinished(result); });
+        });
+    
+    // モジュールのロードは、GUIスレッドから起動するプラグインスキャンプロセスで行う
+    pimpl_->plugin_scanner_ = std::make_unique<PluginScanner>(
+        [this](std::function<void()> f) { CallAfter(std::move(f)); },
+        StartPluginScanProcess);
+    pimpl_->plugin_scanner_->LoadCache(GetPluginScanCacheFilePath());
+    RescanPlugins();
+
+    adm->SetNonInterleavedStreamEnabled(pimpl_->use_non_interleaved_stream_);
+    
+    if(pimpl_->null_device_mode_) {
+        adm->SetNullDeviceMode(*pimpl_->null_device_mode_);
+        OpenNullAudioDevice(pimpl_->config_);
+    } else if(OpenAudioDevice(pimpl_->config_) == false) {
         // Select Audio Device
         SelectAudioDevice();
     }
@@ -535,10 +1496,47 @@ bool App::OnInit()
     
     pimpl_->midi_ins_ = OpenMidiDevices();
     
+    for(auto path: pimpl_->insert_module_paths_) {
+        bool const starts_branch = (path.front() == L'+');
+        if(starts_branch) { path.erase(0, 1); }
+        
+        auto const index = GetNumChainedPlugins();
+        if(pimpl_->isolate_inserts_) {
+            // このプロセスではモジュールをロードしない
+            if(InsertRemoteVst3Plugin(index, path) && starts_branch) {
+                SetChainedPluginInputs(index, {});
+            }
+            continue;
+        }
+        
+        auto factory = pimpl_->factory_list_->FindOrCreateFactory(path);
+        if(!factory || factory->GetComponentCount() == 0) {
+            HWM_ERROR_LOG(L"no plugin found in the module: " << path);
+            continue;
+        }
+        
+        // モジュール内の最初のプラグインをチェインの末尾に追加する
+        if(InsertVst3Plugin(index, path, factory->GetComponentInfo(0).GetCID()) && starts_branch) {
+            SetChainedPluginInputs(index, {});
+        }
+    }
+    
     if(auto dev = adm->GetDevice()) {
         dev->Start();
     }
     
+    pimpl_->remote_plugin_watchdog_.Bind(wxEVT_TIMER, [this](auto &) { pimpl_->CheckRemotePlugins(); });
+    pimpl_->remote_plugin_watchdog_.Start(500);
+    
+    if(pimpl_->autosave_interval_sec_) {
+        pimpl_->autosave_timer_.Bind(wxEVT_TIMER, [this](auto &) {
+            // ロード中はプラグインの状態がそろっていないので、次の機会に保存する
+            if(IsLoadingPlugin()) { return; }
+            SaveProjectFile(GetAutosaveProjectFilePath());
+        });
+        pimpl_->autosave_timer_.Start(*pimpl_->autosave_interval_sec_ * 1000);
+    }
+    
     pimpl_->frame_ = CreateMainFrame();
     pimpl_->frame_->CentreOnScreen();
     pimpl_->frame_->Layout();
@@ -548,12 +1546,36 @@ bool App::OnInit()
     return true;
 }
 
+int App::OnRun()
+{
+    if(pimpl_->offline_render_options_) {
+        return RenderOffline(*pimpl_->offline_render_options_);
+    }
+    
+    if(pimpl_->plugin_host_shared_memory_name_) {
+        return RunPluginHostProcess(*pimpl_->plugin_host_shared_memory_name_);
+    }
+    
+    if(pimpl_->plugin_scan_module_path_) {
+        return RunPluginScanProcess(*pimpl_->plugin_scan_module_path_, pimpl_->plugin_scan_output_path_);
+    }
+    
+    return wxApp::OnRun();
+}
+
 int App::OnExit()
 {
     if(pimpl_->about_dialog_) {
         pimpl_->about_dialog_->Destroy();
     }
     
+    pimpl_->remote_plugin_watchdog_.Stop();
+    pimpl_->autosave_timer_.Stop();
+    // ロード中のプラグインは、ここで停止・解放される
+    pimpl_->plugin_loader_.reset();
+    // 待機中のプロジェクトファイルの書き出しは、すべて完了するまで待機する
+    pimpl_->project_saver_.reset();
+    
     auto adm = AudioDeviceManager::GetInstance();
     auto mdm = MidiDeviceManager::GetInstance();
     
@@ -563,15 +1585,31 @@ int App::OnExit()
     
     if(auto *dev = adm->GetDevice()) {
         dev->Stop();
+        
+        if(auto tp = dev->GetThroughput()) {
+            HWM_INFO_LOG(L"Audio device throughput: " << tp->num_processed_blocks_ << L" blocks, "
+                         << tp->blocks_per_second_ << L" blocks/sec, x"
+                         << tp->realtime_factor_ << L" realtime");
+        }
+        
+        HWM_INFO_LOG(L"Audio processing load:" << std::endl << GetAudioProcessingLoadReport());
+        
         adm->Close();
     }
     
     adm->RemoveCallback(pimpl_.get());
     
+    while(GetNumChainedPlugins() > 0) {
+        RemoveChainedPlugin(GetNumChainedPlugins() - 1);
+    }
     UnloadVst3Module();
     
+    // スキャンを中断して、スキャンスレッドの終了を待機する
+    pimpl_->plugin_scanner_.reset();
     pimpl_->factory_list_.reset();
     
+    pimpl_->rt_logger_.reset();
+    
     HWM_INFO_LOG(L"End logging");
     
     return 0;
@@ -600,6 +1638,7 @@ void App::UnloadVst3Module()
 {
     if(!pimpl_->factory_) { return; }
     
+    CancelPluginLoad();
     UnloadVst3Plugin(); // 開いているプラグインがあれば閉じる
     
     pimpl_->mlls_.Invoke([factory = pimpl_->factory_.get()](auto *listener) {
@@ -611,8 +1650,13 @@ void App::UnloadVst3Module()
 
 bool App::LoadVst3Plugin(ClassInfo::CID cid)
 {
-    auto factory = GetPluginFactory();
+    auto factory = pimpl_->factory_;
     if(!factory) { return false; }
+    
+    if(!pimpl_->main_node_ && pimpl_->chain_.size() >= kMaxNumChainedPlugins) {
+        HWM_ERROR_LOG(L"Failed to load Vst3Plugin: the plugin chain is full.");
+        return false;
+    }
 
     std::unique_ptr<Vst3Plugin> tmp;
     try {
@@ -623,64 +1667,331 @@ bool App::LoadVst3Plugin(ClassInfo::CID cid)
         return false;
     }
     
+    // 差し替える前のプラグインと同じ位置に配置する
+    UInt32 const index = (pimpl_->main_node_ ? pimpl_->GetNodeIndex(pimpl_->main_node_.get()) : 0);
+    
     UnloadVst3Plugin();
     
-    tmp->SetSamplingRate(pimpl_->sample_rate_);
-    tmp->SetBlockSize(pimpl_->block_size_);
+    if(pimpl_->SetUpPlugin(tmp.get()) == false) {
+        return false;
+    }
     
-    try {
-        auto activate_all_buses = [](Vst3Plugin *plugin,
-                                     Steinberg::Vst::MediaTypes media,
-                                     Steinberg::Vst::BusDirections dir)
-        {
-            auto const num = plugin->GetNumBuses(media, dir);
-            for(int i = 0; i < num; ++i) { plugin->SetBusActive(media, dir, i); }
-        };
-        
-        using MT = Steinberg::Vst::MediaTypes;
-        using BD = Steinberg::Vst::BusDirections;
-        
-        activate_all_buses(tmp.get(), MT::kAudio, BD::kInput);
-        activate_all_buses(tmp.get(), MT::kAudio, BD::kOutput);
-        activate_all_buses(tmp.get(), MT::kEvent, BD::kInput);
-        activate_all_buses(tmp.get(), MT::kEvent, BD::kOutput);
-        
-    } catch(std::exception &e) {
-        HWM_ERROR_LOG(L"Failed to setup Vst3Plugin buses: " << to_wstr(e.what()));
-        return nullptr;
+    auto node = std::make_shared<PluginChainNode>(std::move(factory), std::move(tmp));
+    pimpl_->main_node_ = node;
+    pimpl_->InsertNode(index, std::move(node));
+    
+    pimpl_->plls_.Invoke([plugin = GetPlugin()](auto *listener) {
+        listener->OnAfterPluginLoaded(plugin);
+    });
+    
+    return true;
+}
+
+bool App::LoadVst3PluginAsync(ClassInfo::CID cid, std::optional<Vst3Plugin::DumpData> dump)
+{
+    if(!dump) {
+        return LoadVst3PluginAsync(cid, std::optional<Vst3Plugin::DumpDataRef>(), nullptr);
+    }
+    
+    auto owner = std::make_shared<Vst3Plugin::DumpData const>(std::move(*dump));
+    return LoadVst3PluginAsync(cid, Vst3Plugin::DumpDataRef(*owner), owner);
+}
+
+bool App::LoadVst3PluginAsync(ClassInfo::CID cid,
+                              std::optional<Vst3Plugin::DumpDataRef> dump,
+                              std::shared_ptr<void const> owner)
+{
+    auto factory = pimpl_->factory_;
+    if(!factory || !pimpl_->plugin_loader_) { return false; }
+    
+    if(!pimpl_->main_node_ && pimpl_->chain_.size() >= kMaxNumChainedPlugins) {
+        HWM_ERROR_LOG(L"Failed to load Vst3Plugin: the plugin chain is full.");
+        return false;
     }
     
-    tmp->SetSamplingRate(pimpl_->sample_rate_);
-    tmp->SetBlockSize(pimpl_->block_size_);
-    tmp->Resume();
+    pimpl_->pending_editor_type_.reset();
     
-    {
-        auto lock = pimpl_->lf_playback_.make_lock();
-        pimpl_->plugin_ = std::move(tmp);
+    // 同じプラグインをロード中であれば、そのロードの完了を待つ
+    if(!dump && pimpl_->loading_cid_ == cid && IsLoadingPlugin()) {
+        return true;
     }
     
-    pimpl_->plls_.Invoke([plugin = pimpl_->plugin_.get()](auto *listener) {
-        listener->OnAfterPluginLoaded(plugin);
-    });
+    auto task = std::make_unique<Vst3PluginLoadTask>(std::move(factory), cid, dump, std::move(owner),
+                                                     [this](Vst3Plugin *plugin) {
+                                                         return pimpl_->SetUpLoadingPlugin(plugin);
+                                                     });
     
+    pimpl_->loading_cid_ = cid;
+    pimpl_->plugin_load_id_ = pimpl_->plugin_loader_->StartLoad(std::move(task));
     return true;
 }
 
+void App::CancelPluginLoad()
+{
+    if(!pimpl_->plugin_loader_) { return; }
+    
+    pimpl_->plugin_loader_->Cancel();
+    pimpl_->loading_cid_.reset();
+    pimpl_->pending_editor_type_.reset();
+}
+
+bool App::IsLoadingPlugin() const
+{
+    return pimpl_->plugin_loader_ && pimpl_->plugin_loader_->IsLoading();
+}
+
 void App::UnloadVst3Plugin()
 {
-    if(!pimpl_->plugin_) { return; }
+    if(!pimpl_->main_node_) { return; }
     
-    pimpl_->plls_.Invoke([plugin = pimpl_->plugin_.get()](auto *listener) {
+    pimpl_->plls_.Invoke([plugin = GetPlugin()](auto *listener) {
         listener->OnBeforePluginUnloaded(plugin);
     });
+    pimpl_->ClearPluginStates();
+    
+    auto tmp = std::move(pimpl_->main_node_);
+    
+    // プラグインはオーディオスレッドではなく、ここで停止・解放される。
+    pimpl_->RemoveNode(pimpl_->GetNodeIndex(tmp.get()));
+    tmp.reset();
+}
+
+UInt64 App::CapturePluginState(String name)
+{
+    return pimpl_->CapturePluginState(std::move(name));
+}
+
+bool App::RestorePluginState(UInt64 snapshot_id)
+{
+    if(pimpl_->plugin_states_.Contains(snapshot_id) == false) { return false; }
+    
+    auto const undo_id = pimpl_->CapturePluginState(L"Undo");
+    if(undo_id == 0) { return false; }
+    
+    if(pimpl_->LoadPluginState(snapshot_id) == false) {
+        pimpl_->RemovePluginStateIfUnused(undo_id);
+        return false;
+    }
+    
+    pimpl_->ClearPluginStateRedo();
+    pimpl_->PushPluginStateUndo(undo_id);
+    return true;
+}
+
+bool App::UndoPluginStateChange()
+{
+    auto &stack = pimpl_->plugin_state_undo_stack_;
+    if(stack.empty()) { return false; }
+    
+    // Redoでやり直せるように、戻す前の状態を保存する
+    auto const redo_id = pimpl_->CapturePluginState(L"Redo");
+    if(redo_id == 0) { return false; }
+    
+    while(stack.empty() == false) {
+        auto const undo = stack.back();
+        stack.pop_back();
+        
+        // 容量の上限を超えて削除されたものは飛ばす
+        if(pimpl_->LoadPluginState(undo.id_)) {
+            pimpl_->PushPluginStateRedo(redo_id);
+            pimpl_->active_plugin_state_slot_ = undo.slot_;
+            pimpl_->RemovePluginStateIfUnused(undo.id_);
+            if(stack.empty() == false) { pimpl_->PreparePluginState(stack.back().id_); }
+            return true;
+        }
+    }
+    
+    pimpl_->RemovePluginStateIfUnused(redo_id);
+    return false;
+}
+
+bool App::CanUndoPluginStateChange() const
+{
+    return pimpl_->plugin_state_undo_stack_.empty() == false;
+}
+
+bool App::RedoPluginStateChange()
+{
+    auto &stack = pimpl_->plugin_state_redo_stack_;
+    if(stack.empty()) { return false; }
+    
+    // Undoで再び戻せるように、やり直す前の状態を保存する
+    auto const undo_id = pimpl_->CapturePluginState(L"Undo");
+    if(undo_id == 0) { return false; }
+    
+    while(stack.empty() == false) {
+        auto const redo = stack.back();
+        stack.pop_back();
+        
+        if(pimpl_->LoadPluginState(redo.id_)) {
+            pimpl_->PushPluginStateUndo(undo_id);
+            pimpl_->active_plugin_state_slot_ = redo.slot_;
+            pimpl_->RemovePluginStateIfUnused(redo.id_);
+            if(stack.empty() == false) { pimpl_->PreparePluginState(stack.back().id_); }
+            return true;
+        }
+    }
+    
+    pimpl_->RemovePluginStateIfUnused(undo_id);
+    return false;
+}
+
+bool App::CanRedoPluginStateChange() const
+{
+    return pimpl_->plugin_state_redo_stack_.empty() == false;
+}
+
+bool App::TogglePluginStateAB()
+{
+    auto &slots = pimpl_->plugin_state_slots_;
+    auto const current = pimpl_->active_plugin_state_slot_;
+    auto const next = 1 - current;
+    
+    auto const id = pimpl_->CapturePluginState(current == 0 ? L"A" : L"B");
+    if(id == 0) { return false; }
+    slots[current] = id;
+    
+    if(slots[next] == 0 || pimpl_->plugin_states_.Contains(slots[next]) == false) {
+        // 現在の状態を、もう一方のスロットの初期状態にする
+        slots[next] = id;
+    } else if(pimpl_->LoadPluginState(slots[next])) {
+        // 切り替える前の状態に、Undoで戻せるようにする
+        pimpl_->ClearPluginStateRedo();
+        pimpl_->PushPluginStateUndo(id);
+    } else {
+        return false;
+    }
+    
+    pimpl_->active_plugin_state_slot_ = next;
+    
+    // 次の切り替えに備えて、切り替え前の状態を復元する準備をしておく
+    pimpl_->PreparePluginState(slots[current]);
+    return true;
+}
+
+UInt32 App::GetActivePluginStateSlot() const
+{
+    return pimpl_->active_plugin_state_slot_;
+}
+
+bool App::InsertVst3Plugin(UInt32 index, String module_path, ClassInfo::CID cid)
+{
+    if(pimpl_->chain_.size() >= kMaxNumChainedPlugins) {
+        HWM_ERROR_LOG(L"Failed to insert Vst3Plugin: the plugin chain is full.");
+        return false;
+    }
     
-    std::shared_ptr<Vst3Plugin> tmp;
+    auto factory = pimpl_->factory_list_->FindOrCreateFactory(module_path);
+    if(!factory) {
+        HWM_ERROR_LOG(L"Failed to load the vst3 module: " << module_path);
+        return false;
+    }
+    
+    std::unique_ptr<Vst3Plugin> tmp;
+    try {
+        tmp = factory->CreateByID(cid);
+        assert(tmp);
+    } catch(std::exception &e) {
+        HWM_ERROR_LOG(L"Failed to create Vst3Plugin: " << to_wstr(e.what()));
+        return false;
+    }
+    
+    if(pimpl_->SetUpPlugin(tmp.get()) == false) {
+        return false;
+    }
+    
+    index = std::min<UInt32>(index, pimpl_->chain_.size());
+    pimpl_->InsertNode(index, std::make_shared<PluginChainNode>(std::move(factory), std::move(tmp)));
+    return true;
+}
+
+bool App::InsertRemoteVst3Plugin(UInt32 index, String module_path, std::optional<ClassInfo::CID> cid)
+{
+    if(pimpl_->chain_.size() >= kMaxNumChainedPlugins) {
+        HWM_ERROR_LOG(L"Failed to insert Vst3Plugin: the plugin chain is full.");
+        return false;
+    }
+    
+    auto remote = std::make_unique<RemotePlugin>(module_path, cid);
+    if(remote->Start(pimpl_->sample_rate_, pimpl_->block_size_,
+                     pimpl_->GetNumChainChannels(), pimpl_->use_double_precision_) == false)
     {
-        auto lock = pimpl_->lf_playback_.make_lock();
-        tmp = std::move(pimpl_->plugin_);
+        HWM_ERROR_LOG(L"Failed to launch the plugin host process for Vst3Plugin: " << module_path);
+        return false;
     }
     
-    tmp->Suspend();
+    index = std::min<UInt32>(index, pimpl_->chain_.size());
+    pimpl_->InsertNode(index, std::make_shared<PluginChainNode>(std::move(remote)));
+    return true;
+}
+
+void App::RemoveChainedPlugin(UInt32 index)
+{
+    assert(index < GetNumChainedPlugins());
+    if(pimpl_->chain_[index] == pimpl_->main_node_) {
+        UnloadVst3Plugin();
+        return;
+    }
+    
+    pimpl_->RemoveNode(index);
+}
+
+void App::MoveChainedPlugin(UInt32 from, UInt32 to)
+{
+    auto &chain = pimpl_->chain_;
+    assert(from < chain.size());
+    assert(to < chain.size());
+    if(from == to) { return; }
+    
+    auto node = chain[from];
+    chain.erase(chain.begin() + from);
+    chain.insert(chain.begin() + to, std::move(node));
+    pimpl_->PublishPlaybackState();
+}
+
+void App::SetChainedPluginInputs(UInt32 index, std::vector<UInt32> const &inputs)
+{
+    auto &chain = pimpl_->chain_;
+    assert(index < chain.size());
+    
+    auto &dest = pimpl_->explicit_inputs_[chain[index].get()];
+    dest.clear();
+    for(auto input: inputs) {
+        assert(input < index);
+        if(input >= index) { continue; }
+        dest.push_back(chain[input].get());
+    }
+    pimpl_->PublishPlaybackState();
+}
+
+void App::ResetChainedPluginInputs(UInt32 index)
+{
+    assert(index < GetNumChainedPlugins());
+    pimpl_->explicit_inputs_.erase(pimpl_->chain_[index].get());
+    pimpl_->PublishPlaybackState();
+}
+
+void App::SetChainedPluginBypassed(UInt32 index, bool bypassed)
+{
+    assert(index < GetNumChainedPlugins());
+    pimpl_->chain_[index]->SetBypassed(bypassed);
+}
+
+bool App::IsChainedPluginBypassed(UInt32 index) const
+{
+    assert(index < GetNumChainedPlugins());
+    return pimpl_->chain_[index]->IsBypassed();
+}
+
+UInt32 App::GetNumChainedPlugins() const
+{
+    return pimpl_->chain_.size();
+}
+
+Vst3Plugin * App::GetChainedPlugin(UInt32 index)
+{
+    assert(index < GetNumChainedPlugins());
+    return pimpl_->chain_[index]->GetPlugin();
 }
 
 Vst3PluginFactory * App::GetPluginFactory()
@@ -690,7 +2001,7 @@ Vst3PluginFactory * App::GetPluginFactory()
 
 Vst3Plugin * App::GetPlugin()
 {
-    return pimpl_->plugin_.get();
+    return (pimpl_->main_node_ ? pimpl_->main_node_->GetPlugin() : nullptr);
 }
 
 App::ModuleLoadListenerService & App::GetModuleLoadListenerService()
@@ -708,6 +2019,45 @@ App::PlaybackOptionChangeListenerService & App::GetPlaybackOptionChangeListenerS
     return pimpl_->pocls_;
 }
 
+App::PluginScanListenerService & App::GetPluginScanListenerService()
+{
+    return pimpl_->psls_;
+}
+
+App::ProjectSaveListenerService & App::GetProjectSaveListenerService()
+{
+    return pimpl_->psvls_;
+}
+
+std::vector<PluginScanEntry> App::GetScannedPlugins() const
+{
+    if(!pimpl_->plugin_scanner_) { return {}; }
+    return pimpl_->plugin_scanner_->GetEntries();
+}
+
+void App::RescanPlugins()
+{
+    if(!pimpl_->plugin_scanner_) { return; }
+    
+    auto search_dirs = PluginScanner::GetDefaultSearchDirectories();
+    auto const &search_path = pimpl_->config_.plugin_search_path_;
+    if(search_path.empty() == false) {
+        search_dirs.insert(search_dirs.begin(), search_path);
+    }
+    
+    pimpl_->plugin_scanner_->StartScan(search_dirs, GetPluginScanCacheFilePath(), [this] {
+        // スキャンスレッドから呼ばれるので、GUIスレッドでリスナーに通知する
+        CallAfter([this] {
+            pimpl_->psls_.Invoke([](auto *li) { li->OnPluginScanFinished(); });
+        });
+    });
+}
+
+bool App::IsScanningPlugins() const
+{
+    return pimpl_->plugin_scanner_ && pimpl_->plugin_scanner_->IsScanning();
+}
+
 void App::SendNoteOn(Int32 note_number, Int32 velocity)
 {
     assert(0 <= note_number && note_number < 128);
@@ -763,6 +2113,35 @@ void App::EnableAudioInput(bool enable)
     });
 }
 
+bool App::IsInputMonitoringEnabled() const
+{
+    return pimpl_->enable_input_monitoring_.load();
+}
+
+void App::EnableInputMonitoring(bool enable)
+{
+    if(enable == IsInputMonitoringEnabled()) { return; }
+    
+    pimpl_->enable_input_monitoring_.store(enable);
+    pimpl_->pocls_.Invoke([enable](auto *li) {
+        li->OnInputMonitoringEnableStateChanged(enable);
+    });
+}
+
+SampleCount App::GetPluginLatencySamples() const
+{
+    return pimpl_->graph_latency_.load();
+}
+
+double App::GetRoundTripLatency() const
+{
+    auto adm = AudioDeviceManager::GetInstance();
+    auto dev = adm->GetDevice();
+    if(!dev) { return 0; }
+    
+    return dev->GetInputLatency() + dev->GetOutputLatency() + GetPluginLatencySamples() / dev->GetSampleRate();
+}
+
 double App::GetAudioOutputMinLevel() const
 {
     return pimpl_->output_level_.get_min_db();
@@ -811,11 +2190,78 @@ std::bitset<128> App::GetPlayingNotes()
     return ret;
 }
 
-void App::GetAudioOutputLevelMeter(std::vector<double> &dest)
+void App::GetAudioOutputLevelMeter(std::vector<LevelMeterValue> &dest)
 {
     pimpl_->GetLevelMeter(dest);
 }
 
+String App::GetAudioProcessingLoadReport() const
+{
+    std::wstringstream ss;
+    
+    auto write_summary = [&ss](wchar_t const *label, LatencyHistogram::Summary const &summary) {
+        ss << label << L": p50 " << summary.p50_ << L"us, p99 " << summary.p99_
+        << L"us, max " << summary.max_ << L"us (" << summary.count_ << L" blocks)" << std::endl;
+    };
+    
+    auto adm = AudioDeviceManager::GetInstance();
+    auto dev = adm->GetDevice();
+    auto st = (dev ? dev->GetLoadStatistics() : std::nullopt);
+    
+    if(st) {
+        if(st->deadline_usec_ > 0) {
+            ss << L"Deadline: " << st->deadline_usec_ << L"us (missed "
+            << st->num_deadline_misses_ << L" blocks)" << std::endl;
+        }
+        write_summary(L"Device callback", st->callback_usec_);
+        write_summary(L"Device conversion", st->conversion_usec_);
+        write_summary(L"App process", st->process_usec_);
+        ss << L"Input underflow: " << st->input_underflow_count_
+        << L", Input overflow: " << st->input_overflow_count_
+        << L", Output underflow: " << st->output_underflow_count_
+        << L", Output overflow: " << st->output_overflow_count_
+        << L", Priming output: " << st->priming_output_count_ << std::endl;
+    } else {
+        ss << L"Device load statistics are not available." << std::endl;
+    }
+    
+    if(auto const &pool = pimpl_->worker_pool_) {
+        ss << L"Worker threads: " << pool->GetNumWorkers()
+        << L" (realtime " << pool->GetNumRealtimeWorkers() << L")" << std::endl;
+    }
+    
+    ss << L"Plugin latency: " << GetPluginLatencySamples() << L" samples, round trip: "
+    << (GetRoundTripLatency() * 1000.0) << L"ms" << std::endl;
+    
+    UInt64 num_overflowed_output_events = 0;
+    for(auto const &node: pimpl_->chain_) {
+        auto const label = L"Plugin process [" + node->GetPluginName()
+        + (node->IsBypassed() ? L"] (bypassed)" : L"]");
+        if(auto plugin = node->GetPlugin()) {
+            write_summary(label.c_str(), plugin->GetProcessTimeSummary());
+        } else {
+            auto remote = node->GetRemotePlugin();
+            write_summary(label.c_str(), remote->GetProcessTimeSummary());
+            auto const overhead_label = L"Remote plugin overhead [" + node->GetPluginName() + L"]";
+            write_summary(overhead_label.c_str(), remote->GetOverheadSummary());
+            ss << L"Remote plugin dropped: " << remote->GetNumDroppedBlocks() << L" blocks, restarted: "
+            << remote->GetNumRestarts() << L" times" << std::endl;
+        }
+        num_overflowed_output_events += node->GetOutputEventBuffers().GetNumOverflowedEvents();
+    }
+    
+    auto const &ms = pimpl_->midi_scheduler_;
+    auto const jitter = ms.GetJitterSummary();
+    ss << L"MIDI latency: " << (ms.GetLatency() * 1000.0) << L"ms, block jitter: p50 " << jitter.p50_
+    << L"us, p99 " << jitter.p99_ << L"us, max " << jitter.max_ << L"us"
+    << L" (late " << ms.GetNumLateEvents() << L", dropped " << ms.GetNumDroppedEvents() << L" events)" << std::endl;
+    ss << L"MIDI input dropped: " << MidiDeviceManager::GetInstance()->GetNumDroppedInputMessages() << L" messages" << std::endl;
+    ss << L"Event buffer overflow: " << pimpl_->input_event_buffers_.GetNumOverflowedEvents() << L" input, "
+    << num_overflowed_output_events << L" output events" << std::endl;
+    
+    return ss.str();
+}
+
 void App::SelectAudioDevice()
 {
     bool const old_inputtability = CanEnableAudioInput();
@@ -856,6 +2302,8 @@ void App::SelectAudioDevice()
             li->OnAudioInputAvailabilityChanged(new_inputtability);
         });
     }
+    
+    pimpl_->pocls_.Invoke([](auto *li) { li->OnLatencyChanged(); });
 }
 
 void App::ShowAboutDialog()
@@ -887,17 +2335,10 @@ Config const & App::GetConfig() const
 
 void App::LoadProjectFile(String path_to_load)
 {
-    ProjectFile file;
-    
-    std::ifstream ifs;
-#if defined(_MSC_VER)
-    ifs.open(path_to_load);
-#else
-    ifs.open(to_utf8(path_to_load));
-#endif
+    auto file = std::make_shared<ProjectFile>();
     
     try {
-        ifs >> file;
+        file->Load(path_to_load);
     } catch(std::exception &e) {
         HWM_ERROR_LOG(L"failed to load project file [" << path_to_load << L"]: " << to_wstr(e.what()));
         return;
@@ -905,60 +2346,58 @@ void App::LoadProjectFile(String path_to_load)
     
     UnloadVst3Module();
     
-    if(file.oscillator_type_) {
-        SetTestWaveformType(*file.oscillator_type_);
+    if(file->oscillator_type_) {
+        SetTestWaveformType(*file->oscillator_type_);
     }
     
-    SetAudioOutputLevel(file.audio_output_level_);
-    EnableAudioInput(file.is_audio_input_enabled_);
+    SetAudioOutputLevel(file->audio_output_level_);
+    EnableAudioInput(file->is_audio_input_enabled_);
     
-    if(file.vst3_plugin_path_.empty()) { return; }
+    if(file->vst3_plugin_path_.empty()) { return; }
     
-    if(!LoadVst3Module(file.vst3_plugin_path_)) {
+    if(!LoadVst3Module(file->vst3_plugin_path_)) {
         return;
     }
     
-    if(!LoadVst3Plugin(file.vst3_plugin_cid_)) {
-        return;
+    // プラグインの状態は、別スレッドでプラグインを開始する前に復元する。
+    // バイナリ形式のファイルではマップしたファイルを直接参照するので、ロードが終わるまで file を保持する
+    std::optional<Vst3Plugin::DumpDataRef> dump;
+    auto const file_dump = file->GetVst3PluginDumpData();
+    if(file_dump.processor_data_.empty() == false) {
+        dump = file_dump;
     }
     
-    if(file.vst3_plugin_proc_data_.empty()) {
+    if(!LoadVst3PluginAsync(file->vst3_plugin_cid_, dump, file)) {
         return;
     }
     
-    Vst3Plugin::DumpData dump;
-    dump.processor_data_ = file.vst3_plugin_proc_data_;
-    dump.edit_controller_data_ = file.vst3_plugin_edit_data_;
-    
-    GetPlugin()->LoadData(dump);
-    
-    if(file.editor_type_) {
-        auto frame = IMainFrame::GetInstance();
-        wxCommandEvent ev(wxEVT_COMMAND_MENU_SELECTED);
-        ev.SetId(IMainFrame::kID_View_PluginEditor);
-        ev.SetEventObject(frame);
-        frame->ProcessWindowEvent(ev);
-        
-        auto editor = IPluginEditorFrame::GetInstance();
-        editor->SetViewType(*file.editor_type_);
-    }
+    // エディタはロードが完了してから開く
+    pimpl_->pending_editor_type_ = file->editor_type_;
 }
 
 void App::SaveProjectFile(String path_to_save)
 {
-    ProjectFile file;
-    file.ScanAudioDeviceStatus();
-    file.ScanPluginStatus();
-    file.ScanAppStatus();
-    
-    std::ofstream ofs;
-#if defined(_MSC_VER)
-    ofs.open(path_to_save);
-#else
-    ofs.open(to_utf8(path_to_save));
-#endif
+    // プラグインの状態の取得はGUIスレッドで行う必要があるので、ここではスナップショットの取得だけを行う
+    auto file = std::make_shared<ProjectFile>();
+    file->ScanAudioDeviceStatus();
+    file->ScanPluginStatus();
+    file->ScanAppStatus();
+    
+    if(pimpl_->project_saver_) {
+        pimpl_->project_saver_->StartSave(std::move(file), path_to_save);
+        return;
+    }
     
-    ofs << file;
+    try {
+        file->Save(path_to_save);
+    } catch(std::exception &e) {
+        HWM_ERROR_LOG(L"failed to save project file [" << path_to_save << L"]: " << to_wstr(e.what()));
+    }
+}
+
+bool App::IsSavingProject() const
+{
+    return pimpl_->project_saver_ && pimpl_->project_saver_->IsSaving();
 }
 
 void App::SaveConfig()
@@ -974,6 +2413,26 @@ namespace {
     {
         { wxCMD_LINE_SWITCH, "h", "help", "show help", wxCMD_LINE_VAL_NONE, wxCMD_LINE_OPTION_HELP },
         { wxCMD_LINE_OPTION, "l", "logging-level", "set logging level to (Error|Warn|Info|Debug). the default value is \"Info\"", wxCMD_LINE_VAL_STRING, 0 },
+        { wxCMD_LINE_SWITCH, "n", "null-device", "use the null audio device which requires no sound card", wxCMD_LINE_VAL_NONE, 0 },
+        { wxCMD_LINE_SWITCH, NULL, "freewheel", "(with --null-device) process audio as fast as possible instead of pacing to the sample rate", wxCMD_LINE_VAL_NONE, 0 },
+        { wxCMD_LINE_SWITCH, NULL, "non-interleaved", "open the sound card with non-interleaved buffers to skip the sample format conversion", wxCMD_LINE_VAL_NONE, 0 },
+        { wxCMD_LINE_SWITCH, NULL, "double-precision", "process plugins with 64-bit samples if they support it", wxCMD_LINE_VAL_NONE, 0 },
+        { wxCMD_LINE_OPTION, NULL, "insert", "vst3 module files separated by ';' to insert after the main plugin. the first plugin in each module is used. a path prefixed with '+' starts a new branch fed by the app input", wxCMD_LINE_VAL_STRING, 0 },
+        { wxCMD_LINE_SWITCH, NULL, "isolate-inserts", "run the plugins given by --insert in separate processes so that a crashing plugin does not take down the app", wxCMD_LINE_VAL_NONE, 0 },
+        { wxCMD_LINE_OPTION, NULL, kPluginHostOptionName, "(internal) run as the plugin host process attached to the specified shared memory", wxCMD_LINE_VAL_STRING, wxCMD_LINE_HIDDEN },
+        { wxCMD_LINE_OPTION, NULL, kPluginScanOptionName, "(internal) load the specified vst3 module and write its plugin information", wxCMD_LINE_VAL_STRING, wxCMD_LINE_HIDDEN },
+        { wxCMD_LINE_OPTION, NULL, kPluginScanOutputOptionName, "(internal) (with --plugin-scan) file to write the plugin information", wxCMD_LINE_VAL_STRING, wxCMD_LINE_HIDDEN },
+        { wxCMD_LINE_OPTION, NULL, "worker-threads", "number of threads processing independent plugins in parallel besides the audio thread. defaults to the number of cpu cores minus one", wxCMD_LINE_VAL_NUMBER, 0 },
+        { wxCMD_LINE_OPTION, NULL, "autosave", "save the project into the app's document directory every specified seconds", wxCMD_LINE_VAL_NUMBER, 0 },
+        { wxCMD_LINE_OPTION, NULL, "midi-latency", "milliseconds from receiving a midi input message to playing it. 0 (the default) chooses the smallest latency from the audio device", wxCMD_LINE_VAL_DOUBLE, 0 },
+        { wxCMD_LINE_OPTION, "r", "render", "render offline into the specified wave file without opening any audio device and exit", wxCMD_LINE_VAL_STRING, 0 },
+        { wxCMD_LINE_OPTION, NULL, "project", "(with --render) project file to load", wxCMD_LINE_VAL_STRING, 0 },
+        { wxCMD_LINE_OPTION, NULL, "module", "(with --render) vst3 module file to load. overrides the module path in the project file", wxCMD_LINE_VAL_STRING, 0 },
+        { wxCMD_LINE_OPTION, NULL, "input-wav", "(with --render) wave file fed to the plugin's audio inputs", wxCMD_LINE_VAL_STRING, 0 },
+        { wxCMD_LINE_OPTION, NULL, "input-midi", "(with --render) standard midi file fed to the plugin's event input", wxCMD_LINE_VAL_STRING, 0 },
+        { wxCMD_LINE_OPTION, NULL, "sample-rate", "(with --render) sample rate to render", wxCMD_LINE_VAL_DOUBLE, 0 },
+        { wxCMD_LINE_OPTION, NULL, "block-size", "(with --render) block size to render", wxCMD_LINE_VAL_NUMBER, 0 },
+        { wxCMD_LINE_OPTION, NULL, "tail", "(with --render) seconds rendered after the end of the inputs. the default value is 2.0", wxCMD_LINE_VAL_DOUBLE, 0 },
         { wxCMD_LINE_NONE },
     };
 }
@@ -992,6 +2451,89 @@ bool App::OnCmdLineParsed(wxCmdLineParser& parser)
     level = level.Capitalize();
     logger->SetMostDetailedActiveLoggingLevel(level.ToStdWstring());
     
+    pimpl_->use_non_interleaved_stream_ = parser.Found("non-interleaved");
+    pimpl_->use_double_precision_ = parser.Found("double-precision");
+    
+    wxString insert_paths;
+    if(parser.Found("insert", &insert_paths)) {
+        // Windowsのパス区切り文字をエスケープ文字として扱わないようにする
+        auto const paths = wxSplit(insert_paths, L';', L'\0');
+        for(auto const &path: paths) {
+            if(path.empty() == false) {
+                pimpl_->insert_module_paths_.push_back(path.ToStdWstring());
+            }
+        }
+    }
+    
+    pimpl_->isolate_inserts_ = parser.Found("isolate-inserts");
+    
+    wxString plugin_host_name;
+    if(parser.Found(kPluginHostOptionName, &plugin_host_name)) {
+        pimpl_->plugin_host_shared_memory_name_ = plugin_host_name.ToStdWstring();
+    }
+    
+    wxString plugin_scan_module_path;
+    wxString plugin_scan_output_path;
+    if(parser.Found(kPluginScanOptionName, &plugin_scan_module_path)
+       && parser.Found(kPluginScanOutputOptionName, &plugin_scan_output_path))
+    {
+        pimpl_->plugin_scan_module_path_ = plugin_scan_module_path.ToStdWstring();
+        pimpl_->plugin_scan_output_path_ = plugin_scan_output_path.ToStdWstring();
+    }
+    
+    long num_worker_threads = 0;
+    if(parser.Found("worker-threads", &num_worker_threads)) {
+        pimpl_->num_worker_threads_ = (UInt32)std::clamp<long>(num_worker_threads, 0, 64);
+    }
+    
+    long autosave_interval_sec = 0;
+    if(parser.Found("autosave", &autosave_interval_sec) && autosave_interval_sec > 0) {
+        pimpl_->autosave_interval_sec_ = (UInt32)std::min<long>(autosave_interval_sec, 24 * 60 * 60);
+    }
+    
+    double midi_latency_msec = 0;
+    if(parser.Found("midi-latency", &midi_latency_msec)) {
+        pimpl_->midi_scheduler_.SetLatency(std::max(midi_latency_msec, 0.0) / 1000.0);
+    }
+    
+    if(parser.Found("null-device")) {
+        using NDM = AudioDeviceManager::NullDeviceMode;
+        pimpl_->null_device_mode_ = parser.Found("freewheel") ? NDM::kFreewheel : NDM::kPaced;
+    }
+    
+    wxString output_path;
+    if(parser.Found("render", &output_path)) {
+        OfflineRenderOptions opts;
+        opts.output_path_ = output_path.ToStdWstring();
+        opts.double_precision_ = pimpl_->use_double_precision_;
+        
+        wxString str;
+        if(parser.Found("project", &str))       { opts.project_path_ = str.ToStdWstring(); }
+        if(parser.Found("module", &str))        { opts.module_path_ = str.ToStdWstring(); }
+        if(parser.Found("input-wav", &str))     { opts.input_wave_path_ = str.ToStdWstring(); }
+        if(parser.Found("input-midi", &str))    { opts.input_midi_path_ = str.ToStdWstring(); }
+        
+        double dval = 0;
+        long lval = 0;
+        if(parser.Found("sample-rate", &dval)) {
+            opts.sample_rate_ = Clamp<double>(dval, kSupportedSampleRateMin, kSupportedSampleRateMax);
+        }
+        if(parser.Found("block-size", &lval)) {
+            opts.block_size_ = Clamp<long>(lval, kSupportedBlockSizeMin, kSupportedBlockSizeMax);
+        }
+        if(parser.Found("tail", &dval)) {
+            opts.tail_seconds_ = std::max(dval, 0.0);
+        }
+        
+        if(opts.project_path_.empty() && opts.module_path_.empty()) {
+            std::cerr << "--render requires --project or --module." << std::endl;
+            parser.Usage();
+            return false;
+        }
+        
+        pimpl_->offline_render_options_ = opts;
+    }
+    
     return true;
 }
 
@@ -2,11 +2,17 @@
 
 #include <memory>
 #include <bitset>
+#include <optional>
+#include <vector>
 
 #include "../misc/SingleInstance.hpp"
+#include "../misc/LevelMeter.hpp"
 #include "../plugin/vst3/Vst3Plugin.hpp"
 #include "../file/Config.hpp"
+#include "../file/PluginScanCache.hpp"
 #include "./OscillatorType.hpp"
+#include "./PluginLoader.hpp"
+#include "./ProjectSaver.hpp"
 
 NS_HWM_BEGIN
 
@@ -26,14 +32,107 @@ public:
     void UnloadVst3Module();
     
     //! 現在ロードしているモジュールのIPluginFactoryで、指定したcidのVST3プラグインをロードする。
+    /*! ロードが完了するまで呼び出したスレッドをブロックする。GUIからは LoadVst3PluginAsync() を使う。
+     */
     bool LoadVst3Plugin(ClassInfo::CID cid);
+    
+    //! 現在ロードしているモジュールのIPluginFactoryで、指定したcidのVST3プラグインを段階的にロードする。
+    /*! 状態の復元に使用するデータの準備を別スレッドで行い、
+     *  プラグインの作成、設定、状態の復元、開始は、VST3の規約に従ってGUIスレッドで一段階ずつ行う。
+     *  その進捗を IPluginLoadListener::OnPluginLoadProgress() で通知する。
+     *  ロードが完了するまでは、ロード済みのプラグインがそのまま再生を続け、
+     *  完了したときに同じ位置で新しいプラグインに差し替える。
+     *  ロード中に呼び出した場合は、実行中のロードを中断して新しいプラグインをロードする。
+     *  @param dump 指定した場合は、プラグインを開始する前にこの状態を復元する
+     *  @return ロードを開始できなかった場合はfalse
+     */
+    bool LoadVst3PluginAsync(ClassInfo::CID cid, std::optional<Vst3Plugin::DumpData> dump = std::nullopt);
+    //! dump が参照する状態を復元して、VST3プラグインを段階的にロードする。
+    /*! @param owner dump が参照するデータを保持するオブジェクト。ロードが終わるまで保持する
+     */
+    bool LoadVst3PluginAsync(ClassInfo::CID cid,
+                             std::optional<Vst3Plugin::DumpDataRef> dump,
+                             std::shared_ptr<void const> owner);
+    //! LoadVst3PluginAsync() で開始したロードを中断する
+    void CancelPluginLoad();
+    bool IsLoadingPlugin() const;
     //! 現在ロードしているプラグインをアンロードする
     void UnloadVst3Plugin();
     
+    //! ロードしているプラグインの現在の状態を、メモリ上にスナップショットとして保存する。
+    /*! 同じ内容の状態は共有するので、変更が少なければ何度保存してもメモリの使用量はほとんど増えない。
+     *  スナップショットはプラグインを差し替えたりアンロードしたりすると破棄される。
+     *  @return 保存したスナップショットのID。保存できなかった場合は0
+     */
+    UInt64 CapturePluginState(String name);
+    //! CapturePluginState() で保存したスナップショットの状態に戻す。
+    /*! 戻す前の状態は UndoPluginStateChange() で戻せるように保存しておく。
+     */
+    bool RestorePluginState(UInt64 snapshot_id);
+    //! 直前の RestorePluginState() や TogglePluginStateAB() で変更する前の状態に戻す
+    /*! 戻す前の状態は RedoPluginStateChange() でやり直せるように保存しておく。
+     */
+    bool UndoPluginStateChange();
+    bool CanUndoPluginStateChange() const;
+    //! 直前の UndoPluginStateChange() で戻す前の状態をやり直す。
+    /*! RestorePluginState() や TogglePluginStateAB() で新しく状態を変更すると、やり直せる状態は破棄される。
+     */
+    bool RedoPluginStateChange();
+    bool CanRedoPluginStateChange() const;
+    //! A/B比較を切り替える。
+    /*! 現在の状態を今のスロットに保存して、もう一方のスロットに保存しておいた状態に切り替える。
+     *  もう一方のスロットにまだ状態を保存していない場合は、現在の状態をそのスロットの初期状態にする。
+     *  切り替え先の状態は別スレッドで復元用のストリームを準備しておくので、すぐに切り替えられる。
+     */
+    bool TogglePluginStateAB();
+    //! A/B比較で現在選択しているスロット。0: A, 1: B
+    UInt32 GetActivePluginStateSlot() const;
+    
+    //! 指定したモジュールファイル（*.vst3）のVST3プラグインをロードして、プラグインチェインの index 番目に挿入する。
+    /*! index がチェインの長さ以上の場合は末尾に追加する。
+     *  挿入したプラグインは、LoadVst3Plugin() でロードしたプラグインとは別に管理され、
+     *  IPluginLoadListener への通知も行わない。
+     */
+    bool InsertVst3Plugin(UInt32 index, String module_path, ClassInfo::CID cid);
+    
+    //! 指定したモジュールファイル（*.vst3）のVST3プラグインを別プロセスで動作させて、プラグインチェインの index 番目に挿入する。
+    /*! プラグインがクラッシュしても、アプリケーションは動作を続け、プラグインホストプロセスは自動で起動し直される。
+     *  このプロセスではモジュールをロードしない。
+     *  プラグインホストプロセスでプラグインが開始されるのは待たずに戻り、開始されるまでは無音を出力する。
+     *  プラグインの名前とレイテンシーは、開始された後に反映される。
+     *  このプラグインに対しては GetChainedPlugin() はnullptrを返し、エディタを開くこともできない。
+     *  @param cid 省略した場合は、モジュールの最初のプラグインを使う
+     */
+    bool InsertRemoteVst3Plugin(UInt32 index, String module_path, std::optional<ClassInfo::CID> cid = std::nullopt);
+    //! プラグインチェインの index 番目のプラグインを取り除いて解放する。
+    //! LoadVst3Plugin() でロードしたプラグインを指定した場合は UnloadVst3Plugin() と同じ。
+    void RemoveChainedPlugin(UInt32 index);
+    //! プラグインチェインの from 番目のプラグインを、 to 番目に移動する。
+    void MoveChainedPlugin(UInt32 from, UInt32 to);
+    //! プラグインチェインの index 番目のプラグインの入力を、 inputs 番目のプラグインの出力にする。
+    /*! 複数指定した場合は、それらの出力を合成して入力にする。
+     *  空の場合はAppの入力（テスト波形やオーディオ入力、MIDI入力）を使う。
+     *  どのプラグインの入力にもなっていないプラグインの出力は、合成してデバイスに出力する。
+     *  依存関係のないプラグイン同士は、別々のスレッドで並列に処理される。
+     *  @pre inputs の各要素は index より小さいこと
+     */
+    void SetChainedPluginInputs(UInt32 index, std::vector<UInt32> const &inputs);
+    //! プラグインチェインの index 番目のプラグインの入力を、直前のプラグインの出力に戻す。
+    void ResetChainedPluginInputs(UInt32 index);
+    //! プラグインチェインの index 番目のプラグインのバイパスを切り替える。
+    void SetChainedPluginBypassed(UInt32 index, bool bypassed);
+    bool IsChainedPluginBypassed(UInt32 index) const;
+    //! プラグインチェインに含まれるプラグインの数を返す。
+    UInt32 GetNumChainedPlugins() const;
+    //! プラグインチェインの index 番目のプラグインを返す。
+    /*! InsertRemoteVst3Plugin() で挿入したプラグインの場合はnullptrを返す。
+     */
+    Vst3Plugin * GetChainedPlugin(UInt32 index);
+    
     //! ロードしたモジュールから構築したVst3PluginFactoryを返す。
     //! まだモジュールをロードしていない場合はnullptrが返る。
     Vst3PluginFactory * GetPluginFactory();
-    //! ロードしたプラグインを返す。
+    //! LoadVst3Plugin() でロードしたプラグインを返す。
     //! まだプラグインをロードしていない場合はnullptrが返る。
     Vst3Plugin * GetPlugin();
     
@@ -55,10 +154,51 @@ public:
     public:
         virtual void OnAfterPluginLoaded(Vst3Plugin *plugin) {}
         virtual void OnBeforePluginUnloaded(Vst3Plugin *plugin) {}
+        //! LoadVst3PluginAsync() によるロードの段階が進んだときに呼ばれるコールバック
+        virtual void OnPluginLoadProgress(ClassInfo::CID cid, PluginLoader::Stage stage) {}
+        //! LoadVst3PluginAsync() によるロードに失敗したときに呼ばれるコールバック
+        virtual void OnPluginLoadFailed(ClassInfo::CID cid, String error_msg) {}
     };
     using PluginLoadListenerService = IListenerService<IPluginLoadListener>;
     PluginLoadListenerService & GetPluginLoadListenerService();
     
+    //! プラグインのスキャン状態の変更通知を受け取るリスナークラス
+    class IPluginScanListener : public IListenerBase {
+    protected:
+        IPluginScanListener() {}
+    public:
+        //! バックグラウンドのスキャンが完了して、 GetScannedPlugins() の内容が更新されたときに呼ばれるコールバック
+        virtual void OnPluginScanFinished() {}
+    };
+    using PluginScanListenerService = IListenerService<IPluginScanListener>;
+    PluginScanListenerService & GetPluginScanListenerService();
+    
+    //! プロジェクトファイルの保存状態の変更通知を受け取るリスナークラス
+    class IProjectSaveListener : public IListenerBase {
+    protected:
+        IProjectSaveListener() {}
+    public:
+        //! SaveProjectFile() による書き出しの段階が進んだときに呼ばれるコールバック
+        virtual void OnProjectSaveProgress(String path, ProjectSaver::Stage stage) {}
+        //! SaveProjectFile() による書き出しが完了したときに呼ばれるコールバック
+        virtual void OnProjectSaved(String path) {}
+        //! SaveProjectFile() による書き出しに失敗したときに呼ばれるコールバック
+        virtual void OnProjectSaveFailed(String path, String error_msg) {}
+    };
+    using ProjectSaveListenerService = IListenerService<IProjectSaveListener>;
+    ProjectSaveListenerService & GetProjectSaveListenerService();
+    
+    //! スキャン済みのプラグインモジュールの一覧を返す。
+    /*! 起動直後はキャッシュファイルに保存しておいた前回のスキャン結果を返すので、モジュールをロードせずにすぐに取得できる。
+     *  バックグラウンドのスキャンが完了すると、その結果に置き換わる。
+     */
+    std::vector<PluginScanEntry> GetScannedPlugins() const;
+    //! Config::plugin_search_path_ と標準的なインストール先のディレクトリを、バックグラウンドでスキャンし直す。
+    /*! 前回のスキャンから変更のあったモジュールだけをロードして、その結果をキャッシュファイルに保存する。
+     */
+    void RescanPlugins();
+    bool IsScanningPlugins() const;
+    
     //! Appクラス再生系パラメータの変更通知を受け取るリスナークラス
     class IPlaybackOptionChangeListener : public IListenerBase {
     protected:
@@ -75,6 +215,13 @@ public:
 
         //! オーディオ入力が可能な状態で、その有効／無効を切り替えたときに呼ばれるコールバック
         virtual void OnAudioInputEnableStateChanged(bool enabled) {}
+        
+        //! 入力モニターの有効／無効を切り替えたときに呼ばれるコールバック
+        virtual void OnInputMonitoringEnableStateChanged(bool enabled) {}
+        
+        //! プラグインのレイテンシーやオーディオデバイスが変わって、
+        //! GetRoundTripLatency() の値が変化した可能性があるときに呼ばれるコールバック
+        virtual void OnLatencyChanged() {}
     };
     using PlaybackOptionChangeListenerService = IListenerService<IPlaybackOptionChangeListener>;
     PlaybackOptionChangeListenerService & GetPlaybackOptionChangeListenerService();
@@ -95,6 +242,24 @@ public:
     //! オーディオ入力を有効／無効にする
     void EnableAudioInput(bool enable = true);
     
+    //! 入力モニターが有効かどうか
+    bool IsInputMonitoringEnabled() const;
+    //! 入力モニターを有効／無効にする
+    /*! 有効な場合は、Appの入力（テスト波形やオーディオ入力）をプラグインを通さずに出力にも合成する。
+     *  入力はプラグインのグラフ全体のレイテンシー分だけ遅らせて、プラグインの出力とタイミングを揃える。
+     */
+    void EnableInputMonitoring(bool enable = true);
+    
+    //! プラグインのグラフ全体のレイテンシー（サンプル数）を返す。
+    /*! 並列の経路やバイパスしたプラグインは、最もレイテンシーが大きい経路に揃えて補正される。
+     */
+    SampleCount GetPluginLatencySamples() const;
+    //! オーディオ入力から出力までの往復のレイテンシー（秒）を返す。
+    /*! オーディオデバイスの入出力のレイテンシーと、 GetPluginLatencySamples() の合計。
+     *  オーディオデバイスをオープンしていない場合は0を返す。
+     */
+    double GetRoundTripLatency() const;
+    
     //! オーディオ出力レベルの最小値(dB値)を返す。
     double GetAudioOutputMinLevel() const;
     //! オーディオ出力レベルの最大値(dB値)を返す。
@@ -110,11 +275,19 @@ public:
     //! 再生中のノートを返す。
     std::bitset<128> GetPlayingNotes();
 
-    //! オーディオ出力レベルメータの値(dB値)を取得する。
-    /*! @param dest レベルメータの値を受け取るバッファ
+    //! オーディオ出力レベルメータの値を取得する。
+    /*! この関数はロックを行わないが、GUIスレッドからのみ呼び出すこと。
+     *  @param dest レベルメータの値を受け取るバッファ
      *  @pre dest.size() == オーディオデバイス出力のチャンネル数
      */
-    void GetAudioOutputLevelMeter(std::vector<double> &dest);
+    void GetAudioOutputLevelMeter(std::vector<LevelMeterValue> &dest);
+    
+    //! オーディオ処理の負荷とドロップアウトの回数をまとめた文字列を返す。
+    /*! デバイスのコールバック全体、サンプルフォーマットの変換、App の処理、プラグインの処理の
+     *  それぞれの処理時間の分布（中央値、99パーセンタイル値、最大値）を含む。
+     *  GUIスレッドから呼び出すこと。
+     */
+    String GetAudioProcessingLoadReport() const;
     
     //! オーディオデバイスを選択し、オープンに成功したらコンフィグファイルを更新する
     void SelectAudioDevice();
@@ -124,7 +297,14 @@ public:
     Config const & GetConfig() const;
     
     void LoadProjectFile(String path_to_load);
+    //! 現在の状態をプロジェクトファイルに保存する。
+    /*! GUIスレッドではプラグインの状態などのスナップショットを取得するだけにして、
+     *  ファイルへの書き出しは別スレッドで行う。
+     *  書き出しの進捗と結果は IProjectSaveListener で通知する。
+     */
     void SaveProjectFile(String path_to_save);
+    //! 実行中または待機中のプロジェクトファイルの書き出しがあるかどうか
+    bool IsSavingProject() const;
     
     void SaveConfig();
     
@@ -133,6 +313,7 @@ private:
     std::unique_ptr<Impl> pimpl_;
     
     bool OnInit() override;
+    int OnRun() override;
     int OnExit() override;
     
     void OnInitCmdLine(wxCmdLineParser& parser) override;
@@ -0,0 +1,266 @@
+#include "OfflineRenderer.hpp"
+
+#include <chrono>
+
+#include "../file/ProjectFile.hpp"
+#include "../file/WaveFile.hpp"
+#include "../file/StandardMidiFile.hpp"
+#include "../plugin/vst3/Vst3Plugin.hpp"
+#include "../plugin/vst3/Vst3PluginFactory.hpp"
+#include "../processor/EventBuffer.hpp"
+#include "../log/LoggingSupport.hpp"
+
+NS_HWM_BEGIN
+
+namespace {
+    //! ログファイルだけでなく、ヘッドレス環境で結果を確認できるように標準出力にも書き出す
+    void report(String const &msg)
+    {
+        HWM_INFO_LOG(msg);
+        std::cout << to_utf8(msg) << std::endl;
+    }
+    
+    void report_error(String const &msg)
+    {
+        HWM_ERROR_LOG(msg);
+        std::cerr << to_utf8(msg) << std::endl;
+    }
+}
+
+int RenderOffline(OfflineRenderOptions const &opts)
+{
+    using clock_t = std::chrono::steady_clock;
+    
+    std::optional<ProjectFile> project;
+    if(opts.project_path_.empty() == false) {
+        try {
+            ProjectFile tmp;
+            tmp.Load(opts.project_path_);
+            project = std::move(tmp);
+        } catch(std::exception &e) {
+            report_error(L"failed to load the project file [" + opts.project_path_ + L"]: " + to_wstr(e.what()));
+            return -1;
+        }
+    }
+    
+    String const module_path
+    = (opts.module_path_.empty() == false) ? opts.module_path_
+    : project ? project->vst3_plugin_path_
+    : String();
+    
+    if(module_path.empty()) {
+        report_error(L"no vst3 module is specified.");
+        return -1;
+    }
+    
+    Buffer<float> input_wave;
+    WaveFileInfo input_wave_info;
+    if(opts.input_wave_path_.empty() == false) {
+        try {
+            input_wave = ReadWaveFile(opts.input_wave_path_, &input_wave_info);
+        } catch(std::exception &e) {
+            report_error(L"failed to read the input wave file: " + to_wstr(e.what()));
+            return -1;
+        }
+    }
+    
+    std::vector<DeviceMidiMessage> input_midi;
+    if(opts.input_midi_path_.empty() == false) {
+        try {
+            input_midi = ReadStandardMidiFile(opts.input_midi_path_);
+        } catch(std::exception &e) {
+            report_error(L"failed to read the input midi file: " + to_wstr(e.what()));
+            return -1;
+        }
+    }
+    
+    double sample_rate = kSupportedSampleRateDefault;
+    if(opts.sample_rate_) { sample_rate = *opts.sample_rate_; }
+    else if(input_wave_info.sample_rate_ > 0) { sample_rate = input_wave_info.sample_rate_; }
+    else if(project) { sample_rate = project->sample_rate_; }
+    
+    Int32 block_size = kSupportedBlockSizeDefault;
+    if(opts.block_size_) { block_size = *opts.block_size_; }
+    else if(project) { block_size = project->block_size_; }
+    
+    if(sample_rate <= 0 || block_size <= 0) {
+        report_error(L"invalid sample rate or block size.");
+        return -1;
+    }
+    
+    if(input_wave_info.sample_rate_ > 0 && input_wave_info.sample_rate_ != sample_rate) {
+        // サンプルレート変換は行わない
+        HWM_WARN_LOG(L"the sample rate of the input wave file (" << input_wave_info.sample_rate_
+                     << L") differs from the rendering sample rate (" << sample_rate << L")");
+    }
+    
+    auto factory = Vst3PluginFactoryList::GetInstance()->FindOrCreateFactory(module_path);
+    if(!factory) {
+        report_error(L"failed to load the vst3 module: " + module_path);
+        return -1;
+    }
+    
+    std::unique_ptr<Vst3Plugin> plugin;
+    try {
+        if(project && opts.module_path_.empty()) {
+            plugin = factory->CreateByID(project->vst3_plugin_cid_);
+        } else if(factory->GetComponentCount() > 0) {
+            plugin = factory->CreateByIndex(0);
+        }
+        
+        if(!plugin) {
+            report_error(L"no plugin found in the module: " + module_path);
+            return -1;
+        }
+        
+        ActivateAllBuses(plugin.get());
+        plugin->SetSamplingRate(sample_rate);
+        plugin->SetBlockSize(block_size);
+        plugin->SetProcessMode(Steinberg::Vst::ProcessModes::kOffline);
+        if(opts.double_precision_) {
+            plugin->SetSymbolicSampleSize(Steinberg::Vst::SymbolicSampleSizes::kSample64);
+        }
+        plugin->Resume();
+        
+        if(project) {
+            auto const dump = project->GetVst3PluginDumpData();
+            if(dump.processor_data_.empty() == false) {
+                plugin->LoadData(dump);
+            }
+        }
+    } catch(std::exception &e) {
+        report_error(L"failed to setup the plugin: " + to_wstr(e.what()));
+        return -1;
+    }
+    
+    UInt32 const num_inputs = plugin->GetNumAudioInputs();
+    UInt32 const num_outputs = plugin->GetNumAudioOutputs();
+    if(num_outputs == 0) {
+        report_error(L"the plugin has no audio outputs: " + plugin->GetPluginName());
+        return -1;
+    }
+    
+    SampleCount input_length = input_wave.samples();
+    if(input_midi.empty() == false) {
+        auto const last_event_pos = (SampleCount)std::ceil(input_midi.back().time_stamp_ * sample_rate);
+        input_length = std::max(input_length, last_event_pos + 1);
+    }
+    
+    SampleCount const total_length = input_length + (SampleCount)std::round(opts.tail_seconds_ * sample_rate);
+    
+    std::unique_ptr<WaveFileWriter> writer;
+    try {
+        writer = std::make_unique<WaveFileWriter>(opts.output_path_, num_outputs, sample_rate);
+    } catch(std::exception &e) {
+        report_error(L"failed to open the output file: " + to_wstr(e.what()));
+        return -1;
+    }
+    
+    bool const processes_double
+    = (plugin->GetProcessingSampleSize() == Steinberg::Vst::SymbolicSampleSizes::kSample64);
+    
+    report(L"Render [" + plugin->GetPluginName() + L"] into " + opts.output_path_
+           + L" (" + std::to_wstring(total_length) + L" samples, "
+           + std::to_wstring((Int32)sample_rate) + L"Hz, block size: " + std::to_wstring(block_size)
+           + (processes_double ? L", 64-bit" : L", 32-bit") + L")");
+    
+    Buffer<float> input_buffer(std::max<UInt32>(num_inputs, 1), block_size);
+    Buffer<float> output_buffer(num_outputs, block_size);
+    // 倍精度で処理する場合は、プラグインとの間でこちらのバッファを使用する
+    Buffer<double> input_buffer64(processes_double ? input_buffer.channels() : 0, block_size);
+    Buffer<double> output_buffer64(processes_double ? num_outputs : 0, block_size);
+    EventBufferList input_event_buffers;
+    EventBufferList output_event_buffers;
+    input_event_buffers.SetNumBuffers(1);
+    output_event_buffers.SetNumBuffers(1);
+    
+    auto next_event = input_midi.begin();
+    auto const begin_time = clock_t::now();
+    
+    try {
+        for(SampleCount pos = 0; pos < total_length; pos += block_size) {
+            SampleCount const length = std::min<SampleCount>(block_size, total_length - pos);
+            
+            input_buffer.fill();
+            output_buffer.fill();
+            output_buffer64.fill();
+            
+            // モノラルのWAVEファイルは、すべての入力チャンネルに入力する
+            if(input_wave.channels() > 0 && pos < input_wave.samples()) {
+                auto const num_to_copy = std::min<SampleCount>(length, input_wave.samples() - pos);
+                for(UInt32 ch = 0; ch < num_inputs; ++ch) {
+                    auto const src_ch = (input_wave.channels() == 1) ? 0 : ch;
+                    if(src_ch >= input_wave.channels()) { break; }
+                    std::copy_n(input_wave.data()[src_ch] + pos, num_to_copy, input_buffer.data()[ch]);
+                }
+            }
+            
+            auto &buf0 = *input_event_buffers.GetBuffer(0);
+            for( ; next_event != input_midi.end(); ++next_event) {
+                auto const event_pos = (SampleCount)std::round(next_event->time_stamp_ * sample_rate);
+                if(event_pos >= pos + length) { break; }
+                
+                ProcessInfo::MidiMessage msg;
+                msg.offset_ = std::max<SampleCount>(event_pos - pos, 0);
+                msg.channel_ = next_event->channel_;
+                msg.data_ = next_event->data_;
+                buf0.AddEvent(msg);
+            }
+            buf0.Sort();
+            
+            ProcessInfo pi;
+            if(processes_double) {
+                for(UInt32 ch = 0; ch < num_inputs; ++ch) {
+                    std::copy_n(input_buffer.data()[ch], length, input_buffer64.data()[ch]);
+                }
+                pi.input_audio_buffer64_ = BufferRef<double const>(input_buffer64, 0, num_inputs, 0, length);
+                pi.output_audio_buffer64_ = BufferRef<double>(output_buffer64, 0, num_outputs, 0, length);
+            } else {
+                pi.input_audio_buffer_ = BufferRef<float const>(input_buffer, 0, num_inputs, 0, length);
+                pi.output_audio_buffer_ = BufferRef<float>(output_buffer, 0, num_outputs, 0, length);
+            }
+            pi.time_info_.is_playing_ = true;
+            pi.time_info_.sample_length_ = length;
+            pi.time_info_.sample_rate_ = sample_rate;
+            pi.time_info_.sample_pos_ = pos;
+            pi.time_info_.ppq_pos_ = (pos / sample_rate) * pi.time_info_.tempo_ / 60.0;
+            pi.input_event_buffers_ = &input_event_buffers;
+            pi.output_event_buffers_ = &output_event_buffers;
+            
+            plugin->Process(pi);
+            
+            if(processes_double) {
+                for(UInt32 ch = 0; ch < num_outputs; ++ch) {
+                    std::copy_n(output_buffer64.data()[ch], length, output_buffer.data()[ch]);
+                }
+            }
+            
+            writer->Write(BufferRef<float const>(output_buffer, 0, num_outputs, 0, length), length);
+            
+            input_event_buffers.Clear();
+            output_event_buffers.Clear();
+        }
+        
+        writer->Close();
+    } catch(std::exception &e) {
+        report_error(L"failed to render: " + to_wstr(e.what()));
+        plugin->Suspend();
+        return -1;
+    }
+    
+    plugin->Suspend();
+    
+    auto const elapsed = std::chrono::duration<double>(clock_t::now() - begin_time).count();
+    auto const rendered = total_length / sample_rate;
+    
+    std::wstringstream ss;
+    ss << L"Rendered " << rendered << L" sec in " << elapsed << L" sec";
+    if(elapsed > 0) {
+        ss << L" (x" << (rendered / elapsed) << L" realtime)";
+    }
+    report(ss.str());
+    
+    return 0;
+}
+
+NS_HWM_END
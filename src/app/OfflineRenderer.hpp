@@ -0,0 +1,40 @@
+#pragma once
+
+NS_HWM_BEGIN
+
+//! オフラインレンダリングの設定
+struct OfflineRenderOptions
+{
+    //! 書き出し先のWAVEファイルのパス
+    String output_path_;
+    //! 読み込むプロジェクトファイルのパス。（省略可）
+    String project_path_;
+    //! 読み込むモジュールファイル(*.vst3)のパス。
+    /*! 指定した場合はプロジェクトファイルに記録されたパスより優先する。
+     *  プロジェクトファイルを指定しない場合は、モジュール内の最初のプラグインを使用する。
+     */
+    String module_path_;
+    //! プラグインへのオーディオ入力とするWAVEファイルのパス。（省略可）
+    String input_wave_path_;
+    //! プラグインへのMIDI入力とするStandard MIDI Fileのパス。（省略可）
+    String input_midi_path_;
+    //! 省略時は入力WAVEファイル、プロジェクトファイルの順に参照し、どちらもなければデフォルト値を使用する
+    std::optional<double> sample_rate_;
+    //! 省略時はプロジェクトファイルの設定かデフォルト値を使用する
+    std::optional<Int32> block_size_;
+    //! 入力の終端以降に追加でレンダリングする長さ(秒)
+    double tail_seconds_ = 2.0;
+    //! プラグインが対応していれば、倍精度(kSample64)で処理する
+    /*! 精度の変換は、入力WAVEファイルの読み込み時と出力WAVEファイルへの書き出し時にだけ行う。
+     */
+    bool double_precision_ = false;
+};
+
+//! オーディオデバイスを使用せずに、プラグインの処理結果をWAVEファイルに書き出す。
+/*! プラグインは Steinberg::Vst::ProcessModes::kOffline で動作させ、
+ *  実時間を待たずにできるだけ速く処理を行う。
+ *  @return プロセスの終了コード。成功時は0
+ */
+int RenderOffline(OfflineRenderOptions const &opts);
+
+NS_HWM_END
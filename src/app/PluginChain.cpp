@@ -0,0 +1,259 @@
+#include "PluginChain.hpp"
+
+#include <algorithm>
+#include <type_traits>
+
+NS_HWM_BEGIN
+
+PluginChainNode::PluginChainNode(std::shared_ptr<Vst3PluginFactory> factory,
+                                 std::unique_ptr<Vst3Plugin> plugin)
+:   factory_(std::move(factory))
+,   plugin_(std::move(plugin))
+{
+    assert(plugin_);
+    is_effect_ = plugin_->GetComponentInfo().IsEffect();
+    input_event_buffers_.SetNumBuffers(1);
+    output_event_buffers_.SetNumBuffers(1);
+}
+
+PluginChainNode::PluginChainNode(std::unique_ptr<RemotePlugin> remote_plugin)
+:   remote_plugin_(std::move(remote_plugin))
+{
+    assert(remote_plugin_);
+    input_event_buffers_.SetNumBuffers(1);
+    output_event_buffers_.SetNumBuffers(1);
+}
+
+PluginChainNode::PluginChainNode(std::unique_ptr<IPluginChainNodeProcessor> processor, bool is_effect)
+:   processor_(std::move(processor))
+,   is_effect_(is_effect)
+{
+    assert(processor_);
+    input_event_buffers_.SetNumBuffers(1);
+    output_event_buffers_.SetNumBuffers(1);
+}
+
+PluginChainNode::~PluginChainNode()
+{
+    // ファクトリより先にプラグインを解放する
+    plugin_.reset();
+}
+
+Vst3Plugin * PluginChainNode::GetPlugin() const
+{
+    return plugin_.get();
+}
+
+RemotePlugin * PluginChainNode::GetRemotePlugin() const
+{
+    return remote_plugin_.get();
+}
+
+bool PluginChainNode::IsEffect() const
+{
+    // 別プロセスのプラグインの種類は、プラグインホストプロセスを開始するまでわからない
+    return (remote_plugin_ ? remote_plugin_->IsEffect() : is_effect_);
+}
+
+String PluginChainNode::GetPluginName() const
+{
+    if(remote_plugin_) { return remote_plugin_->GetPluginName(); }
+    if(processor_) { return processor_->GetPluginName(); }
+    return plugin_->GetPluginName();
+}
+
+UInt32 PluginChainNode::GetLatencySamples() const
+{
+    if(remote_plugin_) { return remote_plugin_->GetLatencySamples(); }
+    if(processor_) { return processor_->GetLatencySamples(); }
+    return plugin_->GetLatencySamples();
+}
+
+void PluginChainNode::SetBypassed(bool bypassed)
+{
+    bypassed_.store(bypassed);
+}
+
+bool PluginChainNode::IsBypassed() const
+{
+    return bypassed_.load();
+}
+
+bool PluginChainNode::ProcessesDoublePrecision() const
+{
+    if(processor_) { return processor_->UsesDoublePrecision(); }
+    // 別プロセスのプラグインとは、単精度で受け渡す
+    return (plugin_ && plugin_->GetProcessingSampleSize() == Steinberg::Vst::SymbolicSampleSizes::kSample64);
+}
+
+void PluginChainNode::PrepareBuffers(UInt32 num_channels, SampleCount max_block_size, bool double_precision)
+{
+    auto resize = [](auto &buffer, bool used, UInt32 num_channels, SampleCount max_block_size) {
+        if(used) { buffer.resize(num_channels, max_block_size); }
+        else { buffer.resize(0, 0); }
+    };
+
+    resize(mix_buffer_, !double_precision, num_channels, max_block_size);
+    resize(output_buffer_, !double_precision, num_channels, max_block_size);
+    resize(mix_buffer64_, double_precision, num_channels, max_block_size);
+    resize(output_buffer64_, double_precision, num_channels, max_block_size);
+
+    // プラグインの処理精度がグラフと異なる場合だけ、変換用のバッファを確保する
+    bool const plugin_double_precision = ProcessesDoublePrecision();
+    bool const converts = (plugin_double_precision != double_precision);
+    resize(conversion_buffers_.input_, converts && !plugin_double_precision, num_channels, max_block_size);
+    resize(conversion_buffers_.output_, converts && !plugin_double_precision, num_channels, max_block_size);
+    resize(conversion_buffers64_.input_, converts && plugin_double_precision, num_channels, max_block_size);
+    resize(conversion_buffers64_.output_, converts && plugin_double_precision, num_channels, max_block_size);
+}
+
+EventBufferList & PluginChainNode::GetInputEventBuffers()
+{
+    return input_event_buffers_;
+}
+
+EventBufferList const & PluginChainNode::GetOutputEventBuffers() const
+{
+    return output_event_buffers_;
+}
+
+namespace {
+
+void SetAudioBuffers(ProcessInfo &pi, BufferRef<AudioSample const> input, BufferRef<AudioSample> output)
+{
+    pi.input_audio_buffer_ = input;
+    pi.output_audio_buffer_ = output;
+}
+
+void SetAudioBuffers(ProcessInfo &pi, BufferRef<double const> input, BufferRef<double> output)
+{
+    pi.input_audio_buffer64_ = input;
+    pi.output_audio_buffer64_ = output;
+}
+
+} // namespace
+
+template<class U, class T, class F>
+void PluginChainNode::ProcessWithSampleType(BufferRef<T const> input, BufferRef<T> output, F f)
+{
+    if constexpr(std::is_same_v<T, U>) {
+        f(input, output);
+    } else {
+        auto &buffers = [this]() -> ConversionBuffers<U> & {
+            if constexpr(std::is_same_v<U, double>) { return conversion_buffers64_; }
+            else { return conversion_buffers_; }
+        }();
+
+        auto const block_size = output.samples();
+        assert(buffers.input_.samples() >= block_size);
+
+        auto const num_inputs = std::min(input.channels(), buffers.input_.channels());
+        for(UInt32 ch = 0; ch < num_inputs; ++ch) {
+            std::copy_n(input.get_channel_data(ch), block_size, buffers.input_.data()[ch]);
+        }
+
+        auto const num_outputs = std::min(output.channels(), buffers.output_.channels());
+        BufferRef<U> converted_output(buffers.output_, 0, num_outputs, 0, block_size);
+        // 処理されなかったブロックで、前のブロックの出力を output にコピーしないようにする
+        converted_output.fill(U(0));
+
+        f(BufferRef<U const>(buffers.input_, 0, num_inputs, 0, block_size), converted_output);
+
+        for(UInt32 ch = 0; ch < num_outputs; ++ch) {
+            std::copy_n(buffers.output_.data()[ch], block_size, output.get_channel_data(ch));
+        }
+    }
+}
+
+template<class T>
+void PluginChainNode::ProcessImpl(ProcessInfo::TimeInfo const &time_info,
+                                  BufferRef<T const> input,
+                                  BufferRef<T> output,
+                                  DelayLine<T> &bypass_delay)
+{
+    auto const block_size = output.samples();
+    assert(block_size <= GetOutputBuffer<T>().samples());
+
+    output_event_buffers_.Clear();
+
+    bool const bypassed = IsBypassed();
+    if(bypassed && !was_bypassed_) {
+        // バイパスする前の信号が残っていないようにする
+        bypass_delay.Clear();
+    }
+    was_bypassed_ = bypassed;
+
+    if(bypassed) {
+        auto const num_channels = std::min(input.channels(), output.channels());
+        bypass_delay.Process(BufferRef<T const>(input.data(), input.channel_from(), num_channels,
+                                                input.sample_from(), block_size),
+                             BufferRef<T>(output.data(), output.channel_from(), num_channels,
+                                          output.sample_from(), block_size));
+        for(UInt32 ch = num_channels; ch < output.channels(); ++ch) {
+            std::fill_n(output.get_channel_data(ch), block_size, T(0));
+        }
+        for(UInt32 i = 0; i < output_event_buffers_.GetNumBuffers(); ++i) {
+            output_event_buffers_.GetBuffer(i)->AddEvents(input_event_buffers_.GetRef(i));
+        }
+        return;
+    }
+
+    if(remote_plugin_) {
+        ProcessWithSampleType<AudioSample>(input, output, [&](auto in, auto out) {
+            remote_plugin_->Process(time_info, in, out, input_event_buffers_, output_event_buffers_);
+        });
+        return;
+    }
+
+    ProcessInfo pi;
+    pi.time_info_ = time_info;
+    pi.input_event_buffers_ = &input_event_buffers_;
+    pi.output_event_buffers_ = &output_event_buffers_;
+
+    // プラグインは、処理中の状態でない場合などにブロックの処理を行わずに戻るので、
+    // 前のブロックの出力が残らないように無音にしておく
+    for(UInt32 ch = 0; ch < output.channels(); ++ch) {
+        std::fill_n(output.get_channel_data(ch), block_size, T(0));
+    }
+
+    auto process = [&](auto in, auto out) {
+        SetAudioBuffers(pi, in, out);
+        if(processor_) { processor_->Process(pi); }
+        else { plugin_->Process(pi); }
+    };
+    if(ProcessesDoublePrecision()) {
+        ProcessWithSampleType<double>(input, output, process);
+    } else {
+        ProcessWithSampleType<AudioSample>(input, output, process);
+    }
+
+    auto const num_po = (processor_ ? processor_->GetNumAudioOutputs() : plugin_->GetNumAudioOutputs());
+    if(num_po == 1) {
+        // spread mono channel to the other channels
+        for(UInt32 ch = 1; ch < output.channels(); ++ch) {
+            std::copy_n(output.get_channel_data(0), block_size, output.get_channel_data(ch));
+        }
+    } else {
+        for(UInt32 ch = num_po; ch < output.channels(); ++ch) {
+            std::fill_n(output.get_channel_data(ch), block_size, T(0));
+        }
+    }
+}
+
+void PluginChainNode::Process(ProcessInfo::TimeInfo const &time_info,
+                              BufferRef<AudioSample const> input,
+                              BufferRef<AudioSample> output,
+                              DelayLine<AudioSample> &bypass_delay)
+{
+    ProcessImpl(time_info, input, output, bypass_delay);
+}
+
+void PluginChainNode::Process(ProcessInfo::TimeInfo const &time_info,
+                              BufferRef<double const> input,
+                              BufferRef<double> output,
+                              DelayLine<double> &bypass_delay)
+{
+    ProcessImpl(time_info, input, output, bypass_delay);
+}
+
+NS_HWM_END
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+
+#include "../misc/Buffer.hpp"
+#include "../misc/DelayLine.hpp"
+#include "../plugin/vst3/Vst3Plugin.hpp"
+#include "../plugin/vst3/Vst3PluginFactory.hpp"
+#include "../processor/EventBuffer.hpp"
+#include "./RemotePlugin.hpp"
+
+NS_HWM_BEGIN
+
+//! ノードでプラグインの代わりに処理を行うオブジェクト
+/*! プラグインを読み込まずにノードの処理を確認するテストで使用する。
+ */
+class IPluginChainNodeProcessor
+{
+public:
+    virtual ~IPluginChainNodeProcessor() {}
+
+    virtual String GetPluginName() const = 0;
+    virtual UInt32 GetLatencySamples() const = 0;
+    virtual UInt32 GetNumAudioOutputs() const = 0;
+
+    //! true を返すと、 Vst3Plugin の kSample64 と同じく ProcessInfo の倍精度のバッファで処理する
+    virtual bool UsesDoublePrecision() const { return false; }
+
+    //! Vst3Plugin::Process() と同じく、ブロックの処理を行わずに戻ることがある。
+    virtual void Process(ProcessInfo &pi) = 0;
+};
+
+//! プラグインチェインの、ひとつのノード
+/*! ノードごとにイベントバッファと出力バッファを持ち、前段のノードの出力が次段のノードの入力になる。
+ *  ノード間のバッファは、グラフ全体で単精度（AudioSample）か倍精度（double）のどちらかに揃える。
+ *  プラグインの処理精度がグラフと異なるノードだけが、ノードの中で精度を変換する。
+ *  バッファは PrepareBuffers() でだけ確保し、 Process() ではメモリの確保もロックも行わない。
+ *  ノードごとにバッファが独立しているので、依存関係のないノード同士は別々のスレッドで同時に処理できる。
+ */
+class PluginChainNode
+{
+public:
+    //! @param factory プラグインを作成したファクトリ。
+    //! ノードが解放されるまでモジュールがアンロードされないように保持する。
+    PluginChainNode(std::shared_ptr<Vst3PluginFactory> factory,
+                    std::unique_ptr<Vst3Plugin> plugin);
+
+    //! プラグインを別プロセスで動作させるノードを作成する。
+    /*! プラグインホストプロセスの開始と停止は、ノードの利用側で行う。
+     */
+    explicit
+    PluginChainNode(std::unique_ptr<RemotePlugin> remote_plugin);
+
+    //! プラグインの代わりに processor で処理を行うノードを作成する。
+    PluginChainNode(std::unique_ptr<IPluginChainNodeProcessor> processor, bool is_effect);
+    ~PluginChainNode();
+
+    PluginChainNode(PluginChainNode const &) = delete;
+    PluginChainNode & operator=(PluginChainNode const &) = delete;
+
+    //! このプロセスで動作しているプラグイン。別プロセスで動作させるノードや、
+    //! IPluginChainNodeProcessor で処理するノードではnullptrを返す
+    Vst3Plugin * GetPlugin() const;
+    //! 別プロセスで動作しているプラグイン。それ以外のノードではnullptrを返す
+    RemotePlugin * GetRemotePlugin() const;
+    bool IsEffect() const;
+    String GetPluginName() const;
+    UInt32 GetLatencySamples() const;
+
+    //! バイパスの状態を変更する。どのスレッドから呼び出してもよい。
+    /*! バイパス中のノードはプラグインの処理を行わず、入力とイベントをそのまま出力に渡す。
+     *  バイパスを切り替えても後段とのタイミングがずれないように、
+     *  オーディオ信号は Process() に渡したディレイラインでプラグインのレイテンシー分だけ遅らせる。
+     */
+    void SetBypassed(bool bypassed);
+    bool IsBypassed() const;
+
+    //! 出力バッファとイベントバッファを確保する。
+    /*! オーディオスレッドがこのノードを参照していないときに呼び出すこと。
+     *  @param double_precision ノード間で倍精度のバッファを受け渡す場合はtrue
+     */
+    void PrepareBuffers(UInt32 num_channels, SampleCount max_block_size, bool double_precision);
+
+    //! 複数のノードの出力を合成して入力にするときに使うバッファ
+    /*! @tparam T PrepareBuffers() で単精度を指定した場合は AudioSample、倍精度を指定した場合は double
+     */
+    template<class T = AudioSample>
+    Buffer<T> & GetMixBuffer()
+    {
+        if constexpr(std::is_same_v<T, double>) { return mix_buffer64_; }
+        else { return mix_buffer_; }
+    }
+
+    //! @tparam T GetMixBuffer() と同じ
+    template<class T = AudioSample>
+    Buffer<T> & GetOutputBuffer()
+    {
+        if constexpr(std::is_same_v<T, double>) { return output_buffer64_; }
+        else { return output_buffer_; }
+    }
+
+    //! プラグインに渡すイベント。 Process() の前に、前段の出力イベントを書き込んでおく
+    EventBufferList & GetInputEventBuffers();
+    EventBufferList const & GetOutputEventBuffers() const;
+
+    //! プラグインの処理を行う。
+    /*! @param output 書き込み先。 GetOutputBuffer() かデバイスの出力バッファを指す。
+     *  プラグインがブロックの処理を行わなかった場合は、無音が書き込まれる。
+     *  プラグインの出力がモノラルで output が2チャンネル以上ある場合は、すべてのチャンネルに同じ信号を書き込む。
+     *  @param bypass_delay バイパス中に入力を遅らせるディレイライン。
+     *  遅延時間は GetLatencySamples() に合わせておく。（イベントは遅らせない）
+     *  @pre PrepareBuffers() で確保した大きさを超えないこと
+     */
+    void Process(ProcessInfo::TimeInfo const &time_info,
+                 BufferRef<AudioSample const> input,
+                 BufferRef<AudioSample> output,
+                 DelayLine<AudioSample> &bypass_delay);
+
+    //! PrepareBuffers() で倍精度を指定した場合に、倍精度のバッファで処理を行う。
+    /*! 別プロセスのプラグインとは単精度で受け渡す。（倍精度への変換はプラグインホストプロセスで行う）
+     */
+    void Process(ProcessInfo::TimeInfo const &time_info,
+                 BufferRef<double const> input,
+                 BufferRef<double> output,
+                 DelayLine<double> &bypass_delay);
+
+private:
+    //! グラフとプラグインで処理精度が異なるときに、プラグインに渡すバッファ
+    template<class T>
+    struct ConversionBuffers
+    {
+        Buffer<T> input_;
+        Buffer<T> output_;
+    };
+
+    //! プラグイン（または IPluginChainNodeProcessor）が倍精度で処理するかどうか
+    bool ProcessesDoublePrecision() const;
+
+    template<class T>
+    void ProcessImpl(ProcessInfo::TimeInfo const &time_info,
+                     BufferRef<T const> input,
+                     BufferRef<T> output,
+                     DelayLine<T> &bypass_delay);
+
+    //! U の精度のバッファで f を呼び出す。 T と異なる場合は ConversionBuffers を経由して変換する
+    template<class U, class T, class F>
+    void ProcessWithSampleType(BufferRef<T const> input, BufferRef<T> output, F f);
+
+    std::shared_ptr<Vst3PluginFactory> factory_;
+    std::unique_ptr<Vst3Plugin> plugin_;
+    std::unique_ptr<RemotePlugin> remote_plugin_;
+    std::unique_ptr<IPluginChainNodeProcessor> processor_;
+    bool is_effect_ = false;
+    std::atomic<bool> bypassed_ = { false };
+    //! 直前の Process() でバイパスしていたかどうか。オーディオスレッドからだけ参照する
+    bool was_bypassed_ = false;
+
+    //! ノード間で受け渡すバッファ。 PrepareBuffers() で指定した精度の方だけを確保する
+    Buffer<AudioSample> mix_buffer_;
+    Buffer<AudioSample> output_buffer_;
+    Buffer<double> mix_buffer64_;
+    Buffer<double> output_buffer64_;
+    ConversionBuffers<AudioSample> conversion_buffers_;
+    ConversionBuffers<double> conversion_buffers64_;
+    EventBufferList input_event_buffers_;
+    EventBufferList output_event_buffers_;
+};
+
+using PluginChainNodePtr = std::shared_ptr<PluginChainNode>;
+
+//! プラグインチェインに挿入できるプラグインの最大数
+constexpr UInt32 kMaxNumChainedPlugins = 256;
+
+NS_HWM_END
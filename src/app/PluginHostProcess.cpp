@@ -0,0 +1,183 @@
+#include "PluginHostProcess.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <wx/process.h>
+
+#include "../misc/InterProcessSignal.hpp"
+#include "../misc/SharedMemory.hpp"
+#include "../misc/StrCnv.hpp"
+#include "../plugin/vst3/Vst3Plugin.hpp"
+#include "../plugin/vst3/Vst3PluginFactory.hpp"
+#include "../log/LoggingSupport.hpp"
+#include "./PluginChain.hpp"
+#include "./PluginHostProtocol.hpp"
+
+NS_HWM_BEGIN
+
+namespace {
+
+//! 親プロセスの生存を確認する間隔
+constexpr auto kParentCheckInterval = std::chrono::seconds(1);
+
+std::unique_ptr<Vst3Plugin> CreatePlugin(Vst3PluginFactory &factory, PluginHostSharedData const &data)
+{
+    if(data.has_cid_) {
+        return factory.CreateByID(data.cid_);
+    }
+
+    for(size_t i = 0; i < factory.GetComponentCount(); ++i) {
+        if(factory.GetComponentInfo(i).GetCategory() == to_wstr(kVstAudioEffectClass)) {
+            return factory.CreateByIndex(i);
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+int RunPluginHostProcess(String const &shared_memory_name)
+{
+    using clock_t = std::chrono::steady_clock;
+
+    std::unique_ptr<SharedMemory> shm;
+    try {
+        shm = SharedMemory::Open(shared_memory_name, sizeof(PluginHostSharedData));
+    } catch(std::exception &e) {
+        HWM_ERROR_LOG(L"Failed to open the shared memory for the plugin host: " << to_wstr(e.what()));
+        return -1;
+    }
+
+    auto &data = *static_cast<PluginHostSharedData *>(shm->GetData());
+    if(data.magic_ != PluginHostSharedData::kMagic || data.version_ != PluginHostSharedData::kVersion) {
+        HWM_ERROR_LOG(L"Unknown plugin host protocol.");
+        return -1;
+    }
+
+    auto fail = [&](String const &msg) {
+        HWM_ERROR_LOG(msg);
+        data.host_state_.store(PluginHostSharedData::kFailed);
+        return -1;
+    };
+
+    std::unique_ptr<InterProcessSignal> request;
+    std::unique_ptr<InterProcessSignal> response;
+    try {
+        request = std::make_unique<InterProcessSignal>(data.request_counter_, shared_memory_name + L"_req", false);
+        response = std::make_unique<InterProcessSignal>(data.response_counter_, shared_memory_name + L"_res", false);
+    } catch(std::exception &e) {
+        return fail(L"Failed to open the plugin host signals: " + to_wstr(e.what()));
+    }
+
+    data.module_path_[PluginHostSharedData::kMaxPathLength - 1] = '\0';
+    auto const module_path = to_wstr(data.module_path_);
+    auto const num_channels = std::min(data.num_channels_, PluginHostSharedData::kMaxNumChannels);
+    auto const max_block_size = std::min<UInt32>(data.max_block_size_, PluginHostSharedData::kMaxBlockSize);
+
+    auto factory = Vst3PluginFactoryList::GetInstance()->FindOrCreateFactory(module_path);
+    if(!factory) {
+        return fail(L"Failed to load the vst3 module: " + module_path);
+    }
+
+    std::unique_ptr<PluginChainNode> node;
+    try {
+        auto plugin = CreatePlugin(*factory, data);
+        if(!plugin) {
+            return fail(L"No plugin found in the module: " + module_path);
+        }
+
+        ActivateAllBuses(plugin.get());
+        plugin->SetSamplingRate(data.sample_rate_);
+        plugin->SetBlockSize(max_block_size);
+        if(data.use_double_precision_) {
+            plugin->SetSymbolicSampleSize(Steinberg::Vst::SymbolicSampleSizes::kSample64);
+        }
+
+        node = std::make_unique<PluginChainNode>(factory, std::move(plugin));
+        node->PrepareBuffers(num_channels, max_block_size, false);
+        node->GetPlugin()->Resume();
+    } catch(std::exception &e) {
+        return fail(L"Failed to setup the plugin [" + module_path + L"]: " + to_wstr(e.what()));
+    }
+
+    auto *plugin = node->GetPlugin();
+    auto const name = to_utf8(plugin->GetPluginName());
+    auto const name_length = std::min<size_t>(name.size(), PluginHostSharedData::kMaxNameLength - 1);
+    std::memcpy(data.plugin_name_, name.data(), name_length);
+    data.plugin_name_[name_length] = '\0';
+    data.is_effect_ = node->IsEffect();
+    data.latency_samples_.store(plugin->GetLatencySamples());
+
+    HWM_INFO_LOG(L"Plugin host started [" << plugin->GetPluginName() << L"]");
+    data.host_state_.store(PluginHostSharedData::kReady);
+
+    auto &input_events = *node->GetInputEventBuffers().GetBuffer(0);
+    // プラグインホストプロセスではバイパスしないので、ディレイラインは使われない
+    DelayLine<AudioSample> bypass_delay;
+    Buffer<AudioSample> output(num_channels, max_block_size);
+
+    UInt32 last_request = request->GetCount();
+    auto last_parent_check = clock_t::now();
+    for( ; ; ) {
+        bool const requested = request->Wait(last_request, kParentCheckInterval);
+
+        if(data.quit_requested_.load()) { break; }
+
+        auto const now = clock_t::now();
+        if(now - last_parent_check >= kParentCheckInterval) {
+            last_parent_check = now;
+            if(wxProcess::Exists((int)data.parent_process_id_) == false) {
+                HWM_WARN_LOG(L"The parent process has exited.");
+                break;
+            }
+        }
+
+        if(requested == false) { continue; }
+        last_request = request->GetCount();
+
+        auto const block_size = std::min(data.block_size_, max_block_size);
+
+        input_events.Clear();
+        auto const num_input_events = std::min(data.num_input_events_, PluginHostSharedData::kMaxNumEvents);
+        for(UInt32 i = 0; i < num_input_events; ++i) {
+            input_events.AddEvent(data.input_events_[i]);
+        }
+
+        AudioSample const *input_channels[PluginHostSharedData::kMaxNumChannels];
+        for(UInt32 ch = 0; ch < num_channels; ++ch) {
+            input_channels[ch] = data.input_audio_[ch];
+        }
+
+        auto const process_begin = clock_t::now();
+        node->Process(data.time_info_,
+                      BufferRef<AudioSample const>(input_channels, 0, num_channels, 0, block_size),
+                      BufferRef<AudioSample>(output, 0, num_channels, 0, block_size),
+                      bypass_delay);
+        auto const process_end = clock_t::now();
+
+        for(UInt32 ch = 0; ch < num_channels; ++ch) {
+            std::copy_n(output.data()[ch], block_size, data.output_audio_[ch]);
+        }
+
+        auto const output_events = node->GetOutputEventBuffers().GetRef(0);
+        auto const num_output_events = std::min<UInt32>(output_events.size(), PluginHostSharedData::kMaxNumEvents);
+        std::copy_n(output_events.begin(), num_output_events, data.output_events_);
+        data.num_output_events_ = num_output_events;
+
+        data.process_time_usec_
+        = std::chrono::duration_cast<std::chrono::microseconds>(process_end - process_begin).count();
+        data.latency_samples_.store(plugin->GetLatencySamples());
+
+        response->Notify();
+    }
+
+    plugin->Suspend();
+    node.reset();
+    data.host_state_.store(PluginHostSharedData::kExited);
+    HWM_INFO_LOG(L"Plugin host exited.");
+    return 0;
+}
+
+NS_HWM_END
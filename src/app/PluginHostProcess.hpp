@@ -0,0 +1,15 @@
+#pragma once
+
+NS_HWM_BEGIN
+
+//! 別プロセスで動作させるプラグインをロードして、親プロセスからのリクエストを処理する。
+/*! アプリケーションが --plugin-host オプション付きで起動されたときに、GUIを作成せずに呼び出される。
+ *  共有メモリに書き込まれた設定でプラグインを開始し、親プロセスから終了を要求されるか、
+ *  親プロセスが終了するまでリクエストを処理し続ける。
+ *  プラグインがクラッシュした場合は、このプロセスだけが終了する。
+ *  @param shared_memory_name 親プロセスが作成した、PluginHostSharedData を配置した共有メモリの名前
+ *  @return プロセスの終了コード。成功時は0
+ */
+int RunPluginHostProcess(String const &shared_memory_name);
+
+NS_HWM_END
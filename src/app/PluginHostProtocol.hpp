@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <type_traits>
+
+#include "../device/DeviceType.hpp"
+#include "../plugin/vst3/ClassInfo.hpp"
+#include "../processor/EventBuffer.hpp"
+#include "../processor/ProcessInfo.hpp"
+
+NS_HWM_BEGIN
+
+//! プラグインを別プロセスで動作させるときに、親プロセスとプラグインホストプロセスで共有するデータ
+/*! 親プロセスが共有メモリ上に配置し、プラグインホストプロセスを起動する前に設定項目を書き込む。
+ *  プラグインホストプロセスはプラグインを開始したら、プラグインの情報を書き込んでから host_state_ を kReady にする。
+ *
+ *  オーディオデータとイベントは、ブロックごとに1つの領域でやり取りする。
+ *  親プロセスは入力を書き込んでから request_counter_ を進め、
+ *  プラグインホストプロセスは出力を書き込んでから response_counter_ を進める。
+ *  前のブロックの応答が返ってくるまで、親プロセスは次のブロックの入力を書き込まない。
+ *
+ *  両方のプロセスは同じ実行ファイルから起動されるので、構造体のレイアウトは一致している。
+ */
+struct PluginHostSharedData
+{
+    static constexpr UInt32 kMagic = 0x50485748; // "HWHP"
+    static constexpr UInt32 kVersion = 1;
+    static constexpr UInt32 kMaxNumChannels = 16;
+    static constexpr UInt32 kMaxBlockSize = kSupportedBlockSizeMax;
+    static constexpr UInt32 kMaxNumEvents = EventBuffer::kDefaultCapacity;
+    static constexpr UInt32 kMaxPathLength = 4096;
+    static constexpr UInt32 kMaxNameLength = 256;
+
+    enum HostState : UInt32 {
+        kStarting,  //!< プラグインホストプロセスの起動中
+        kReady,     //!< プラグインを開始して、リクエストを受け付けられる
+        kFailed,    //!< プラグインのロードや開始に失敗した
+        kExited,    //!< プラグインホストプロセスが正常に終了した
+    };
+
+    UInt32 magic_ = kMagic;
+    UInt32 version_ = kVersion;
+
+    //! @name 親プロセスが起動前に書き込む設定
+    //@{
+    //! モジュールファイルのパス (UTF-8, null終端)
+    char module_path_[kMaxPathLength] = {};
+    //! falseの場合は、モジュールの最初のプラグインを使う
+    bool has_cid_ = false;
+    ClassInfo::CID cid_ = {};
+    double sample_rate_ = 44100.0;
+    UInt32 max_block_size_ = 0;
+    UInt32 num_channels_ = 0;
+    bool use_double_precision_ = false;
+    //! 親プロセスが異常終了したことを検出するための、親プロセスのID
+    UInt64 parent_process_id_ = 0;
+    //@}
+
+    //! @name プラグインホストプロセスが kReady の前に書き込む情報
+    //@{
+    //! プラグイン名 (UTF-8, null終端)
+    char plugin_name_[kMaxNameLength] = {};
+    bool is_effect_ = false;
+    //@}
+
+    std::atomic<UInt32> host_state_ = { kStarting };
+    //! プラグインのレイテンシー。プラグインホストプロセスが更新する
+    std::atomic<UInt32> latency_samples_ = { 0 };
+    //! 親プロセスからの終了要求
+    std::atomic<bool> quit_requested_ = { false };
+    std::atomic<UInt32> request_counter_ = { 0 };
+    std::atomic<UInt32> response_counter_ = { 0 };
+
+    //! @name ブロックごとにやり取りするデータ
+    //@{
+    ProcessInfo::TimeInfo time_info_;
+    UInt32 block_size_ = 0;
+    UInt32 num_input_events_ = 0;
+    UInt32 num_output_events_ = 0;
+    //! プラグインの処理にかかった時間 [us]。プラグインホストプロセスが書き込む
+    UInt64 process_time_usec_ = 0;
+    ProcessInfo::MidiMessage input_events_[kMaxNumEvents];
+    ProcessInfo::MidiMessage output_events_[kMaxNumEvents];
+    AudioSample input_audio_[kMaxNumChannels][kMaxBlockSize];
+    AudioSample output_audio_[kMaxNumChannels][kMaxBlockSize];
+    //@}
+};
+
+static_assert(std::atomic<UInt32>::is_always_lock_free,
+              "atomic variables in the shared memory must be lock free");
+static_assert(std::is_trivially_copyable<ProcessInfo::TimeInfo>::value,
+              "TimeInfo must be trivially copyable to be shared between processes");
+
+//! プラグインホストプロセスの起動時に、共有メモリの名前を渡すコマンドラインオプション
+constexpr char const *kPluginHostOptionName = "plugin-host";
+
+NS_HWM_END
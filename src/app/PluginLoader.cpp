@@ -0,0 +1,236 @@
+#include "PluginLoader.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+
+#include "../misc/LockFactory.hpp"
+#include "../misc/StrCnv.hpp"
+#include "../log/LoggingSupport.hpp"
+
+NS_HWM_BEGIN
+
+class PluginLoader::Impl
+{
+public:
+    struct Job
+    {
+        UInt64 id_ = 0;
+        TaskPtr task_;
+        String error_msg_;
+    };
+    using JobPtr = std::shared_ptr<Job>;
+
+    Dispatcher dispatcher_;
+    ProgressCallback progress_;
+    FinishedCallback finished_;
+    //! Dispatcher で呼び出される処理が、 PluginLoader の破棄後に何もしないようにするための参照
+    std::weak_ptr<Impl> weak_self_;
+
+    LockFactory lf_;
+    std::condition_variable cv_;
+    std::thread thread_;
+    bool quit_ = false;
+    //! ロード用のスレッドで準備を待っているリクエスト
+    JobPtr pending_;
+    //! 最後に完了したロードの結果。GUIスレッドからだけアクセスする
+    std::optional<Result> result_;
+    //! 最新のリクエストのID。これと異なるIDのロードは中断する
+    std::atomic<UInt64> latest_id_ = { 0 };
+    std::atomic<bool> is_loading_ = { false };
+
+    bool IsSuperseded(UInt64 id) const
+    {
+        return latest_id_.load() != id;
+    }
+
+    //! f をGUIスレッドで呼び出す。 PluginLoader が破棄されていた場合は呼び出さない
+    void Dispatch(std::function<void(Impl *self)> f)
+    {
+        dispatcher_([weak = weak_self_, f = std::move(f)] {
+            if(auto self = weak.lock()) { f(self.get()); }
+        });
+    }
+
+    void Run()
+    {
+        for( ; ; ) {
+            JobPtr job;
+            {
+                auto lock = lf_.make_lock();
+                cv_.wait(lock, [this] { return quit_ || pending_; });
+                if(quit_) { return; }
+
+                job = std::move(pending_);
+            }
+
+            // ここではまだプラグインを作成していないので、中断したリクエストはこのスレッドで解放してよい
+            if(IsSuperseded(job->id_)) { continue; }
+
+            if(job->task_->HasStage(Stage::kPreparing)) {
+                Dispatch([id = job->id_](Impl *self) { self->NotifyProgress(id, Stage::kPreparing); });
+                try {
+                    job->task_->Prepare();
+                } catch(std::exception &e) {
+                    job->error_msg_ = to_wstr(e.what());
+                }
+            }
+
+            // 以降の段階は、GUIスレッドで行う
+            Dispatch([job = std::move(job)](Impl *self) { self->StartNextStage(job, Stage::kPreparing); });
+        }
+    }
+
+    void NotifyProgress(UInt64 id, Stage stage)
+    {
+        if(IsSuperseded(id) || !progress_) { return; }
+        progress_(id, stage);
+    }
+
+    //! 中断されたロードであれば、 true を返す。
+    /*! 中断したロードのタスクは、ジョブを参照する最後の処理が終わったときに、GUIスレッドで解放される。
+     */
+    bool CheckSuperseded(Job const &job) const
+    {
+        if(IsSuperseded(job.id_) == false) { return false; }
+
+        HWM_DEBUG_LOG(L"Plugin load superseded: " << job.id_);
+        return true;
+    }
+
+    //! stage の次の段階を開始する。GUIスレッドから呼び出す
+    void StartNextStage(JobPtr const &job, Stage stage)
+    {
+        if(CheckSuperseded(*job)) { return; }
+        if(job->error_msg_.empty() == false) {
+            Finish(*job);
+            return;
+        }
+
+        auto next = (int)stage + 1;
+        for( ; next <= (int)Stage::kActivating; ++next) {
+            if(job->task_->HasStage((Stage)next)) { break; }
+        }
+        if(next > (int)Stage::kActivating) {
+            Finish(*job);
+            return;
+        }
+
+        NotifyProgress(job->id_, (Stage)next);
+        // 進捗の表示や中断の操作を処理できるように、一度イベント処理に戻ってから実行する
+        Dispatch([job, next = (Stage)next](Impl *self) { self->RunStage(job, next); });
+    }
+
+    //! stage の処理を行う。GUIスレッドから呼び出す
+    void RunStage(JobPtr const &job, Stage stage)
+    {
+        if(CheckSuperseded(*job)) { return; }
+
+        try {
+            job->task_->Run(stage);
+        } catch(std::exception &e) {
+            job->error_msg_ = to_wstr(e.what());
+        }
+        StartNextStage(job, stage);
+    }
+
+    void Finish(Job &job)
+    {
+        Result result;
+        result.id_ = job.id_;
+        result.error_msg_ = job.error_msg_;
+        // 失敗したタスクは、ジョブと一緒に解放する
+        if(job.error_msg_.empty()) { result.task_ = std::move(job.task_); }
+
+        // 受け取られなかった前回の結果は、ここで解放する
+        result_ = std::move(result);
+        is_loading_.store(false);
+        if(finished_) { finished_(job.id_); }
+    }
+};
+
+PluginLoader::PluginLoader(Dispatcher dispatcher, ProgressCallback progress, FinishedCallback finished)
+:   pimpl_(std::make_shared<Impl>())
+{
+    pimpl_->dispatcher_ = std::move(dispatcher);
+    pimpl_->progress_ = std::move(progress);
+    pimpl_->finished_ = std::move(finished);
+    pimpl_->weak_self_ = pimpl_;
+    pimpl_->thread_ = std::thread([this] { pimpl_->Run(); });
+}
+
+PluginLoader::~PluginLoader()
+{
+    Cancel();
+    {
+        auto lock = pimpl_->lf_.make_lock();
+        pimpl_->quit_ = true;
+    }
+    pimpl_->cv_.notify_one();
+    pimpl_->thread_.join();
+
+    pimpl_->result_.reset();
+}
+
+UInt64 PluginLoader::StartLoad(TaskPtr task)
+{
+    auto job = std::make_shared<Impl::Job>();
+    job->task_ = std::move(task);
+
+    Impl::JobPtr old_pending;
+    UInt64 id = 0;
+    {
+        auto lock = pimpl_->lf_.make_lock();
+        id = pimpl_->latest_id_.fetch_add(1) + 1;
+        job->id_ = id;
+        old_pending = std::move(pimpl_->pending_);
+        pimpl_->pending_ = std::move(job);
+        pimpl_->is_loading_.store(true);
+    }
+    pimpl_->cv_.notify_one();
+    return id;
+}
+
+void PluginLoader::Cancel()
+{
+    Impl::JobPtr pending;
+    {
+        auto lock = pimpl_->lf_.make_lock();
+        pimpl_->latest_id_.fetch_add(1);
+        pending = std::move(pimpl_->pending_);
+        pimpl_->is_loading_.store(false);
+    }
+    // 待機中だったリクエストは、ロックの外で解放する
+    pending.reset();
+}
+
+bool PluginLoader::IsLoading() const
+{
+    return pimpl_->is_loading_.load();
+}
+
+std::optional<PluginLoader::Result> PluginLoader::TakeResult(UInt64 id)
+{
+    auto &result = pimpl_->result_;
+    if(!result || result->id_ != id || pimpl_->IsSuperseded(id)) {
+        return std::nullopt;
+    }
+
+    auto taken = std::move(result);
+    result.reset();
+    return taken;
+}
+
+String PluginLoader::ToString(Stage stage)
+{
+    switch(stage) {
+        case Stage::kPreparing:         return L"Preparing";
+        case Stage::kCreating:          return L"Creating";
+        case Stage::kSettingUp:         return L"Setting up";
+        case Stage::kRestoringState:    return L"Restoring state";
+        case Stage::kActivating:        return L"Activating";
+    }
+    return L"";
+}
+
+NS_HWM_END
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <optional>
+
+NS_HWM_BEGIN
+
+//! プラグインのロードを、GUIスレッドを長時間ブロックせずに段階的に行うクラス
+/*! VST3 では、コンポーネントの作成、 initialize()、 setState()、 setActive() などは
+ *  GUIスレッドから呼び出さなければならない。
+ *  そのため、状態データの準備のように、プラグインに触れない時間のかかる処理だけを専用のスレッドで行い、
+ *  プラグインの作成、設定、状態の復元、開始は Dispatcher を通じてGUIスレッドで一段階ずつ行う。
+ *  段階ごとにGUIスレッドのイベント処理に戻るので、ロード中も進捗の表示や中断の操作ができる。
+ *  ロードが完了したら FinishedCallback を呼び出すので、 TakeResult() で結果を受け取る。
+ *
+ *  ロード中に StartLoad() が呼ばれた場合は、実行中のロードを次の段階に進む前に中断して、新しいリクエストを処理する。
+ *  中断したロードのタスクは、GUIスレッドで解放する。
+ */
+class PluginLoader final
+{
+public:
+    //! ロードの段階
+    enum class Stage {
+        kPreparing,         //!< ロード用のスレッドで、状態の復元に使用するデータを準備している
+        kCreating,          //!< プラグインを作成している
+        kSettingUp,         //!< バスとサンプリングレートなどを設定している
+        kRestoringState,    //!< 状態を復元している
+        kActivating,        //!< プラグインを開始している
+    };
+
+    //! ロードの各段階の処理を実装するクラス
+    class ITask
+    {
+    public:
+        virtual ~ITask() {}
+
+        //! stage の処理が必要かどうか。 false を返した段階は飛ばす
+        virtual bool HasStage(Stage stage) const { return true; }
+
+        //! Stage::kPreparing の処理を、ロード用のスレッドで行う。
+        /*! プラグインのメソッドを呼び出してはいけない。失敗した場合は例外を送出する。
+         */
+        virtual void Prepare() = 0;
+
+        //! Stage::kPreparing 以外の stage の処理を、GUIスレッドで行う。
+        /*! 段階の順に呼び出される。失敗した場合は例外を送出する。
+         */
+        virtual void Run(Stage stage) = 0;
+    };
+    using TaskPtr = std::unique_ptr<ITask>;
+
+    struct Result
+    {
+        UInt64 id_ = 0;
+        //! すべての段階を完了したタスク。ロードに失敗した場合はnullptr
+        TaskPtr task_;
+        String error_msg_;
+    };
+
+    //! f をGUIスレッドで呼び出すように依頼する関数。どのスレッドからも呼び出される。
+    /*! App では wxApp::CallAfter() を使用する。
+     */
+    using Dispatcher = std::function<void(std::function<void()> f)>;
+    //! 各段階を開始する前に、GUIスレッドから呼び出されるコールバック
+    using ProgressCallback = std::function<void(UInt64 id, Stage stage)>;
+    //! ロードが完了（または失敗）したときに、GUIスレッドから呼び出されるコールバック
+    using FinishedCallback = std::function<void(UInt64 id)>;
+
+    PluginLoader(Dispatcher dispatcher, ProgressCallback progress, FinishedCallback finished);
+
+    //! 実行中のロードを中断して、ロード用のスレッドの終了を待機する。GUIスレッドから呼び出す
+    /*! これ以降に Dispatcher で呼び出された処理は何もしない。
+     */
+    ~PluginLoader();
+
+    PluginLoader(PluginLoader const &) = delete;
+    PluginLoader & operator=(PluginLoader const &) = delete;
+
+    //! ロードを開始する。実行中または待機中のロードは中断する。GUIスレッドから呼び出す
+    /*! @return このリクエストのID。コールバックと TakeResult() で使用する
+     */
+    UInt64 StartLoad(TaskPtr task);
+
+    //! 実行中または待機中のロードを中断する。GUIスレッドから呼び出す
+    void Cancel();
+
+    //! 実行中または待機中のロードがあるかどうか
+    bool IsLoading() const;
+
+    //! ロードの結果を受け取る。GUIスレッドから呼び出す
+    /*! id が最新のリクエストのものでない場合や、すでに受け取っている場合は std::nullopt を返す。
+     */
+    std::optional<Result> TakeResult(UInt64 id);
+
+    static String ToString(Stage stage);
+
+private:
+    class Impl;
+    std::shared_ptr<Impl> pimpl_;
+};
+
+NS_HWM_END
@@ -0,0 +1,86 @@
+#include "PluginScanProcess.hpp"
+
+#include <fstream>
+
+#include <wx/process.h>
+#include <wx/stdpaths.h>
+#include <wx/utils.h>
+
+#include "../file/PluginScanCache.hpp"
+#include "../misc/StrCnv.hpp"
+#include "../plugin/vst3/Vst3PluginFactory.hpp"
+#include "../log/LoggingSupport.hpp"
+
+NS_HWM_BEGIN
+
+namespace {
+
+//! プラグインスキャンプロセスの終了を検出する
+class PluginScanProcess
+:   public wxProcess
+{
+public:
+    PluginScanProcess(std::function<void()> on_finished)
+    :   on_finished_(std::move(on_finished))
+    {}
+
+    void OnTerminate(int pid, int status) override
+    {
+        HWM_DEBUG_LOG(L"Plugin scan process terminated [" << pid << L"]: " << status);
+        if(on_finished_) { on_finished_(); }
+        delete this;
+    }
+
+private:
+    std::function<void()> on_finished_;
+};
+
+} // namespace
+
+int RunPluginScanProcess(String const &module_path, String const &output_path)
+{
+    PluginScanCache cache;
+    cache.entries_.emplace_back();
+    auto &entry = cache.entries_.back();
+    entry.module_path_ = module_path;
+    entry.is_loadable_ = Vst3PluginFactoryList::GetInstance()->ScanModule(module_path,
+                                                                          entry.factory_info_,
+                                                                          entry.class_info_list_);
+
+#if defined(_MSC_VER)
+    std::ofstream ofs(output_path, std::ios::trunc);
+#else
+    std::ofstream ofs(to_utf8(output_path), std::ios::trunc);
+#endif
+    ofs << cache;
+    if(!ofs) {
+        HWM_ERROR_LOG(L"Failed to write the plugin scan result: " << output_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+void StartPluginScanProcess(String const &module_path, String const &output_path, std::function<void()> on_finished)
+{
+    auto const exe_path = wxStandardPaths::Get().GetExecutablePath().ToStdWstring();
+    auto const scan_option = L"--" + to_wstr(kPluginScanOptionName);
+    auto const output_option = L"--" + to_wstr(kPluginScanOutputOptionName);
+
+    // モジュールのパスに空白が含まれていても分割されないように、引数を配列で渡す
+    wchar_t const *argv[] = {
+        exe_path.c_str(),
+        scan_option.c_str(), module_path.c_str(),
+        output_option.c_str(), output_path.c_str(),
+        nullptr
+    };
+
+    auto *process = new PluginScanProcess(std::move(on_finished));
+    if(wxExecute(argv, wxEXEC_ASYNC, process) == 0) {
+        HWM_ERROR_LOG(L"Failed to launch the plugin scan process: " << module_path);
+        // OnTerminate() は呼ばれないので、ここで完了を通知する
+        process->OnTerminate(0, -1);
+    }
+}
+
+NS_HWM_END
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <functional>
+
+NS_HWM_BEGIN
+
+//! プラグインスキャンプロセスの起動時に、スキャンするモジュールのパスを渡すコマンドラインオプション
+constexpr char const *kPluginScanOptionName = "plugin-scan";
+//! プラグインスキャンプロセスの起動時に、スキャン結果を書き出すファイルのパスを渡すコマンドラインオプション
+constexpr char const *kPluginScanOutputOptionName = "plugin-scan-output";
+
+//! モジュールをロードして、その情報をファイルに書き出す。
+/*! アプリケーションが --plugin-scan オプション付きで起動されたときに、GUIを作成せずに呼び出される。
+ *  スキャン結果は、モジュールのエントリをひとつだけ含む PluginScanCache の形式で書き出す。
+ *  モジュールのロード中にクラッシュした場合は、このプロセスだけが終了する。
+ *  @return プロセスの終了コード。成功時は0
+ */
+int RunPluginScanProcess(String const &module_path, String const &output_path);
+
+//! このアプリケーションの実行ファイルを --plugin-scan オプション付きで起動して、 module_path のモジュールをスキャンする。
+/*! プロセスの終了は待たずに戻る。プロセスが終了したら（起動に失敗した場合も） on_finished を呼び出す。
+ *  GUIスレッドから呼び出すこと。 on_finished もGUIスレッドから呼び出される。
+ */
+void StartPluginScanProcess(String const &module_path, String const &output_path, std::function<void()> on_finished);
+
+NS_HWM_END
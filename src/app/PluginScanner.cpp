@@ -0,0 +1,509 @@
+#include "PluginScanner.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <thread>
+
+#include <wx/dir.h>
+#include <wx/filename.h>
+#include <wx/filefn.h>
+#include <wx/utils.h>
+
+#include "../misc/LockFactory.hpp"
+#include "../misc/StrCnv.hpp"
+#include "../log/LoggingSupport.hpp"
+
+NS_HWM_BEGIN
+
+namespace {
+
+//! ModuleScanner にモジュールのロードを依頼してから、完了を待つ時間の上限。
+//! 超えた場合は、そのモジュールをスキャン結果に含めず、次回のスキャンでロードし直す
+constexpr auto kModuleScanTimeout = std::chrono::seconds(60);
+//! ロードの完了を待つ間に、スキャンの中断を確認する間隔
+constexpr auto kCancelCheckInterval = std::chrono::milliseconds(50);
+
+//! モジュールのバイナリファイルの状態
+struct ModuleFileStatus
+{
+    String binary_path_;
+    Int64 modification_time_ = 0;
+    Int64 file_size_ = 0;
+};
+
+bool IsModulePath(wxString const &path)
+{
+    bool const is_case_sensitive = false;
+    return wxFileName(path).GetExt().IsSameAs(L"vst3", is_case_sensitive);
+}
+
+//! モジュールのパスから、実際にロードされるバイナリファイルのパスを返す。
+/*! バンドル形式のモジュールはディレクトリなので、その中のバイナリファイルを探す。
+ *  見つからない場合はモジュールのパスをそのまま返す。
+ */
+String FindModuleBinary(String const &module_path)
+{
+    if(wxFileName::FileExists(module_path)) {
+        return module_path;
+    }
+
+    auto binary = wxFileName::DirName(module_path);
+    auto const name = wxFileName(module_path).GetName();
+    binary.AppendDir(L"Contents");
+#if defined(_MSC_VER)
+#if defined(_WIN64)
+    binary.AppendDir(L"x86_64-win");
+#else
+    binary.AppendDir(L"x86-win");
+#endif
+    binary.SetName(name);
+    binary.SetExt(L"vst3");
+#else
+    binary.AppendDir(L"MacOS");
+    binary.SetName(name);
+#endif
+
+    if(binary.FileExists()) {
+        return binary.GetFullPath().ToStdWstring();
+    }
+
+    return module_path;
+}
+
+ModuleFileStatus GetModuleFileStatus(String const &module_path)
+{
+    ModuleFileStatus status;
+    status.binary_path_ = FindModuleBinary(module_path);
+
+    wxFileName file(status.binary_path_);
+    auto const mtime = file.GetModificationTime();
+    if(mtime.IsValid()) {
+        status.modification_time_ = mtime.GetValue().GetValue();
+    }
+
+    auto const size = wxFileName::GetSize(status.binary_path_);
+    if(size != wxInvalidSize) {
+        status.file_size_ = (Int64)size.GetValue();
+    }
+
+    return status;
+}
+
+//! バイナリファイルの先頭と末尾の一部と、ファイルサイズからハッシュ値（FNV-1a）を計算する。
+/*! 大きなモジュールでもファイル全体を読み込まずに済むように、ハッシュの計算に使う範囲を制限している。
+ */
+UInt64 CalculateModuleHash(ModuleFileStatus const &status)
+{
+    constexpr UInt64 kOffsetBasis = 14695981039346656037ull;
+    constexpr UInt64 kPrime = 1099511628211ull;
+    constexpr Int64 kBlockSize = 64 * 1024;
+
+    UInt64 hash = kOffsetBasis;
+    auto update = [&hash](char const *data, size_t length) {
+        for(size_t i = 0; i < length; ++i) {
+            hash ^= (UInt8)data[i];
+            hash *= kPrime;
+        }
+    };
+
+    update(reinterpret_cast<char const *>(&status.file_size_), sizeof(status.file_size_));
+
+#if defined(_MSC_VER)
+    std::ifstream ifs(status.binary_path_, std::ios::binary);
+#else
+    std::ifstream ifs(to_utf8(status.binary_path_), std::ios::binary);
+#endif
+    if(!ifs) { return hash; }
+
+    std::vector<char> buf(kBlockSize);
+    auto read_block = [&](Int64 pos, Int64 length) {
+        ifs.clear();
+        ifs.seekg(pos);
+        ifs.read(buf.data(), length);
+        update(buf.data(), (size_t)ifs.gcount());
+    };
+
+    read_block(0, std::min(kBlockSize, status.file_size_));
+    if(status.file_size_ > kBlockSize) {
+        auto const tail_pos = std::max(kBlockSize, status.file_size_ - kBlockSize);
+        read_block(tail_pos, status.file_size_ - tail_pos);
+    }
+
+    return hash;
+}
+
+class ModuleFinder
+:   public wxDirTraverser
+{
+public:
+    ModuleFinder(std::vector<String> &found, std::atomic<bool> const &cancel)
+    :   found_(found)
+    ,   cancel_(cancel)
+    {}
+
+    wxDirTraverseResult OnFile(wxString const &filename) override
+    {
+        if(cancel_.load()) { return wxDIR_STOP; }
+
+        if(IsModulePath(filename)) {
+            found_.push_back(filename.ToStdWstring());
+        }
+        return wxDIR_CONTINUE;
+    }
+
+    wxDirTraverseResult OnDir(wxString const &dirname) override
+    {
+        if(cancel_.load()) { return wxDIR_STOP; }
+
+        // バンドル形式のモジュールの中は探索しない
+        if(IsModulePath(dirname)) {
+            found_.push_back(dirname.ToStdWstring());
+            return wxDIR_IGNORE;
+        }
+        return wxDIR_CONTINUE;
+    }
+
+    wxDirTraverseResult OnOpenError(wxString const &openerrorname) override
+    {
+        return wxDIR_IGNORE;
+    }
+
+private:
+    std::vector<String> &found_;
+    std::atomic<bool> const &cancel_;
+};
+
+} // namespace
+
+//! ModuleScanner に依頼したロードの完了を、スキャンスレッドに通知する
+struct ModuleScanRequest
+{
+    LockFactory lf_;
+    std::condition_variable cv_;
+    bool finished_ = false;
+};
+
+class PluginScanner::Impl
+{
+public:
+    Impl(Dispatcher dispatcher, ModuleScanner module_scanner)
+    :   dispatcher_(std::move(dispatcher))
+    ,   module_scanner_(std::move(module_scanner))
+    {}
+
+    Dispatcher dispatcher_;
+    ModuleScanner module_scanner_;
+    LockFactory lf_;
+    std::vector<PluginScanEntry> entries_;
+    std::thread scan_thread_;
+    std::atomic<bool> cancel_ = { false };
+    std::atomic<bool> is_scanning_ = { false };
+
+    std::vector<String> FindModules(std::vector<String> const &search_dirs)
+    {
+        std::vector<String> found;
+        ModuleFinder finder(found, cancel_);
+
+        for(auto const &dir_path: search_dirs) {
+            if(wxDir::Exists(dir_path) == false) { continue; }
+
+            wxDir dir(dir_path);
+            if(dir.IsOpened() == false) { continue; }
+            dir.Traverse(finder);
+        }
+
+        std::sort(found.begin(), found.end());
+        found.erase(std::unique(found.begin(), found.end()), found.end());
+        return found;
+    }
+
+    //! GUIスレッドの ModuleScanner にモジュールのロードを依頼して、その完了を待つ。
+    /*! このスレッドではモジュールをロードしない。
+     *  @return スキャンが中断された場合や、時間内にロードが完了しなかった場合はstd::nullopt
+     */
+    std::optional<PluginScanEntry> ScanModule(String const &module_path, ModuleFileStatus const &status, UInt64 hash)
+    {
+        auto const output_path = wxFileName::CreateTempFileName(L"hwm_plugin_scan").ToStdWstring();
+        if(output_path.empty()) {
+            HWM_ERROR_LOG(L"Failed to create a temporary file for the plugin scan: " << module_path);
+            return std::nullopt;
+        }
+
+        auto request = std::make_shared<ModuleScanRequest>();
+        // スキャンの中断後に呼び出されることもあるので、 this は参照しない
+        dispatcher_([module_scanner = module_scanner_, module_path, output_path, request] {
+            module_scanner(module_path, output_path, [request] {
+                {
+                    auto lock = request->lf_.make_lock();
+                    request->finished_ = true;
+                }
+                request->cv_.notify_all();
+            });
+        });
+
+        bool finished = false;
+        auto const deadline = std::chrono::steady_clock::now() + kModuleScanTimeout;
+        for( ; ; ) {
+            auto lock = request->lf_.make_lock();
+            finished = request->cv_.wait_for(lock, kCancelCheckInterval, [&] { return request->finished_; });
+            if(finished || cancel_.load() || std::chrono::steady_clock::now() >= deadline) { break; }
+        }
+
+        std::optional<PluginScanEntry> entry;
+        if(finished) {
+            entry = ReadModuleScanResult(output_path);
+            entry->module_path_ = module_path;
+            entry->modification_time_ = status.modification_time_;
+            entry->file_size_ = status.file_size_;
+            entry->hash_ = hash;
+        } else if(cancel_.load() == false) {
+            HWM_WARN_LOG(L"Timed out scanning the module: " << module_path);
+        }
+
+        // 中断した場合やタイムアウトした場合も、書き出しが終わっていなければ削除に失敗するだけなので問題ない
+        wxRemoveFile(output_path);
+        return entry;
+    }
+
+    //! ModuleScanner が書き出した結果を読み込む。読み込めない場合は、ロードに失敗したエントリを返す
+    static PluginScanEntry ReadModuleScanResult(String const &output_path)
+    {
+#if defined(_MSC_VER)
+        std::ifstream ifs(output_path);
+#else
+        std::ifstream ifs(to_utf8(output_path));
+#endif
+        PluginScanCache result;
+        try {
+            ifs >> result;
+        } catch(std::exception &e) {
+            HWM_DEBUG_LOG(L"Failed to read the module scan result: " << to_wstr(e.what()));
+            return PluginScanEntry{};
+        }
+
+        if(result.entries_.size() != 1) { return PluginScanEntry{}; }
+        return std::move(result.entries_[0]);
+    }
+
+    void Scan(std::vector<String> const &search_dirs,
+              String const &cache_file_path,
+              ScanFinishedCallback const &callback)
+    {
+        std::map<String, PluginScanEntry> previous;
+        for(auto &entry: GetEntries()) {
+            auto path = entry.module_path_;
+            previous.emplace(std::move(path), std::move(entry));
+        }
+
+        auto const module_paths = FindModules(search_dirs);
+
+        PluginScanCache cache;
+        UInt32 num_scanned = 0;
+        bool is_modified = (module_paths.size() != previous.size());
+
+        for(auto const &path: module_paths) {
+            if(cancel_.load()) {
+                HWM_INFO_LOG(L"Plugin scan canceled.");
+                return;
+            }
+
+            auto const status = GetModuleFileStatus(path);
+            std::optional<UInt64> hash;
+
+            auto found = previous.find(path);
+            if(found != previous.end() && found->second.file_size_ == status.file_size_) {
+                auto &prev = found->second;
+                if(prev.modification_time_ == status.modification_time_) {
+                    cache.entries_.push_back(std::move(prev));
+                    continue;
+                }
+
+                // 更新日時だけが変わっている場合は、内容が変わっているかどうかをハッシュ値で確認する
+                hash = CalculateModuleHash(status);
+                if(prev.hash_ == *hash) {
+                    prev.modification_time_ = status.modification_time_;
+                    cache.entries_.push_back(std::move(prev));
+                    is_modified = true;
+                    continue;
+                }
+            }
+
+            if(!hash) { hash = CalculateModuleHash(status); }
+
+            HWM_DEBUG_LOG(L"Scan the module: " << path);
+            auto entry = ScanModule(path, status, *hash);
+            if(cancel_.load()) {
+                HWM_INFO_LOG(L"Plugin scan canceled.");
+                return;
+            }
+
+            // スキャン結果に含めなかったモジュールは、次回のスキャンでロードし直す
+            is_modified = true;
+            if(!entry) { continue; }
+
+            cache.entries_.push_back(std::move(*entry));
+            num_scanned += 1;
+        }
+
+        HWM_INFO_LOG(L"Plugin scan finished: " << cache.entries_.size() << L" modules found, "
+                     << num_scanned << L" modules scanned.");
+
+        if(is_modified) {
+            SaveCache(cache_file_path, cache);
+        }
+
+        {
+            auto lock = lf_.make_lock();
+            entries_ = std::move(cache.entries_);
+        }
+
+        if(callback) { callback(); }
+    }
+
+    std::vector<PluginScanEntry> GetEntries() const
+    {
+        auto lock = lf_.make_lock();
+        return entries_;
+    }
+
+    //! 書き込み途中のファイルが残らないように、一時ファイルに書き出してから置き換える
+    static bool SaveCache(String const &cache_file_path, PluginScanCache const &cache)
+    {
+        wxFileName path(cache_file_path);
+        if(path.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL) == false) {
+            HWM_ERROR_LOG(L"failed to create the plugin scan cache directory");
+            return false;
+        }
+
+        String const tmp_path = cache_file_path + L".tmp";
+        {
+#if defined(_MSC_VER)
+            std::ofstream ofs(tmp_path, std::ios::trunc);
+#else
+            std::ofstream ofs(to_utf8(tmp_path), std::ios::trunc);
+#endif
+            ofs << cache;
+            if(!ofs) {
+                HWM_ERROR_LOG(L"failed to write the plugin scan cache: " << tmp_path);
+                return false;
+            }
+        }
+
+        bool const overwrite = true;
+        if(wxRenameFile(tmp_path, cache_file_path, overwrite) == false) {
+            HWM_ERROR_LOG(L"failed to replace the plugin scan cache: " << cache_file_path);
+            wxRemoveFile(tmp_path);
+            return false;
+        }
+
+        return true;
+    }
+};
+
+PluginScanner::PluginScanner(Dispatcher dispatcher, ModuleScanner module_scanner)
+:   pimpl_(std::make_unique<Impl>(std::move(dispatcher), std::move(module_scanner)))
+{
+    assert(pimpl_->dispatcher_);
+    assert(pimpl_->module_scanner_);
+}
+
+PluginScanner::~PluginScanner()
+{
+    CancelScan();
+}
+
+std::vector<String> PluginScanner::GetDefaultSearchDirectories()
+{
+    std::vector<String> dirs;
+
+#if defined(_MSC_VER)
+    wxString common_files;
+    if(wxGetEnv(L"COMMONPROGRAMFILES", &common_files)) {
+        dirs.push_back((common_files + L"\\VST3").ToStdWstring());
+    } else {
+        dirs.push_back(L"C:/Program Files/Common Files/VST3");
+    }
+
+    wxString local_app_data;
+    if(wxGetEnv(L"LOCALAPPDATA", &local_app_data)) {
+        dirs.push_back((local_app_data + L"\\Programs\\Common\\VST3").ToStdWstring());
+    }
+#else
+    dirs.push_back(L"/Library/Audio/Plug-Ins/VST3");
+    dirs.push_back((wxGetHomeDir() + L"/Library/Audio/Plug-Ins/VST3").ToStdWstring());
+#endif
+
+    return dirs;
+}
+
+bool PluginScanner::LoadCache(String cache_file_path)
+{
+    errno = 0;
+#if defined(_MSC_VER)
+    std::ifstream ifs(cache_file_path);
+#else
+    std::ifstream ifs(to_utf8(cache_file_path));
+#endif
+    if(!ifs) {
+        HWM_INFO_LOG(L"No plugin scan cache found: " << to_wstr(strerror(errno)));
+        return false;
+    }
+
+    PluginScanCache cache;
+    try {
+        ifs >> cache;
+    } catch(std::exception &e) {
+        HWM_WARN_LOG(L"Failed to read the plugin scan cache: " << to_wstr(e.what()));
+        return false;
+    }
+
+    auto lock = pimpl_->lf_.make_lock();
+    pimpl_->entries_ = std::move(cache.entries_);
+    return true;
+}
+
+void PluginScanner::StartScan(std::vector<String> search_dirs,
+                              String cache_file_path,
+                              ScanFinishedCallback callback)
+{
+    CancelScan();
+
+    pimpl_->cancel_.store(false);
+    pimpl_->is_scanning_.store(true);
+    pimpl_->scan_thread_ = std::thread([this,
+                                        search_dirs = std::move(search_dirs),
+                                        cache_file_path = std::move(cache_file_path),
+                                        callback = std::move(callback)]
+    {
+        pimpl_->Scan(search_dirs, cache_file_path, callback);
+        pimpl_->is_scanning_.store(false);
+    });
+}
+
+void PluginScanner::CancelScan()
+{
+    pimpl_->cancel_.store(true);
+    if(pimpl_->scan_thread_.joinable()) {
+        pimpl_->scan_thread_.join();
+    }
+    pimpl_->is_scanning_.store(false);
+}
+
+bool PluginScanner::IsScanning() const
+{
+    return pimpl_->is_scanning_.load();
+}
+
+std::vector<PluginScanEntry> PluginScanner::GetEntries() const
+{
+    return pimpl_->GetEntries();
+}
+
+NS_HWM_END
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "../file/PluginScanCache.hpp"
+
+NS_HWM_BEGIN
+
+//! プラグインモジュールを探索して、その情報をキャッシュファイルに保存するクラス
+/*! スキャンは別スレッドで行い、前回のスキャン結果から変更のあったモジュールだけをロードする。
+ *  モジュールのバイナリファイルの更新日時とサイズが前回と同じであれば、ロードせずにキャッシュの内容を使う。
+ *  更新日時やサイズが変わっていても、ファイルの先頭と末尾から計算したハッシュ値が同じであれば、内容は変わっていないものとする。
+ *
+ *  VST3 では、モジュールのロードとファクトリの問い合わせはGUIスレッドから行わなければならない。
+ *  そのため、スキャンスレッドではディレクトリの探索、ファイルの状態とハッシュ値の確認、キャッシュファイルの読み書きだけを行い、
+ *  モジュールのロードは Dispatcher を通じてGUIスレッドから ModuleScanner に依頼する。
+ */
+class PluginScanner
+{
+public:
+    //! f をGUIスレッドで呼び出すように依頼する関数。スキャンスレッドから呼び出される。
+    /*! App では wxApp::CallAfter() を使用する。
+     */
+    using Dispatcher = std::function<void(std::function<void()> f)>;
+
+    //! module_path のモジュールをロードして、その情報を output_path に書き出す処理を開始する関数。GUIスレッドから呼び出される。
+    /*! 書き出す内容は、モジュールのエントリをひとつだけ含む PluginScanCache の形式とする。
+     *  書き出しが終わったら（失敗した場合も）、 on_finished を呼び出す。 on_finished はどのスレッドから呼び出してもよい。
+     *  output_path に読み込めるエントリがない場合は、モジュールのロードに失敗したものとする。
+     *  App では StartPluginScanProcess() で別プロセスを起動し、モジュールがクラッシュしてもアプリケーションに影響しないようにする。
+     */
+    using ModuleScanner = std::function<void(String const &module_path,
+                                             String const &output_path,
+                                             std::function<void()> on_finished)>;
+
+    PluginScanner(Dispatcher dispatcher, ModuleScanner module_scanner);
+
+    //! 実行中のスキャンを中断し、スキャンスレッドの終了を待機する
+    ~PluginScanner();
+
+    PluginScanner(PluginScanner const &) = delete;
+    PluginScanner & operator=(PluginScanner const &) = delete;
+
+    //! 標準的なVST3プラグインのインストール先のディレクトリを返す
+    static std::vector<String> GetDefaultSearchDirectories();
+
+    //! キャッシュファイルから前回のスキャン結果を読み込む。
+    /*! スキャンの前に呼び出しておくと、スキャンの完了を待たずに GetEntries() でプラグインの一覧を取得できる。
+     *  @return キャッシュファイルの読み込みに失敗した場合はfalse
+     */
+    bool LoadCache(String cache_file_path);
+
+    //! スキャン完了時に呼ばれるコールバック。スキャンスレッドから呼び出される
+    using ScanFinishedCallback = std::function<void()>;
+
+    //! 別スレッドでスキャンを開始する。
+    /*! 実行中のスキャンがあれば、中断してから開始する。
+     *  スキャンが完了すると、結果をキャッシュファイルに書き出してから callback を呼び出す。
+     *  search_dirs 以下にないモジュールは、スキャン結果から取り除かれる。
+     */
+    void StartScan(std::vector<String> search_dirs,
+                   String cache_file_path,
+                   ScanFinishedCallback callback);
+
+    //! 実行中のスキャンを中断する。
+    /*! 中断した場合、キャッシュファイルは更新されず、コールバックも呼び出されない。
+     */
+    void CancelScan();
+
+    bool IsScanning() const;
+
+    //! 現在のスキャン結果のコピーを返す。
+    /*! スキャン中は、前回のスキャン結果（あるいは LoadCache() で読み込んだ内容）を返す。
+     */
+    std::vector<PluginScanEntry> GetEntries() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl_;
+};
+
+NS_HWM_END
@@ -0,0 +1,148 @@
+#include "ProjectSaver.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#include "../misc/LockFactory.hpp"
+#include "../misc/StrCnv.hpp"
+#include "../log/LoggingSupport.hpp"
+
+NS_HWM_BEGIN
+
+class ProjectSaver::Impl
+{
+public:
+    struct Request
+    {
+        UInt64 id_ = 0;
+        std::shared_ptr<ProjectFile const> snapshot_;
+        String path_;
+    };
+
+    ProgressCallback progress_;
+    FinishedCallback finished_;
+
+    LockFactory lf_;
+    std::condition_variable cv_;
+    std::thread thread_;
+    bool quit_ = false;
+    //! 待機中のリクエスト。パスごとに最大1つ
+    std::vector<Request> pending_;
+    UInt64 last_id_ = 0;
+    std::atomic<bool> is_saving_ = { false };
+
+    void Run()
+    {
+        for( ; ; ) {
+            Request request;
+            {
+                auto lock = lf_.make_lock();
+                cv_.wait(lock, [this] { return quit_ || pending_.empty() == false; });
+                // 終了する前に、待機中のリクエストはすべて書き出す
+                if(pending_.empty()) { return; }
+
+                request = std::move(pending_.front());
+                pending_.erase(pending_.begin());
+            }
+
+            auto result = Save(request);
+            request = Request{};
+
+            {
+                auto lock = lf_.make_lock();
+                is_saving_.store(pending_.empty() == false);
+            }
+
+            if(finished_) { finished_(result); }
+        }
+    }
+
+    Result Save(Request const &request)
+    {
+        Result result;
+        result.id_ = request.id_;
+        result.path_ = request.path_;
+
+        try {
+            request.snapshot_->Save(request.path_, [&](Stage stage) {
+                if(progress_) { progress_(request.id_, request.path_, stage); }
+            });
+            result.succeeded_ = true;
+        } catch(std::exception &e) {
+            HWM_ERROR_LOG(L"Failed to save the project file [" << request.path_ << L"]: " << to_wstr(e.what()));
+            result.error_msg_ = to_wstr(e.what());
+        }
+
+        return result;
+    }
+};
+
+ProjectSaver::ProjectSaver(ProgressCallback progress, FinishedCallback finished)
+:   pimpl_(std::make_unique<Impl>())
+{
+    pimpl_->progress_ = std::move(progress);
+    pimpl_->finished_ = std::move(finished);
+    pimpl_->thread_ = std::thread([this] { pimpl_->Run(); });
+}
+
+ProjectSaver::~ProjectSaver()
+{
+    {
+        auto lock = pimpl_->lf_.make_lock();
+        pimpl_->quit_ = true;
+    }
+    pimpl_->cv_.notify_one();
+    pimpl_->thread_.join();
+}
+
+UInt64 ProjectSaver::StartSave(std::shared_ptr<ProjectFile const> snapshot, String path)
+{
+    assert(snapshot);
+
+    std::shared_ptr<ProjectFile const> replaced;
+    UInt64 id = 0;
+    {
+        auto lock = pimpl_->lf_.make_lock();
+        id = ++pimpl_->last_id_;
+
+        auto &pending = pimpl_->pending_;
+        auto found = std::find_if(pending.begin(), pending.end(),
+                                  [&](auto const &req) { return req.path_ == path; });
+
+        if(found != pending.end()) {
+            HWM_DEBUG_LOG(L"Project save coalesced: " << found->id_ << L" -> " << id);
+            replaced = std::move(found->snapshot_);
+            found->id_ = id;
+            found->snapshot_ = std::move(snapshot);
+        } else {
+            pending.push_back({ id, std::move(snapshot), std::move(path) });
+        }
+
+        pimpl_->is_saving_.store(true);
+    }
+    pimpl_->cv_.notify_one();
+
+    // 置き換えられたスナップショットは、ロックの外で解放する
+    replaced.reset();
+    return id;
+}
+
+bool ProjectSaver::IsSaving() const
+{
+    return pimpl_->is_saving_.load();
+}
+
+String ProjectSaver::ToString(Stage stage)
+{
+    switch(stage) {
+        case Stage::kWriting:   return L"Writing";
+        case Stage::kSyncing:   return L"Syncing";
+        case Stage::kReplacing: return L"Replacing";
+    }
+    return L"";
+}
+
+NS_HWM_END
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include "../file/ProjectFile.hpp"
+
+NS_HWM_BEGIN
+
+//! プロジェクトファイルの書き出しを、GUIスレッドをブロックせずに別スレッドで行うクラス
+/*! GUIスレッドでは ProjectFile の Scan*() でプラグインの状態などを取得するだけにして、
+ *  取得したスナップショットのシリアライズ、ディスクへの書き出し、ファイルの置き換えを専用のスレッドで行う。
+ *  書き出しは一時ファイルに行い、完了してから元のファイルと置き換えるので、途中で失敗しても元のファイルは壊れない。
+ *
+ *  同じパスへの書き出しがまだ開始されていないうちに StartSave() が呼ばれた場合は、
+ *  そのリクエストを新しいスナップショットで置き換える。
+ *  そのため、自動保存などで連続して保存しても、書き出しが溜まっていくことはない。
+ */
+class ProjectSaver final
+{
+public:
+    using Stage = ProjectFile::SaveStage;
+
+    struct Result
+    {
+        UInt64 id_ = 0;
+        String path_;
+        bool succeeded_ = false;
+        String error_msg_;
+    };
+
+    //! 書き出しの段階が進むたびに、書き出し用のスレッドから呼び出されるコールバック
+    using ProgressCallback = std::function<void(UInt64 id, String const &path, Stage stage)>;
+    //! 書き出しが完了（または失敗）したときに、書き出し用のスレッドから呼び出されるコールバック
+    /*! 置き換えられたリクエストについては呼び出さない。
+     */
+    using FinishedCallback = std::function<void(Result const &result)>;
+
+    ProjectSaver(ProgressCallback progress, FinishedCallback finished);
+
+    //! 待機中のリクエストをすべて書き出してから、書き出し用のスレッドを終了する
+    ~ProjectSaver();
+
+    ProjectSaver(ProjectSaver const &) = delete;
+    ProjectSaver & operator=(ProjectSaver const &) = delete;
+
+    //! snapshot を path に書き出すリクエストを追加する。
+    /*! @return このリクエストのID。コールバックで使用する
+     */
+    UInt64 StartSave(std::shared_ptr<ProjectFile const> snapshot, String path);
+
+    //! 実行中または待機中の書き出しがあるかどうか
+    bool IsSaving() const;
+
+    static String ToString(Stage stage);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl_;
+};
+
+NS_HWM_END
@@ -0,0 +1,519 @@
+#include "RemotePlugin.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include <wx/process.h>
+#include <wx/stdpaths.h>
+#include <wx/utils.h>
+
+#include "../misc/InterProcessSignal.hpp"
+#include "../misc/RcuPointer.hpp"
+#include "../misc/SharedMemory.hpp"
+#include "../misc/StrCnv.hpp"
+#include "../log/LoggingSupport.hpp"
+#include "./PluginHostProtocol.hpp"
+
+NS_HWM_BEGIN
+
+namespace {
+
+//! プラグインホストプロセスの起動から、プラグインが開始されるまでを待つ時間
+constexpr auto kStartTimeout = std::chrono::seconds(10);
+//! 終了を要求してから、プラグインホストプロセスを強制終了するまでの時間
+constexpr auto kStopTimeout = std::chrono::seconds(2);
+//! 応答がない状態がこの時間続いたら、プラグインホストプロセスが応答しなくなったものとみなす
+constexpr double kHangSeconds = 2.0;
+//! 起動に失敗したときに再試行するまでの時間。失敗が続くたびに倍にする
+constexpr auto kMinRetryInterval = std::chrono::seconds(1);
+constexpr auto kMaxRetryInterval = std::chrono::seconds(60);
+
+//! プラグインホストプロセスの終了を検出する
+class PluginHostProcess
+:   public wxProcess
+{
+public:
+    PluginHostProcess(std::shared_ptr<std::atomic<bool>> terminated)
+    :   terminated_(std::move(terminated))
+    {}
+
+    void OnTerminate(int pid, int status) override
+    {
+        HWM_INFO_LOG(L"Plugin host process terminated [" << pid << L"]: " << status);
+        terminated_->store(true);
+        delete this;
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> terminated_;
+};
+
+void KillProcess(long pid)
+{
+    if(pid != 0 && wxProcess::Exists(pid)) {
+        wxProcess::Kill(pid, wxSIGKILL);
+    }
+}
+
+} // namespace
+
+//! 起動したプラグインホストプロセスとの接続
+struct RemotePluginSession
+{
+    std::unique_ptr<SharedMemory> shm_;
+    PluginHostSharedData *data_ = nullptr;
+    std::unique_ptr<InterProcessSignal> request_;
+    std::unique_ptr<InterProcessSignal> response_;
+    long pid_ = 0;
+    //! プラグインホストプロセスが終了したらtrueになる。wxProcessの解放後も参照できるように共有する
+    std::shared_ptr<std::atomic<bool>> terminated_ = std::make_shared<std::atomic<bool>>(false);
+    double sample_rate_ = 44100.0;
+    //! この回数だけ続けて応答がなければ、応答しなくなったものとみなす
+    UInt32 max_consecutive_timeouts_ = 0;
+    String plugin_name_;
+    bool is_effect_ = false;
+
+    //! 続けて応答が間に合わなかったブロックの数
+    std::atomic<UInt32> num_consecutive_timeouts_ = { 0 };
+
+    //! @name オーディオスレッドからだけ参照する
+    //@{
+    //! 応答が間に合わなかったリクエストの応答を待っているかどうか
+    bool waiting_response_ = false;
+    //! その応答が返ってきたときの response_counter_ の値
+    UInt32 expected_response_ = 0;
+    //@}
+
+    ~RemotePluginSession()
+    {
+        // 共有メモリより先に通知を解放する
+        request_.reset();
+        response_.reset();
+    }
+
+    bool IsCrashed() const
+    {
+        if(terminated_->load()) { return true; }
+        if(data_->host_state_.load() != PluginHostSharedData::kReady) { return true; }
+        return num_consecutive_timeouts_.load() > max_consecutive_timeouts_;
+    }
+};
+
+class RemotePlugin::Impl
+{
+public:
+    using clock_t = std::chrono::steady_clock;
+
+    enum class StartResult
+    {
+        kReady,
+        kPending,
+        kFailed,
+    };
+
+    String module_path_;
+    std::optional<ClassInfo::CID> cid_;
+    RcuPointer<RemotePluginSession> session_;
+
+    double sample_rate_ = 44100.0;
+    SampleCount max_block_size_ = 0;
+    UInt32 num_channels_ = 0;
+    bool use_double_precision_ = false;
+    std::atomic<double> response_time_ratio_ = { 1.0 };
+
+    //! @name GUIスレッドからだけ参照する
+    //@{
+    //! Start() が呼ばれてから Stop() が呼ばれるまでtrue。この間は、停止したプロセスを起動し直す
+    bool should_run_ = false;
+    //! 起動して、プラグインの開始を待っているセッション
+    std::shared_ptr<RemotePluginSession> starting_session_;
+    clock_t::time_point start_deadline_;
+    //! 次に起動を試みる時刻
+    clock_t::time_point next_retry_;
+    clock_t::duration retry_interval_ = kMinRetryInterval;
+    //@}
+
+    LatencyHistogram process_time_;
+    LatencyHistogram overhead_;
+    std::atomic<UInt64> num_dropped_blocks_ = { 0 };
+    UInt32 num_restarts_ = 0;
+
+    //! プラグインホストプロセスを起動する。プラグインの開始は待たない。
+    /*! @return 起動に失敗した場合はnullptr
+     */
+    std::shared_ptr<RemotePluginSession> Launch();
+
+    //! Launch() で起動したプロセスが、プラグインを開始したかどうかを確認する
+    StartResult CheckStarted(RemotePluginSession &session) const;
+
+    //! 開始したセッションを、オーディオスレッドから使用できるようにする
+    void Activate(std::shared_ptr<RemotePluginSession> session);
+
+    //! 起動に失敗したセッションを終了して、次の再試行の時刻を決める
+    void ScheduleRetry(std::shared_ptr<RemotePluginSession> failed_session);
+};
+
+std::shared_ptr<RemotePluginSession> RemotePlugin::Impl::Launch()
+{
+    auto const module_path = to_utf8(module_path_);
+    if(module_path.size() >= PluginHostSharedData::kMaxPathLength) {
+        HWM_ERROR_LOG(L"The module path is too long: " << module_path_);
+        return nullptr;
+    }
+
+    if(max_block_size_ > PluginHostSharedData::kMaxBlockSize) {
+        HWM_ERROR_LOG(L"The block size is too large for the plugin host: " << max_block_size_);
+        return nullptr;
+    }
+
+    auto session = std::make_shared<RemotePluginSession>();
+    auto const name = SharedMemory::MakeUniqueName();
+    try {
+        session->shm_ = SharedMemory::Create(name, sizeof(PluginHostSharedData));
+        session->data_ = new(session->shm_->GetData()) PluginHostSharedData();
+        session->request_ = std::make_unique<InterProcessSignal>(session->data_->request_counter_, name + L"_req", true);
+        session->response_ = std::make_unique<InterProcessSignal>(session->data_->response_counter_, name + L"_res", true);
+    } catch(std::exception &e) {
+        HWM_ERROR_LOG(L"Failed to prepare the plugin host: " << to_wstr(e.what()));
+        return nullptr;
+    }
+
+    auto &data = *session->data_;
+    std::memcpy(data.module_path_, module_path.data(), module_path.size());
+    data.has_cid_ = cid_.has_value();
+    if(cid_) { data.cid_ = *cid_; }
+    data.sample_rate_ = sample_rate_;
+    data.max_block_size_ = max_block_size_;
+    data.num_channels_ = std::min(num_channels_, PluginHostSharedData::kMaxNumChannels);
+    data.use_double_precision_ = use_double_precision_;
+    data.parent_process_id_ = wxGetProcessId();
+
+    session->sample_rate_ = sample_rate_;
+    session->max_consecutive_timeouts_ = (UInt32)std::ceil(kHangSeconds * sample_rate_ / std::max<SampleCount>(max_block_size_, 1));
+
+    auto const command
+    = L"\"" + wxStandardPaths::Get().GetExecutablePath().ToStdWstring() + L"\" --"
+    + to_wstr(kPluginHostOptionName) + L" " + name;
+
+    auto *process = new PluginHostProcess(session->terminated_);
+    session->pid_ = wxExecute(command, wxEXEC_ASYNC, process);
+    if(session->pid_ == 0) {
+        HWM_ERROR_LOG(L"Failed to launch the plugin host process: " << command);
+        delete process;
+        return nullptr;
+    }
+
+    return session;
+}
+
+RemotePlugin::Impl::StartResult RemotePlugin::Impl::CheckStarted(RemotePluginSession &session) const
+{
+    auto &data = *session.data_;
+    auto const state = data.host_state_.load();
+    if(state == PluginHostSharedData::kReady) {
+        data.plugin_name_[PluginHostSharedData::kMaxNameLength - 1] = '\0';
+        session.plugin_name_ = to_wstr(data.plugin_name_);
+        session.is_effect_ = data.is_effect_;
+        return StartResult::kReady;
+    }
+
+    // OnTerminate() はイベントループから呼ばれ、まだ呼ばれていないことがあるので、プロセスの存在も直接確認する
+    if(state != PluginHostSharedData::kStarting
+       || session.terminated_->load()
+       || wxProcess::Exists(session.pid_) == false
+       || clock_t::now() >= start_deadline_)
+    {
+        HWM_ERROR_LOG(L"Failed to start the plugin in the plugin host process: " << module_path_);
+        return StartResult::kFailed;
+    }
+
+    return StartResult::kPending;
+}
+
+void RemotePlugin::Impl::Activate(std::shared_ptr<RemotePluginSession> session)
+{
+    HWM_INFO_LOG(L"Started the plugin host process [" << session->plugin_name_ << L"]: " << session->pid_);
+
+    retry_interval_ = kMinRetryInterval;
+    process_time_.Reset();
+    overhead_.Reset();
+    session_.Exchange(std::move(session));
+}
+
+void RemotePlugin::Impl::ScheduleRetry(std::shared_ptr<RemotePluginSession> failed_session)
+{
+    if(failed_session) { KillProcess(failed_session->pid_); }
+
+    next_retry_ = clock_t::now() + retry_interval_;
+    HWM_INFO_LOG(L"Retry starting the plugin host process in "
+                 << std::chrono::duration_cast<std::chrono::seconds>(retry_interval_).count()
+                 << L" sec: " << module_path_);
+    retry_interval_ = std::min<clock_t::duration>(retry_interval_ * 2, kMaxRetryInterval);
+}
+
+RemotePlugin::RemotePlugin(String module_path, std::optional<ClassInfo::CID> cid)
+:   pimpl_(std::make_unique<Impl>())
+{
+    pimpl_->module_path_ = std::move(module_path);
+    pimpl_->cid_ = cid;
+}
+
+RemotePlugin::~RemotePlugin()
+{
+    Stop();
+}
+
+bool RemotePlugin::Start(double sample_rate, SampleCount max_block_size, UInt32 num_channels, bool use_double_precision)
+{
+    Stop();
+
+    auto &p = *pimpl_;
+    p.sample_rate_ = sample_rate;
+    p.max_block_size_ = max_block_size;
+    p.num_channels_ = num_channels;
+    p.use_double_precision_ = use_double_precision;
+    p.should_run_ = true;
+    p.retry_interval_ = kMinRetryInterval;
+
+    // プラグインの開始は、 Update() で確認する
+    p.starting_session_ = p.Launch();
+    if(!p.starting_session_) {
+        p.ScheduleRetry(nullptr);
+        return false;
+    }
+
+    p.start_deadline_ = Impl::clock_t::now() + kStartTimeout;
+    return true;
+}
+
+void RemotePlugin::Stop()
+{
+    using clock_t = std::chrono::steady_clock;
+
+    pimpl_->should_run_ = false;
+    if(auto starting = std::move(pimpl_->starting_session_)) {
+        KillProcess(starting->pid_);
+    }
+
+    // オーディオスレッドがセッションを参照しなくなるまで待機する
+    auto session = pimpl_->session_.Exchange(nullptr);
+    if(!session) { return; }
+
+    auto &data = *session->data_;
+    data.quit_requested_.store(true);
+    session->request_->Notify();
+
+    auto const deadline = clock_t::now() + kStopTimeout;
+    while(data.host_state_.load() == PluginHostSharedData::kReady
+          && session->terminated_->load() == false
+          && wxProcess::Exists(session->pid_)
+          && clock_t::now() < deadline)
+    {
+        wxMilliSleep(10);
+    }
+
+    if(data.host_state_.load() != PluginHostSharedData::kExited) {
+        HWM_WARN_LOG(L"The plugin host process did not exit normally. kill it: " << session->pid_);
+        KillProcess(session->pid_);
+    }
+}
+
+bool RemotePlugin::IsRunning() const
+{
+    auto session = pimpl_->session_.Get();
+    return session && session->IsCrashed() == false;
+}
+
+bool RemotePlugin::Update()
+{
+    auto &p = *pimpl_;
+    if(p.should_run_ == false) { return false; }
+
+    // Start() や前回の呼び出しで起動したプロセスが、プラグインを開始したかどうかを確認する
+    if(p.starting_session_) {
+        switch(p.CheckStarted(*p.starting_session_)) {
+            case Impl::StartResult::kReady:
+                p.Activate(std::move(p.starting_session_));
+                return true;
+            case Impl::StartResult::kPending:
+                return false;
+            case Impl::StartResult::kFailed:
+                p.ScheduleRetry(std::move(p.starting_session_));
+                return false;
+        }
+    }
+
+    if(auto session = p.session_.Get()) {
+        if(session->IsCrashed() == false) { return false; }
+
+        HWM_WARN_LOG(L"The plugin host process has crashed or stopped responding. restart it ["
+                     << session->plugin_name_ << L"]");
+
+        // 応答しなくなったプロセスの終了は待たずに、強制終了する
+        p.session_.Exchange(nullptr);
+        KillProcess(session->pid_);
+        p.next_retry_ = Impl::clock_t::now();
+    }
+
+    if(Impl::clock_t::now() < p.next_retry_) { return false; }
+
+    p.num_restarts_ += 1;
+    p.starting_session_ = p.Launch();
+    if(!p.starting_session_) {
+        p.ScheduleRetry(nullptr);
+        return false;
+    }
+
+    p.start_deadline_ = Impl::clock_t::now() + kStartTimeout;
+    return false;
+}
+
+void RemotePlugin::SetResponseTimeRatio(double ratio)
+{
+    assert(ratio > 0);
+    pimpl_->response_time_ratio_.store(ratio);
+}
+
+bool RemotePlugin::Process(ProcessInfo::TimeInfo const &time_info,
+                           BufferRef<AudioSample const> input,
+                           BufferRef<AudioSample> output,
+                           EventBufferList const &input_event_buffers,
+                           EventBufferList &output_event_buffers)
+{
+    using clock_t = std::chrono::steady_clock;
+
+    auto const block_size = output.samples();
+    auto write_silence = [&] {
+        for(UInt32 ch = 0; ch < output.channels(); ++ch) {
+            std::fill_n(output.get_channel_data(ch), block_size, 0);
+        }
+    };
+
+    auto session = pimpl_->session_.Read();
+    if(!session || block_size > PluginHostSharedData::kMaxBlockSize) {
+        write_silence();
+        return false;
+    }
+
+    auto &s = *session;
+    auto &data = *s.data_;
+    auto drop = [&] {
+        pimpl_->num_dropped_blocks_.fetch_add(1, std::memory_order_relaxed);
+        s.num_consecutive_timeouts_.fetch_add(1, std::memory_order_relaxed);
+        write_silence();
+        return false;
+    };
+
+    if(s.terminated_->load() || data.host_state_.load() != PluginHostSharedData::kReady) {
+        write_silence();
+        return false;
+    }
+
+    // 前のリクエストの応答が返ってくるまでは、共有メモリに書き込まない
+    if(s.waiting_response_) {
+        if(s.response_->GetCount() != s.expected_response_) { return drop(); }
+        s.waiting_response_ = false;
+    }
+
+    auto const num_channels = std::min(output.channels(), data.num_channels_);
+    for(UInt32 ch = 0; ch < num_channels; ++ch) {
+        if(ch < input.channels()) {
+            std::copy_n(input.get_channel_data(ch), block_size, data.input_audio_[ch]);
+        } else {
+            std::fill_n(data.input_audio_[ch], block_size, 0);
+        }
+    }
+
+    UInt32 num_input_events = 0;
+    if(input_event_buffers.GetNumBuffers() > 0) {
+        auto const events = input_event_buffers.GetRef(0);
+        num_input_events = std::min<UInt32>(events.size(), PluginHostSharedData::kMaxNumEvents);
+        std::copy_n(events.begin(), num_input_events, data.input_events_);
+    }
+    data.num_input_events_ = num_input_events;
+    data.time_info_ = time_info;
+    data.block_size_ = block_size;
+
+    auto const last_response = s.response_->GetCount();
+    auto const begin = clock_t::now();
+    s.request_->Notify();
+
+    // ブロックの長さを超えて待つと、デバイスへの出力が間に合わなくなる。
+    // ほかのノードの処理の時間も残すように、ブロックの長さの一部だけ待つ
+    auto const ratio = pimpl_->response_time_ratio_.load(std::memory_order_relaxed);
+    auto const timeout = std::chrono::microseconds((Int64)(block_size * 1000000.0 * ratio / s.sample_rate_));
+    if(s.response_->Wait(last_response, timeout) == false) {
+        s.waiting_response_ = true;
+        s.expected_response_ = last_response + 1;
+        return drop();
+    }
+    auto const end = clock_t::now();
+    s.num_consecutive_timeouts_.store(0, std::memory_order_relaxed);
+
+    for(UInt32 ch = 0; ch < output.channels(); ++ch) {
+        if(ch < num_channels) {
+            std::copy_n(data.output_audio_[ch], block_size, output.get_channel_data(ch));
+        } else {
+            std::fill_n(output.get_channel_data(ch), block_size, 0);
+        }
+    }
+
+    if(output_event_buffers.GetNumBuffers() > 0) {
+        auto const num_output_events = std::min(data.num_output_events_, PluginHostSharedData::kMaxNumEvents);
+        output_event_buffers.GetBuffer(0)->AddEvents(
+            ArrayRef<ProcessInfo::MidiMessage const>(data.output_events_, data.output_events_ + num_output_events));
+    }
+
+    auto const round_trip = (UInt64)std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+    auto const process_time = data.process_time_usec_;
+    pimpl_->process_time_.Record(process_time);
+    pimpl_->overhead_.Record(round_trip > process_time ? round_trip - process_time : 0);
+    return true;
+}
+
+String RemotePlugin::GetModulePath() const
+{
+    return pimpl_->module_path_;
+}
+
+String RemotePlugin::GetPluginName() const
+{
+    auto session = pimpl_->session_.Get();
+    return (session ? session->plugin_name_ : pimpl_->module_path_);
+}
+
+bool RemotePlugin::IsEffect() const
+{
+    auto session = pimpl_->session_.Get();
+    return (session ? session->is_effect_ : true);
+}
+
+UInt32 RemotePlugin::GetLatencySamples() const
+{
+    auto session = pimpl_->session_.Get();
+    return (session ? session->data_->latency_samples_.load() : 0);
+}
+
+LatencyHistogram::Summary RemotePlugin::GetProcessTimeSummary() const
+{
+    return pimpl_->process_time_.GetSummary();
+}
+
+LatencyHistogram::Summary RemotePlugin::GetOverheadSummary() const
+{
+    return pimpl_->overhead_.GetSummary();
+}
+
+UInt64 RemotePlugin::GetNumDroppedBlocks() const
+{
+    return pimpl_->num_dropped_blocks_.load(std::memory_order_relaxed);
+}
+
+UInt32 RemotePlugin::GetNumRestarts() const
+{
+    return pimpl_->num_restarts_;
+}
+
+NS_HWM_END
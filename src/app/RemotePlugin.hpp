@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <optional>
+
+#include "../misc/Buffer.hpp"
+#include "../misc/LatencyHistogram.hpp"
+#include "../plugin/vst3/ClassInfo.hpp"
+#include "../processor/EventBuffer.hpp"
+#include "../processor/ProcessInfo.hpp"
+
+NS_HWM_BEGIN
+
+//! プラグインを別プロセス（プラグインホストプロセス）で動作させるクラス
+/*! Start() でこのアプリケーションの実行ファイルを --plugin-host オプション付きで起動し、
+ *  ブロックごとのオーディオデータとイベントを共有メモリでやり取りする。
+ *  プラグインがクラッシュしても、アプリケーション側には影響しない。
+ *
+ *  Process() はブロックの長さに SetResponseTimeRatio() の割合を掛けた時間を上限にプラグインホストプロセスの応答を待ち、
+ *  間に合わなかった場合や、プラグインホストプロセスが終了している場合は無音を出力する。
+ *  プラグインのエディタとパラメータの操作には対応していない。
+ */
+class RemotePlugin final
+{
+public:
+    //! @param cid 省略した場合は、モジュールの最初のプラグインを使う
+    RemotePlugin(String module_path, std::optional<ClassInfo::CID> cid = std::nullopt);
+
+    //! プラグインホストプロセスを終了する
+    ~RemotePlugin();
+
+    RemotePlugin(RemotePlugin const &) = delete;
+    RemotePlugin & operator=(RemotePlugin const &) = delete;
+
+    //! プラグインホストプロセスを起動する。プラグインの開始は待たずに戻る。
+    /*! 起動済みの場合は、一度終了してから起動し直す。
+     *  プラグインが開始されたかどうかは、以降の Update() の呼び出しで確認する。
+     *  開始されるまでは Process() は無音を出力する。
+     *  失敗した場合も、 Stop() を呼び出すまでは Update() で起動を再試行する。
+     *  GUIスレッドから呼び出すこと。
+     *  @return プラグインホストプロセスを起動できなかった場合はfalse
+     */
+    bool Start(double sample_rate, SampleCount max_block_size, UInt32 num_channels, bool use_double_precision);
+
+    //! プラグインホストプロセスを終了する。
+    /*! オーディオスレッドが Process() を実行中の場合は、それが終わるまで待機する。
+     *  GUIスレッドから呼び出すこと。
+     */
+    void Stop();
+
+    //! プラグインホストプロセスが動作しているかどうか
+    bool IsRunning() const;
+
+    //! 起動したプラグインホストプロセスで、プラグインが開始されたかどうかを確認する。
+    /*! また、プラグインホストプロセスがクラッシュしたか、応答しなくなっていれば、前回の設定で起動し直す。
+     *  GUIスレッドから定期的に呼び出すこと。
+     *  プラグインの開始は待たずに戻り、以降の呼び出しで開始を確認する。
+     *  起動に失敗した場合は、間隔を延ばしながら再試行する。
+     *  @return Start() で起動したプラグインや、起動し直したプラグインが開始された場合はtrue
+     */
+    bool Update();
+
+    //! Process() で応答を待つ時間の上限を、ブロックの長さに対する割合で設定する。どのスレッドから呼び出してもよい。
+    /*! 直列につながった別プロセスのプラグインで、オーディオコールバックの時間を分け合うために使用する。
+     */
+    void SetResponseTimeRatio(double ratio);
+
+    //! プラグインの処理を行う。オーディオスレッドから呼び出す。
+    /*! @return プラグインホストプロセスの出力を書き込めなかった場合はfalse。このとき output は無音になる。
+     */
+    bool Process(ProcessInfo::TimeInfo const &time_info,
+                 BufferRef<AudioSample const> input,
+                 BufferRef<AudioSample> output,
+                 EventBufferList const &input_event_buffers,
+                 EventBufferList &output_event_buffers);
+
+    String GetModulePath() const;
+    //! Start() に成功するまでは、モジュールのパスを返す
+    String GetPluginName() const;
+    bool IsEffect() const;
+    UInt32 GetLatencySamples() const;
+
+    //! プラグインホストプロセスでの、プラグインの処理時間の分布 [us]
+    LatencyHistogram::Summary GetProcessTimeSummary() const;
+    //! プロセス間の受け渡しにかかった時間（往復の時間からプラグインの処理時間を引いたもの）の分布 [us]
+    LatencyHistogram::Summary GetOverheadSummary() const;
+    //! 応答が間に合わずに無音を出力したブロックの数
+    UInt64 GetNumDroppedBlocks() const;
+    //! Update() で起動し直した回数
+    UInt32 GetNumRestarts() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl_;
+};
+
+NS_HWM_END
@@ -0,0 +1,72 @@
+#include "Vst3PluginLoadTask.hpp"
+
+#include <stdexcept>
+
+NS_HWM_BEGIN
+
+using Stage = PluginLoader::Stage;
+
+Vst3PluginLoadTask::Vst3PluginLoadTask(std::shared_ptr<Vst3PluginFactory> factory,
+                                       ClassInfo::CID cid,
+                                       std::optional<Vst3Plugin::DumpDataRef> dump,
+                                       std::shared_ptr<void const> dump_owner,
+                                       SetUpFunc set_up)
+:   factory_(std::move(factory))
+,   cid_(cid)
+,   dump_(dump)
+,   dump_owner_(std::move(dump_owner))
+,   set_up_(std::move(set_up))
+{}
+
+Vst3PluginLoadTask::~Vst3PluginLoadTask()
+{
+    if(plugin_ && plugin_->IsResumed()) { plugin_->Suspend(); }
+    plugin_.reset();
+}
+
+bool Vst3PluginLoadTask::HasStage(Stage stage) const
+{
+    switch(stage) {
+        case Stage::kPreparing:
+            return dump_.has_value();
+        case Stage::kRestoringState:
+            return prepared_ != nullptr;
+        default:
+            return true;
+    }
+}
+
+void Vst3PluginLoadTask::Prepare()
+{
+    assert(dump_);
+    prepared_ = Vst3Plugin::PrepareData(*dump_);
+
+    // ストリームにコピーしたので、元のデータはもう参照しない
+    dump_.reset();
+    dump_owner_.reset();
+}
+
+void Vst3PluginLoadTask::Run(Stage stage)
+{
+    switch(stage) {
+        case Stage::kCreating:
+            plugin_ = factory_->CreateByID(cid_);
+            if(!plugin_) { throw std::runtime_error("the plugin is not found in the module"); }
+            break;
+        case Stage::kSettingUp:
+            if(set_up_(plugin_.get()) == false) { throw std::runtime_error("failed to set up the plugin"); }
+            break;
+        case Stage::kRestoringState:
+            assert(prepared_);
+            plugin_->LoadData(*prepared_);
+            break;
+        case Stage::kActivating:
+            plugin_->Resume();
+            break;
+        default:
+            assert(false);
+            break;
+    }
+}
+
+NS_HWM_END
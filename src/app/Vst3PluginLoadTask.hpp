@@ -0,0 +1,56 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include "./PluginLoader.hpp"
+#include "../plugin/vst3/Vst3Plugin.hpp"
+#include "../plugin/vst3/Vst3PluginFactory.hpp"
+
+NS_HWM_BEGIN
+
+//! PluginLoader で VST3プラグインをロードするタスク
+/*! ロード用のスレッドでは、 Vst3Plugin::PrepareData() で状態の復元に使用するストリームを作成するだけにして、
+ *  プラグインの作成、設定、 LoadData() による状態の復元、 Resume() はGUIスレッドで行う。
+ *  タスクを破棄したときは、作成したプラグインを停止して解放する。
+ */
+class Vst3PluginLoadTask final
+:   public PluginLoader::ITask
+{
+public:
+    //! 作成したプラグインのバスと再生設定を設定する関数。GUIスレッドから呼び出される。失敗した場合はfalseを返す
+    using SetUpFunc = std::function<bool(Vst3Plugin *plugin)>;
+
+    /*! @param dump 有効な場合は、開始する前にこの状態を復元する
+     *  @param dump_owner dump が参照するデータを保持するオブジェクト。状態の準備が終わるまで保持する
+     */
+    Vst3PluginLoadTask(std::shared_ptr<Vst3PluginFactory> factory,
+                       ClassInfo::CID cid,
+                       std::optional<Vst3Plugin::DumpDataRef> dump,
+                       std::shared_ptr<void const> dump_owner,
+                       SetUpFunc set_up);
+
+    ~Vst3PluginLoadTask();
+
+    bool HasStage(PluginLoader::Stage stage) const override;
+    void Prepare() override;
+    void Run(PluginLoader::Stage stage) override;
+
+    std::shared_ptr<Vst3PluginFactory> const & GetFactory() const { return factory_; }
+    ClassInfo::CID const & GetCID() const { return cid_; }
+
+    //! 開始済みのプラグインを取り出す
+    std::unique_ptr<Vst3Plugin> ReleasePlugin() { return std::move(plugin_); }
+
+private:
+    std::shared_ptr<Vst3PluginFactory> factory_;
+    ClassInfo::CID cid_;
+    std::optional<Vst3Plugin::DumpDataRef> dump_;
+    std::shared_ptr<void const> dump_owner_;
+    SetUpFunc set_up_;
+    std::shared_ptr<Vst3Plugin::PreparedDumpData const> prepared_;
+    std::unique_ptr<Vst3Plugin> plugin_;
+};
+
+NS_HWM_END
@@ -1,10 +1,14 @@
 #include <mutex>
+#include <thread>
+#include <chrono>
 #include <portaudio.h>
 
 #include "./AudioDeviceManager.hpp"
 #include "../misc/Buffer.hpp"
 #include "../misc/StrCnv.hpp"
 #include "../misc/MathUtil.hpp"
+#include "../misc/SampleConversion.hpp"
+#include "../log/RealtimeLogger.hpp"
 
 NS_HWM_BEGIN
 
@@ -40,20 +44,116 @@ PaHostApiIndex FromAudioDriverType(AudioDriverType type)
     }
 }
 
+//! オーディオデバイスのコールバック処理の負荷を計測する
+/*! Record〜() はオーディオスレッドから、GetStatistics() は任意のスレッドから呼び出す。
+ */
+class AudioDeviceLoadMeter
+{
+public:
+    using clock_t = std::chrono::steady_clock;
+    
+    //! 計測結果をリセットする。
+    /*! オーディオスレッドが停止しているときに呼び出すこと。
+     *  @param has_deadline 実時間に合わせてコールバックを呼び出すデバイスかどうか
+     */
+    void Reset(double sample_rate, SampleCount block_size, bool has_deadline)
+    {
+        deadline_usec_ = (has_deadline ? (UInt64)(block_size * 1000000.0 / sample_rate) : 0);
+        callback_usec_.Reset();
+        process_usec_.Reset();
+        conversion_usec_.Reset();
+        num_deadline_misses_.store(0);
+        input_underflow_count_.store(0);
+        input_overflow_count_.store(0);
+        output_underflow_count_.store(0);
+        output_overflow_count_.store(0);
+        priming_output_count_.store(0);
+    }
+    
+    //! 1ブロック分の処理時間を記録する。
+    /*! @param callback_time コールバック全体の処理時間
+     *  @param process_time そのうち IAudioDeviceCallback::Process() の処理時間
+     */
+    void RecordBlock(clock_t::duration callback_time, clock_t::duration process_time)
+    {
+        auto to_usec = [](auto d) {
+            return (UInt64)std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        };
+        
+        auto const callback_usec = to_usec(callback_time);
+        auto const process_usec = to_usec(process_time);
+        
+        callback_usec_.Record(callback_usec);
+        process_usec_.Record(process_usec);
+        conversion_usec_.Record(callback_usec - std::min(callback_usec, process_usec));
+        
+        if(deadline_usec_ > 0 && callback_usec > deadline_usec_) {
+            num_deadline_misses_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    void RecordStatusFlags(PaStreamCallbackFlags flags)
+    {
+        if(flags == 0) { return; }
+        
+        auto count_if = [flags](std::atomic<UInt64> &counter, PaStreamCallbackFlags flag) {
+            if(flags & flag) { counter.fetch_add(1, std::memory_order_relaxed); }
+        };
+        
+        count_if(input_underflow_count_, paInputUnderflow);
+        count_if(input_overflow_count_, paInputOverflow);
+        count_if(output_underflow_count_, paOutputUnderflow);
+        count_if(output_overflow_count_, paOutputOverflow);
+        count_if(priming_output_count_, paPrimingOutput);
+    }
+    
+    AudioDeviceLoadStatistics GetStatistics() const
+    {
+        AudioDeviceLoadStatistics st;
+        st.deadline_usec_ = deadline_usec_;
+        st.callback_usec_ = callback_usec_.GetSummary();
+        st.process_usec_ = process_usec_.GetSummary();
+        st.conversion_usec_ = conversion_usec_.GetSummary();
+        st.num_deadline_misses_ = num_deadline_misses_.load(std::memory_order_relaxed);
+        st.input_underflow_count_ = input_underflow_count_.load(std::memory_order_relaxed);
+        st.input_overflow_count_ = input_overflow_count_.load(std::memory_order_relaxed);
+        st.output_underflow_count_ = output_underflow_count_.load(std::memory_order_relaxed);
+        st.output_overflow_count_ = output_overflow_count_.load(std::memory_order_relaxed);
+        st.priming_output_count_ = priming_output_count_.load(std::memory_order_relaxed);
+        return st;
+    }
+    
+private:
+    UInt64 deadline_usec_ = 0;
+    LatencyHistogram callback_usec_;
+    LatencyHistogram process_usec_;
+    LatencyHistogram conversion_usec_;
+    std::atomic<UInt64> num_deadline_misses_ = { 0 };
+    std::atomic<UInt64> input_underflow_count_ = { 0 };
+    std::atomic<UInt64> input_overflow_count_ = { 0 };
+    std::atomic<UInt64> output_underflow_count_ = { 0 };
+    std::atomic<UInt64> output_overflow_count_ = { 0 };
+    std::atomic<UInt64> priming_output_count_ = { 0 };
+};
+
 class AudioDeviceImpl
 :   public IAudioDevice
 {
 public:
+    using clock_t = AudioDeviceLoadMeter::clock_t;
+    
     AudioDeviceImpl(AudioDeviceInfo const *input,
                     AudioDeviceInfo const *output,
                     double sample_rate,
                     SampleCount block_size,
                     std::vector<IAudioDeviceCallback *> &callbacks,
-                    PaStream *stream)
+                    PaStream *stream,
+                    bool non_interleaved)
     :   sample_rate_(sample_rate)
     ,   block_size_(block_size)
     ,   callbacks_(callbacks)
     ,   stream_(stream)
+    ,   non_interleaved_(non_interleaved)
     {
         if(input) { input_ = *input; }
         if(output) { output_ = *output; }
@@ -67,8 +167,22 @@ public:
         
         num_inputs_ = (input_ ? input_->num_channels_ : 0);
         num_outputs_ = (output_ ? output_->num_channels_ : 0);
-        tmp_input_float_.resize(num_inputs_, block_size);
-        tmp_output_float_.resize(num_outputs_, block_size);
+        
+        // ノンインターリーブのストリームでは、PortAudioのバッファを直接コールバックに渡すので、変換用のバッファは使用しない。
+        if(non_interleaved_ == false) {
+            tmp_input_float_.resize(num_inputs_, block_size);
+            tmp_output_float_.resize(num_outputs_, block_size);
+        }
+    }
+    
+    ~AudioDeviceImpl()
+    {
+        Stop();
+        
+        PaError err = Pa_CloseStream(stream_);
+        if(err != paNoError) {
+            HWM_WARN_LOG(L"PortAudio Error: " << to_wstr(Pa_GetErrorText(err)));
+        }
     }
     
     AudioDeviceImpl(AudioDeviceImpl const &rhs) = delete;
@@ -91,6 +205,7 @@ public:
             ForEachCallbacks([this](auto *cb) {
                 cb->StartProcessing(sample_rate_, block_size_, num_inputs_, num_outputs_);
             });
+            load_meter_.Reset(sample_rate_, block_size_, true);
             Pa_StartStream(stream_);
         }
     }
@@ -108,32 +223,44 @@ public:
         return Pa_IsStreamStopped(stream_);
     }
     
-    PaStream * GetStream() { return stream_; }
-    
     PaStreamCallbackResult StreamCallback(const void *input, void *output,
                                           unsigned long block_size, const PaStreamCallbackTimeInfo *timeInfo,
                                           PaStreamCallbackFlags statusFlags)
     {
-        input_underflow_count_ += ((statusFlags & paInputUnderflow) != 0);
-        input_overflow_count_ += ((statusFlags & paInputOverflow) != 0);
-        output_underflow_count_ += ((statusFlags & paOutputUnderflow) != 0);
-        output_overflow_count_ += ((statusFlags & paOutputOverflow) != 0);
-        priming_output_count_ += ((statusFlags & paPrimingOutput) != 0);
+        auto const callback_begin = clock_t::now();
+        load_meter_.RecordStatusFlags(statusFlags);
+        
+        auto const time_info = GetTimeInfo(callback_begin, timeInfo);
 
-        ClearBuffer<float>(output, block_size);
-        InvokeCallbacks<float>(input, output, block_size);
+        auto const process_time = (non_interleaved_
+                                   ? InvokeCallbacksNonInterleaved(input, output, block_size, time_info)
+                                   : InvokeCallbacksInterleaved(input, output, block_size, time_info));
+        
+        load_meter_.RecordBlock(clock_t::now() - callback_begin, process_time);
         return paContinue;
     }
     
     void OnStopped()
     {
+        // 計測結果は、停止後も次に Start() するまで参照できるように残しておく。
         ForEachCallbacks([](auto *cb) { cb->StopProcessing(); });
-        
-        input_underflow_count_ = 0;
-        input_overflow_count_ = 0;
-        output_underflow_count_ = 0;
-        output_overflow_count_ = 0;
-        priming_output_count_ = 0;
+    }
+    
+    std::optional<AudioDeviceLoadStatistics> GetLoadStatistics() const override
+    {
+        return load_meter_.GetStatistics();
+    }
+    
+    double GetInputLatency() const override
+    {
+        auto info = Pa_GetStreamInfo(stream_);
+        return (info && input_) ? info->inputLatency : 0;
+    }
+    
+    double GetOutputLatency() const override
+    {
+        auto info = Pa_GetStreamInfo(stream_);
+        return (info && output_) ? info->outputLatency : 0;
     }
     
 private:
@@ -146,13 +273,9 @@ private:
     PaStream *stream_ = nullptr;
     int num_inputs_ = 0;
     int num_outputs_ = 0;
+    bool non_interleaved_ = false;
     Buffer<float> tmp_input_float_, tmp_output_float_;
-
-    UInt64 input_underflow_count_ = 0;
-    UInt64 input_overflow_count_ = 0;
-    UInt64 output_underflow_count_ = 0;
-    UInt64 output_overflow_count_ = 0;
-    UInt64 priming_output_count_ = 0;
+    AudioDeviceLoadMeter load_meter_;
     
     //! @tparam F is a functor where its signature is `void(IAudioDeviceCallback *)`
     template<class F>
@@ -160,41 +283,255 @@ private:
         std::for_each(callbacks_.begin(), callbacks_.end(), f);
     }
     
-    template<class SampleType>
-    void ClearBuffer(void *output, SampleCount block_size)
+    //! PortAudioの時刻情報を、steady_clock を基準にした時刻に変換する。
+    /*! PortAudioの時刻はホストAPIごとに基準が異なるので、出力までの時間だけを利用する。
+     */
+    static
+    AudioDeviceTimeInfo GetTimeInfo(clock_t::time_point callback_begin, PaStreamCallbackTimeInfo const *pa_time_info)
     {
-        auto *p = reinterpret_cast<SampleType *>(output);
-        std::fill_n(p, num_outputs_ * block_size, 0);
+        AudioDeviceTimeInfo time_info;
+        time_info.callback_time_ = std::chrono::duration<double>(callback_begin.time_since_epoch()).count();
+        time_info.output_time_ = time_info.callback_time_;
+        
+        if(pa_time_info && pa_time_info->outputBufferDacTime > 0 && pa_time_info->currentTime > 0) {
+            auto const output_latency = pa_time_info->outputBufferDacTime - pa_time_info->currentTime;
+            if(output_latency > 0) {
+                time_info.output_time_ += output_latency;
+            }
+        }
+        
+        return time_info;
     }
     
-    template<class SampleType>
-    void InvokeCallbacks(const void *input, void *output, SampleCount block_size)
+    //! @return IAudioDeviceCallback::Process() の処理時間
+    clock_t::duration Process(float const * const * input, float **output, SampleCount block_size,
+                              AudioDeviceTimeInfo const &time_info)
     {
-        SampleType const * const * input_non_interleaved = nullptr;
-        SampleType ** output_non_interleaved = nullptr;
-        
-        auto *pi = reinterpret_cast<SampleType const *>(input);
-        for(int ch = 0; ch < num_inputs_; ++ch) {
-            for(SampleCount smp = 0; smp < block_size; ++smp) {
-                tmp_input_float_.data()[ch][smp] = pi[smp * num_inputs_ + ch];
-            }
+        auto const process_begin = clock_t::now();
+        ForEachCallbacks([&](IAudioDeviceCallback *cb) {
+            cb->Process(block_size, input, output, time_info);
+        });
+        return clock_t::now() - process_begin;
+    }
+    
+    //! インターリーブされたストリームのバッファを変換して、コールバックを呼び出す。
+    clock_t::duration InvokeCallbacksInterleaved(const void *input, void *output, SampleCount block_size,
+                                                 AudioDeviceTimeInfo const &time_info)
+    {
+        if(num_inputs_ > 0) {
+            Deinterleave(static_cast<float const *>(input), tmp_input_float_.data(), num_inputs_, block_size);
         }
         
         tmp_output_float_.fill(0.0);
         
-        input_non_interleaved = tmp_input_float_.data();
-        output_non_interleaved = tmp_output_float_.data();
+        auto const process_time = Process(tmp_input_float_.data(), tmp_output_float_.data(), block_size, time_info);
         
-        ForEachCallbacks([&](IAudioDeviceCallback *cb) {
-            cb->Process(block_size, input_non_interleaved, output_non_interleaved);
-        });
+        // 出力バッファは全サンプルが書き込まれるので、事前にクリアする必要はない。
+        if(num_outputs_ > 0) {
+            InterleaveWithClip(tmp_output_float_.data(), static_cast<float *>(output), num_outputs_, block_size);
+        }
+        
+        return process_time;
+    }
+    
+    //! ノンインターリーブのストリームのバッファをそのままコールバックに渡す。
+    clock_t::duration InvokeCallbacksNonInterleaved(const void *input, void *output, SampleCount block_size,
+                                                    AudioDeviceTimeInfo const &time_info)
+    {
+        auto const *pi = static_cast<float const * const *>(input);
+        auto **po = static_cast<float **>(output);
+        
+        for(int ch = 0; ch < num_outputs_; ++ch) {
+            std::fill_n(po[ch], block_size, 0.0f);
+        }
+        
+        auto const process_time = Process(pi, po, block_size, time_info);
         
-        auto *po = reinterpret_cast<SampleType *>(output);
         for(int ch = 0; ch < num_outputs_; ++ch) {
-            for(SampleCount smp = 0; smp < block_size; ++smp) {
-                po[smp * num_outputs_ + ch] = Clamp<AudioSample>(tmp_output_float_.data()[ch][smp],
-                                                                 -1.0, 1.0);
+            Clip(po[ch], po[ch], block_size);
+        }
+        
+        return process_time;
+    }
+};
+
+
+wchar_t const * const kNullDeviceName = L"Null Device";
+int const kNullDeviceNumChannels = 2;
+
+//! サウンドカードを使用せずに、内部のスレッドからコールバックを呼び出すデバイス
+class NullAudioDevice
+:   public IAudioDevice
+{
+public:
+    using NullDeviceMode = AudioDeviceManager::NullDeviceMode;
+    using clock_t = std::chrono::steady_clock;
+    
+    NullAudioDevice(AudioDeviceInfo const *input,
+                    AudioDeviceInfo const *output,
+                    double sample_rate,
+                    SampleCount block_size,
+                    std::vector<IAudioDeviceCallback *> &callbacks,
+                    NullDeviceMode mode)
+    :   sample_rate_(sample_rate)
+    ,   block_size_(block_size)
+    ,   callbacks_(callbacks)
+    ,   mode_(mode)
+    {
+        if(input) { input_ = *input; }
+        if(output) { output_ = *output; }
+        
+        assert(input_ || output_);
+        assert(sample_rate_ > 0);
+        assert(block_size_ > 0);
+        
+        num_inputs_ = (input_ ? input_->num_channels_ : 0);
+        num_outputs_ = (output_ ? output_->num_channels_ : 0);
+        tmp_input_float_.resize(num_inputs_, block_size);
+        tmp_output_float_.resize(num_outputs_, block_size);
+    }
+    
+    ~NullAudioDevice()
+    {
+        Stop();
+    }
+    
+    NullAudioDevice(NullAudioDevice const &rhs) = delete;
+    NullAudioDevice & operator=(NullAudioDevice const &rhs) = delete;
+    NullAudioDevice(NullAudioDevice &&rhs) = delete;
+    NullAudioDevice & operator=(NullAudioDevice &&rhs) = delete;
+    
+    AudioDeviceInfo const * GetDeviceInfo(DeviceIOType io) const override
+    {
+        auto const &info = (io == DeviceIOType::kInput) ? input_ : output_;
+        return info ? &*info : nullptr;
+    }
+    
+    double GetSampleRate() const override { return sample_rate_; }
+    SampleCount GetBlockSize() const override { return block_size_; }
+    
+    void Start() override
+    {
+        if(IsStopped() == false) { return; }
+        
+        ForEachCallbacks([this](auto *cb) {
+            cb->StartProcessing(sample_rate_, block_size_, num_inputs_, num_outputs_);
+        });
+        
+        num_processed_blocks_.store(0);
+        load_meter_.Reset(sample_rate_, block_size_, mode_ == NullDeviceMode::kPaced);
+        start_time_ = clock_t::now();
+        stop_requested_.store(false);
+        is_running_ = true;
+        thread_ = std::thread([this] { Run(); });
+    }
+    
+    void Stop() override
+    {
+        if(IsStopped()) { return; }
+        
+        stop_requested_.store(true);
+        thread_.join();
+        stop_time_ = clock_t::now();
+        is_running_ = false;
+        
+        ForEachCallbacks([](auto *cb) { cb->StopProcessing(); });
+    }
+    
+    bool IsStopped() const override
+    {
+        return is_running_ == false;
+    }
+    
+    std::optional<AudioDeviceThroughput> GetThroughput() const override
+    {
+        auto const end_time = (is_running_ ? clock_t::now() : stop_time_);
+        auto const elapsed = std::chrono::duration<double>(end_time - start_time_).count();
+        
+        AudioDeviceThroughput tp;
+        tp.num_processed_blocks_ = num_processed_blocks_.load(std::memory_order_relaxed);
+        if(elapsed > 0) {
+            tp.blocks_per_second_ = tp.num_processed_blocks_ / elapsed;
+            tp.realtime_factor_ = (tp.num_processed_blocks_ * block_size_ / sample_rate_) / elapsed;
+        }
+        
+        return tp;
+    }
+    
+    std::optional<AudioDeviceLoadStatistics> GetLoadStatistics() const override
+    {
+        return load_meter_.GetStatistics();
+    }
+    
+private:
+    std::optional<AudioDeviceInfo> input_;
+    std::optional<AudioDeviceInfo> output_;
+    double sample_rate_ = 0;
+    SampleCount block_size_ = 0;
+    
+    std::vector<IAudioDeviceCallback *> &callbacks_;
+    NullDeviceMode mode_ = NullDeviceMode::kPaced;
+    int num_inputs_ = 0;
+    int num_outputs_ = 0;
+    Buffer<float> tmp_input_float_, tmp_output_float_;
+    
+    std::thread thread_;
+    std::atomic<bool> stop_requested_ = { false };
+    bool is_running_ = false;
+    std::atomic<UInt64> num_processed_blocks_ = { 0 };
+    AudioDeviceLoadMeter load_meter_;
+    clock_t::time_point start_time_;
+    clock_t::time_point stop_time_;
+    
+    //! @tparam F is a functor where its signature is `void(IAudioDeviceCallback *)`
+    template<class F>
+    void ForEachCallbacks(F f) {
+        std::for_each(callbacks_.begin(), callbacks_.end(), f);
+    }
+    
+    void Run()
+    {
+        std::chrono::duration<double> const block_duration(block_size_ / sample_rate_);
+        
+        // ブロックごとに待機時間を足し込んでいくと誤差が蓄積するので、基準時刻からのブロック数で次の時刻を決める
+        auto base_time = clock_t::now();
+        UInt64 num_blocks_from_base = 0;
+        
+        while(stop_requested_.load() == false) {
+            // 入力は常に無音
+            auto const callback_begin = clock_t::now();
+            tmp_input_float_.fill(0.0);
+            tmp_output_float_.fill(0.0);
+            
+            // 出力レイテンシーは無いものとして扱う
+            AudioDeviceTimeInfo time_info;
+            time_info.callback_time_ = std::chrono::duration<double>(callback_begin.time_since_epoch()).count();
+            time_info.output_time_ = time_info.callback_time_;
+            
+            auto const process_begin = clock_t::now();
+            ForEachCallbacks([&](IAudioDeviceCallback *cb) {
+                cb->Process(block_size_, tmp_input_float_.data(), tmp_output_float_.data(), time_info);
+            });
+            auto const process_end = clock_t::now();
+            load_meter_.RecordBlock(process_end - callback_begin, process_end - process_begin);
+            
+            num_processed_blocks_.fetch_add(1, std::memory_order_relaxed);
+            
+            if(mode_ == NullDeviceMode::kFreewheel) { continue; }
+            
+            num_blocks_from_base += 1;
+            auto const next_time
+            = base_time + std::chrono::duration_cast<clock_t::duration>(block_duration * (double)num_blocks_from_base);
+            
+            auto const now = clock_t::now();
+            if(next_time + block_duration < now) {
+                // 処理が1ブロック以上遅れた場合は、遅れを取り戻そうとせずに基準時刻をリセットする
+                base_time = now;
+                num_blocks_from_base = 0;
+                continue;
             }
+            
+            std::this_thread::sleep_until(next_time);
         }
     }
 };
@@ -206,7 +543,9 @@ public:
     {}
     
     std::vector<IAudioDeviceCallback *> callbacks_;
-    std::unique_ptr<AudioDeviceImpl> device_;
+    std::unique_ptr<IAudioDevice> device_;
+    NullDeviceMode null_device_mode_ = NullDeviceMode::kPaced;
+    bool non_interleaved_ = false;
     
     static
     int StaticStreamCallback(const void *input, void *output,
@@ -216,7 +555,8 @@ public:
         auto *self = reinterpret_cast<Impl *>(userData);
         assert(self);
         
-        auto *device = self->device_.get();
+        // StreamCallbackはPortAudioのデバイスをオープンしているときにだけ呼び出される
+        auto *device = static_cast<AudioDeviceImpl *>(self->device_.get());
         assert(device);
         
         return device->StreamCallback(input, output, frameCount, timeInfo, statusFlags);
@@ -263,10 +603,14 @@ std::vector<AudioDeviceInfo> AudioDeviceManager::Enumerate()
     auto const device_count = Pa_GetDeviceCount();
     
     if(device_count < 0) {
+        // サウンドカードのデバイスが取得できなくても、ヌルデバイスは列挙する
         ShowErrorMsg(device_count);
-        return {};
     }
     
+    auto const supported_sample_rates = { 44100, 48000, 88200, 96000, 176400, 192000 };
+    assert(*supported_sample_rates.begin() == kSupportedSampleRateMin);
+    assert(*(supported_sample_rates.end() - 1) == kSupportedSampleRateMax);
+    
     std::vector<AudioDeviceInfo> result;
     for(PaDeviceIndex i = 0; i < device_count; ++i) {
         auto *info = Pa_GetDeviceInfo(i);
@@ -286,10 +630,6 @@ std::vector<AudioDeviceInfo> AudioDeviceManager::Enumerate()
             info->maxOutputChannels
         };
         
-        auto const supported_sample_rates = { 44100, 48000, 88200, 96000, 176400, 192000 };
-        assert(*supported_sample_rates.begin() == kSupportedSampleRateMin);
-        assert(*(supported_sample_rates.end() - 1) == kSupportedSampleRateMax);
-        
         for(auto rate: supported_sample_rates) {
             PaStreamParameters pi;
             PaStreamParameters po;
@@ -320,12 +660,44 @@ std::vector<AudioDeviceInfo> AudioDeviceManager::Enumerate()
         if(info->maxOutputChannels > 0) { result.push_back(tmp_out); }
     }
     
+    for(auto io_type: { DeviceIOType::kInput, DeviceIOType::kOutput }) {
+        AudioDeviceInfo null_device {
+            AudioDriverType::kNull,
+            io_type,
+            kNullDeviceName,
+            kNullDeviceNumChannels
+        };
+        null_device.supported_sample_rates_.assign(supported_sample_rates.begin(),
+                                                   supported_sample_rates.end());
+        result.push_back(null_device);
+    }
+    
     return result;
 }
 
+void AudioDeviceManager::SetNullDeviceMode(NullDeviceMode mode)
+{
+    pimpl_->null_device_mode_ = mode;
+}
+
+AudioDeviceManager::NullDeviceMode AudioDeviceManager::GetNullDeviceMode() const
+{
+    return pimpl_->null_device_mode_;
+}
+
+void AudioDeviceManager::SetNonInterleavedStreamEnabled(bool enable)
+{
+    pimpl_->non_interleaved_ = enable;
+}
+
+bool AudioDeviceManager::IsNonInterleavedStreamEnabled() const
+{
+    return pimpl_->non_interleaved_;
+}
+
 void SteamFinishedCallback(void* user_data)
 {
-    HWM_DEBUG_LOG(L"-------------- stream stopped --------------");
+    HWM_RT_DEBUG_LOG(L"-------------- stream stopped --------------");
 }
 
 AudioDeviceManager::OpenResult
@@ -350,12 +722,39 @@ AudioDeviceManager::Open(AudioDeviceInfo const *input_device,
         return Error(ErrorCode::kInvalidParameters, L"Unsupported block size.");
     }
     
+    auto is_null_device = [](AudioDeviceInfo const *info) {
+        return info && info->driver_ == AudioDriverType::kNull;
+    };
+    
+    if(is_null_device(input_device) || is_null_device(output_device)) {
+        if((input_device && !is_null_device(input_device)) ||
+           (output_device && !is_null_device(output_device)))
+        {
+            return Error(ErrorCode::kInvalidParameters, L"The null device can't be combined with other devices.");
+        }
+        
+        HWM_INFO_LOG(L"Open Null Device [ "
+                     << (input_device ? input_device->num_channels_ : 0) << L"ch in, "
+                     << (output_device ? output_device->num_channels_ : 0) << L"ch out, "
+                     << sample_rate << L", " << block_size << L", "
+                     << (pimpl_->null_device_mode_ == NullDeviceMode::kFreewheel ? L"freewheel" : L"paced")
+                     << L" ]");
+        
+        pimpl_->device_ = std::make_unique<NullAudioDevice>(input_device, output_device,
+                                                            sample_rate, block_size,
+                                                            pimpl_->callbacks_,
+                                                            pimpl_->null_device_mode_);
+        return pimpl_->device_.get();
+    }
+    
     PaStreamParameters ip = {};
     PaStreamParameters op = {};
     PaStreamParameters *pip = nullptr;
     PaStreamParameters *pop = nullptr;
     PaStreamFlags flags = 0;
     
+    PaSampleFormat const sample_format = (pimpl_->non_interleaved_ ? (paFloat32|paNonInterleaved) : paFloat32);
+    
     auto find_index = [](auto const &target) -> int {
         int num = Pa_GetDeviceCount();
         for(int i = 0; i < num; ++i) {
@@ -373,14 +772,14 @@ AudioDeviceManager::Open(AudioDeviceInfo const *input_device,
     if(input_device && input_device->num_channels_ > 0) {
         ip.channelCount = input_device->num_channels_;
         ip.device = find_index(*input_device);
-        ip.sampleFormat = paFloat32;
+        ip.sampleFormat = sample_format;
         if(ip.device >= 0) { pip = &ip; }
     }
     
     if(output_device && output_device->num_channels_ > 0) {
         op.channelCount = output_device->num_channels_;
         op.device = find_index(*output_device);
-        op.sampleFormat = paFloat32;
+        op.sampleFormat = sample_format;
         if(op.device >= 0) { pop = &op; }
     }
     
@@ -389,11 +788,12 @@ AudioDeviceManager::Open(AudioDeviceInfo const *input_device,
         return info->name_ + L" (" + to_wstring(info->driver_) + L")";
     };
     
-    HWM_INFO_LOG(wxString::Format(L"Open Device [ %ls, %ls, %6lg, %d ]",
+    HWM_INFO_LOG(wxString::Format(L"Open Device [ %ls, %ls, %6lg, %d, %ls ]",
                                   pip ? name_with_driver(input_device).c_str() : L"N/A",
                                   pop ? name_with_driver(output_device).c_str() : L"N/A",
                                   sample_rate,
-                                  (Int32)block_size
+                                  (Int32)block_size,
+                                  pimpl_->non_interleaved_ ? L"non-interleaved" : L"interleaved"
                                   ).ToStdWstring()
                  );
     
@@ -416,7 +816,8 @@ AudioDeviceManager::Open(AudioDeviceInfo const *input_device,
     pimpl_->device_ = std::make_unique<AudioDeviceImpl>(input_device, output_device,
                                                         sample_rate, block_size,
                                                         pimpl_->callbacks_,
-                                                        stream);
+                                                        stream,
+                                                        pimpl_->non_interleaved_);
     
     return pimpl_->device_.get();
 }
@@ -431,10 +832,6 @@ void AudioDeviceManager::Close()
     if(!IsOpened()) { return; }
     
     pimpl_->device_->Stop();
-    
-    PaError err = Pa_CloseStream(pimpl_->device_->GetStream());
-    ShowErrorMsg(err);
-    
     pimpl_->device_.reset();
 }
 
@@ -2,6 +2,7 @@
 
 #include "../misc/SingleInstance.hpp"
 #include "../misc/Either.hpp"
+#include "../misc/LatencyHistogram.hpp"
 #include "./DeviceType.hpp"
 
 NS_HWM_BEGIN
@@ -23,6 +24,43 @@ struct AudioDeviceInfo
     }
 };
 
+//! オーディオデバイスの処理性能の計測結果
+struct AudioDeviceThroughput
+{
+    //! Start() してから処理したブロック数
+    UInt64 num_processed_blocks_ = 0;
+    //! 1秒あたりに処理したブロック数
+    double blocks_per_second_ = 0;
+    //! 処理したオーディオの長さと経過時間の比。実時間と同じ速さで処理している場合は1.0になる
+    double realtime_factor_ = 0;
+};
+
+//! オーディオデバイスのコールバック処理の負荷の計測結果
+/*! 処理時間の単位はすべてマイクロ秒
+ */
+struct AudioDeviceLoadStatistics
+{
+    //! 1ブロックの処理に使える時間。（ブロックサイズ分の長さ）
+    /*! 実時間に合わせずに処理するデバイスでは0になる。
+     */
+    UInt64 deadline_usec_ = 0;
+    //! デバイスのコールバック全体の処理時間
+    LatencyHistogram::Summary callback_usec_;
+    //! IAudioDeviceCallback::Process() の処理時間（登録されているコールバックの合計）
+    LatencyHistogram::Summary process_usec_;
+    //! サンプルフォーマットの変換など、コールバック全体から IAudioDeviceCallback::Process() を除いた処理時間
+    LatencyHistogram::Summary conversion_usec_;
+    //! コールバック全体の処理時間が deadline_usec_ を超えたブロック数
+    UInt64 num_deadline_misses_ = 0;
+    
+    //! デバイスから通知されたアンダーフロー／オーバーフローの回数
+    UInt64 input_underflow_count_ = 0;
+    UInt64 input_overflow_count_ = 0;
+    UInt64 output_underflow_count_ = 0;
+    UInt64 output_overflow_count_ = 0;
+    UInt64 priming_output_count_ = 0;
+};
+
 class IAudioDevice
 {
 protected:
@@ -54,6 +92,43 @@ public:
     //! 指定したオーディオデバイスが停止中かどうかを返す。
     virtual
     bool IsStopped() const = 0;
+    
+    //! Start() してからの処理性能を返す。
+    /*! 計測に対応していないデバイスは std::nullopt を返す。
+     */
+    virtual
+    std::optional<AudioDeviceThroughput> GetThroughput() const { return std::nullopt; }
+    
+    //! Start() してからのコールバック処理の負荷を返す。
+    /*! オーディオスレッドの処理中に、どのスレッドから呼び出してもよい。
+     *  計測に対応していないデバイスは std::nullopt を返す。
+     */
+    virtual
+    std::optional<AudioDeviceLoadStatistics> GetLoadStatistics() const { return std::nullopt; }
+    
+    //! デバイスが報告する入力のレイテンシー（秒）を返す。
+    /*! 入力をオープンしていないデバイスや、レイテンシーを報告しないデバイスは0を返す。
+     */
+    virtual
+    double GetInputLatency() const { return 0; }
+    
+    //! デバイスが報告する出力のレイテンシー（秒）を返す。
+    virtual
+    double GetOutputLatency() const { return 0; }
+};
+
+//! オーディオデバイスから通知される、ブロックの時刻情報
+/*! 時刻は、std::chrono::steady_clock の time_since_epoch() からの秒数で表す。
+ *  (DeviceMidiMessage::time_stamp_ と同じ基準)
+ */
+struct AudioDeviceTimeInfo
+{
+    //! コールバックが呼び出された時刻
+    double callback_time_ = 0;
+    //! このブロックの先頭のサンプルがデバイスから出力される時刻の見込み
+    /*! デバイスが出力レイテンシーを報告しない場合は callback_time_ と同じ値になる。
+     */
+    double output_time_ = 0;
 };
 
 class IAudioDeviceCallback
@@ -73,8 +148,10 @@ public:
                          int num_input_channels,
                          int num_output_channels) = 0;
     
+    //! @param time_info このブロックの時刻情報
     virtual
-    void Process(SampleCount block_size, float const * const * input, float **output) = 0;
+    void Process(SampleCount block_size, float const * const * input, float **output,
+                 AudioDeviceTimeInfo const &time_info) = 0;
     
     virtual
     void StopProcessing() = 0;
@@ -91,9 +168,30 @@ public:
     
     //! デバイスを列挙する
     /*! デバイスがオープンした状態で呼び出してはいけない。
+     *  サウンドカードのデバイスに加えて、AudioDriverType::kNull のヌルデバイスが列挙される。
      */
     std::vector<AudioDeviceInfo> Enumerate();
     
+    //! ヌルデバイスの動作モード
+    enum class NullDeviceMode {
+        //! オープン時に指定したサンプリングレートとブロックサイズに合わせた間隔でコールバックを呼び出す
+        kPaced,
+        //! 待機せずに、できるだけ速くコールバックを呼び出す
+        kFreewheel,
+    };
+    
+    //! ヌルデバイスの動作モードを設定する。次回のヌルデバイスの Open() から反映される。
+    void SetNullDeviceMode(NullDeviceMode mode);
+    NullDeviceMode GetNullDeviceMode() const;
+    
+    //! サウンドカードのデバイスを、ノンインターリーブのバッファでオープンするかどうかを設定する。
+    /*! 有効にすると、PortAudioのバッファをそのまま IAudioDeviceCallback に渡すので、
+     *  インターリーブ／デインターリーブの変換が不要になる。
+     *  次回の Open() から反映される。デフォルトは無効。
+     */
+    void SetNonInterleavedStreamEnabled(bool enable);
+    bool IsNonInterleavedStreamEnabled() const;
+    
     enum ErrorCode {
         kAlreadyOpened,
         kDeviceNotFound,
@@ -21,6 +21,7 @@ std::map<AudioDriverType, std::string> const kAudioDriverTypeTable
     { AudioDriverType::kCoreAudio, "CoreAudio" },
     { AudioDriverType::kALSA, "ALSA" },
     { AudioDriverType::kJACK, "JACK" },
+    { AudioDriverType::kNull, "Null" },
 };
 
 std::string to_string(DeviceIOType io)
@@ -28,6 +28,7 @@ enum class AudioDriverType {
     kCoreAudio,
     kALSA,
     kJACK,
+    kNull,      //!< サウンドカードを使用しない仮想デバイス
 };
 
 std::string to_string(AudioDriverType type);
@@ -3,7 +3,8 @@
 #include "../misc/StrCnv.hpp"
 #include "../misc/ArrayRef.hpp"
 #include "../misc/LockFactory.hpp"
-#include "../misc/ThreadSafeRingBuffer.hpp"
+#include "../misc/RcuPointer.hpp"
+#include "../misc/SpscRingBuffer.hpp"
 
 NS_HWM_BEGIN
 
@@ -122,10 +123,12 @@ bool DeviceMidiMessage::ToBytes(std::vector<UInt8> &buf, UInt8 &running_status)
 struct MidiIn
 :   public IMidiDevice
 {
+    static constexpr UInt32 kRingCapacity = 1024;
+
     //! @throw RtMidiError
-    MidiIn(MidiDeviceInfo const &info, std::function<void(DeviceMidiMessage const &)> on_input)
+    MidiIn(MidiDeviceInfo const &info)
     :   info_(info)
-    ,   on_input_(on_input)
+    ,   ring_(kRingCapacity)
     {
         assert(info.io_type_ == DeviceIOType::kInput);
         midi_in_.ignoreTypes();
@@ -156,12 +159,27 @@ struct MidiIn
 
     MidiDeviceInfo const & GetDeviceInfo() const override { return info_; }
 
+    //! [オーディオスレッド] 受信したメッセージを、リングバッファ上で連続した区間ごとに f に渡して取り除く。
+    /*! @tparam F `void(ArrayRef<DeviceMidiMessage const> messages)`
+     */
+    template<class F>
+    void DrainMessages(F &f)
+    {
+        ring_.Read(ring_.GetCapacity(), [&f](DeviceMidiMessage const *src, UInt32 length, UInt32) {
+            f(ArrayRef<DeviceMidiMessage const>(src, src + length));
+        });
+    }
+
+    //! リングバッファが満杯で破棄したメッセージの数
+    UInt64 GetNumDroppedMessages() const { return num_dropped_messages_.load(std::memory_order_relaxed); }
 
 private:
     MidiDeviceInfo info_;
     RtMidiIn midi_in_;
     std::optional<UInt8> running_status_;
-    std::function<void(DeviceMidiMessage const &)> on_input_;
+    //! RtMidiのコールバックスレッドからオーディオスレッドへメッセージを渡すためのリングバッファ
+    SpscRingBuffer<DeviceMidiMessage> ring_;
+    std::atomic<UInt64> num_dropped_messages_ = { 0 };
 
     static
     void Callback(double, std::vector<unsigned char> *message, void *userData)
@@ -229,7 +247,10 @@ private:
                 assert(false);
         }
 
-        on_input_(m);
+        // タイムスタンプはここで付与済みなので、オーディオスレッドではそのまま利用できる
+        if(ring_.Push(m) == false) {
+            num_dropped_messages_.fetch_add(1, std::memory_order_relaxed);
+        }
     }
 
     void OnErrorCallback(RtMidiError::Type type, const std::string &errorText)
@@ -305,29 +326,24 @@ private:
 
 struct MidiDeviceManager::Impl
 {
-    static constexpr int kNumCapacity = 4096;
-    Impl()
-    :   input_messages_(kNumCapacity)
-    {}
-
     using MidiInPtr = std::shared_ptr<MidiIn>;
     using MidiOutPtr = std::shared_ptr<MidiOut>;
 
     std::vector<MidiInPtr> ins_;
     std::vector<MidiOutPtr> outs_;
-    SingleChannelThreadSafeRingBuffer<DeviceMidiMessage> input_messages_;
-
-    void AddMidiMessage(DeviceMidiMessage const &m)
+    //! オーディオスレッドから参照する、オープン中のMIDI入力デバイスのリスト
+    RcuPointer<std::vector<MidiIn *>> active_ins_;
+
+    //! ins_ の内容をオーディオスレッドに公開する。
+    /*! 差し替え前のリストが参照されなくなるまで待機するので、
+     *  この関数から戻った後は、リストから外したデバイスを解放できる。
+     *  lf_in_ をロックした状態で呼び出すこと。
+     */
+    void PublishInputs()
     {
-        std::string str_bytes;
-        std::vector<UInt8> buf(3);
-        m.ToBytes(buf);
-
-        for( ; ; ) {
-            auto result = input_messages_.Push(&m, 1);
-            if(result.error_code() == ThreadSafeRingBufferErrorCode::kTokenUnavailable) { continue; }
-            else { break; }
-        }
+        auto list = std::make_shared<std::vector<MidiIn *>>();
+        for(auto const &in: ins_) { list->push_back(in.get()); }
+        active_ins_.Exchange(std::move(list));
     }
 
     LockFactory lf_in_;
@@ -364,10 +380,11 @@ IMidiDevice * MidiDeviceManager::Open(MidiDeviceInfo const &info, String *error)
 {
     try {
         if(info.io_type_ == DeviceIOType::kInput) {
-            auto p = std::make_shared<MidiIn>(info, [this](auto const &m) { pimpl_->AddMidiMessage(m); });
+            auto p = std::make_shared<MidiIn>(info);
             {
                 auto lock = pimpl_->lf_in_.make_lock();
                 pimpl_->ins_.push_back(p);
+                pimpl_->PublishInputs();
             }
             return p.get();
         } else {
@@ -411,6 +428,7 @@ void MidiDeviceManager::Close(IMidiDevice const *device)
 
         auto moved = std::move(*found);
         pimpl_->ins_.erase(found);
+        pimpl_->PublishInputs();
         lock.unlock();
 
         moved.reset(); // close the device here
@@ -453,17 +471,33 @@ IMidiDevice * MidiDeviceManager::GetDevice(MidiDeviceInfo const &info)
 double MidiDeviceManager::GetMessages(std::vector<DeviceMidiMessage> &msg)
 {
     msg.clear();
+    return DrainMessages([&msg](ArrayRef<DeviceMidiMessage const> ms) {
+        msg.insert(msg.end(), ms.begin(), ms.end());
+    });
+}
 
-    for( ; ; ) {
-        auto num = pimpl_->input_messages_.GetNumPoppable();
-        msg.resize(num);
+double MidiDeviceManager::DrainMessagesImpl(DrainCallback cb, void *context)
+{
+    auto visit = [cb, context](ArrayRef<DeviceMidiMessage const> ms) { cb(context, ms); };
 
-        auto result = pimpl_->input_messages_.PopOverwrite(msg.data(), num);
-        if(result) { break; }
+    if(auto ins = pimpl_->active_ins_.Read()) {
+        for(auto *in: *ins) {
+            in->DrainMessages(visit);
+        }
     }
+
     return get_timestamp();
 }
 
+UInt64 MidiDeviceManager::GetNumDroppedInputMessages() const
+{
+    auto lock = pimpl_->lf_in_.make_lock();
+
+    UInt64 sum = 0;
+    for(auto const &in: pimpl_->ins_) { sum += in->GetNumDroppedMessages(); }
+    return sum;
+}
+
 //! MIDIメッセージを送信する。
 //! システムメッセージには未対応。
 void MidiDeviceManager::SendMessages(std::vector<DeviceMidiMessage> const &msg, double epoch)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../misc/SingleInstance.hpp"
+#include "../misc/ArrayRef.hpp"
 #include "../data_type/MidiDataType.hpp"
 #include "./DeviceType.hpp"
 #include "./MidiDevice.hpp"
@@ -71,6 +72,25 @@ public:
     //! 現在のタイムスタンプを返す。
     double GetMessages(std::vector<DeviceMidiMessage> &ms);
     
+    //! この瞬間までに取得できたMIDIメッセージを、コピーせずに f に渡して取り除く。
+    /*! @tparam F `void(ArrayRef<DeviceMidiMessage const> messages)`
+     *  入力デバイスごと、内部のリングバッファ上で連続した区間ごとに呼び出される。
+     *  メッセージのタイムスタンプは、受信したスレッドで付与済み。
+     *  ロックもメモリの確保も行わないので、オーディオスレッドから呼び出せる。
+     *  ただし、同時に呼び出せるのは1つのスレッドだけ。
+     *  @return 現在のタイムスタンプ
+     */
+    template<class F>
+    double DrainMessages(F &&f)
+    {
+        return DrainMessagesImpl([](void *context, ArrayRef<DeviceMidiMessage const> ms) {
+            (*static_cast<std::remove_reference_t<F> *>(context))(ms);
+        }, &f);
+    }
+    
+    //! 受信したが、オーディオスレッドで取り出される前にバッファが満杯になって破棄したメッセージの数
+    UInt64 GetNumDroppedInputMessages() const;
+    
     //! MIDIメッセージを送信する。
     //! システムメッセージには未対応。
     //! 各DeviceMidiMessageのtime_stampは、epochからの時間として扱う
@@ -79,6 +99,9 @@ public:
 private:
     struct Impl;
     std::unique_ptr<Impl> pimpl_;
+    
+    using DrainCallback = void(*)(void *context, ArrayRef<DeviceMidiMessage const> messages);
+    double DrainMessagesImpl(DrainCallback cb, void *context);
 };
 
 NS_HWM_END
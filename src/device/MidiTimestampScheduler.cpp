@@ -0,0 +1,133 @@
+#include "MidiTimestampScheduler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+NS_HWM_BEGIN
+
+namespace {
+    //! DLLの予測からこれ以上(ブロック数)外れた場合は、xrunなどでクロックが飛んだとみなしてロックし直す
+    double const kMaxPhaseErrorInBlocks = 2.0;
+    //! レイテンシーを自動で決める場合に追加する余裕 [秒]
+    double const kAutoLatencyMargin = 0.001;
+
+    double const kPi = 3.14159265358979323846;
+}
+
+MidiTimestampScheduler::MidiTimestampScheduler(UInt32 capacity, double bandwidth)
+:   pending_(capacity)
+,   bandwidth_(bandwidth)
+{
+    assert(capacity > 0);
+    assert(bandwidth > 0);
+}
+
+void MidiTimestampScheduler::SetLatency(double latency)
+{
+    requested_latency_ = latency;
+}
+
+double MidiTimestampScheduler::GetLatency() const
+{
+    return latency_.load(std::memory_order_relaxed);
+}
+
+void MidiTimestampScheduler::Reset(double sample_rate, SampleCount max_block_size)
+{
+    assert(sample_rate > 0);
+    assert(max_block_size > 0);
+
+    sample_rate_ = sample_rate;
+    num_pending_ = 0;
+    is_locked_ = false;
+    block_size_ = 0;
+    latency_.store(std::max(requested_latency_, 0.0));
+
+    jitter_usec_.Reset();
+    num_late_events_.store(0);
+    num_dropped_events_.store(0);
+}
+
+void MidiTimestampScheduler::UpdateCoefficients(SampleCount block_size)
+{
+    // 2次のDLL。(F. Adriaensen, "Using a DLL to filter time")
+    double const omega = 2 * kPi * bandwidth_ * block_size / sample_rate_;
+    b_ = std::sqrt(2.0) * omega;
+    c_ = omega * omega;
+}
+
+void MidiTimestampScheduler::BeginBlock(AudioDeviceTimeInfo const &time_info, SampleCount block_size)
+{
+    assert(block_size > 0);
+
+    double const t = time_info.output_time_;
+    double const nominal_period = block_size / sample_rate_;
+
+    if(block_size != block_size_) {
+        block_size_ = block_size;
+        UpdateCoefficients(block_size);
+        is_locked_ = false;
+    }
+
+    if(is_locked_) {
+        double const e = t - t1_;
+        if(std::abs(e) > nominal_period * kMaxPhaseErrorInBlocks) {
+            is_locked_ = false;
+        } else {
+            jitter_usec_.Record((UInt64)std::round(std::abs(e) * 1000000.0));
+            t0_ = t1_;
+            t1_ += b_ * e + e2_;
+            e2_ += c_ * e;
+        }
+    }
+
+    if(is_locked_ == false) {
+        t0_ = t;
+        t1_ = t + nominal_period;
+        e2_ = nominal_period;
+        is_locked_ = true;
+
+        // 一度決めたレイテンシーは、ロックし直しても変更しない
+        if(latency_.load(std::memory_order_relaxed) <= 0) {
+            auto const output_latency = std::max(time_info.output_time_ - time_info.callback_time_, 0.0);
+            latency_.store(output_latency + nominal_period + kAutoLatencyMargin, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool MidiTimestampScheduler::Push(DeviceMidiMessage const &msg)
+{
+    if(num_pending_ == pending_.size()) {
+        num_dropped_events_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    pending_[num_pending_++] = msg;
+    return true;
+}
+
+double MidiTimestampScheduler::GetPosition(DeviceMidiMessage const &msg) const
+{
+    assert(is_locked_);
+
+    double const play_time = msg.time_stamp_ + latency_.load(std::memory_order_relaxed);
+    return (play_time - t0_) / (t1_ - t0_) * block_size_;
+}
+
+LatencyHistogram::Summary MidiTimestampScheduler::GetJitterSummary() const
+{
+    return jitter_usec_.GetSummary();
+}
+
+UInt64 MidiTimestampScheduler::GetNumLateEvents() const
+{
+    return num_late_events_.load(std::memory_order_relaxed);
+}
+
+UInt64 MidiTimestampScheduler::GetNumDroppedEvents() const
+{
+    return num_dropped_events_.load(std::memory_order_relaxed);
+}
+
+NS_HWM_END
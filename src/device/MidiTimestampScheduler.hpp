@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "./AudioDeviceManager.hpp"
+#include "./MidiDeviceManager.hpp"
+#include "../misc/LatencyHistogram.hpp"
+
+NS_HWM_BEGIN
+
+//! MIDI入力のタイムスタンプを、オーディオブロック内のサンプル位置に変換するクラス
+/*! オーディオデバイスのクロックと steady_clock の対応を、ブロックごとの時刻情報から
+ *  DLL(delay-locked loop)で推定する。
+ *  MIDIメッセージは、受信した時刻から一定のレイテンシーだけ遅らせた位置に配置するので、
+ *  ブロック単位の量子化による揺れが発生しない。
+ *  レイテンシーが小さすぎて間に合わなかったメッセージは、ブロックの先頭に配置される。
+ *
+ *  Reset() 以外の関数はメモリの確保を行わないので、オーディオスレッドから呼び出せる。
+ *  GetJitterSummary() などの統計情報は、どのスレッドから呼び出してもよい。
+ */
+class MidiTimestampScheduler
+{
+public:
+    //! 保持できる、まだ再生位置に達していないメッセージの数
+    static constexpr UInt32 kDefaultCapacity = 1024;
+    //! DLLの帯域幅 [Hz]
+    static constexpr double kDefaultBandwidth = 0.5;
+
+    MidiTimestampScheduler(UInt32 capacity = kDefaultCapacity,
+                           double bandwidth = kDefaultBandwidth);
+
+    //! 受信してから再生するまでのレイテンシーを設定する。
+    /*! @param latency 秒数。0以下を指定した場合は、最初のブロックの時刻情報から
+     *  メッセージが間に合う最小のレイテンシー（出力レイテンシー + 1ブロック分 + 余裕）を求めて、以降はその値を使用する。
+     *  次回の Reset() から反映される。
+     */
+    void SetLatency(double latency);
+
+    //! 現在使用しているレイテンシーを返す。自動で決める場合、最初のブロックまでは0を返す。
+    double GetLatency() const;
+
+    //! オーディオ処理の開始時に呼び出す。
+    /*! オーディオスレッドが停止しているときに呼び出すこと。
+     */
+    void Reset(double sample_rate, SampleCount max_block_size);
+
+    //! ブロックの処理の開始時に呼び出して、DLLを更新する。
+    void BeginBlock(AudioDeviceTimeInfo const &time_info, SampleCount block_size);
+
+    //! 受信したMIDIメッセージを追加する。
+    /*! @return 保持できる数を超えて、メッセージを破棄した場合はfalse
+     */
+    bool Push(DeviceMidiMessage const &msg);
+
+    //! 現在のブロックに含まれるメッセージを取り出す。
+    /*! @tparam F `void(DeviceMidiMessage const &msg, SampleCount offset)`
+     *  offset は [0, block_size) の範囲に収まる。
+     */
+    template<class F>
+    void PopEvents(F f);
+    
+    //! 受信したMIDIメッセージを、現在のブロックに含まれる場合は直接 f に渡し、そうでなければ Push() する。
+    /*! PopEvents() を呼び出した後に、新しく受信したメッセージに対して呼び出す。
+     *  @return 保持できる数を超えて、メッセージを破棄した場合はfalse
+     */
+    template<class F>
+    bool Schedule(DeviceMidiMessage const &msg, F f);
+
+    //! DLLで推定したブロックの時刻と、デバイスから通知された時刻との差の分布 [マイクロ秒]
+    LatencyHistogram::Summary GetJitterSummary() const;
+    //! レイテンシー内に間に合わず、ブロックの先頭に配置したメッセージの数
+    UInt64 GetNumLateEvents() const;
+    //! 保持できる数を超えて破棄したメッセージの数
+    UInt64 GetNumDroppedEvents() const;
+
+private:
+    //! まだ再生位置に達していないメッセージ。（受信順）
+    std::vector<DeviceMidiMessage> pending_;
+    UInt32 num_pending_ = 0;
+
+    double bandwidth_ = kDefaultBandwidth;
+    double requested_latency_ = 0;
+    std::atomic<double> latency_ = { 0 };
+    double sample_rate_ = 44100;
+
+    // DLLの状態
+    bool is_locked_ = false;
+    double t0_ = 0;         //!< 現在のブロックの先頭の時刻
+    double t1_ = 0;         //!< 次のブロックの先頭の時刻の予測
+    double e2_ = 0;         //!< ブロックの長さの推定値
+    double b_ = 0;
+    double c_ = 0;
+    SampleCount block_size_ = 0;
+
+    LatencyHistogram jitter_usec_;
+    std::atomic<UInt64> num_late_events_ = { 0 };
+    std::atomic<UInt64> num_dropped_events_ = { 0 };
+
+    void UpdateCoefficients(SampleCount block_size);
+
+    //! メッセージの再生位置を、現在のブロックの先頭からのサンプル数で返す
+    double GetPosition(DeviceMidiMessage const &msg) const;
+    
+    //! メッセージが現在のブロックに含まれる場合は f に渡して true を返す。
+    template<class F>
+    bool EmitIfDue(DeviceMidiMessage const &msg, F &f);
+};
+
+template<class F>
+bool MidiTimestampScheduler::EmitIfDue(DeviceMidiMessage const &msg, F &f)
+{
+    auto const pos = GetPosition(msg);
+    
+    // まだ再生位置に達していない
+    if(pos >= block_size_) { return false; }
+    
+    if(pos < 0) {
+        num_late_events_.fetch_add(1, std::memory_order_relaxed);
+        f(msg, 0);
+    } else {
+        f(msg, (SampleCount)pos);
+    }
+    return true;
+}
+
+template<class F>
+void MidiTimestampScheduler::PopEvents(F f)
+{
+    UInt32 num_remaining = 0;
+    for(UInt32 i = 0; i < num_pending_; ++i) {
+        auto const &msg = pending_[i];
+        if(EmitIfDue(msg, f)) { continue; }
+        
+        if(num_remaining != i) { pending_[num_remaining] = msg; }
+        ++num_remaining;
+    }
+    num_pending_ = num_remaining;
+}
+
+template<class F>
+bool MidiTimestampScheduler::Schedule(DeviceMidiMessage const &msg, F f)
+{
+    if(EmitIfDue(msg, f)) { return true; }
+    return Push(msg);
+}
+
+NS_HWM_END
@@ -0,0 +1,174 @@
+#include "./AtomicFileWriter.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "../misc/StrCnv.hpp"
+
+NS_HWM_BEGIN
+
+namespace {
+
+#if defined(_MSC_VER)
+std::string GetLastErrorString()
+{
+    return "error code " + std::to_string(GetLastError());
+}
+#else
+std::string GetLastErrorString()
+{
+    return strerror(errno);
+}
+
+//! ファイルの内容をディスクに書き出す
+bool SyncFileDescriptor(int fd)
+{
+#if defined(F_FULLFSYNC)
+    // macOSの fsync() はディスクのキャッシュまでは書き出さない
+    if(fcntl(fd, F_FULLFSYNC) != -1) { return true; }
+#endif
+    return fsync(fd) == 0;
+}
+#endif
+
+} // namespace
+
+class AtomicFileWriter::Impl
+{
+public:
+    String path_;
+    String tmp_path_;
+    std::ofstream ofs_;
+    bool synced_ = false;
+    bool replaced_ = false;
+
+    [[noreturn]]
+    void Fail(std::string const &what)
+    {
+        throw std::runtime_error("failed to " + what + " [" + to_utf8(tmp_path_) + "]: " + GetLastErrorString());
+    }
+
+    void RemoveTemporaryFile()
+    {
+#if defined(_MSC_VER)
+        DeleteFileW(tmp_path_.c_str());
+#else
+        unlink(to_utf8(tmp_path_).c_str());
+#endif
+    }
+};
+
+AtomicFileWriter::AtomicFileWriter(String const &path)
+:   pimpl_(std::make_unique<Impl>())
+{
+    pimpl_->path_ = path;
+    pimpl_->tmp_path_ = path + L".saving";
+
+#if defined(_MSC_VER)
+    pimpl_->ofs_.open(pimpl_->tmp_path_, std::ios::binary | std::ios::trunc);
+#else
+    pimpl_->ofs_.open(to_utf8(pimpl_->tmp_path_), std::ios::binary | std::ios::trunc);
+#endif
+
+    if(!pimpl_->ofs_) {
+        pimpl_->Fail("create the temporary file");
+    }
+}
+
+AtomicFileWriter::~AtomicFileWriter()
+{
+    if(pimpl_->replaced_) { return; }
+
+    pimpl_->ofs_.close();
+    pimpl_->RemoveTemporaryFile();
+}
+
+std::ostream & AtomicFileWriter::GetStream()
+{
+    return pimpl_->ofs_;
+}
+
+void AtomicFileWriter::Sync()
+{
+    if(pimpl_->synced_) { return; }
+
+    pimpl_->ofs_.close();
+    if(!pimpl_->ofs_) {
+        pimpl_->Fail("write the temporary file");
+    }
+
+#if defined(_MSC_VER)
+    auto file = CreateFileW(pimpl_->tmp_path_.c_str(), GENERIC_WRITE, 0, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE) { pimpl_->Fail("open the temporary file"); }
+
+    auto const flushed = FlushFileBuffers(file);
+    CloseHandle(file);
+    if(!flushed) { pimpl_->Fail("sync the temporary file"); }
+#else
+    auto fd = open(to_utf8(pimpl_->tmp_path_).c_str(), O_RDONLY);
+    if(fd == -1) { pimpl_->Fail("open the temporary file"); }
+
+    auto const synced = SyncFileDescriptor(fd);
+    close(fd);
+    if(!synced) { pimpl_->Fail("sync the temporary file"); }
+#endif
+
+    pimpl_->synced_ = true;
+}
+
+void AtomicFileWriter::Replace()
+{
+    assert(pimpl_->replaced_ == false);
+
+    Sync();
+
+#if defined(_MSC_VER)
+    if(!MoveFileExW(pimpl_->tmp_path_.c_str(), pimpl_->path_.c_str(),
+                    MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        pimpl_->Fail("replace the file with");
+    }
+#else
+    if(rename(to_utf8(pimpl_->tmp_path_).c_str(), to_utf8(pimpl_->path_).c_str()) != 0) {
+        pimpl_->Fail("replace the file with");
+    }
+
+    // リネームした結果もディスクに書き出しておく。失敗してもファイルの内容は壊れないので無視する
+    auto const utf8_path = to_utf8(pimpl_->path_);
+    auto const separator = utf8_path.find_last_of('/');
+    auto const dir = (separator == std::string::npos) ? std::string(".")
+    : (separator == 0) ? std::string("/")
+    : utf8_path.substr(0, separator);
+
+    auto dir_fd = open(dir.c_str(), O_RDONLY);
+    if(dir_fd != -1) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+#endif
+
+    pimpl_->replaced_ = true;
+}
+
+String const & AtomicFileWriter::GetPath() const
+{
+    return pimpl_->path_;
+}
+
+String const & AtomicFileWriter::GetTemporaryPath() const
+{
+    return pimpl_->tmp_path_;
+}
+
+NS_HWM_END
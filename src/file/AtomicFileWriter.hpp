@@ -0,0 +1,52 @@
+#pragma once
+
+#include <fstream>
+#include <memory>
+
+NS_HWM_BEGIN
+
+//! ファイルを書き出すときに、書き出しが完了するまで元のファイルを変更しないようにするクラス
+/*! 書き出し先と同じディレクトリの一時ファイルに書き出して、
+ *  Sync() でその内容をディスクに書き出してから、 Replace() で書き出し先のファイルと置き換える。
+ *  置き換えはOSのリネームで行うので、書き出しの途中でアプリケーションが終了しても、
+ *  書き出し先には元のファイルか新しいファイルのどちらかが完全な状態で残る。
+ *
+ *  Windows以外では、置き換える前のファイルをマップしている場合も、
+ *  そのマップは元のファイルの内容を参照し続ける。
+ */
+class AtomicFileWriter final
+{
+public:
+    //! path に書き出すための一時ファイルを作成する。
+    /*! @exception std::runtime_error
+     */
+    explicit AtomicFileWriter(String const &path);
+
+    //! Replace() を呼び出していない場合は、一時ファイルを削除する
+    ~AtomicFileWriter();
+
+    AtomicFileWriter(AtomicFileWriter const &) = delete;
+    AtomicFileWriter & operator=(AtomicFileWriter const &) = delete;
+
+    //! 一時ファイルへ書き出すストリーム
+    std::ostream & GetStream();
+
+    //! 一時ファイルを閉じて、その内容をディスクに書き出す。
+    /*! @exception std::runtime_error
+     */
+    void Sync();
+
+    //! 一時ファイルで書き出し先のファイルを置き換える。 Sync() を呼び出していない場合は先に呼び出す。
+    /*! @exception std::runtime_error
+     */
+    void Replace();
+
+    String const & GetPath() const;
+    String const & GetTemporaryPath() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl_;
+};
+
+NS_HWM_END
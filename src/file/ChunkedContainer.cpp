@@ -0,0 +1,151 @@
+#include "./ChunkedContainer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+NS_HWM_BEGIN
+
+namespace {
+    char const kSignature[8] = { 'H', 'W', 'M', 'C', 'H', 'U', 'N', 'K' };
+    size_t const kTocEntrySize = 24;
+
+    UInt64 AlignUp(UInt64 value, UInt64 alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void PutLE(char *dest, UInt64 value, size_t num_bytes)
+    {
+        for(size_t i = 0; i < num_bytes; ++i) {
+            dest[i] = (char)((value >> (i * 8)) & 0xFF);
+        }
+    }
+
+    UInt64 GetLE(char const *src, size_t num_bytes)
+    {
+        UInt64 value = 0;
+        for(size_t i = 0; i < num_bytes; ++i) {
+            value |= (UInt64)(unsigned char)src[i] << (i * 8);
+        }
+        return value;
+    }
+
+    void WritePadding(std::ostream &os, UInt64 size)
+    {
+        char const zeros[kChunkedContainerAlignment] = {};
+        while(size > 0) {
+            auto const n = std::min<UInt64>(size, sizeof(zeros));
+            os.write(zeros, (std::streamsize)n);
+            size -= n;
+        }
+    }
+}
+
+FailedToParseChunkedContainer::FailedToParseChunkedContainer(std::string const &error_msg)
+:   std::runtime_error("Failed to parse the chunked container: " + error_msg)
+{}
+
+bool HasChunkedContainerSignature(ArrayRef<char const> data)
+{
+    return data.size() >= sizeof(kSignature)
+    && std::memcmp(data.data(), kSignature, sizeof(kSignature)) == 0;
+}
+
+void WriteChunkedContainer(std::ostream &os, std::vector<ContainerChunk> const &chunks)
+{
+    // 先にすべてのチャンクの位置を決めておき、ファイルを先頭から一度だけ書き出す
+    std::vector<UInt64> offsets;
+    offsets.reserve(chunks.size());
+    
+    UInt64 pos = AlignUp(kChunkedContainerHeaderSize, kChunkedContainerAlignment);
+    for(auto const &chunk: chunks) {
+        offsets.push_back(pos);
+        pos = AlignUp(pos + chunk.data_.size(), kChunkedContainerAlignment);
+    }
+    
+    UInt64 const toc_offset = pos;
+    UInt64 const file_size = toc_offset + kTocEntrySize * chunks.size();
+    
+    char header[kChunkedContainerHeaderSize] = {};
+    std::memcpy(header, kSignature, sizeof(kSignature));
+    PutLE(header + 8, kChunkedContainerVersion, 4);
+    PutLE(header + 12, chunks.size(), 4);
+    PutLE(header + 16, toc_offset, 8);
+    PutLE(header + 24, file_size, 8);
+    os.write(header, sizeof(header));
+    
+    UInt64 written = sizeof(header);
+    for(size_t i = 0; i < chunks.size(); ++i) {
+        WritePadding(os, offsets[i] - written);
+        os.write(chunks[i].data_.data(), (std::streamsize)chunks[i].data_.size());
+        written = offsets[i] + chunks[i].data_.size();
+    }
+    WritePadding(os, toc_offset - written);
+    
+    for(size_t i = 0; i < chunks.size(); ++i) {
+        char entry[kTocEntrySize] = {};
+        PutLE(entry, chunks[i].id_, 4);
+        PutLE(entry + 8, offsets[i], 8);
+        PutLE(entry + 16, chunks[i].data_.size(), 8);
+        os.write(entry, sizeof(entry));
+    }
+}
+
+std::vector<ContainerChunk> ReadChunkedContainer(ArrayRef<char const> data)
+{
+    using E = FailedToParseChunkedContainer;
+    
+    if(data.size() < kChunkedContainerHeaderSize || !HasChunkedContainerSignature(data)) {
+        throw E("unknown signature.");
+    }
+    
+    auto const header = data.data();
+    auto const version = (UInt32)GetLE(header + 8, 4);
+    auto const num_chunks = (UInt32)GetLE(header + 12, 4);
+    auto const toc_offset = GetLE(header + 16, 8);
+    auto const file_size = GetLE(header + 24, 8);
+    
+    if(version == 0 || version > kChunkedContainerVersion) {
+        throw E("unsupported version " + std::to_string(version) + ".");
+    }
+    
+    if(file_size > data.size()) {
+        throw E("the file is truncated.");
+    }
+    
+    if(toc_offset > file_size || (file_size - toc_offset) / kTocEntrySize < num_chunks) {
+        throw E("the table of contents is out of range.");
+    }
+    
+    std::vector<ContainerChunk> chunks;
+    chunks.reserve(num_chunks);
+    
+    for(UInt32 i = 0; i < num_chunks; ++i) {
+        auto const entry = header + toc_offset + kTocEntrySize * i;
+        auto const id = (UInt32)GetLE(entry, 4);
+        auto const offset = GetLE(entry + 8, 8);
+        auto const size = GetLE(entry + 16, 8);
+        
+        if(offset > toc_offset || size > toc_offset - offset) {
+            throw E("the chunk #" + std::to_string(i) + " is out of range.");
+        }
+        
+        ContainerChunk chunk;
+        chunk.id_ = id;
+        chunk.data_ = ArrayRef<char const>(header + offset, header + offset + size);
+        chunks.push_back(chunk);
+    }
+    
+    return chunks;
+}
+
+ContainerChunk const * FindChunk(std::vector<ContainerChunk> const &chunks, UInt32 id)
+{
+    auto found = std::find_if(chunks.begin(), chunks.end(),
+                              [id](auto const &chunk) { return chunk.id_ == id; });
+    
+    return (found == chunks.end()) ? nullptr : &*found;
+}
+
+NS_HWM_END
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "../misc/ArrayRef.hpp"
+
+NS_HWM_BEGIN
+
+//! ヘッダー、データ、目次(TOC)の順に、複数のバイナリデータ(チャンク)を格納するファイル形式
+/*! ファイルのレイアウトは以下の通り。数値はすべてリトルエンディアンで格納する。
+ *
+ *  | オフセット | 内容 |
+ *  |---|---|
+ *  | 0 | ヘッダー (kChunkedContainerHeaderSize バイト) |
+ *  | 64 | 各チャンクのデータ。先頭は kChunkedContainerAlignment バイト境界に揃える |
+ *  | toc_offset | 目次。チャンクごとに ID, 予約領域, オフセット, サイズ を格納する |
+ *
+ *  チャンクのデータはエンコードせずにそのまま格納するので、
+ *  ファイルをメモリにマップすれば、デコードやコピーをせずに参照できる。
+ *  読み込み側が知らないIDのチャンクは無視するので、チャンクを追加してもバージョンを上げる必要はない。
+ */
+
+//! ヘッダーのサイズ
+constexpr size_t kChunkedContainerHeaderSize = 32;
+//! チャンクのデータの配置境界
+constexpr size_t kChunkedContainerAlignment = 64;
+//! このバージョンで書き出すファイルのバージョン。これより大きいバージョンのファイルは読み込めない
+constexpr UInt32 kChunkedContainerVersion = 1;
+
+//! 4文字のASCIIからチャンクのIDを作成する
+constexpr UInt32 MakeChunkID(char a, char b, char c, char d)
+{
+    return (UInt32)(unsigned char)a
+    | ((UInt32)(unsigned char)b << 8)
+    | ((UInt32)(unsigned char)c << 16)
+    | ((UInt32)(unsigned char)d << 24);
+}
+
+struct ContainerChunk
+{
+    UInt32 id_ = 0;
+    //! 書き出すときは書き出すデータを、読み込んだときは読み込み元の領域を参照する
+    ArrayRef<char const> data_;
+};
+
+class FailedToParseChunkedContainer : public std::runtime_error
+{
+public:
+    FailedToParseChunkedContainer(std::string const &error_msg);
+};
+
+//! data の先頭がこのファイル形式のシグネチャかどうか
+bool HasChunkedContainerSignature(ArrayRef<char const> data);
+
+//! チャンクを os に書き出す。
+/*! 書き出しに失敗したかどうかは、 os の状態で確認する。
+ */
+void WriteChunkedContainer(std::ostream &os, std::vector<ContainerChunk> const &chunks);
+
+//! data をこのファイル形式として解析して、チャンクの一覧を返す。
+/*! 返り値の各チャンクは data の領域を参照する。
+ *  @exception FailedToParseChunkedContainer
+ */
+std::vector<ContainerChunk> ReadChunkedContainer(ArrayRef<char const> data);
+
+//! chunks から id のチャンクを探す。同じIDのチャンクが複数ある場合は最初のものを返す
+ContainerChunk const * FindChunk(std::vector<ContainerChunk> const &chunks, UInt32 id);
+
+NS_HWM_END
@@ -0,0 +1,206 @@
+#include <string>
+#include <map>
+#include <algorithm>
+#include <iomanip>
+
+#include "./PluginScanCache.hpp"
+#include "./Util.hpp"
+#include "../misc/StringAlgo.hpp"
+
+NS_HWM_BEGIN
+
+namespace {
+    std::string const kPluginScanCacheFormatID_v1 = "plugin_scan_cache_format_v1";
+    //! モジュールごとのセクションの開始を表す行
+    std::string const kModuleSectionHeader = "[module]";
+
+    using KeyValueMap = std::map<std::string, std::string>;
+
+    //! "key = value" 形式の行をまとめて読み込む。
+    /*! モジュールの数だけキーを検索するので、 find_value() で一行ずつ探索する代わりにここでまとめて分解しておく。
+     */
+    KeyValueMap to_key_value_map(std::vector<std::string>::const_iterator begin,
+                                 std::vector<std::string>::const_iterator end)
+    {
+        KeyValueMap map;
+        for(auto it = begin; it != end; ++it) {
+            auto const &line = *it;
+            if(line.empty() || line.front() == '#') { continue; }
+
+            auto const pos = line.find('=');
+            if(pos == std::string::npos) { continue; }
+
+            std::stringstream ss;
+            ss.str(line.substr(pos + 1));
+            std::string value;
+            ss >> std::quoted(value);
+            map.emplace(trim(line.substr(0, pos)), std::move(value));
+        }
+        return map;
+    }
+
+    template<class T>
+    bool read_value(KeyValueMap const &map, std::string const &key, T &v)
+    {
+        auto found = map.find(key);
+        if(found == map.end()) { return false; }
+        return from_s(found->second, v);
+    }
+
+    std::string class_key(size_t index, std::string const &name)
+    {
+        return "class" + std::to_string(index) + "_" + name;
+    }
+
+    std::optional<PluginScanEntry> read_entry(KeyValueMap const &map)
+    {
+        PluginScanEntry entry;
+
+        if(read_value(map, "module_path", entry.module_path_) == false ||
+           read_value(map, "modification_time", entry.modification_time_) == false ||
+           read_value(map, "file_size", entry.file_size_) == false ||
+           read_value(map, "hash", entry.hash_) == false ||
+           read_value(map, "is_loadable", entry.is_loadable_) == false)
+        {
+            return std::nullopt;
+        }
+
+        if(entry.is_loadable_ == false) { return entry; }
+
+        String vendor, url, email;
+        Steinberg::int32 flags = 0;
+        UInt32 num_classes = 0;
+        if(read_value(map, "factory_vendor", vendor) == false ||
+           read_value(map, "factory_url", url) == false ||
+           read_value(map, "factory_email", email) == false ||
+           read_value(map, "factory_flags", flags) == false ||
+           read_value(map, "num_classes", num_classes) == false)
+        {
+            return std::nullopt;
+        }
+
+        entry.factory_info_ = FactoryInfo(vendor, url, email, flags);
+
+        for(UInt32 i = 0; i < num_classes; ++i) {
+            ClassInfo::CID cid;
+            String name, category;
+            Steinberg::int32 cardinality = 0;
+            bool has_classinfo2 = false;
+            if(read_value(map, class_key(i, "cid"), cid) == false ||
+               read_value(map, class_key(i, "name"), name) == false ||
+               read_value(map, class_key(i, "category"), category) == false ||
+               read_value(map, class_key(i, "cardinality"), cardinality) == false ||
+               read_value(map, class_key(i, "has_classinfo2"), has_classinfo2) == false)
+            {
+                return std::nullopt;
+            }
+
+            std::optional<ClassInfo2Data> classinfo2;
+            if(has_classinfo2) {
+                String sub_categories, class_vendor, version, sdk_version;
+                if(read_value(map, class_key(i, "sub_categories"), sub_categories) == false ||
+                   read_value(map, class_key(i, "vendor"), class_vendor) == false ||
+                   read_value(map, class_key(i, "version"), version) == false ||
+                   read_value(map, class_key(i, "sdk_version"), sdk_version) == false)
+                {
+                    return std::nullopt;
+                }
+                classinfo2.emplace(sub_categories, class_vendor, version, sdk_version);
+            }
+
+            entry.class_info_list_.emplace_back(cid, name, category, cardinality, std::move(classinfo2));
+        }
+
+        return entry;
+    }
+}
+
+PluginScanCache::FailedToParse::FailedToParse(std::string const &error_msg)
+:   std::ios_base::failure("Failed to parse: " + error_msg)
+{}
+
+std::ostream & operator<<(std::ostream &os, PluginScanCache const &self)
+{
+    os
+    << "format = " << kPluginScanCacheFormatID_v1 << "\n"
+    << "# This is a plugin scan cache file of Vst3SampleHost." << "\n"
+    << "# This file is rebuilt automatically. Remove it to rescan all plugins." << "\n"
+    ;
+
+    for(auto const &entry: self.entries_) {
+        os
+        << kModuleSectionHeader << "\n"
+        << write_line("module_path", to_s(entry.module_path_)) << "\n"
+        << write_line("modification_time", to_s(entry.modification_time_)) << "\n"
+        << write_line("file_size", to_s(entry.file_size_)) << "\n"
+        << write_line("hash", to_s(entry.hash_)) << "\n"
+        << write_line("is_loadable", to_s(entry.is_loadable_)) << "\n"
+        ;
+
+        if(entry.is_loadable_ == false) { continue; }
+
+        auto const &fi = entry.factory_info_;
+        os
+        << write_line("factory_vendor", to_s(fi.GetVendor())) << "\n"
+        << write_line("factory_url", to_s(fi.GetURL())) << "\n"
+        << write_line("factory_email", to_s(fi.GetEmail())) << "\n"
+        << write_line("factory_flags", to_s(fi.GetFlags())) << "\n"
+        << write_line("num_classes", to_s(entry.class_info_list_.size())) << "\n"
+        ;
+
+        for(size_t i = 0; i < entry.class_info_list_.size(); ++i) {
+            auto const &ci = entry.class_info_list_[i];
+            os
+            << write_line(class_key(i, "cid"), to_s(ci.GetCID())) << "\n"
+            << write_line(class_key(i, "name"), to_s(ci.GetName())) << "\n"
+            << write_line(class_key(i, "category"), to_s(ci.GetCategory())) << "\n"
+            << write_line(class_key(i, "cardinality"), to_s(ci.GetCardinality())) << "\n"
+            << write_line(class_key(i, "has_classinfo2"), to_s(ci.HasClassInfo2())) << "\n"
+            ;
+
+            if(ci.HasClassInfo2() == false) { continue; }
+
+            auto const &ci2 = ci.GetClassInfo2();
+            os
+            << write_line(class_key(i, "sub_categories"), to_s(ci2.GetSubCategories())) << "\n"
+            << write_line(class_key(i, "vendor"), to_s(ci2.GetVendor())) << "\n"
+            << write_line(class_key(i, "version"), to_s(ci2.GetVersion())) << "\n"
+            << write_line(class_key(i, "sdk_version"), to_s(ci2.GetSDKVersion())) << "\n"
+            ;
+        }
+    }
+
+    return os;
+}
+
+std::istream & operator>>(std::istream &is, PluginScanCache &self)
+{
+    is.exceptions(std::ios::badbit);
+
+    auto const lines = read_lines(is);
+
+    auto val = find_value(lines, "format");
+    if(!val || *val != kPluginScanCacheFormatID_v1) {
+        throw PluginScanCache::FailedToParse("Unknown format.");
+    }
+
+    self.entries_.clear();
+
+    auto it = std::find(lines.begin(), lines.end(), kModuleSectionHeader);
+    while(it != lines.end()) {
+        auto next = std::find(it + 1, lines.end(), kModuleSectionHeader);
+
+        if(auto entry = read_entry(to_key_value_map(it + 1, next))) {
+            self.entries_.push_back(std::move(*entry));
+        } else {
+            // 壊れたエントリは読み飛ばす。次のスキャンで再スキャンされる
+            HWM_WARN_LOG(L"Skipped a broken entry in the plugin scan cache.");
+        }
+
+        it = next;
+    }
+
+    return is;
+}
+
+NS_HWM_END
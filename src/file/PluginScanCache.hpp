@@ -0,0 +1,54 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "../plugin/vst3/FactoryInfo.hpp"
+#include "../plugin/vst3/ClassInfo.hpp"
+
+NS_HWM_BEGIN
+
+//! ひとつのプラグインモジュールをスキャンした結果
+struct PluginScanEntry
+{
+    //! モジュールのパス（*.vst3）。キャッシュのキーになる
+    String module_path_;
+    //! モジュールのバイナリファイルの更新日時（UNIX時間のミリ秒）
+    Int64 modification_time_ = 0;
+    //! モジュールのバイナリファイルのサイズ
+    Int64 file_size_ = 0;
+    //! モジュールのバイナリファイルの先頭と末尾から計算したハッシュ値
+    UInt64 hash_ = 0;
+
+    //! モジュールのロードに成功したかどうか。
+    /*! ロードに失敗したモジュールも記録しておき、ファイルが変更されるまで再スキャンしない。
+     */
+    bool is_loadable_ = false;
+    FactoryInfo factory_info_;
+    std::vector<ClassInfo> class_info_list_;
+};
+
+//! プラグインのスキャン結果をファイルに保存しておくためのクラス
+/*! モジュールをロードせずに、前回のスキャン結果からプラグインの一覧を作成するために使う。
+ */
+struct PluginScanCache
+{
+    std::vector<PluginScanEntry> entries_;
+
+    //! ostreamにスキャン結果を書き出し
+    friend
+    std::ostream & operator<<(std::ostream &os, PluginScanCache const &self);
+
+    class FailedToParse : public std::ios_base::failure
+    {
+    public:
+        FailedToParse(std::string const &error_msg);
+    };
+
+    //! istreamからスキャン結果を読み込む。
+    /*! @exception FailedToParse
+     */
+    friend
+    std::istream & operator>>(std::istream &is, PluginScanCache &self);
+};
+
+NS_HWM_END
@@ -4,8 +4,11 @@
 
 #include "./Util.hpp"
 #include "./ProjectFile.hpp"
+#include "./ChunkedContainer.hpp"
+#include "./AtomicFileWriter.hpp"
 #include "../app/App.hpp"
 #include "../misc/StringAlgo.hpp"
+#include "../misc/StrCnv.hpp"
 #include "../misc/MathUtil.hpp"
 #include "../device/AudioDeviceManager.hpp"
 #include "../plugin/vst3/Vst3PluginFactory.hpp"
@@ -15,6 +18,64 @@ NS_HWM_BEGIN
 
 namespace {
     std::string const kProjectFileFormatID_v1 = "project_file_format_v1";
+    
+    //! バイナリ形式のチャンクのID
+    UInt32 const kSettingsChunkID = MakeChunkID('S', 'E', 'T', 'T');
+    UInt32 const kProcessorDataChunkID = MakeChunkID('P', 'R', 'O', 'C');
+    UInt32 const kEditControllerDataChunkID = MakeChunkID('E', 'D', 'I', 'T');
+    
+#define WRITE_MEMBER(name) \
+<< write_line(#name, to_s(self. name ## _)) << "\n"
+    
+    //! プラグインの状態以外の設定を書き出す
+    void WriteSettings(std::ostream &os, ProjectFile const &self)
+    {
+        os
+        WRITE_MEMBER(vst3_plugin_path)
+        WRITE_MEMBER(vst3_plugin_cid)
+        WRITE_MEMBER(editor_type)
+        WRITE_MEMBER(sample_rate)
+        WRITE_MEMBER(block_size)
+        WRITE_MEMBER(oscillator_type)
+        WRITE_MEMBER(audio_output_level)
+        WRITE_MEMBER(is_audio_input_enabled)
+        ;
+    }
+    
+#undef WRITE_MEMBER
+    
+#define READ_MEMBER(key) \
+if(auto val = find_value(lines, #key)) { from_s(*val, self. key ## _); }
+    
+    //! プラグインの状態以外の設定を読み込む
+    void ReadSettings(std::vector<std::string> const &lines, ProjectFile &self)
+    {
+        READ_MEMBER(vst3_plugin_path);
+        READ_MEMBER(vst3_plugin_cid);
+        READ_MEMBER(editor_type);
+        
+        READ_MEMBER(sample_rate);
+        self.sample_rate_ = Clamp<double>(self.sample_rate_,
+                                          kSupportedSampleRateMin,
+                                          kSupportedSampleRateMax);
+        
+        READ_MEMBER(block_size);
+        self.block_size_ = Clamp<double>(self.block_size_,
+                                         kSupportedBlockSizeMin,
+                                         kSupportedBlockSizeMax);
+        
+        READ_MEMBER(oscillator_type);
+        
+        auto app = App::GetInstance();
+        READ_MEMBER(audio_output_level);
+        self.audio_output_level_ = Clamp<double>(self.audio_output_level_,
+                                                 app->GetAudioOutputMinLevel(),
+                                                 app->GetAudioOutputMaxLevel());
+        
+        READ_MEMBER(is_audio_input_enabled);
+    }
+    
+#undef READ_MEMBER
 }
 
 ProjectFile::FailedToParse::FailedToParse(std::string const &error_msg)
@@ -38,6 +99,7 @@ void ProjectFile::ScanPluginStatus()
     
     vst3_plugin_cid_.fill(0);
     vst3_plugin_path_.clear();
+    ResetMappedFile();
     vst3_plugin_proc_data_.clear();
     vst3_plugin_edit_data_.clear();
     editor_type_ = std::nullopt;
@@ -85,26 +147,20 @@ void ProjectFile::ScanAppStatus()
 
 std::ostream & operator<<(std::ostream &os, ProjectFile const &self)
 {
-#define WRITE_MEMBER(name) \
-<< write_line(#name, to_s(self. name ## _)) << "\n"
+    auto const dump = self.GetVst3PluginDumpData();
     
     os
     << "format = " << kProjectFileFormatID_v1 << "\n"
     << "# This is a config file of Vst3SampleHost." << "\n"
     << "# The line starting '#' is treated as a comment line." << "\n"
-    WRITE_MEMBER(vst3_plugin_path)
-    WRITE_MEMBER(vst3_plugin_cid)
-    WRITE_MEMBER(vst3_plugin_proc_data)
-    WRITE_MEMBER(vst3_plugin_edit_data)
-    WRITE_MEMBER(editor_type)
-    WRITE_MEMBER(sample_rate)
-    WRITE_MEMBER(block_size)
-    WRITE_MEMBER(oscillator_type)
-    WRITE_MEMBER(audio_output_level)
-    WRITE_MEMBER(is_audio_input_enabled)
     ;
     
-#undef WRITE_MEMBER
+    write_base64_line(os, "vst3_plugin_proc_data",
+                      dump.processor_data_.data(), dump.processor_data_.size()) << "\n";
+    write_base64_line(os, "vst3_plugin_edit_data",
+                      dump.edit_controller_data_.data(), dump.edit_controller_data_.size()) << "\n";
+    
+    WriteSettings(os, self);
     
     return os;
 }
@@ -113,46 +169,111 @@ std::istream & operator>>(std::istream &is, ProjectFile &self)
 {
     is.exceptions(std::ios::badbit);
     
-    auto const lines = read_lines(is);
+    // プラグインの状態は大きくなることがあるので、行の文字列を作らずにデコードしながら読み込む
+    std::map<std::string, std::optional<std::vector<char>>> state_values {
+        { "vst3_plugin_proc_data", std::nullopt },
+        { "vst3_plugin_edit_data", std::nullopt },
+    };
+    auto const lines = read_lines(is, state_values);
     
     if(auto val = find_value(lines, "format")) {
         if(*val != kProjectFileFormatID_v1) {
             throw Config::FailedToParse("Unknown format.");
         }
     }
+    
+    self.ResetMappedFile();
+    
+    if(auto &val = state_values["vst3_plugin_proc_data"]) { self.vst3_plugin_proc_data_ = std::move(*val); }
+    if(auto &val = state_values["vst3_plugin_edit_data"]) { self.vst3_plugin_edit_data_ = std::move(*val); }
+    
+    ReadSettings(lines, self);
+    
+    return is;
+}
 
-#define READ_MEMBER(key) \
-if(auto val = find_value(lines, #key)) { from_s(*val, self. key ## _); }
+void ProjectFile::Load(String const &path)
+{
+    std::shared_ptr<MappedFile const> file = MappedFile::Open(path);
+    auto const data = file->GetData();
     
-    READ_MEMBER(vst3_plugin_path);
-    READ_MEMBER(vst3_plugin_cid);
-    READ_MEMBER(vst3_plugin_proc_data);
-    READ_MEMBER(vst3_plugin_edit_data);
-    READ_MEMBER(editor_type);
+    if(HasChunkedContainerSignature(data) == false) {
+        // テキスト形式のファイル
+        std::istringstream ss(std::string(data.begin(), data.end()));
+        ss >> *this;
+        return;
+    }
     
-    READ_MEMBER(sample_rate);
-    self.sample_rate_ = Clamp<double>(self.sample_rate_,
-                                      kSupportedSampleRateMin,
-                                      kSupportedSampleRateMax);
+    std::vector<ContainerChunk> chunks;
+    try {
+        chunks = ReadChunkedContainer(data);
+    } catch(FailedToParseChunkedContainer &e) {
+        throw FailedToParse(e.what());
+    }
     
-    READ_MEMBER(block_size);
-    self.block_size_ = Clamp<double>(self.block_size_,
-                                     kSupportedBlockSizeMin,
-                                     kSupportedBlockSizeMax);
+    auto settings = FindChunk(chunks, kSettingsChunkID);
+    if(!settings) {
+        throw FailedToParse("the settings chunk is not found.");
+    }
     
-    READ_MEMBER(oscillator_type);
+    std::istringstream ss(std::string(settings->data_.begin(), settings->data_.end()));
+    ReadSettings(read_lines(ss), *this);
     
-    auto app = App::GetInstance();
-    READ_MEMBER(audio_output_level);
-    self.audio_output_level_ = Clamp<double>(self.audio_output_level_,
-                                             app->GetAudioOutputMinLevel(),
-                                             app->GetAudioOutputMaxLevel());
+    ResetMappedFile();
+    vst3_plugin_proc_data_.clear();
+    vst3_plugin_edit_data_.clear();
     
-    READ_MEMBER(is_audio_input_enabled);
+    if(auto chunk = FindChunk(chunks, kProcessorDataChunkID)) { mapped_proc_data_ = chunk->data_; }
+    if(auto chunk = FindChunk(chunks, kEditControllerDataChunkID)) { mapped_edit_data_ = chunk->data_; }
+    mapped_file_ = std::move(file);
+}
+
+void ProjectFile::Save(String const &path, SaveProgressCallback progress) const
+{
+    auto notify = [&](SaveStage stage) { if(progress) { progress(stage); } };
     
-#undef READ_MEMBER
+    std::ostringstream settings;
+    WriteSettings(settings, *this);
+    auto const settings_str = settings.str();
     
-    return is;
+    auto const dump = GetVst3PluginDumpData();
+    
+    std::vector<ContainerChunk> chunks(3);
+    chunks[0].id_ = kSettingsChunkID;
+    chunks[0].data_ = ArrayRef<char const>(settings_str);
+    chunks[1].id_ = kProcessorDataChunkID;
+    chunks[1].data_ = dump.processor_data_;
+    chunks[2].id_ = kEditControllerDataChunkID;
+    chunks[2].data_ = dump.edit_controller_data_;
+    
+    // 書き出し先のファイルを自身がマップしていても、置き換えるまでは元の内容を参照できる
+    AtomicFileWriter writer(path);
+    
+    notify(SaveStage::kWriting);
+    WriteChunkedContainer(writer.GetStream(), chunks);
+    
+    notify(SaveStage::kSyncing);
+    writer.Sync();
+    
+    notify(SaveStage::kReplacing);
+    writer.Replace();
+}
+
+Vst3Plugin::DumpDataRef ProjectFile::GetVst3PluginDumpData() const
+{
+    if(mapped_file_) {
+        return Vst3Plugin::DumpDataRef(mapped_proc_data_, mapped_edit_data_);
+    } else {
+        return Vst3Plugin::DumpDataRef(ArrayRef<char const>(vst3_plugin_proc_data_),
+                                       ArrayRef<char const>(vst3_plugin_edit_data_));
+    }
+}
+
+void ProjectFile::ResetMappedFile()
+{
+    mapped_file_.reset();
+    mapped_proc_data_ = ArrayRef<char const>();
+    mapped_edit_data_ = ArrayRef<char const>();
 }
 
 NS_HWM_END
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <functional>
 #include <iostream>
+#include <memory>
 #include "../device/DeviceType.hpp"
 #include "../gui/PluginViewType.hpp"
 #include "../app/OscillatorType.hpp"
+#include "../plugin/vst3/Vst3Plugin.hpp"
+#include "../misc/MappedFile.hpp"
 
 NS_HWM_BEGIN
 
@@ -44,6 +48,46 @@ struct ProjectFile
      */
     friend
     std::istream & operator>>(std::istream &is, ProjectFile &self);
+    
+    //! ファイルからプロジェクトを読み込む。
+    /*! バイナリ形式とテキスト形式(project_file_format_v1)のどちらにも対応する。
+     *  バイナリ形式の場合、プラグインの状態はデコードもコピーもせずに、マップしたファイルの領域を参照する。
+     *  その場合 vst3_plugin_proc_data_ と vst3_plugin_edit_data_ は空になるので、
+     *  プラグインの状態は GetVst3PluginDumpData() で取得する。
+     *  @exception FailedToParse, std::runtime_error
+     */
+    void Load(String const &path);
+    
+    //! Save() の段階
+    enum class SaveStage {
+        kWriting,   //!< 一時ファイルに書き出している
+        kSyncing,   //!< 一時ファイルの内容をディスクに書き出している
+        kReplacing, //!< 一時ファイルで元のファイルを置き換えている
+    };
+    
+    using SaveProgressCallback = std::function<void(SaveStage stage)>;
+    
+    //! バイナリ形式でファイルに書き出す。
+    /*! 一時ファイルに書き出してから元のファイルと置き換えるので、
+     *  途中で失敗しても元のファイルは壊れない。
+     *  @param progress 段階が進むたびに呼び出すコールバック。nullptrでもよい
+     *  @exception std::runtime_error
+     */
+    void Save(String const &path, SaveProgressCallback progress = nullptr) const;
+    
+    //! プラグインの状態を参照する。
+    /*! 返り値は、このオブジェクト（またはそのコピー）が破棄されるか、
+     *  ScanPluginStatus() や Load() を呼び出すまで有効。
+     */
+    Vst3Plugin::DumpDataRef GetVst3PluginDumpData() const;
+    
+private:
+    //! Load() でバイナリ形式のファイルを読み込んだときに、プラグインの状態が参照しているファイル
+    std::shared_ptr<MappedFile const> mapped_file_;
+    ArrayRef<char const> mapped_proc_data_;
+    ArrayRef<char const> mapped_edit_data_;
+    
+    void ResetMappedFile();
 };
 
 NS_HWM_END
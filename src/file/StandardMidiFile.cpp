@@ -0,0 +1,237 @@
+#include "StandardMidiFile.hpp"
+
+#include <fstream>
+#include <cstring>
+
+NS_HWM_BEGIN
+
+namespace {
+    struct TrackEvent
+    {
+        Int64 tick_ = 0;
+        //! テンポイベントの場合は4分音符あたりのマイクロ秒
+        std::optional<UInt32> tempo_;
+        UInt8 status_ = 0;
+        UInt8 data1_ = 0;
+        UInt8 data2_ = 0;
+    };
+
+    class Reader
+    {
+    public:
+        Reader(UInt8 const *begin, UInt8 const *end)
+        :   pos_(begin)
+        ,   end_(end)
+        {}
+
+        bool empty() const { return pos_ == end_; }
+        size_t remaining() const { return end_ - pos_; }
+        UInt8 const * pos() const { return pos_; }
+
+        UInt8 peek() const
+        {
+            if(empty()) { throw StandardMidiFileError("unexpected end of data"); }
+            return *pos_;
+        }
+
+        UInt8 read8()
+        {
+            auto const v = peek();
+            ++pos_;
+            return v;
+        }
+
+        //! MIDIファイル内の数値はビッグエンディアンで記録されている
+        UInt32 read_be(int num_bytes)
+        {
+            UInt32 v = 0;
+            for(int i = 0; i < num_bytes; ++i) { v = (v << 8) | read8(); }
+            return v;
+        }
+
+        UInt32 read_var_len()
+        {
+            UInt32 v = 0;
+            for(int i = 0; i < 4; ++i) {
+                auto const b = read8();
+                v = (v << 7) | (b & 0x7F);
+                if((b & 0x80) == 0) { return v; }
+            }
+            throw StandardMidiFileError("invalid variable length quantity");
+        }
+
+        void skip(size_t n)
+        {
+            if(remaining() < n) { throw StandardMidiFileError("unexpected end of data"); }
+            pos_ += n;
+        }
+
+    private:
+        UInt8 const *pos_;
+        UInt8 const *end_;
+    };
+
+    int get_num_data_bytes(UInt8 status)
+    {
+        switch(status & 0xF0) {
+            case MidiDataType::kProgramChange:
+            case MidiDataType::kChannelPressure:
+                return 1;
+            default:
+                return 2;
+        }
+    }
+
+    void read_track(Reader &r, std::vector<TrackEvent> &events)
+    {
+        Int64 tick = 0;
+        UInt8 running_status = 0;
+
+        while(r.empty() == false) {
+            tick += r.read_var_len();
+
+            UInt8 status = r.peek();
+            if(status & 0x80) {
+                r.read8();
+            } else if(running_status != 0) {
+                status = running_status;
+            } else {
+                throw StandardMidiFileError("data byte without running status");
+            }
+
+            if(status == 0xFF) {
+                auto const type = r.read8();
+                auto const len = r.read_var_len();
+                if(type == 0x51 && len == 3) {
+                    TrackEvent ev;
+                    ev.tick_ = tick;
+                    ev.tempo_ = r.read_be(3);
+                    events.push_back(ev);
+                } else if(type == 0x2F) {
+                    r.skip(len);
+                    break; // end of track
+                } else {
+                    r.skip(len);
+                }
+                running_status = 0;
+            } else if(status == 0xF0 || status == 0xF7) {
+                r.skip(r.read_var_len());
+                running_status = 0;
+            } else if(status >= 0xF0) {
+                throw StandardMidiFileError("unexpected system message in track data");
+            } else {
+                TrackEvent ev;
+                ev.tick_ = tick;
+                ev.status_ = status;
+                ev.data1_ = r.read8() & 0x7F;
+                if(get_num_data_bytes(status) == 2) {
+                    ev.data2_ = r.read8() & 0x7F;
+                }
+                events.push_back(ev);
+                running_status = status;
+            }
+        }
+    }
+}
+
+StandardMidiFileError::StandardMidiFileError(std::string const &error_msg)
+:   std::runtime_error(error_msg)
+{}
+
+std::vector<DeviceMidiMessage> ReadStandardMidiFile(String const &path)
+{
+    std::ifstream ifs;
+#if defined(_MSC_VER)
+    ifs.open(path, std::ios::binary);
+#else
+    ifs.open(to_utf8(path), std::ios::binary);
+#endif
+    if(!ifs) {
+        throw StandardMidiFileError("failed to open the file: " + to_utf8(path));
+    }
+
+    std::vector<UInt8> data((std::istreambuf_iterator<char>(ifs)),
+                            std::istreambuf_iterator<char>());
+
+    Reader r(data.data(), data.data() + data.size());
+
+    auto read_chunk_header = [&r](char const *expected_id) -> std::optional<UInt32> {
+        if(r.remaining() < 8) { return std::nullopt; }
+        bool const matched = (std::memcmp(r.pos(), expected_id, 4) == 0);
+        r.skip(4);
+        auto const len = r.read_be(4);
+        if(len > r.remaining()) { throw StandardMidiFileError("chunk size exceeds the file size"); }
+        if(!matched) {
+            r.skip(len);
+            return 0;
+        }
+        return len;
+    };
+
+    if(r.remaining() < 4 || std::memcmp(r.pos(), "MThd", 4) != 0) {
+        throw StandardMidiFileError("not a standard midi file");
+    }
+
+    auto const header_len = *read_chunk_header("MThd");
+    if(header_len < 6) { throw StandardMidiFileError("invalid header chunk"); }
+    auto const format = r.read_be(2);
+    auto const num_tracks = r.read_be(2);
+    auto const division = r.read_be(2);
+    r.skip(header_len - 6);
+
+    if(format > 1) {
+        throw StandardMidiFileError("unsupported format: " + std::to_string(format));
+    }
+
+    std::vector<TrackEvent> events;
+    for(UInt32 i = 0; i < num_tracks && r.empty() == false; ) {
+        auto const len = read_chunk_header("MTrk");
+        if(!len) { break; }
+        if(*len == 0) { continue; } // 未知のチャンク
+
+        Reader track(r.pos(), r.pos() + *len);
+        read_track(track, events);
+        r.skip(*len);
+        ++i;
+    }
+
+    // 同じTickのイベントは、テンポイベントを先にしつつ、トラック内の順序を保つ
+    std::stable_sort(events.begin(), events.end(), [](auto const &x, auto const &y) {
+        if(x.tick_ != y.tick_) { return x.tick_ < y.tick_; }
+        return x.tempo_.has_value() && !y.tempo_.has_value();
+    });
+
+    // Tickを秒に変換する
+    double sec_per_tick = 0;
+    bool const is_smpte = (division & 0x8000) != 0;
+    if(is_smpte) {
+        int const fps = -(Int8)((division >> 8) & 0xFF);
+        int const ticks_per_frame = division & 0xFF;
+        if(fps <= 0 || ticks_per_frame == 0) { throw StandardMidiFileError("invalid time division"); }
+        sec_per_tick = 1.0 / (fps * ticks_per_frame);
+    } else {
+        if(division == 0) { throw StandardMidiFileError("invalid time division"); }
+        sec_per_tick = 0.5 / division; // 120 BPM
+    }
+
+    std::vector<DeviceMidiMessage> result;
+    Int64 last_tick = 0;
+    double last_sec = 0;
+    for(auto const &ev: events) {
+        last_sec += (ev.tick_ - last_tick) * sec_per_tick;
+        last_tick = ev.tick_;
+
+        if(ev.tempo_) {
+            if(!is_smpte && *ev.tempo_ > 0) {
+                sec_per_tick = (*ev.tempo_ / 1000000.0) / division;
+            }
+            continue;
+        }
+
+        result.push_back(DeviceMidiMessage::Create(nullptr, last_sec, ev.status_, ev.data1_, ev.data2_));
+    }
+
+    return result;
+}
+
+NS_HWM_END
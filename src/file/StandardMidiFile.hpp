@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdexcept>
+#include "../device/MidiDeviceManager.hpp"
+
+NS_HWM_BEGIN
+
+//! Standard MIDI File の読み込みに失敗したときに送出される例外
+class StandardMidiFileError : public std::runtime_error
+{
+public:
+    StandardMidiFileError(std::string const &error_msg);
+};
+
+//! Standard MIDI File(format 0/1)を読み込み、チャンネルメッセージを演奏時刻順に並べて返す。
+/*! テンポチェンジを反映して、各メッセージの time_stamp_ にはファイル先頭からの秒数が設定される。
+ *  システムエクスクルーシブとテンポ以外のメタイベントは読み飛ばす。
+ *  @exception StandardMidiFileError
+ */
+std::vector<DeviceMidiMessage> ReadStandardMidiFile(String const &path);
+
+NS_HWM_END
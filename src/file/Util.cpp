@@ -6,7 +6,7 @@
 #include "Util.hpp"
 #include "../misc/StringAlgo.hpp"
 
-#include <wx/base64.h>
+#include "../misc/Base64.hpp"
 
 NS_HWM_BEGIN
 
@@ -65,6 +65,58 @@ std::optional<std::string> find_value(std::vector<std::string> const &lines,
     return std::nullopt;
 }
 
+std::vector<std::string> read_lines(std::istream &is,
+                                    std::map<std::string, std::optional<std::vector<char>>> &base64_values)
+{
+    std::vector<std::string> lines;
+    
+    auto const eof = std::char_traits<char>::eof();
+    auto *sb = is.rdbuf();
+    
+    // 行末までを dest に追加して、行末の文字（またはeof）を返す
+    auto read_rest = [sb, eof](std::string &dest) {
+        auto c = sb->sbumpc();
+        for( ; c != eof && c != '\n'; c = sb->sbumpc()) { dest.push_back((char)c); }
+        return c;
+    };
+    
+    while(is) {
+        if(sb->sgetc() == eof) {
+            is.setstate(std::ios::eofbit);
+            break;
+        }
+        
+        // 値を読み込む前に、 '=' までを読み込んでキーを調べる
+        std::string line;
+        auto c = sb->sbumpc();
+        for( ; c != eof && c != '\n' && c != '='; c = sb->sbumpc()) { line.push_back((char)c); }
+        
+        if(c == '=') {
+            auto found = base64_values.find(trim(line));
+            if(found != base64_values.end()) {
+                while(sb->sgetc() == ' ' || sb->sgetc() == '\t') { sb->sbumpc(); }
+                if(auto decoded = base64_decode(is)) {
+                    found->second = std::move(decoded);
+                } else {
+                    HWM_DEBUG_LOG(L"Failed to decode the value of: " << to_wstr(found->first));
+                }
+                
+                std::string rest;
+                if(read_rest(rest) == eof) { is.setstate(std::ios::eofbit); }
+                continue;
+            }
+            
+            line.push_back('=');
+            c = read_rest(line);
+        }
+        
+        lines.push_back(trim(line));
+        if(c == eof) { is.setstate(std::ios::eofbit); }
+    }
+    
+    return lines;
+}
+
 std::ostream & operator<<(std::ostream &os, write_line_object const &self)
 {
     assert(self.key.find(' ') == std::string::npos &&
@@ -81,9 +133,10 @@ write_line_object write_line(std::string const &key,
 
 std::string base64_encode(char const *data, size_t length)
 {
-    if(length == 0) { return {}; }
+    std::string str(GetBase64EncodedLength(length), '\0');
+    if(length > 0) { Base64Encode(data, length, &str[0]); }
     
-    return wxBase64Encode(data, length).ToStdString();
+    return str;
 }
 
 std::string base64_encode(std::vector<char> const &data)
@@ -93,17 +146,78 @@ std::string base64_encode(std::vector<char> const &data)
 
 std::optional<std::vector<char>> base64_decode(std::string const &data)
 {
+    std::vector<char> buf(GetBase64DecodedMaxLength(data.size()));
     size_t error_pos = -1;
-    auto buf = wxBase64Decode(data.data(), data.size(),
-                              wxBase64DecodeMode::wxBase64DecodeMode_Strict,
-                              &error_pos);
+    auto const size = Base64Decode(data.data(), data.size(), buf.data(),
+                                   GetDefaultBase64Impl(), &error_pos);
     
-    if(error_pos != -1) {
+    if(!size) {
         HWM_DEBUG_LOG(L"Failed to decode base64 data at: " << error_pos);
         return std::nullopt;
     }
     
-    return std::vector<char>((char *)buf.GetData(), (char *)buf.GetData() + buf.GetDataLen());
+    buf.resize(*size);
+    return buf;
+}
+
+std::optional<std::vector<char>> base64_decode(std::istream &is)
+{
+    auto const eof = std::char_traits<char>::eof();
+    auto *sb = is.rdbuf();
+    
+    if(sb->sgetc() != '"') { return std::nullopt; }
+    sb->sbumpc();
+    
+    std::vector<char> decoded;
+    Base64Decoder decoder([&decoded](char const *p, size_t n) { decoded.insert(decoded.end(), p, p + n); });
+    
+    // 値の文字列を一定の大きさごとにデコーダーに渡す
+    size_t const kBlockSize = 64 * 1024;
+    std::vector<char> block(kBlockSize);
+    size_t num_read = 0;
+    bool succeeded = true;
+    
+    for( ; ; ) {
+        auto const c = sb->sgetc();
+        if(c == eof || c == '\n') {
+            // 閉じる '"' がない
+            if(c == eof) { is.setstate(std::ios::eofbit); }
+            return std::nullopt;
+        }
+        
+        sb->sbumpc();
+        if(c == '"') { break; }
+        
+        block[num_read++] = (char)c;
+        if(num_read == kBlockSize) {
+            succeeded = succeeded && decoder.Write(block.data(), num_read);
+            num_read = 0;
+        }
+    }
+    
+    succeeded = succeeded && decoder.Write(block.data(), num_read) && decoder.Finish();
+    if(!succeeded) {
+        HWM_DEBUG_LOG(L"Failed to decode base64 data at: " << decoder.GetErrorPosition().value_or(0));
+        return std::nullopt;
+    }
+    
+    return decoded;
+}
+
+std::ostream & write_base64_line(std::ostream &os, std::string const &key,
+                                 char const *data, size_t length)
+{
+    assert(key.find(' ') == std::string::npos &&
+           key.find('\t') == std::string::npos);
+    
+    os << key << " = \"";
+    
+    // エンコードした文字列の全体を一度に確保しないように、少しずつ書き出す
+    Base64Encoder encoder([&os](char const *p, size_t n) { os.write(p, n); });
+    encoder.Write(data, length);
+    encoder.Finish();
+    
+    return os << "\"";
 }
 
 template<>
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <map>
 #include <string>
 #include <vector>
 #include <optional>
@@ -21,6 +22,14 @@ std::vector<std::string> read_lines(std::istream &is);
 
 std::optional<std::string> find_value(std::vector<std::string> const &lines, std::string const &key);
 
+//! read_lines() と同じく、前後の空白を取り除いた行を読み込む。
+/*! base64_values のキーと一致する `key = "..."` の形式の行は、値の文字列の全体を確保せずに
+ *  base64_decode(std::istream &) でデコードしながら読み込み、 base64_values の値に格納する。
+ *  これらの行は戻り値に含めない。デコードに失敗した場合は、 base64_values の値を変更しない。
+ */
+std::vector<std::string> read_lines(std::istream &is,
+                                    std::map<std::string, std::optional<std::vector<char>>> &base64_values);
+
 struct write_line_object {
     std::string const key;
     std::string const value;
@@ -36,6 +45,20 @@ std::string base64_encode(char const *data, size_t length);
 
 std::optional<std::vector<char>> base64_decode(std::string const &data);
 
+//! is から `"` で囲まれた base64 の値を読み込んで、デコードする。
+/*! 値の文字列は一定の大きさごとに Base64Decoder に渡すので、全体をメモリ上に確保しない。
+ *  is は値の前の `"` の位置にあること。
+ *  成功した場合は、値の後の `"` の次の位置まで読み込む。失敗した場合は、行末より後は読み込まない。
+ *  @return 値が `"` で囲まれていない場合や、デコードに失敗した場合は std::nullopt
+ */
+std::optional<std::vector<char>> base64_decode(std::istream &is);
+
+//! write_line() と同じ形式で、データを base64 でエンコードした値を書き出す。
+/*! エンコードした文字列の全体をメモリ上に確保せずに、少しずつ書き出す。
+ */
+std::ostream & write_base64_line(std::ostream &os, std::string const &key,
+                                 char const *data, size_t length);
+
 template<class T>
 std::string to_s(T const &v) {
     std::stringstream ss;
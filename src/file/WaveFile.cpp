@@ -0,0 +1,336 @@
+#include "WaveFile.hpp"
+
+#include <fstream>
+#include <cstring>
+#include <cmath>
+
+#include "../misc/MathUtil.hpp"
+
+NS_HWM_BEGIN
+
+namespace {
+    UInt16 const kWaveFormatPCM = 0x0001;
+    UInt16 const kWaveFormatIEEEFloat = 0x0003;
+    UInt16 const kWaveFormatExtensible = 0xFFFE;
+
+    //! WAVEファイルはリトルエンディアンで記録されている
+    UInt32 read_le(UInt8 const *p, int num_bytes)
+    {
+        UInt32 v = 0;
+        for(int i = 0; i < num_bytes; ++i) {
+            v |= (UInt32)p[i] << (i * 8);
+        }
+        return v;
+    }
+
+    void write_le(std::ostream &os, UInt32 v, int num_bytes)
+    {
+        for(int i = 0; i < num_bytes; ++i) {
+            os.put((char)((v >> (i * 8)) & 0xFF));
+        }
+    }
+
+    char * write_le(char *dest, UInt32 v, int num_bytes)
+    {
+        for(int i = 0; i < num_bytes; ++i) {
+            *dest++ = (char)((v >> (i * 8)) & 0xFF);
+        }
+        return dest;
+    }
+
+    int get_bytes_per_sample(WaveSampleFormat format)
+    {
+        switch(format) {
+            case WaveSampleFormat::kInt16: return 2;
+            case WaveSampleFormat::kInt24: return 3;
+            case WaveSampleFormat::kInt32: return 4;
+            case WaveSampleFormat::kFloat32: return 4;
+            case WaveSampleFormat::kFloat64: return 8;
+        }
+        assert(false);
+        return 0;
+    }
+
+    bool is_float_format(WaveSampleFormat format)
+    {
+        return format == WaveSampleFormat::kFloat32 || format == WaveSampleFormat::kFloat64;
+    }
+
+    double decode_sample(UInt8 const *p, WaveSampleFormat format)
+    {
+        switch(format) {
+            case WaveSampleFormat::kInt16:
+                return (Int16)read_le(p, 2) / 32768.0;
+            case WaveSampleFormat::kInt24: {
+                // 24bit値を符号拡張する
+                Int32 v = (Int32)(read_le(p, 3) << 8) >> 8;
+                return v / 8388608.0;
+            }
+            case WaveSampleFormat::kInt32:
+                return (Int32)read_le(p, 4) / 2147483648.0;
+            case WaveSampleFormat::kFloat32: {
+                UInt32 const bits = read_le(p, 4);
+                float v;
+                std::memcpy(&v, &bits, sizeof(v));
+                return v;
+            }
+            case WaveSampleFormat::kFloat64: {
+                UInt64 const bits = (UInt64)read_le(p, 4) | ((UInt64)read_le(p + 4, 4) << 32);
+                double v;
+                std::memcpy(&v, &bits, sizeof(v));
+                return v;
+            }
+        }
+        assert(false);
+        return 0;
+    }
+
+    //! destにサンプルを書き込み、書き込んだ次の位置を返す
+    char * encode_sample(char *dest, double v, WaveSampleFormat format)
+    {
+        switch(format) {
+            case WaveSampleFormat::kInt16:
+                return write_le(dest, (UInt32)(Int32)std::lround(Clamp<double>(v, -1.0, 1.0) * 32767.0), 2);
+            case WaveSampleFormat::kInt24:
+                return write_le(dest, (UInt32)(Int32)std::lround(Clamp<double>(v, -1.0, 1.0) * 8388607.0), 3);
+            case WaveSampleFormat::kInt32:
+                return write_le(dest, (UInt32)(Int32)std::llround(Clamp<double>(v, -1.0, 1.0) * 2147483647.0), 4);
+            case WaveSampleFormat::kFloat32: {
+                float const f = (float)v;
+                UInt32 bits;
+                std::memcpy(&bits, &f, sizeof(f));
+                return write_le(dest, bits, 4);
+            }
+            case WaveSampleFormat::kFloat64: {
+                UInt64 bits;
+                std::memcpy(&bits, &v, sizeof(v));
+                dest = write_le(dest, (UInt32)(bits & 0xFFFF'FFFF), 4);
+                return write_le(dest, (UInt32)(bits >> 32), 4);
+            }
+        }
+        assert(false);
+        return dest;
+    }
+
+    template<class Stream>
+    void open_stream(Stream &s, String const &path, std::ios::openmode mode)
+    {
+#if defined(_MSC_VER)
+        s.open(path, mode);
+#else
+        s.open(to_utf8(path), mode);
+#endif
+    }
+}
+
+WaveFileError::WaveFileError(std::string const &error_msg)
+:   std::runtime_error(error_msg)
+{}
+
+Buffer<float> ReadWaveFile(String const &path, WaveFileInfo *info)
+{
+    std::ifstream ifs;
+    open_stream(ifs, path, std::ios::binary);
+    if(!ifs) {
+        throw WaveFileError("failed to open the file: " + to_utf8(path));
+    }
+
+    std::vector<UInt8> data((std::istreambuf_iterator<char>(ifs)),
+                            std::istreambuf_iterator<char>());
+
+    if(data.size() < 12
+       || std::memcmp(data.data(), "RIFF", 4) != 0
+       || std::memcmp(data.data() + 8, "WAVE", 4) != 0)
+    {
+        throw WaveFileError("not a RIFF/WAVE file");
+    }
+
+    std::optional<WaveFileInfo> fmt;
+    UInt32 block_align = 0;
+    UInt8 const *sample_data = nullptr;
+    size_t sample_data_size = 0;
+
+    // 未知のチャンクは読み飛ばす
+    for(size_t pos = 12; pos + 8 <= data.size(); ) {
+        UInt8 const *chunk = data.data() + pos;
+        size_t const chunk_size = read_le(chunk + 4, 4);
+        size_t const available = std::min(chunk_size, data.size() - pos - 8);
+
+        if(std::memcmp(chunk, "fmt ", 4) == 0) {
+            if(available < 16) { throw WaveFileError("invalid fmt chunk"); }
+
+            auto const *p = chunk + 8;
+            UInt16 tag = read_le(p, 2);
+            UInt16 const num_channels = read_le(p + 2, 2);
+            UInt32 const sample_rate = read_le(p + 4, 4);
+            block_align = read_le(p + 12, 2);
+            UInt16 const bits = read_le(p + 14, 2);
+
+            if(tag == kWaveFormatExtensible) {
+                if(available < 40) { throw WaveFileError("invalid extensible fmt chunk"); }
+                // SubFormat GUIDの先頭2バイトがフォーマットタグ
+                tag = read_le(p + 24, 2);
+            }
+
+            WaveFileInfo tmp;
+            tmp.sample_rate_ = sample_rate;
+            tmp.num_channels_ = num_channels;
+            if(tag == kWaveFormatPCM && bits == 16)             { tmp.format_ = WaveSampleFormat::kInt16; }
+            else if(tag == kWaveFormatPCM && bits == 24)        { tmp.format_ = WaveSampleFormat::kInt24; }
+            else if(tag == kWaveFormatPCM && bits == 32)        { tmp.format_ = WaveSampleFormat::kInt32; }
+            else if(tag == kWaveFormatIEEEFloat && bits == 32)  { tmp.format_ = WaveSampleFormat::kFloat32; }
+            else if(tag == kWaveFormatIEEEFloat && bits == 64)  { tmp.format_ = WaveSampleFormat::kFloat64; }
+            else {
+                throw WaveFileError("unsupported sample format (tag: " + std::to_string(tag)
+                                    + ", bits: " + std::to_string(bits) + ")");
+            }
+
+            if(num_channels == 0
+               || block_align != (UInt32)(num_channels * get_bytes_per_sample(tmp.format_)))
+            {
+                throw WaveFileError("invalid block alignment");
+            }
+
+            fmt = tmp;
+        } else if(std::memcmp(chunk, "data", 4) == 0) {
+            sample_data = chunk + 8;
+            sample_data_size = available;
+        }
+
+        // チャンクは2バイト境界に揃えられている
+        pos += 8 + chunk_size + (chunk_size & 1);
+    }
+
+    if(!fmt) { throw WaveFileError("fmt chunk not found"); }
+    if(!sample_data) { throw WaveFileError("data chunk not found"); }
+
+    fmt->num_samples_ = sample_data_size / block_align;
+
+    Buffer<float> buf(fmt->num_channels_, fmt->num_samples_);
+    auto const bytes_per_sample = get_bytes_per_sample(fmt->format_);
+    for(SampleCount smp = 0; smp < fmt->num_samples_; ++smp) {
+        auto const *frame = sample_data + smp * block_align;
+        for(UInt32 ch = 0; ch < fmt->num_channels_; ++ch) {
+            buf.data()[ch][smp] = (float)decode_sample(frame + ch * bytes_per_sample, fmt->format_);
+        }
+    }
+
+    if(info) { *info = *fmt; }
+
+    return buf;
+}
+
+struct WaveFileWriter::Impl
+{
+    std::ofstream ofs_;
+    UInt32 num_channels_ = 0;
+    double sample_rate_ = 0;
+    WaveSampleFormat format_ = WaveSampleFormat::kFloat32;
+    SampleCount num_written_ = 0;
+    std::vector<char> tmp_;
+
+    void WriteHeader()
+    {
+        auto const bytes_per_sample = get_bytes_per_sample(format_);
+        UInt32 const block_align = num_channels_ * bytes_per_sample;
+        UInt32 const data_size = (UInt32)(num_written_ * block_align);
+        UInt32 const fmt_size = 16;
+
+        ofs_.seekp(0);
+        ofs_.write("RIFF", 4);
+        write_le(ofs_, 4 + (8 + fmt_size) + (8 + data_size) + (data_size & 1), 4);
+        ofs_.write("WAVE", 4);
+
+        ofs_.write("fmt ", 4);
+        write_le(ofs_, fmt_size, 4);
+        write_le(ofs_, is_float_format(format_) ? kWaveFormatIEEEFloat : kWaveFormatPCM, 2);
+        write_le(ofs_, num_channels_, 2);
+        write_le(ofs_, (UInt32)sample_rate_, 4);
+        write_le(ofs_, (UInt32)sample_rate_ * block_align, 4);
+        write_le(ofs_, block_align, 2);
+        write_le(ofs_, bytes_per_sample * 8, 2);
+
+        ofs_.write("data", 4);
+        write_le(ofs_, data_size, 4);
+    }
+};
+
+WaveFileWriter::WaveFileWriter(String const &path,
+                               UInt32 num_channels,
+                               double sample_rate,
+                               WaveSampleFormat format)
+:   pimpl_(std::make_unique<Impl>())
+{
+    assert(num_channels > 0);
+
+    pimpl_->num_channels_ = num_channels;
+    pimpl_->sample_rate_ = sample_rate;
+    pimpl_->format_ = format;
+
+    open_stream(pimpl_->ofs_, path, std::ios::binary | std::ios::trunc);
+    if(!pimpl_->ofs_) {
+        throw WaveFileError("failed to open the file: " + to_utf8(path));
+    }
+
+    // サイズ未確定のヘッダーを書いておき、Close()時に書き直す
+    pimpl_->WriteHeader();
+}
+
+WaveFileWriter::~WaveFileWriter()
+{
+    try {
+        Close();
+    } catch(std::exception &e) {
+        HWM_ERROR_LOG(L"failed to close the wave file: " << to_wstr(e.what()));
+    }
+}
+
+void WaveFileWriter::Write(BufferRef<float const> buf, SampleCount length)
+{
+    assert(pimpl_->ofs_.is_open());
+    assert(length <= buf.samples());
+
+    auto const num_src_channels = std::min<UInt32>(buf.channels(), pimpl_->num_channels_);
+    auto const block_align = pimpl_->num_channels_ * get_bytes_per_sample(pimpl_->format_);
+
+    auto &tmp = pimpl_->tmp_;
+    tmp.resize(length * block_align);
+    char *dest = tmp.data();
+    for(SampleCount smp = 0; smp < length; ++smp) {
+        for(UInt32 ch = 0; ch < pimpl_->num_channels_; ++ch) {
+            double const v = (ch < num_src_channels ? buf.get_channel_data(ch)[smp] : 0.0);
+            dest = encode_sample(dest, v, pimpl_->format_);
+        }
+    }
+
+    pimpl_->ofs_.write(tmp.data(), tmp.size());
+    if(!pimpl_->ofs_) {
+        throw WaveFileError("failed to write the wave data");
+    }
+
+    pimpl_->num_written_ += length;
+}
+
+void WaveFileWriter::Close()
+{
+    if(pimpl_->ofs_.is_open() == false) { return; }
+
+    auto const block_align = pimpl_->num_channels_ * get_bytes_per_sample(pimpl_->format_);
+    if((pimpl_->num_written_ * block_align) & 1) {
+        pimpl_->ofs_.put(0); // pad byte
+    }
+
+    pimpl_->WriteHeader();
+    pimpl_->ofs_.close();
+
+    if(pimpl_->ofs_.fail()) {
+        throw WaveFileError("failed to finalize the wave file");
+    }
+}
+
+SampleCount WaveFileWriter::GetNumWrittenSamples() const
+{
+    return pimpl_->num_written_;
+}
+
+NS_HWM_END
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include "../misc/Buffer.hpp"
+
+NS_HWM_BEGIN
+
+//! WAVEファイルのサンプルフォーマット
+enum class WaveSampleFormat {
+    kInt16,
+    kInt24,
+    kInt32,
+    kFloat32,
+    kFloat64,
+};
+
+//! WAVEファイルの読み書きに失敗したときに送出される例外
+class WaveFileError : public std::runtime_error
+{
+public:
+    WaveFileError(std::string const &error_msg);
+};
+
+//! WAVEファイルのフォーマット情報
+struct WaveFileInfo
+{
+    double sample_rate_ = 0;
+    UInt32 num_channels_ = 0;
+    SampleCount num_samples_ = 0;
+    WaveSampleFormat format_ = WaveSampleFormat::kFloat32;
+};
+
+//! WAVEファイル全体を読み込んで、チャンネルごとに分かれたバッファとして返す。
+/*! リニアPCM(16/24/32bit整数、32/64bit浮動小数点数)に対応する。
+ *  @param info nullptrでなければ、読み込んだファイルのフォーマット情報が書き込まれる。
+ *  @exception WaveFileError
+ */
+Buffer<float> ReadWaveFile(String const &path, WaveFileInfo *info = nullptr);
+
+//! WAVEファイルにブロック単位でオーディオデータを書き込むクラス
+/*! ヘッダーのサイズ情報は Close() 時（またはデストラクタ）に確定する。
+ */
+class WaveFileWriter
+{
+public:
+    //! @exception WaveFileError
+    WaveFileWriter(String const &path,
+                   UInt32 num_channels,
+                   double sample_rate,
+                   WaveSampleFormat format = WaveSampleFormat::kFloat32);
+    ~WaveFileWriter();
+
+    //! バッファの先頭からlengthサンプル分を書き込む。
+    /*! buf のチャンネル数が num_channels に満たない場合、足りないチャンネルは無音として書き込む
+     *  @exception WaveFileError
+     */
+    void Write(BufferRef<float const> buf, SampleCount length);
+
+    //! ヘッダーを確定してファイルを閉じる。
+    //! @exception WaveFileError
+    void Close();
+
+    SampleCount GetNumWrittenSamples() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pimpl_;
+};
+
+NS_HWM_END
@@ -111,8 +111,12 @@ public:
                 dc.DrawLine(0, gap_y, size.x, gap_y);
             }
             
-            auto const cur = Clamp<double>(level_meter_[ch], kViewMinDB, kViewMaxDB);
-            int const left_pos = std::round(size.x * (cur - kViewMinDB) / (kViewMaxDB - kViewMinDB));
+            auto to_pos = [&](double db) {
+                auto const cur = Clamp<double>(db, kViewMinDB, kViewMaxDB);
+                return (int)std::round(size.x * (cur - kViewMinDB) / (kViewMaxDB - kViewMinDB));
+            };
+            
+            int const left_pos = to_pos(level_meter_[ch].peak_db_);
             wxRect rc {
                 wxPoint { left_pos, top },
                 wxSize { size.x - left_pos, bar_height }
@@ -120,6 +124,12 @@ public:
             dc.SetPen(wxPen(HSVToColour(0, 0, 0.2)));
             dc.SetBrush(wxBrush(HSVToColour(0, 0, 0.2)));
             dc.DrawRectangle(rc);
+            
+            int const hold_pos = to_pos(level_meter_[ch].peak_hold_db_);
+            if(hold_pos > left_pos) {
+                dc.SetPen(wxPen(HSVToColour(0, 0, 0.85)));
+                dc.DrawLine(hold_pos, top, hold_pos, top + bar_height);
+            }
         }
         
         auto const kZeroDB = 0;
@@ -136,7 +146,7 @@ private:
     
     wxFont font_;
     wxTimer timer_;
-    std::vector<double> level_meter_;
+    std::vector<LevelMeterValue> level_meter_;
     GraphicsBuffer bmp_;
 };
 
@@ -262,6 +272,23 @@ public:
         
         btn_enable_input_->Bind(wxEVT_CHECKBOX, [this](wxCommandEvent &ev) { OnCheckBox(ev); });
         
+        btn_enable_monitoring_ = new wxCheckBox(this, wxID_ANY, L"入力モニター",
+                                                wxDefaultPosition);
+        btn_enable_monitoring_->SetForegroundColour(kColLabel);
+        btn_enable_monitoring_->SetBackgroundColour(kColInputCheckBox);
+        btn_enable_monitoring_->SetValue(app->IsInputMonitoringEnabled());
+        
+        btn_enable_monitoring_->Bind(wxEVT_CHECKBOX, [this](wxCommandEvent &ev) {
+            App::GetInstance()->EnableInputMonitoring(btn_enable_monitoring_->IsChecked());
+        });
+        
+        lbl_latency_ = new wxStaticText(this, wxID_ANY, L"", wxDefaultPosition, wxDefaultSize,
+                                        wxST_NO_AUTORESIZE|wxALIGN_RIGHT);
+        lbl_latency_->SetForegroundColour(kColLabel);
+        auto size = lbl_latency_->GetTextExtent(L"レイテンシー: 000.0 ms");
+        size.IncBy(10, 0);
+        lbl_latency_->SetMinClientSize(size);
+        
         auto vcenter_box = [](auto window) {
             auto vbox = new wxBoxSizer(wxVERTICAL);
             vbox->AddStretchSpacer(1);
@@ -273,13 +300,19 @@ public:
         
         auto hbox = new wxBoxSizer(wxHORIZONTAL);
         hbox->Add(vcenter_box(btn_enable_input_), wxSizerFlags(1).Expand());
+        hbox->Add(vcenter_box(btn_enable_monitoring_), wxSizerFlags(1).Expand());
+        hbox->Add(vcenter_box(lbl_latency_), wxSizerFlags(0).Expand());
         SetSizer(hbox);
         
         slr_pocl_.reset(app->GetPlaybackOptionChangeListenerService(), this);
+        
+        UpdateLatencyText();
     }
     
 private:
     wxCheckBox *btn_enable_input_ = nullptr;
+    wxCheckBox *btn_enable_monitoring_ = nullptr;
+    wxStaticText *lbl_latency_ = nullptr;
     ScopedListenerRegister<App::IPlaybackOptionChangeListener> slr_pocl_;
     
     bool AcceptsFocus() const override { return false; }
@@ -299,6 +332,23 @@ private:
     {
         btn_enable_input_->SetValue(enabled);
     }
+    
+    void OnInputMonitoringEnableStateChanged(bool enabled) override
+    {
+        btn_enable_monitoring_->SetValue(enabled);
+    }
+    
+    void OnLatencyChanged() override
+    {
+        UpdateLatencyText();
+    }
+    
+    //! オーディオ入力から出力までの往復のレイテンシーを表示する
+    void UpdateLatencyText()
+    {
+        auto const latency_msec = App::GetInstance()->GetRoundTripLatency() * 1000.0;
+        lbl_latency_->SetLabel(wxString::Format(L"レイテンシー: %.1f ms", latency_msec));
+    }
 };
 
 class HeaderPanel
@@ -343,6 +393,7 @@ class MainWindow
 :   public wxWindow
 ,   public App::IModuleLoadListener
 ,   public App::IPluginLoadListener
+,   public App::IPluginScanListener
 ,   public IPluginEditorFrameListener
 {
 public:
@@ -368,6 +419,9 @@ public:
         
         btn_load_module_ = new wxButton(this, wxID_ANY, "Load Module", wxDefaultPosition, wxSize(100, 20));
         
+        cho_scanned_plugins_ = new wxChoice(this, wxID_ANY, wxDefaultPosition, wxSize(100, 20), 0, nullptr, wxCB_SORT);
+        btn_rescan_plugins_ = new wxButton(this, wxID_ANY, "Rescan", wxDefaultPosition, wxSize(100, 20));
+        
         st_factory_info_label_ = new wxStaticText(this, wxID_ANY, "Factory Info", wxDefaultPosition, wxSize(100, 20), wxST_NO_AUTORESIZE);
         st_factory_info_label_->SetForegroundColour(*wxWHITE);
         tc_factory_info_ = new wxTextCtrl(this, wxID_ANY, "", wxDefaultPosition, wxSize(200, 20), wxTE_READONLY|wxTE_MULTILINE);
@@ -375,6 +429,9 @@ public:
         
         cho_select_component_ = new wxChoice(this, wxID_ANY, wxDefaultPosition, wxSize(100, 20));
         
+        st_plugin_load_status_ = new wxStaticText(this, wxID_ANY, "", wxDefaultPosition, wxSize(100, 20), wxST_NO_AUTORESIZE);
+        st_plugin_load_status_->SetForegroundColour(*wxWHITE);
+        
         st_component_info_label_ = new wxStaticText(this, wxID_ANY, "Component Info", wxDefaultPosition, wxSize(100, 20), wxST_NO_AUTORESIZE);
         st_component_info_label_->SetForegroundColour(*wxWHITE);
         tc_component_info_ = new wxTextCtrl(this, wxID_ANY, "", wxDefaultPosition, wxSize(100, 100), wxTE_READONLY|wxTE_MULTILINE);
@@ -403,10 +460,18 @@ public:
             
             vbox_inner->Add(browse_box, wxSizerFlags(0).Expand());
             
+            auto scanned_box = new wxBoxSizer(wxHORIZONTAL);
+            
+            scanned_box->Add(cho_scanned_plugins_, wxSizerFlags(1).Expand().Border());
+            scanned_box->Add(btn_rescan_plugins_, wxSizerFlags().Expand().Border());
+            
+            vbox_inner->Add(scanned_box, wxSizerFlags(0).Expand());
+            
             vbox_factory_ = new wxBoxSizer(wxVERTICAL);
             vbox_factory_->Add(st_factory_info_label_, wxSizerFlags(0).Expand().Border(wxTOP|wxLEFT|wxRIGHT));
             vbox_factory_->Add(tc_factory_info_, wxSizerFlags(1).Expand().Border(wxBOTTOM|wxLEFT|wxRIGHT));
             vbox_factory_->Add(cho_select_component_, wxSizerFlags(0).Expand().Border());
+            vbox_factory_->Add(st_plugin_load_status_, wxSizerFlags(0).Expand().Border(wxLEFT|wxRIGHT|wxBOTTOM));
             vbox_factory_->ShowItems(false);
             
             vbox_inner->Add(vbox_factory_, wxSizerFlags(1).Expand());
@@ -439,12 +504,17 @@ public:
         
         Bind(wxEVT_PAINT, [this](auto &ev) { OnPaint(ev); });
         btn_load_module_->Bind(wxEVT_BUTTON, [this](auto &ev) { OnLoadModule(); });
+        cho_scanned_plugins_->Bind(wxEVT_CHOICE, [this](auto &ev) { OnSelectScannedPlugin(); });
+        btn_rescan_plugins_->Bind(wxEVT_BUTTON, [this](auto &ev) { OnRescanPlugins(); });
         cho_select_component_->Bind(wxEVT_CHOICE, [this](auto &ev) { OnSelectComponent(); });
         btn_open_editor_->Bind(wxEVT_BUTTON, [this](auto &ev) { OnOpenEditor(); });
         
         auto app = App::GetInstance();
         slr_mll_.reset(app->GetModuleLoadListenerService(), this);
         slr_pll_.reset(app->GetPluginLoadListenerService(), this);
+        slr_psl_.reset(app->GetPluginScanListenerService(), this);
+        
+        UpdateScannedPluginList();
     }
     
     bool AcceptsFocus() const override { return false; }
@@ -518,6 +588,7 @@ private:
         
         vbox_factory_->ShowItems(false);
         cho_select_component_->Hide();
+        st_plugin_load_status_->SetLabel("");
     }
     
     void OnAfterPluginLoaded(Vst3Plugin *plugin) override
@@ -562,6 +633,7 @@ private:
         vbox_component_->ShowItems(true);
         btn_open_editor_->Show();
         btn_open_editor_->Enable();
+        st_plugin_load_status_->SetLabel("");
         
         Layout();
     }
@@ -574,13 +646,32 @@ private:
         btn_open_editor_->Hide();
     }
     
+    //! ロード中も、ロード済みのプラグインの再生とエディタはそのまま使える
+    void OnPluginLoadProgress(ClassInfo::CID cid, PluginLoader::Stage stage) override
+    {
+        st_plugin_load_status_->SetLabel(L"Loading... (" + PluginLoader::ToString(stage) + L")");
+    }
+    
+    void OnPluginLoadFailed(ClassInfo::CID cid, String error_msg) override
+    {
+        st_plugin_load_status_->SetLabel(L"Failed to load the plugin: " + error_msg);
+    }
+    
+    void OnPluginScanFinished() override
+    {
+        UpdateScannedPluginList();
+    }
+    
     wxTimer timer_;
     wxTextCtrl      *tc_filepath_;
     wxButton        *btn_load_module_;
+    wxChoice        *cho_scanned_plugins_;
+    wxButton        *btn_rescan_plugins_;
     wxBoxSizer      *vbox_factory_;
     wxStaticText    *st_factory_info_label_;
     wxTextCtrl      *tc_factory_info_;
     wxChoice        *cho_select_component_;
+    wxStaticText    *st_plugin_load_status_;
     wxBoxSizer      *vbox_component_;
     wxSizerItem     *dummy_component_;
     wxStaticText    *st_component_info_label_;
@@ -592,6 +683,7 @@ private:
     
     ScopedListenerRegister<App::IModuleLoadListener> slr_mll_;
     ScopedListenerRegister<App::IPluginLoadListener> slr_pll_;
+    ScopedListenerRegister<App::IPluginScanListener> slr_psl_;
     
     void OnPaint(wxPaintEvent &)
     {
@@ -635,9 +727,15 @@ private:
         }
         
         auto path = String(openFileDialog.GetPath().ToStdWstring());
+        auto const old_search_path = app->GetConfig().plugin_search_path_;
         app->GetConfig().plugin_search_path_ = wxFileName(path).GetPath();
         app->SaveConfig();
         
+        // 新しいディレクトリのプラグインも一覧に表示できるようにする
+        if(app->GetConfig().plugin_search_path_ != old_search_path) {
+            app->RescanPlugins();
+        }
+        
         if(App::GetInstance()->LoadVst3Module(path) == false) {
             wxMessageBox(L"モジュールのオープンに失敗しました");
         }
@@ -668,7 +766,79 @@ private:
         }
         
         if(!found) { }
-        App::GetInstance()->LoadVst3Plugin(p->cid_);
+        App::GetInstance()->LoadVst3PluginAsync(p->cid_);
+    }
+    
+    class ScannedPluginData : public wxClientData
+    {
+    public:
+        ScannedPluginData(String module_path, ClassInfo::CID cid)
+        :   module_path_(module_path)
+        ,   cid_(cid)
+        {}
+        
+        String module_path_;
+        ClassInfo::CID cid_;
+    };
+    
+    //! スキャン済みのプラグインの一覧を更新する。モジュールのロードは行わない
+    void UpdateScannedPluginList()
+    {
+        auto app = App::GetInstance();
+        
+        cho_scanned_plugins_->Clear();
+        
+        for(auto const &entry: app->GetScannedPlugins()) {
+            if(entry.is_loadable_ == false) { continue; }
+            
+            for(auto const &info: entry.class_info_list_) {
+                if(info.GetCategory() != hwm::to_wstr(kVstAudioEffectClass)) { continue; }
+                
+                String label = info.GetName();
+                if(info.HasClassInfo2() && info.GetClassInfo2().GetVendor().empty() == false) {
+                    label += L" (" + info.GetClassInfo2().GetVendor() + L")";
+                }
+                cho_scanned_plugins_->Append(label, new ScannedPluginData{entry.module_path_, info.GetCID()});
+            }
+        }
+        
+        cho_scanned_plugins_->SetSelection(wxNOT_FOUND);
+        cho_scanned_plugins_->Enable(cho_scanned_plugins_->GetCount() > 0);
+        btn_rescan_plugins_->Enable(app->IsScanningPlugins() == false);
+    }
+    
+    void OnSelectScannedPlugin()
+    {
+        auto sel = cho_scanned_plugins_->GetSelection();
+        if(sel == wxNOT_FOUND) { return; }
+        
+        auto const p = static_cast<ScannedPluginData const *>(cho_scanned_plugins_->GetClientObject(sel));
+        auto app = App::GetInstance();
+        
+        if(app->LoadVst3Module(p->module_path_) == false) {
+            wxMessageBox(L"モジュールのオープンに失敗しました");
+            return;
+        }
+        
+        // モジュール内のプラグインがひとつだけの場合は、モジュールのロード時にすでにロードされている
+        auto plugin = app->GetPlugin();
+        if(plugin && plugin->GetComponentInfo().GetCID() == p->cid_) { return; }
+        
+        for(UInt32 i = 0; i < cho_select_component_->GetCount(); ++i) {
+            auto component_data = static_cast<ComponentData const *>(cho_select_component_->GetClientObject(i));
+            if(component_data->cid_ == p->cid_) {
+                cho_select_component_->SetSelection(i);
+                break;
+            }
+        }
+        
+        app->LoadVst3PluginAsync(p->cid_);
+    }
+    
+    void OnRescanPlugins()
+    {
+        btn_rescan_plugins_->Disable();
+        App::GetInstance()->RescanPlugins();
     }
     
     void OnDestroyFromPluginEditorFrame() override
@@ -712,6 +882,7 @@ IMainFrame::IMainFrame(Args&&... args)
 class MainFrame
 :   public IMainFrame
 ,   public App::IPlaybackOptionChangeListener
+,   public App::IProjectSaveListener
 {
     wxSize const initial_size = { 480, 600 };
     
@@ -732,6 +903,11 @@ public:
         menu_file->Append(kID_File_Load, L"開く\tCTRL-O", L"プロジェクトファイルを開きます");
         menu_file->Append(kID_File_Save, L"保存\tCTRL-S", L"プロジェクトファイルを保存します");
 
+        auto menu_edit = new wxMenu();
+        menu_edit->Append(kID_Edit_UndoPluginState, L"プラグインの状態を元に戻す", L"A/B比較などで変更する前のプラグインの状態に戻します");
+        menu_edit->Append(kID_Edit_RedoPluginState, L"プラグインの状態をやり直す", L"元に戻す前のプラグインの状態をやり直します");
+        menu_edit->Append(kID_Edit_TogglePluginStateAB, L"A/B比較を切り替え", L"現在のプラグインの状態を保存して、もう一方の状態に切り替えます");
+        
         auto menu_playback = new wxMenu();
         menu_enable_input_ = menu_playback->AppendCheckItem(kID_Playback_EnableAudioInputs,
                                                             L"オーディオ入力を有効化\tCTRL-I",
@@ -751,6 +927,7 @@ public:
         
         auto menu_device = new wxMenu();
         menu_device->Append(kID_Device_Preferences, L"デバイス設定\tCTRL-,", L"デバイス設定を変更します");
+        menu_device->Append(kID_Device_ShowLoadStatistics, L"処理負荷を表示...", L"オーディオ処理の負荷とドロップアウトの回数を表示します");
         
 #if defined(_MSC_VER)
         auto menu_help = new wxMenu();   
@@ -765,6 +942,7 @@ public:
 
         auto menubar = new wxMenuBar();
         menubar->Append(menu_file, L"ファイル");
+        menubar->Append(menu_edit, L"編集");
         menubar->Append(menu_playback, L"再生");
         menubar->Append(menu_view, L"表示");
         menubar->Append(menu_device, L"デバイス");
@@ -772,6 +950,9 @@ public:
         menubar->Append(menu_help, L"ヘルプ");
 #endif
         SetMenuBar(menubar);
+        
+        // メニューのヘルプ文字列と、プロジェクトファイルの保存状態を表示する
+        CreateStatusBar();
 
 #if defined(_MSC_VER)
         Bind(wxEVT_COMMAND_MENU_SELECTED, [this](auto&) {
@@ -787,6 +968,27 @@ public:
         Bind(wxEVT_COMMAND_MENU_SELECTED, [this](auto &) { OnLoadProject(); }, kID_File_Load);
         Bind(wxEVT_COMMAND_MENU_SELECTED, [this](auto &) { OnSaveProject(); }, kID_File_Save);
         
+        Bind(wxEVT_COMMAND_MENU_SELECTED, [this](auto &) {
+            auto app = App::GetInstance();
+            if(app->UndoPluginStateChange()) {
+                SetStatusText(L"Restored the previous plugin state");
+            }
+        }, kID_Edit_UndoPluginState);
+        
+        Bind(wxEVT_COMMAND_MENU_SELECTED, [this](auto &) {
+            auto app = App::GetInstance();
+            if(app->RedoPluginStateChange()) {
+                SetStatusText(L"Redid the plugin state change");
+            }
+        }, kID_Edit_RedoPluginState);
+        
+        Bind(wxEVT_COMMAND_MENU_SELECTED, [this](auto &) {
+            auto app = App::GetInstance();
+            if(app->TogglePluginStateAB()) {
+                SetStatusText(app->GetActivePluginStateSlot() == 0 ? L"A/B: A" : L"A/B: B");
+            }
+        }, kID_Edit_TogglePluginStateAB);
+        
         Bind(wxEVT_COMMAND_MENU_SELECTED, [](auto &ev) {
             auto app = App::GetInstance();
             app->EnableAudioInput(app->IsAudioInputEnabled() == false);
@@ -813,6 +1015,11 @@ public:
             app->SelectAudioDevice();
         }, kID_Device_Preferences);
         
+        Bind(wxEVT_COMMAND_MENU_SELECTED, [this](auto &ev) {
+            auto app = App::GetInstance();
+            wxMessageBox(app->GetAudioProcessingLoadReport(), L"処理負荷", wxOK|wxCENTER, this);
+        }, kID_Device_ShowLoadStatistics);
+        
         Bind(wxEVT_COMMAND_MENU_SELECTED, [this](auto &ev) {
             OnOpenEditor();
         }, kID_View_PluginEditor);
@@ -837,6 +1044,18 @@ public:
             ev.Enable(wnd_->CanOpenEditor());
         }, kID_View_PluginEditor);
         
+        Bind(wxEVT_UPDATE_UI, [](auto &ev) {
+            ev.Enable(App::GetInstance()->CanUndoPluginStateChange());
+        }, kID_Edit_UndoPluginState);
+        
+        Bind(wxEVT_UPDATE_UI, [](auto &ev) {
+            ev.Enable(App::GetInstance()->CanRedoPluginStateChange());
+        }, kID_Edit_RedoPluginState);
+        
+        Bind(wxEVT_UPDATE_UI, [](auto &ev) {
+            ev.Enable(App::GetInstance()->GetPlugin() != nullptr);
+        }, kID_Edit_TogglePluginStateAB);
+        
         auto key_input = PCKeyboardInput::GetInstance();
         key_input->ApplyTo(this);
         
@@ -853,6 +1072,7 @@ public:
         
         auto app = App::GetInstance();
         slr_pocl_.reset(app->GetPlaybackOptionChangeListenerService(), this);
+        slr_psl_.reset(app->GetProjectSaveListenerService(), this);
         
         Bind(wxEVT_CLOSE_WINDOW, [this](auto &ev) {
             wnd_->Destroy();
@@ -866,12 +1086,14 @@ public:
         DestroyChildren();
         wnd_ = nullptr;
         slr_pocl_.reset();
+        slr_psl_.reset();
         return base_type::Destroy();
     }
     
 private:
     MainWindow *wnd_;
     ScopedListenerRegister<App::IPlaybackOptionChangeListener> slr_pocl_;
+    ScopedListenerRegister<App::IProjectSaveListener> slr_psl_;
     wxMenuItem *menu_enable_input_;
     String project_file_dir_;
     
@@ -885,6 +1107,21 @@ private:
         menu_enable_input_->Check(enabled);
     }
     
+    void OnProjectSaveProgress(String path, ProjectSaver::Stage stage) override
+    {
+        SetStatusText(L"Saving... (" + ProjectSaver::ToString(stage) + L") " + path);
+    }
+    
+    void OnProjectSaved(String path) override
+    {
+        SetStatusText(L"Saved: " + path);
+    }
+    
+    void OnProjectSaveFailed(String path, String error_msg) override
+    {
+        SetStatusText(L"Failed to save the project: " + error_msg);
+    }
+    
     void OnLoadProject()
     {
         // load
@@ -16,9 +16,13 @@ public:
         kID_Playback_Waveform_Square,
         kID_Playback_Waveform_Triangle,
         kID_Device_Preferences,
+        kID_Device_ShowLoadStatistics,
         kID_File_Load,
         kID_File_Save,
         kID_View_PluginEditor,
+        kID_Edit_UndoPluginState,
+        kID_Edit_RedoPluginState,
+        kID_Edit_TogglePluginStateAB,
     };
     
     template<class... Args>
@@ -137,10 +137,9 @@ StrategyPtr Logger::GetStrategy() const
     return pimpl_->st_;
 }
 
-Error Logger::OutputLogImpl(String level, String message)
+String FormatLogEntry(String const &level, std::time_t t, String const &message)
 {
     std::string time_str;
-    auto t = time(nullptr);
     struct tm ltime;
 #if defined(_MSC_VER)
     auto error = localtime_s(&ltime, &t);
@@ -157,8 +156,41 @@ Error Logger::OutputLogImpl(String level, String message)
         time_str = buf;
     }
     
-    String entry = String(L"[") + to_wstr(time_str) + L"][" + level + L"] " + message;
-    return GetStrategy()->OutputLog(entry);
+    return String(L"[") + to_wstr(time_str) + L"][" + level + L"] " + message;
+}
+
+Error Logger::OutputLogImpl(String level, String message)
+{
+    return GetStrategy()->OutputLog(FormatLogEntry(level, time(nullptr), message));
+}
+
+Error Logger::OutputLogBatch(std::vector<Entry> const &entries)
+{
+    auto lock = lf_logging_.make_lock();
+    
+    if(IsLoggingStarted() == false) { return Error::NoError(); }
+    
+    std::vector<String> messages;
+    messages.reserve(entries.size());
+    bool has_invalid_level = false;
+    
+    for(auto const &entry: entries) {
+        // an entry with an invalid level must not discard the other entries.
+        if(IsValidLoggingLevel(entry.level_) == false) { has_invalid_level = true; continue; }
+        if(IsActiveLoggingLevel(entry.level_) == false) { continue; }
+        
+        messages.push_back(FormatLogEntry(entry.level_,
+                                       std::chrono::system_clock::to_time_t(entry.time_),
+                                       entry.message_));
+    }
+    
+    if(messages.empty() == false) {
+        if(auto err = GetStrategy()->OutputLogBatch(messages)) { return err; }
+    }
+    
+    if(has_invalid_level) { return Error(L"Invalid logging level is specified."); }
+    
+    return Error::NoError();
 }
 
 NS_HWM_END
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <initializer_list>
 #include <memory>
 #include <string>
@@ -138,6 +139,23 @@ public:
         return OutputLogImpl(level, get_message());
     }
     
+    //! A log entry whose message has already been built.
+    struct Entry
+    {
+        String level_;
+        std::chrono::system_clock::time_point time_;
+        String message_;
+    };
+    
+    //! Output multiple log entries at once.
+    /*! Entries whose levels are not active are skipped.
+     *  Each entry is stamped with its own `time_` instead of the current time,
+     *  and all entries are passed to the strategy with a single call of `OutputLogBatch()`.
+     *  Entries whose levels are not contained in the list of GetLoggingLevels() are skipped too,
+     *  and an error is returned after the other entries are output.
+     */
+    Error OutputLogBatch(std::vector<Entry> const &entries);
+    
 private:
     class Impl;
     std::unique_ptr<Impl> pimpl_;
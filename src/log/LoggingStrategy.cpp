@@ -18,6 +18,17 @@ Logger::LoggingStrategy::LoggingStrategy()
 Logger::LoggingStrategy::~LoggingStrategy()
 {}
 
+Error Logger::LoggingStrategy::OutputLogBatch(std::vector<String> const &messages)
+{
+    for(auto const &message: messages) {
+        if(auto err = OutputLog(message)) {
+            return err;
+        }
+    }
+    
+    return Error::NoError();
+}
+
 struct FileLoggingStrategy::Impl
 {
     LockFactory lf_stream_;
@@ -226,6 +237,72 @@ Error FileLoggingStrategy::OutputLog(String const &message)
     return Error::NoError();
 }
 
+Error FileLoggingStrategy::OutputLogBatch(std::vector<String> const &messages)
+{
+    if(pimpl_->redirect_to_debug_console_.load()) {
+        for(auto const &message: messages) {
+#if defined(_MSC_VER)
+            hwm::wdout << message << L"\n";
+#else
+            hwm::dout << to_utf8(message) << "\n";
+#endif
+        }
+#if defined(_MSC_VER)
+        hwm::wdout << std::flush;
+#else
+        hwm::dout << std::flush;
+#endif
+    }
+    
+    auto write_all = [&messages](std::ofstream &s) -> Error {
+        errno = 0;
+        s.clear();
+        for(auto const &message: messages) {
+            s << to_utf8(message) << '\n';
+        }
+        s.flush();
+        if(s.fail()) {
+            return Error(get_error_message());
+        }
+        return Error::NoError();
+    };
+    
+    auto lock = pimpl_->lf_stream_.make_lock();
+    if(pimpl_->stream_.is_open()) {
+        if(auto err = write_all(pimpl_->stream_)) {
+            return err;
+        }
+        
+        // Rotate the log file while running, because the file is opened permanently
+        // and the rotation on opening never happens until the next launch.
+        UInt64 const limit = GetFileSizeLimit();
+        auto const pos = pimpl_->stream_.tellp();
+        if(pos >= 0 && (UInt64)pos > limit) {
+            pimpl_->stream_.close();
+            if(auto err = Rotate(pimpl_->path_, limit * 0.9)) {
+                return err;
+            }
+            
+            auto result = create_file_stream<std::ofstream>(pimpl_->path_, kDefaultOpenMode);
+            if(result.is_right() == false) {
+                return result.left();
+            }
+            pimpl_->stream_ = std::move(result.right());
+        }
+    } else {
+        lock.unlock();
+        Rotate(pimpl_->path_, GetFileSizeLimit() * 0.9);
+        auto result = create_file_stream<std::ofstream>(pimpl_->path_, kDefaultOpenMode);
+        if(result.is_right() == false) {
+            return result.left();
+        }
+        
+        return write_all(result.right());
+    }
+    
+    return Error::NoError();
+}
+
 DebugConsoleLoggingStrategy::DebugConsoleLoggingStrategy()
 {}
 
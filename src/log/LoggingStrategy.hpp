@@ -3,6 +3,7 @@
 #include "./Logger.hpp"
 
 #include <memory>
+#include <vector>
 
 NS_HWM_BEGIN
 
@@ -23,6 +24,12 @@ public:
     
     virtual
     Logger::Error OutputLog(String const &message) = 0;
+    
+    //! Output multiple messages at once.
+    /*! The default implementation calls `OutputLog()` for each message.
+     */
+    virtual
+    Logger::Error OutputLogBatch(std::vector<String> const &messages);
 };
 
 class FileLoggingStrategy : public Logger::LoggingStrategy
@@ -53,6 +60,11 @@ public:
     void OnBeforeDeassigned(Logger *logger) override;
     Logger::Error OutputLog(String const &message) override;
     
+    //! Write all messages and flush the stream only once.
+    /*! If the file has been opened permanently and grows over the file size limit,
+     *  the file is rotated and reopened.
+     */
+    Logger::Error OutputLogBatch(std::vector<String> const &messages) override;
     
     //! Get file size limit.
     UInt64 GetFileSizeLimit() const;
@@ -0,0 +1,259 @@
+#include "./RealtimeLogger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "./GlobalLogger.hpp"
+#include "../misc/SpscRingBuffer.hpp"
+
+NS_HWM_BEGIN
+
+String FormatRealtimeLogRecord(RealtimeLogRecord const &rec)
+{
+    std::wstringstream ss;
+
+    auto write_arg = [&ss](RealtimeLogArg const &arg) {
+        using Type = RealtimeLogArg::Type;
+        switch(arg.type_) {
+            case Type::kInt: ss << arg.i_; break;
+            case Type::kUInt: ss << arg.u_; break;
+            case Type::kDouble: ss << arg.d_; break;
+            case Type::kBool: ss << (arg.b_ ? L"true" : L"false"); break;
+            case Type::kString: ss << (arg.s_ ? arg.s_ : L"(null)"); break;
+            case Type::kPointer: ss << arg.p_; break;
+            case Type::kFormattedInt:
+                if(arg.formatter_) { ss << arg.formatter_(arg.i_); } else { ss << arg.i_; }
+                break;
+        }
+    };
+
+    UInt32 arg_index = 0;
+    for(auto p = rec.format_; p && *p; ++p) {
+        if(p[0] == L'{' && p[1] == L'}' && arg_index < rec.num_args_) {
+            write_arg(rec.args_[arg_index++]);
+            ++p;
+        } else {
+            ss << *p;
+        }
+    }
+
+    return ss.str();
+}
+
+namespace {
+
+//! A single-producer single-consumer ring of log records.
+class RecordRing
+{
+public:
+    RecordRing(UInt32 capacity)
+    :   records_(capacity)
+    {}
+
+    bool Push(RealtimeLogRecord const &rec) { return records_.Push(rec); }
+    bool Pop(RealtimeLogRecord &rec) { return records_.Pop(rec); }
+
+    //! true while a thread owns this ring.
+    std::atomic<bool> in_use_ = { false };
+
+private:
+    SpscRingBuffer<RealtimeLogRecord> records_;
+};
+
+std::atomic<UInt64> g_next_logger_id_ = { 1 };
+
+//! The ring assigned to the current thread.
+/*! The ring is returned to the logger when the thread exits.
+ *  The assignment shares the ownership of the ring,
+ *  so the ring outlives the logger if the thread exits after the logger is destroyed.
+ */
+struct RingAssignment
+{
+    UInt64 logger_id_ = 0;
+    std::shared_ptr<RecordRing> ring_;
+
+    ~RingAssignment();
+};
+
+thread_local RingAssignment t_ring_assignment_;
+
+} // namespace
+
+class RealtimeLogger::Impl
+{
+public:
+    Impl(Options const &opts)
+    :   opts_(opts)
+    ,   id_(g_next_logger_id_.fetch_add(1))
+    {
+        assert(opts_.num_rings_ > 0);
+        assert(opts_.ring_capacity_ > 0);
+
+        for(UInt32 i = 0; i < opts_.num_rings_; ++i) {
+            rings_.push_back(std::make_shared<RecordRing>(opts_.ring_capacity_));
+        }
+    }
+
+    RecordRing * GetRingForCurrentThread()
+    {
+        auto &assignment = t_ring_assignment_;
+        if(assignment.logger_id_ == id_ && assignment.ring_) {
+            return assignment.ring_.get();
+        }
+
+        for(auto &ring: rings_) {
+            bool expected = false;
+            if(ring->in_use_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                // return the ring of the previous logger before switching to this logger.
+                if(assignment.ring_) { assignment.ring_->in_use_.store(false, std::memory_order_release); }
+                assignment.logger_id_ = id_;
+                assignment.ring_ = ring;
+                return ring.get();
+            }
+        }
+
+        return nullptr;
+    }
+
+    void WriterThread()
+    {
+        for( ; ; ) {
+            bool stopped = false;
+            {
+                auto lock = lf_.make_lock();
+                cv_.wait_for(lock, opts_.flush_interval_, [this] { return stop_requested_; });
+                stopped = stop_requested_;
+            }
+
+            Drain();
+
+            if(stopped) { break; }
+        }
+    }
+
+    void Drain()
+    {
+        records_.clear();
+
+        RealtimeLogRecord rec;
+        for(auto &ring: rings_) {
+            while(ring->Pop(rec)) {
+                records_.push_back(rec);
+            }
+        }
+
+        auto const num_dropped = num_dropped_.load(std::memory_order_relaxed);
+        auto const num_newly_dropped = num_dropped - num_reported_dropped_;
+        num_reported_dropped_ = num_dropped;
+
+        if(records_.empty() && num_newly_dropped == 0) { return; }
+
+        // records from different threads are merged in chronological order.
+        std::stable_sort(records_.begin(), records_.end(),
+                         [](auto const &lhs, auto const &rhs) { return lhs.time_ < rhs.time_; });
+
+        entries_.clear();
+        for(auto const &r: records_) {
+            entries_.push_back(Logger::Entry { r.level_, r.time_, FormatRealtimeLogRecord(r) });
+        }
+
+        if(num_newly_dropped > 0) {
+            std::wstringstream ss;
+            ss << num_newly_dropped << L" realtime log records were dropped.";
+            entries_.push_back(Logger::Entry { L"Warn", std::chrono::system_clock::now(), ss.str() });
+        }
+
+        if(opts_.logger_) {
+            opts_.logger_->OutputLogBatch(entries_);
+        } else if(auto logger = GetGlobalLogger()) {
+            logger->OutputLogBatch(entries_);
+        }
+    }
+
+    Options opts_;
+    UInt64 id_;
+    std::vector<std::shared_ptr<RecordRing>> rings_;
+    std::atomic<UInt64> num_dropped_ = { 0 };
+    UInt64 num_reported_dropped_ = 0;
+
+    LockFactory lf_;
+    std::condition_variable cv_;
+    bool stop_requested_ = false;
+    std::thread writer_;
+
+    // reused by the writer thread.
+    std::vector<RealtimeLogRecord> records_;
+    std::vector<Logger::Entry> entries_;
+};
+
+namespace {
+
+RingAssignment::~RingAssignment()
+{
+    if(!ring_) { return; }
+
+    // the ring is still valid here even if the logger has been destroyed.
+    ring_->in_use_.store(false, std::memory_order_release);
+}
+
+} // namespace
+
+RealtimeLogger::RealtimeLogger()
+:   RealtimeLogger(Options{})
+{}
+
+RealtimeLogger::RealtimeLogger(Options const &opts)
+:   pimpl_(std::make_unique<Impl>(opts))
+{}
+
+RealtimeLogger::~RealtimeLogger()
+{
+    Stop();
+}
+
+void RealtimeLogger::Start()
+{
+    assert(pimpl_->writer_.joinable() == false);
+
+    {
+        auto lock = pimpl_->lf_.make_lock();
+        pimpl_->stop_requested_ = false;
+    }
+
+    pimpl_->writer_ = std::thread([this] { pimpl_->WriterThread(); });
+}
+
+void RealtimeLogger::Stop()
+{
+    if(pimpl_->writer_.joinable() == false) { return; }
+
+    {
+        auto lock = pimpl_->lf_.make_lock();
+        pimpl_->stop_requested_ = true;
+    }
+    pimpl_->cv_.notify_one();
+    pimpl_->writer_.join();
+}
+
+bool RealtimeLogger::Push(RealtimeLogRecord const &rec)
+{
+    auto *ring = pimpl_->GetRingForCurrentThread();
+    if(ring && ring->Push(rec)) {
+        return true;
+    }
+
+    pimpl_->num_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+UInt64 RealtimeLogger::GetNumDroppedRecords() const
+{
+    return pimpl_->num_dropped_.load(std::memory_order_relaxed);
+}
+
+NS_HWM_END
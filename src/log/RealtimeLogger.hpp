@@ -0,0 +1,198 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "./Logger.hpp"
+#include "../misc/SingleInstance.hpp"
+
+NS_HWM_BEGIN
+
+//! An argument of a RealtimeLogRecord.
+/*! Arguments are stored as values and formatted later on the writer thread.
+ */
+struct RealtimeLogArg
+{
+    enum class Type : UInt8 {
+        kInt,
+        kUInt,
+        kDouble,
+        kBool,
+        kString,    //!< a pointer to a wide string which must outlive the record (e.g. a string literal)
+        kPointer,
+        kFormattedInt, //!< an integer which is converted into a string by `formatter_`
+    };
+
+    using Formatter = String (*)(Int64 value);
+
+    RealtimeLogArg() : i_(0) {}
+
+    Type type_ = Type::kInt;
+    //! used only for Type::kFormattedInt.
+    Formatter formatter_ = nullptr;
+    union {
+        Int64 i_;
+        UInt64 u_;
+        double d_;
+        bool b_;
+        wchar_t const *s_;
+        void const *p_;
+    };
+};
+
+//! An integer which is formatted with a function on the writer thread.
+/*! Use this for values whose readable form can't be built on realtime threads,
+ *  e.g. error codes converted with a lookup which allocates a string.
+ *  The formatter must be callable from any thread.
+ */
+struct RealtimeLogFormattedInt
+{
+    Int64 value_ = 0;
+    RealtimeLogArg::Formatter formatter_ = nullptr;
+};
+
+template<class T>
+struct is_realtime_log_unsupported_arg : std::false_type {};
+
+//! Convert a value into a RealtimeLogArg.
+/*! Strings which own their buffers (std::wstring, std::string) are not accepted,
+ *  because copying them is not allocation-free and the buffer may be released before the record is formatted.
+ */
+template<class T>
+RealtimeLogArg MakeRealtimeLogArg(T const &value)
+{
+    using U = std::decay_t<T>;
+
+    RealtimeLogArg arg;
+    if constexpr(std::is_same_v<U, RealtimeLogFormattedInt>) {
+        arg.type_ = RealtimeLogArg::Type::kFormattedInt;
+        arg.i_ = value.value_;
+        arg.formatter_ = value.formatter_;
+    } else if constexpr(std::is_same_v<U, bool>) {
+        arg.type_ = RealtimeLogArg::Type::kBool;
+        arg.b_ = value;
+    } else if constexpr(std::is_enum_v<U>) {
+        arg.type_ = RealtimeLogArg::Type::kInt;
+        arg.i_ = static_cast<Int64>(value);
+    } else if constexpr(std::is_integral_v<U> && std::is_signed_v<U>) {
+        arg.type_ = RealtimeLogArg::Type::kInt;
+        arg.i_ = value;
+    } else if constexpr(std::is_integral_v<U>) {
+        arg.type_ = RealtimeLogArg::Type::kUInt;
+        arg.u_ = value;
+    } else if constexpr(std::is_floating_point_v<U>) {
+        arg.type_ = RealtimeLogArg::Type::kDouble;
+        arg.d_ = value;
+    } else if constexpr(std::is_same_v<U, wchar_t const *> || std::is_same_v<U, wchar_t *>) {
+        arg.type_ = RealtimeLogArg::Type::kString;
+        arg.s_ = value;
+    } else if constexpr(std::is_same_v<U, char const *> || std::is_same_v<U, char *>) {
+        static_assert(is_realtime_log_unsupported_arg<U>::value, "multi byte string is not allowed");
+    } else if constexpr(std::is_pointer_v<U>) {
+        arg.type_ = RealtimeLogArg::Type::kPointer;
+        arg.p_ = value;
+    } else {
+        static_assert(is_realtime_log_unsupported_arg<U>::value, "unsupported argument type for realtime logging");
+    }
+
+    return arg;
+}
+
+//! A log record pushed from realtime threads.
+struct RealtimeLogRecord
+{
+    static constexpr UInt32 kMaxArgs = 8;
+
+    wchar_t const *level_ = nullptr;    //!< must be a string literal
+    wchar_t const *format_ = nullptr;   //!< must be a string literal
+    std::chrono::system_clock::time_point time_;
+    UInt32 num_args_ = 0;
+    std::array<RealtimeLogArg, kMaxArgs> args_;
+};
+
+//! Build a message by replacing each "{}" in the format string with the next argument.
+/*! Excess "{}" are left as they are, and excess arguments are ignored.
+ */
+String FormatRealtimeLogRecord(RealtimeLogRecord const &rec);
+
+//! A logger which can be used from realtime threads such as the audio thread and MIDI threads.
+/*! Each thread which pushes records is assigned one of the rings preallocated in the constructor,
+ *  and `Push()` only copies the record into the ring. It never locks nor allocates.
+ *  A background writer thread periodically drains all rings, formats the records,
+ *  and passes them to the target Logger as a batch.
+ *  Records are dropped and counted if the ring is full or no ring is available for the thread.
+ */
+class RealtimeLogger
+:   public SingleInstance<RealtimeLogger>
+{
+public:
+    struct Options
+    {
+        //! the maximum number of threads which can push records at the same time.
+        UInt32 num_rings_ = 16;
+        //! the number of records which each ring can hold. rounded up to a power of two.
+        UInt32 ring_capacity_ = 1024;
+        //! the interval the writer thread drains the rings.
+        std::chrono::milliseconds flush_interval_ = std::chrono::milliseconds(50);
+        //! the target logger. if nullptr, the global logger is used.
+        Logger *logger_ = nullptr;
+    };
+
+    RealtimeLogger();
+    RealtimeLogger(Options const &opts);
+
+    //! Stop the writer thread if it's still running.
+    ~RealtimeLogger();
+
+    //! Start the writer thread.
+    void Start();
+
+    //! Drain all remaining records and stop the writer thread.
+    void Stop();
+
+    //! Push a record into the ring assigned to the current thread.
+    /*! @return true if the record was pushed, false if it was dropped.
+     */
+    bool Push(RealtimeLogRecord const &rec);
+
+    //! Returns the number of records dropped so far.
+    UInt64 GetNumDroppedRecords() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl_;
+};
+
+template<class... Args>
+void RealtimeLog(wchar_t const *level, wchar_t const *format, Args const &... args)
+{
+    static_assert(sizeof...(Args) <= RealtimeLogRecord::kMaxArgs, "too many arguments");
+
+    auto *logger = RealtimeLogger::GetInstance();
+    if(!logger) { return; }
+
+    RealtimeLogRecord rec;
+    rec.level_ = level;
+    rec.format_ = format;
+    rec.time_ = std::chrono::system_clock::now();
+    rec.num_args_ = sizeof...(Args);
+
+    [[maybe_unused]] UInt32 i = 0;
+    ((rec.args_[i++] = MakeRealtimeLogArg(args)), ...);
+
+    logger->Push(rec);
+}
+
+// logging macros for realtime threads.
+// the format string uses "{}" as placeholders, e.g. HWM_RT_DEBUG_LOG(L"pitch: {}", pitch);
+#define HWM_RT_LOG(level, ...) ::hwm::RealtimeLog(level, __VA_ARGS__)
+
+#define HWM_RT_ERROR_LOG(...) HWM_RT_LOG(L"Error", __VA_ARGS__)
+#define HWM_RT_WARN_LOG(...) HWM_RT_LOG(L"Warn", __VA_ARGS__)
+#define HWM_RT_INFO_LOG(...) HWM_RT_LOG(L"Info", __VA_ARGS__)
+#define HWM_RT_DEBUG_LOG(...) HWM_RT_LOG(L"Debug", __VA_ARGS__)
+
+NS_HWM_END
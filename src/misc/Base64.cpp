@@ -0,0 +1,598 @@
+#include "Base64.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define HWM_BASE64_USE_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVCでは、コンパイルオプションに関係なく拡張命令の組み込み関数を使用できる
+#define HWM_BASE64_TARGET(isa)
+#else
+// GCC/Clangでは、拡張命令を使用する関数だけを、その命令セット向けにコンパイルする
+#define HWM_BASE64_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+NS_HWM_BEGIN
+
+namespace {
+
+constexpr char kEncodeTable[] =
+"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+UInt8 const kInvalid = 0xFF;
+
+struct DecodeTable
+{
+    UInt8 values_[256];
+
+    constexpr
+    DecodeTable()
+    :   values_()
+    {
+        for(int i = 0; i < 256; ++i) { values_[i] = kInvalid; }
+        for(int i = 0; i < 64; ++i) { values_[(UInt8)kEncodeTable[i]] = (UInt8)i; }
+    }
+};
+
+constexpr DecodeTable kDecodeTable;
+
+//! begin バイト目以降の3バイト単位で変換できる範囲をエンコードする。
+/*! @return エンコードしたバイト数
+ */
+size_t EncodeScalarFrom(UInt8 const *src, size_t begin, size_t length, char *dest)
+{
+    size_t i = begin;
+    for( ; i + 3 <= length; i += 3) {
+        UInt32 const v = (src[i] << 16) | (src[i + 1] << 8) | src[i + 2];
+        auto *d = dest + i / 3 * 4;
+        d[0] = kEncodeTable[(v >> 18) & 0x3F];
+        d[1] = kEncodeTable[(v >> 12) & 0x3F];
+        d[2] = kEncodeTable[(v >> 6) & 0x3F];
+        d[3] = kEncodeTable[v & 0x3F];
+    }
+    return i;
+}
+
+//! 3バイトに満たない末尾のデータをパディング付きでエンコードする。
+void EncodeTail(UInt8 const *src, size_t length, char *dest)
+{
+    assert(length < 3);
+    if(length == 0) { return; }
+
+    UInt32 const v = (src[0] << 16) | (length == 2 ? (src[1] << 8) : 0);
+    dest[0] = kEncodeTable[(v >> 18) & 0x3F];
+    dest[1] = kEncodeTable[(v >> 12) & 0x3F];
+    dest[2] = (length == 2 ? kEncodeTable[(v >> 6) & 0x3F] : '=');
+    dest[3] = '=';
+}
+
+//! パディングを含まない4文字単位の文字列を、begin 文字目からデコードする。
+/*! @return デコードできた文字数。 length より小さい場合は、その位置の4文字に不正な文字が含まれている。
+ */
+size_t DecodeScalarFrom(UInt8 const *src, size_t begin, size_t length, char *dest)
+{
+    size_t i = begin;
+    for( ; i + 4 <= length; i += 4) {
+        UInt32 const a = kDecodeTable.values_[src[i]];
+        UInt32 const b = kDecodeTable.values_[src[i + 1]];
+        UInt32 const c = kDecodeTable.values_[src[i + 2]];
+        UInt32 const d = kDecodeTable.values_[src[i + 3]];
+        if((a | b | c | d) & 0x80) { break; }
+
+        UInt32 const v = (a << 18) | (b << 12) | (c << 6) | d;
+        auto *o = dest + i / 4 * 3;
+        o[0] = (char)(v >> 16);
+        o[1] = (char)(v >> 8);
+        o[2] = (char)v;
+    }
+    return i;
+}
+
+//! 4文字の中で最初の不正な文字の位置を返す。
+size_t FindInvalidChar(UInt8 const *src)
+{
+    for(size_t i = 0; i < 4; ++i) {
+        if(kDecodeTable.values_[src[i]] == kInvalid) { return i; }
+    }
+    assert(false && "never reach here");
+    return 0;
+}
+
+//! パディングを含む可能性のある末尾の4文字をデコードする。
+/*! @return デコードしたバイト数。不正な文字が含まれている場合は std::nullopt
+ */
+std::optional<size_t> DecodeLastQuad(UInt8 const *src, char *dest, size_t &error_pos)
+{
+    size_t num_chars = 4;
+    if(src[3] == '=') { num_chars = (src[2] == '=') ? 2 : 3; }
+
+    UInt32 v = 0;
+    for(size_t i = 0; i < num_chars; ++i) {
+        auto const x = kDecodeTable.values_[src[i]];
+        if(x == kInvalid) { error_pos = i; return std::nullopt; }
+        v |= (UInt32)x << (18 - i * 6);
+    }
+
+    size_t const num_bytes = num_chars - 1;
+    for(size_t i = 0; i < num_bytes; ++i) {
+        dest[i] = (char)(v >> (16 - i * 8));
+    }
+    return num_bytes;
+}
+
+#if defined(HWM_BASE64_USE_X86)
+
+// SIMD版の変換は、 Wojciech Muła 氏による以下の手法を元にしている。
+// http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html
+// http://0x80.pl/notesen/2016-01-17-sse-base64-decoding.html
+
+//! 12バイト（上位4バイトは無視する）を、16個の6ビットの値に分解する
+HWM_BASE64_TARGET("ssse3")
+__m128i EncodeReshuffle(__m128i in)
+{
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    __m128i const t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    __m128i const t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i const t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    __m128i const t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+//! 6ビットの値を base64 の文字に変換する
+HWM_BASE64_TARGET("ssse3")
+__m128i EncodeTranslate(__m128i in)
+{
+    __m128i const shift_lut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52,
+                                            '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                            '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                            '/' - 63, 'A', 0, 0);
+    __m128i index = _mm_subs_epu8(in, _mm_set1_epi8(51));
+    __m128i const less = _mm_cmpgt_epi8(_mm_set1_epi8(26), in);
+    index = _mm_or_si128(index, _mm_and_si128(less, _mm_set1_epi8(13)));
+    return _mm_add_epi8(in, _mm_shuffle_epi8(shift_lut, index));
+}
+
+HWM_BASE64_TARGET("ssse3")
+size_t EncodeSSSE3(UInt8 const *src, size_t length, char *dest)
+{
+    // 16バイトを読み込んで12バイトを変換する
+    size_t i = 0;
+    for( ; i + 16 <= length; i += 12) {
+        __m128i const in = _mm_loadu_si128((__m128i const *)(src + i));
+        __m128i const out = EncodeTranslate(EncodeReshuffle(in));
+        _mm_storeu_si128((__m128i *)(dest + i / 3 * 4), out);
+    }
+    return i;
+}
+
+//! 各文字を6ビットの値に変換する。
+/*! @return 不正な文字が含まれていない場合は true
+ */
+HWM_BASE64_TARGET("ssse3")
+bool DecodeTranslate(__m128i &in)
+{
+    __m128i const lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    __m128i const lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    __m128i const lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                           0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i const mask_2f = _mm_set1_epi8(0x2F);
+
+    __m128i const hi_nibbles = _mm_and_si128(_mm_srli_epi32(in, 4), mask_2f);
+    __m128i const lo_nibbles = _mm_and_si128(in, mask_2f);
+    __m128i const lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    __m128i const hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+
+    __m128i const invalid = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+    if(_mm_movemask_epi8(invalid) != 0xFFFF) { return false; }
+
+    __m128i const eq_2f = _mm_cmpeq_epi8(in, mask_2f);
+    __m128i const roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+    in = _mm_add_epi8(in, roll);
+    return true;
+}
+
+//! 16個の6ビットの値を12バイトに詰める（上位4バイトは0になる）
+HWM_BASE64_TARGET("ssse3")
+__m128i DecodeReshuffle(__m128i in)
+{
+    __m128i const merge_ab_and_bc = _mm_maddubs_epi16(in, _mm_set1_epi32(0x01400140));
+    __m128i const out = _mm_madd_epi16(merge_ab_and_bc, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(out, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                               -1, -1, -1, -1));
+}
+
+HWM_BASE64_TARGET("ssse3")
+size_t DecodeSSSE3(UInt8 const *src, size_t length, char *dest)
+{
+    // 16バイトずつ書き込むので、出力先の末尾を越えないように4文字の余裕を残す
+    size_t i = 0;
+    for( ; i + 20 <= length; i += 16) {
+        __m128i in = _mm_loadu_si128((__m128i const *)(src + i));
+        if(DecodeTranslate(in) == false) { break; }
+        _mm_storeu_si128((__m128i *)(dest + i / 4 * 3), DecodeReshuffle(in));
+    }
+    return i;
+}
+
+HWM_BASE64_TARGET("avx2")
+__m256i EncodeReshuffle256(__m256i in)
+{
+    in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                                 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    __m256i const t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    __m256i const t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    __m256i const t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    __m256i const t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    return _mm256_or_si256(t1, t3);
+}
+
+HWM_BASE64_TARGET("avx2")
+__m256i EncodeTranslate256(__m256i in)
+{
+    __m256i const shift_lut = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52,
+                                               '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                               '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                               '/' - 63, 'A', 0, 0,
+                                               'a' - 26, '0' - 52, '0' - 52, '0' - 52,
+                                               '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                               '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                               '/' - 63, 'A', 0, 0);
+    __m256i index = _mm256_subs_epu8(in, _mm256_set1_epi8(51));
+    __m256i const less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), in);
+    index = _mm256_or_si256(index, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    return _mm256_add_epi8(in, _mm256_shuffle_epi8(shift_lut, index));
+}
+
+HWM_BASE64_TARGET("avx2")
+size_t EncodeAVX2(UInt8 const *src, size_t length, char *dest)
+{
+    // 12バイトずつ各レーンに読み込んで、24バイトを変換する
+    size_t i = 0;
+    for( ; i + 28 <= length; i += 24) {
+        __m128i const lo = _mm_loadu_si128((__m128i const *)(src + i));
+        __m128i const hi = _mm_loadu_si128((__m128i const *)(src + i + 12));
+        __m256i const in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        __m256i const out = EncodeTranslate256(EncodeReshuffle256(in));
+        _mm256_storeu_si256((__m256i *)(dest + i / 3 * 4), out);
+    }
+
+    // 残りを16バイト単位で変換する
+    return i + EncodeSSSE3(src + i, length - i, dest + i / 3 * 4);
+}
+
+HWM_BASE64_TARGET("avx2")
+bool DecodeTranslate256(__m256i &in)
+{
+    __m256i const lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    __m256i const lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    __m256i const lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                              0, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 16, 19, 4, -65, -65, -71, -71,
+                                              0, 0, 0, 0, 0, 0, 0, 0);
+    __m256i const mask_2f = _mm256_set1_epi8(0x2F);
+
+    __m256i const hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask_2f);
+    __m256i const lo_nibbles = _mm256_and_si256(in, mask_2f);
+    __m256i const lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    __m256i const hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+
+    if(_mm256_testz_si256(lo, hi) == 0) { return false; }
+
+    __m256i const eq_2f = _mm256_cmpeq_epi8(in, mask_2f);
+    __m256i const roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    in = _mm256_add_epi8(in, roll);
+    return true;
+}
+
+//! 32個の6ビットの値を24バイトに詰める（上位8バイトは不定）
+HWM_BASE64_TARGET("avx2")
+__m256i DecodeReshuffle256(__m256i in)
+{
+    __m256i const merge_ab_and_bc = _mm256_maddubs_epi16(in, _mm256_set1_epi32(0x01400140));
+    __m256i out = _mm256_madd_epi16(merge_ab_and_bc, _mm256_set1_epi32(0x00011000));
+    out = _mm256_shuffle_epi8(out, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                                    -1, -1, -1, -1,
+                                                    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                                    -1, -1, -1, -1));
+    return _mm256_permutevar8x32_epi32(out, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+}
+
+HWM_BASE64_TARGET("avx2")
+size_t DecodeAVX2(UInt8 const *src, size_t length, char *dest)
+{
+    // 32バイトずつ書き込むので、出力先の末尾を越えないように12文字の余裕を残す
+    size_t i = 0;
+    for( ; i + 44 <= length; i += 32) {
+        __m256i in = _mm256_loadu_si256((__m256i const *)(src + i));
+        if(DecodeTranslate256(in) == false) { break; }
+        _mm256_storeu_si256((__m256i *)(dest + i / 4 * 3), DecodeReshuffle256(in));
+    }
+
+    // 不正な文字で中断した場合も、その位置からの特定はスカラー版に任せる
+    return i + DecodeSSSE3(src + i, length - i, dest + i / 4 * 3);
+}
+
+bool HasAVX2()
+{
+#if defined(_MSC_VER)
+    int info[4] = {};
+    __cpuid(info, 0);
+    if(info[0] < 7) { return false; }
+
+    __cpuid(info, 1);
+    bool const has_osxsave = (info[2] & (1 << 27)) != 0;
+    bool const has_avx = (info[2] & (1 << 28)) != 0;
+    if(!has_osxsave || !has_avx) { return false; }
+
+    // OSがYMMレジスタの退避に対応しているか
+    if((_xgetbv(0) & 0x6) != 0x6) { return false; }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+bool HasSSSE3()
+{
+#if defined(_MSC_VER)
+    int info[4] = {};
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+#endif
+
+} // namespace
+
+bool IsBase64ImplSupported(Base64Impl impl)
+{
+    switch(impl) {
+        case Base64Impl::kScalar:
+            return true;
+#if defined(HWM_BASE64_USE_X86)
+        case Base64Impl::kSSSE3: {
+            static bool const supported = HasSSSE3();
+            return supported;
+        }
+        case Base64Impl::kAVX2: {
+            static bool const supported = HasAVX2();
+            return supported;
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+Base64Impl GetDefaultBase64Impl()
+{
+    static Base64Impl const impl = [] {
+        if(IsBase64ImplSupported(Base64Impl::kAVX2)) { return Base64Impl::kAVX2; }
+        if(IsBase64ImplSupported(Base64Impl::kSSSE3)) { return Base64Impl::kSSSE3; }
+        return Base64Impl::kScalar;
+    }();
+
+    return impl;
+}
+
+size_t GetBase64EncodedLength(size_t length)
+{
+    return (length + 2) / 3 * 4;
+}
+
+size_t GetBase64DecodedMaxLength(size_t length)
+{
+    return length / 4 * 3;
+}
+
+void Base64Encode(char const *src, size_t length, char *dest, Base64Impl impl)
+{
+    assert(IsBase64ImplSupported(impl));
+
+    auto const *s = (UInt8 const *)src;
+    size_t i = 0;
+
+#if defined(HWM_BASE64_USE_X86)
+    switch(impl) {
+        case Base64Impl::kSSSE3: i = EncodeSSSE3(s, length, dest); break;
+        case Base64Impl::kAVX2: i = EncodeAVX2(s, length, dest); break;
+        default: break;
+    }
+#endif
+
+    i = EncodeScalarFrom(s, i, length, dest);
+    EncodeTail(s + i, length - i, dest + i / 3 * 4);
+}
+
+std::optional<size_t> Base64Decode(char const *src, size_t length, char *dest,
+                                   Base64Impl impl, size_t *error_pos)
+{
+    assert(IsBase64ImplSupported(impl));
+
+    auto const fail = [error_pos](size_t pos) -> std::optional<size_t> {
+        if(error_pos) { *error_pos = pos; }
+        return std::nullopt;
+    };
+
+    if(length == 0) { return 0; }
+    if(length % 4 != 0) { return fail(length - length % 4); }
+
+    auto const *s = (UInt8 const *)src;
+
+    // パディングを含む可能性がある末尾の4文字は、別に変換する
+    size_t const body_length = length - 4;
+    size_t i = 0;
+
+#if defined(HWM_BASE64_USE_X86)
+    switch(impl) {
+        case Base64Impl::kSSSE3: i = DecodeSSSE3(s, body_length, dest); break;
+        case Base64Impl::kAVX2: i = DecodeAVX2(s, body_length, dest); break;
+        default: break;
+    }
+#endif
+
+    i = DecodeScalarFrom(s, i, body_length, dest);
+    if(i != body_length) {
+        return fail(i + FindInvalidChar(s + i));
+    }
+
+    size_t last_error_pos = 0;
+    auto const num_last_bytes = DecodeLastQuad(s + i, dest + i / 4 * 3, last_error_pos);
+    if(!num_last_bytes) {
+        return fail(i + last_error_pos);
+    }
+
+    return i / 4 * 3 + *num_last_bytes;
+}
+
+namespace {
+
+//! ストリーミング変換で、一度に sink に書き出す文字数
+size_t const kStreamingBlockSize = 64 * 1024;
+
+} // namespace
+
+Base64Encoder::Base64Encoder(Sink sink, Base64Impl impl)
+:   sink_(std::move(sink))
+,   impl_(impl)
+{
+    buffer_.resize(kStreamingBlockSize);
+}
+
+void Base64Encoder::Write(char const *data, size_t length)
+{
+    // 前回の端数を3バイトにそろえる
+    if(num_pending_ > 0) {
+        while(num_pending_ < 3 && length > 0) {
+            pending_[num_pending_++] = *data++;
+            --length;
+        }
+
+        if(num_pending_ < 3) { return; }
+
+        Base64Encode(pending_, 3, buffer_.data(), impl_);
+        sink_(buffer_.data(), 4);
+        num_pending_ = 0;
+    }
+
+    size_t const max_block_bytes = buffer_.size() / 4 * 3;
+    while(length >= 3) {
+        size_t const block_bytes = std::min(length / 3 * 3, max_block_bytes);
+        Base64Encode(data, block_bytes, buffer_.data(), impl_);
+        sink_(buffer_.data(), block_bytes / 3 * 4);
+        data += block_bytes;
+        length -= block_bytes;
+    }
+
+    std::memcpy(pending_, data, length);
+    num_pending_ = length;
+}
+
+void Base64Encoder::Finish()
+{
+    if(num_pending_ == 0) { return; }
+
+    Base64Encode(pending_, num_pending_, buffer_.data(), impl_);
+    sink_(buffer_.data(), 4);
+    num_pending_ = 0;
+}
+
+Base64Decoder::Base64Decoder(Sink sink, Base64Impl impl)
+:   sink_(std::move(sink))
+,   impl_(impl)
+{
+    buffer_.resize(GetBase64DecodedMaxLength(kStreamingBlockSize));
+}
+
+bool Base64Decoder::DecodeBlock(char const *src, size_t length, size_t pos)
+{
+    assert(length % 4 == 0);
+
+    if(padded_) {
+        // パディングの後にはデータを置けない
+        error_pos_ = pos;
+        return false;
+    }
+
+    size_t error_pos = 0;
+    auto const num_bytes = Base64Decode(src, length, buffer_.data(), impl_, &error_pos);
+    if(!num_bytes) {
+        error_pos_ = pos + error_pos;
+        return false;
+    }
+
+    padded_ = (src[length - 1] == '=');
+    sink_(buffer_.data(), *num_bytes);
+    return true;
+}
+
+bool Base64Decoder::Write(char const *data, size_t length)
+{
+    if(error_pos_) { return false; }
+
+    size_t pos = num_consumed_ - num_pending_;
+    num_consumed_ += length;
+
+    if(num_pending_ > 0) {
+        while(num_pending_ < 4 && length > 0) {
+            pending_[num_pending_++] = *data++;
+            --length;
+        }
+
+        if(num_pending_ < 4) { return true; }
+
+        if(DecodeBlock(pending_, 4, pos) == false) { return false; }
+        pos += 4;
+        num_pending_ = 0;
+    }
+
+    while(length >= 4) {
+        size_t const block_chars = std::min(length / 4 * 4, kStreamingBlockSize);
+        if(DecodeBlock(data, block_chars, pos) == false) { return false; }
+        data += block_chars;
+        length -= block_chars;
+        pos += block_chars;
+    }
+
+    std::memcpy(pending_, data, length);
+    num_pending_ = length;
+    return true;
+}
+
+bool Base64Decoder::Finish()
+{
+    if(error_pos_) { return false; }
+
+    if(num_pending_ > 0) {
+        error_pos_ = num_consumed_ - num_pending_;
+        return false;
+    }
+
+    return true;
+}
+
+std::optional<size_t> Base64Decoder::GetErrorPosition() const
+{
+    return error_pos_;
+}
+
+NS_HWM_END
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+NS_HWM_BEGIN
+
+//! base64 の変換処理の実装の種類
+enum class Base64Impl
+{
+    kScalar,    //!< SIMD命令を使用しない実装
+    kSSSE3,     //!< 16バイト単位で変換する実装
+    kAVX2,      //!< 32バイト単位で変換する実装
+};
+
+//! 実行中のCPUで指定した実装が利用できるかどうかを返す。
+bool IsBase64ImplSupported(Base64Impl impl);
+
+//! 実行中のCPUで利用できる、最も速い実装を返す。
+/*! CPUの判定は最初の呼び出しで一度だけ行う。
+ */
+Base64Impl GetDefaultBase64Impl();
+
+//! length バイトのデータをエンコードしたときの文字数（パディングを含む）
+size_t GetBase64EncodedLength(size_t length);
+
+//! length 文字の base64 文字列をデコードしたときの最大のバイト数
+size_t GetBase64DecodedMaxLength(size_t length);
+
+//! データを base64 (RFC 4648, パディングあり) にエンコードする。
+/*! @param dest GetBase64EncodedLength(length) 文字以上の領域を持つこと
+ *  @pre impl は IsBase64ImplSupported() が true を返す実装であること
+ */
+void Base64Encode(char const *src, size_t length, char *dest,
+                  Base64Impl impl = GetDefaultBase64Impl());
+
+//! base64 文字列をデコードする。
+/*! 文字数は4の倍数で、パディングの '=' は末尾にだけ置かれていなければならない。
+ *  空白や改行も不正な文字として扱う。
+ *  @param dest GetBase64DecodedMaxLength(length) バイト以上の領域を持つこと
+ *  @param error_pos 失敗した場合に、不正な文字の位置が書き込まれる。 nullptr でもよい。
+ *  @return 成功した場合はデコードしたバイト数。失敗した場合は std::nullopt
+ */
+std::optional<size_t> Base64Decode(char const *src, size_t length, char *dest,
+                                   Base64Impl impl = GetDefaultBase64Impl(),
+                                   size_t *error_pos = nullptr);
+
+//! 分割して渡されるデータを順にエンコードして、一定の大きさごとに sink に書き出す。
+/*! エンコード結果の全体を一度にメモリ上に確保しないので、
+ *  巨大なデータをファイルに書き出すときに使用する。
+ */
+class Base64Encoder
+{
+public:
+    //! 変換結果を受け取る関数。渡される領域は呼び出しの間だけ有効。
+    using Sink = std::function<void(char const *data, size_t length)>;
+
+    explicit
+    Base64Encoder(Sink sink, Base64Impl impl = GetDefaultBase64Impl());
+
+    Base64Encoder(Base64Encoder const &) = delete;
+    Base64Encoder & operator=(Base64Encoder const &) = delete;
+
+    void Write(char const *data, size_t length);
+
+    //! 端数のデータをパディング付きで書き出す。
+    /*! この後に Write() を呼び出してはいけない。
+     */
+    void Finish();
+
+private:
+    Sink sink_;
+    Base64Impl impl_;
+    char pending_[3];
+    size_t num_pending_ = 0;
+    std::vector<char> buffer_;
+};
+
+//! 分割して渡される base64 文字列を順にデコードして、一定の大きさごとに sink に書き出す。
+/*! Base64Decode() と同じく、パディングは必須で、空白や改行は受け付けない。
+ */
+class Base64Decoder
+{
+public:
+    using Sink = std::function<void(char const *data, size_t length)>;
+
+    explicit
+    Base64Decoder(Sink sink, Base64Impl impl = GetDefaultBase64Impl());
+
+    Base64Decoder(Base64Decoder const &) = delete;
+    Base64Decoder & operator=(Base64Decoder const &) = delete;
+
+    //! 不正な文字が見つかった場合は false を返す。それ以降の書き込みは無視される。
+    bool Write(char const *data, size_t length);
+
+    //! 文字列が4文字単位で終わっていない場合や、すでに失敗している場合は false を返す。
+    bool Finish();
+
+    //! 失敗した場合は、最初の Write() から数えた不正な文字の位置を返す。
+    std::optional<size_t> GetErrorPosition() const;
+
+private:
+    Sink sink_;
+    Base64Impl impl_;
+    char pending_[4];
+    size_t num_pending_ = 0;
+    size_t num_consumed_ = 0;
+    bool padded_ = false;
+    std::optional<size_t> error_pos_;
+    std::vector<char> buffer_;
+
+    bool DecodeBlock(char const *src, size_t length, size_t pos);
+};
+
+NS_HWM_END
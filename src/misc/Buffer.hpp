@@ -127,7 +127,7 @@ public:
         return data()[channel_index + channel_from_] + sample_from_;
     }
     
-    std::add_const<T> * get_channel_data(UInt32 channel_index) const {
+    std::add_const_t<T> * get_channel_data(UInt32 channel_index) const {
         assert(channel_index < num_channels_);
         return data()[channel_index + channel_from_] + sample_from_;
     }
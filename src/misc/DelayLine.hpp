@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+
+#include "./Buffer.hpp"
+
+NS_HWM_BEGIN
+
+//! オーディオ信号を一定のサンプル数だけ遅らせる、マルチチャンネルのディレイライン
+/*! プラグインのレイテンシーに合わせて、並列の経路やドライ信号を遅らせるために使う。
+ *  バッファは Reset() でだけ確保し、 Process() / ProcessAdd() ではメモリの確保もロックも行わない。
+ */
+template<class T>
+class DelayLine
+{
+public:
+    DelayLine()
+    {}
+
+    DelayLine(UInt32 num_channels, SampleCount delay)
+    {
+        Reset(num_channels, delay);
+    }
+
+    //! チャンネル数と遅延時間を変更する。遅延中の信号は無音にリセットされる。
+    /*! メモリを確保するので、オーディオスレッドから呼び出してはいけない。
+     */
+    void Reset(UInt32 num_channels, SampleCount delay)
+    {
+        assert(delay >= 0);
+        ring_.resize(num_channels, (UInt32)delay);
+        pos_ = 0;
+    }
+
+    UInt32 GetNumChannels() const { return ring_.channels(); }
+    SampleCount GetDelay() const { return ring_.samples(); }
+
+    //! 遅延中の信号を無音にする。メモリの確保は行わない。
+    void Clear()
+    {
+        ring_.fill(0);
+        pos_ = 0;
+    }
+
+    //! src を遅らせて dest に書き込む。
+    /*! src と dest は同じバッファを指していてもよい。
+     *  @pre src と dest のチャンネル数とサンプル数が同じで、チャンネル数が GetNumChannels() 以下であること
+     */
+    void Process(BufferRef<T const> src, BufferRef<T> dest)
+    {
+        // 遅延がなく src と dest が同じバッファを指すチャンネルは、コピーしなくてよい
+        ProcessImpl(src, dest, [](T &d, T s) { d = s; }, true);
+    }
+
+    //! src を遅らせて dest に加算する。
+    /*! src と dest は同じバッファを指していてもよい。その場合、遅延が0であれば信号は2倍になる。
+     *  @pre src と dest のチャンネル数とサンプル数が同じで、チャンネル数が GetNumChannels() 以下であること
+     */
+    void ProcessAdd(BufferRef<T const> src, BufferRef<T> dest)
+    {
+        ProcessImpl(src, dest, [](T &d, T s) { d += s; }, false);
+    }
+
+private:
+    Buffer<T> ring_;
+    UInt32 pos_ = 0;
+
+    //! @param skip_aliased_channels 遅延が0のときに、 src と dest が同じチャンネルを処理しない
+    template<class Op>
+    void ProcessImpl(BufferRef<T const> src, BufferRef<T> dest, Op op, bool skip_aliased_channels)
+    {
+        assert(src.channels() == dest.channels());
+        assert(src.samples() == dest.samples());
+
+        auto const num_channels = src.channels();
+        auto const length = src.samples();
+        auto const delay = ring_.samples();
+
+        if(delay == 0) {
+            for(UInt32 ch = 0; ch < num_channels; ++ch) {
+                auto const s = src.get_channel_data(ch);
+                auto d = dest.get_channel_data(ch);
+                if(skip_aliased_channels && s == d) { continue; }
+                for(UInt32 i = 0; i < length; ++i) { op(d[i], s[i]); }
+            }
+            return;
+        }
+
+        assert(num_channels <= ring_.channels());
+
+        UInt32 pos = pos_;
+        for(UInt32 ch = 0; ch < num_channels; ++ch) {
+            auto const s = src.get_channel_data(ch);
+            auto d = dest.get_channel_data(ch);
+            auto r = ring_.data()[ch];
+
+            // リングバッファの終端で分割して、連続した区間ごとに処理する
+            pos = pos_;
+            for(UInt32 done = 0; done < length; ) {
+                auto const n = std::min<UInt32>(length - done, delay - pos);
+                for(UInt32 i = 0; i < n; ++i) {
+                    // s と d が同じ場合のために、先に入力を読み出しておく
+                    auto const x = s[done + i];
+                    op(d[done + i], r[pos + i]);
+                    r[pos + i] = x;
+                }
+                done += n;
+                pos = (pos + n == delay ? 0 : pos + n);
+            }
+        }
+
+        if(num_channels == 0) {
+            pos = (UInt32)((pos_ + length) % delay);
+        }
+        pos_ = pos;
+    }
+};
+
+NS_HWM_END
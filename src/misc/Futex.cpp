@@ -0,0 +1,114 @@
+#include "Futex.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#elif defined(__linux__)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+// libc++ の std::atomic::wait() と同じく、 libsystem_kernel の __ulock_wait を使用する
+extern "C" int __ulock_wait(uint32_t operation, void *addr, uint64_t value, uint32_t timeout_usec);
+extern "C" int __ulock_wake(uint32_t operation, void *addr, uint64_t wake_value);
+#define HWM_UL_COMPARE_AND_WAIT 1
+#define HWM_UL_COMPARE_AND_WAIT_SHARED 3
+#define HWM_ULF_WAKE_ALL 0x00000100
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HWM_FUTEX_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+NS_HWM_BEGIN
+
+static_assert(sizeof(std::atomic<UInt32>) == sizeof(UInt32),
+              "std::atomic<UInt32> must have the same layout as UInt32 to be passed to the os");
+
+void FutexWait(std::atomic<UInt32> &word, UInt32 expected)
+{
+#if defined(_MSC_VER)
+    WaitOnAddress(&word, &expected, sizeof(expected), INFINITE);
+#elif defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<UInt32 *>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#elif defined(__APPLE__)
+    __ulock_wait(HWM_UL_COMPARE_AND_WAIT, &word, expected, 0);
+#else
+    // 休止の仕組みがない環境では、値が変わるまで他のスレッドに処理を譲り続ける
+    while(word.load() == expected) {
+        std::this_thread::yield();
+    }
+#endif
+}
+
+void FutexWakeAll(std::atomic<UInt32> &word)
+{
+#if defined(_MSC_VER)
+    WakeByAddressAll(&word);
+#elif defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<UInt32 *>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#elif defined(__APPLE__)
+    __ulock_wake(HWM_UL_COMPARE_AND_WAIT | HWM_ULF_WAKE_ALL, &word, 0);
+#else
+    (void)word;
+#endif
+}
+
+#if !defined(_MSC_VER)
+
+bool FutexWaitShared(std::atomic<UInt32> &word, UInt32 expected, std::chrono::microseconds timeout)
+{
+    if(word.load() != expected) { return true; }
+    
+#if defined(__linux__)
+    auto const usec = std::max<Int64>(timeout.count(), 0);
+    timespec ts;
+    ts.tv_sec = usec / 1000000;
+    ts.tv_nsec = (usec % 1000000) * 1000;
+    auto const result = syscall(SYS_futex, reinterpret_cast<UInt32 *>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+    return !(result == -1 && errno == ETIMEDOUT);
+#elif defined(__APPLE__)
+    // timeout_usec に0を指定すると無期限に待機するので、最小でも1マイクロ秒にする
+    auto const usec = (uint32_t)std::clamp<Int64>(timeout.count(), 1, UINT32_MAX);
+    auto const result = __ulock_wait(HWM_UL_COMPARE_AND_WAIT_SHARED, &word, expected, usec);
+    return !(result == -1 && errno == ETIMEDOUT);
+#else
+    auto const deadline = std::chrono::steady_clock::now() + timeout;
+    while(word.load() == expected) {
+        if(std::chrono::steady_clock::now() >= deadline) { return false; }
+        std::this_thread::yield();
+    }
+    return true;
+#endif
+}
+
+void FutexWakeAllShared(std::atomic<UInt32> &word)
+{
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<UInt32 *>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#elif defined(__APPLE__)
+    __ulock_wake(HWM_UL_COMPARE_AND_WAIT_SHARED | HWM_ULF_WAKE_ALL, &word, 0);
+#else
+    (void)word;
+#endif
+}
+
+#endif
+
+void CpuRelax()
+{
+#if defined(HWM_FUTEX_USE_SSE2)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+NS_HWM_END
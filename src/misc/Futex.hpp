@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+NS_HWM_BEGIN
+
+//! 32bitのアトミック変数の値が変わるまで、スレッドを休止させるための関数群
+/*! Linuxではfutex、WindowsではWaitOnAddress、macOSでは__ulock_waitを使用する。
+ *  条件変数と違って、起こす側はロックを取らないので、リアルタイムスレッドから FutexWakeAll() を呼び出せる。
+ */
+
+//! word の値が expected と等しい間、スレッドを休止する。
+/*! 値の比較と休止はアトミックに行われるので、比較の直後に FutexWakeAll() が呼ばれても起床を取りこぼさない。
+ *  spurious wakeup が起こりうるので、呼び出し側で値を確認し直すこと。
+ */
+void FutexWait(std::atomic<UInt32> &word, UInt32 expected);
+
+//! word で休止しているすべてのスレッドを起こす。
+void FutexWakeAll(std::atomic<UInt32> &word);
+
+#if !defined(_MSC_VER)
+
+//! 共有メモリ上の word の値が expected と等しい間、スレッドを休止する。
+/*! FutexWait() と同じだが、別のプロセスの FutexWakeAllShared() で起こされる。
+ *  WindowsのWaitOnAddressはプロセスをまたいで使えないので、Windowsでは提供しない。
+ *  @return timeout までに値が変わったか起こされた場合はtrue、タイムアウトした場合はfalse
+ */
+bool FutexWaitShared(std::atomic<UInt32> &word, UInt32 expected, std::chrono::microseconds timeout);
+
+//! 共有メモリ上の word で休止している、すべてのプロセスのスレッドを起こす。
+void FutexWakeAllShared(std::atomic<UInt32> &word);
+
+#endif
+
+//! スピンウェイトのループ内で呼び出して、CPUに待機中であることを知らせる。
+void CpuRelax();
+
+NS_HWM_END
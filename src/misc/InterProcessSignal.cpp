@@ -0,0 +1,108 @@
+#include "InterProcessSignal.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+#include "./Futex.hpp"
+#include "./StrCnv.hpp"
+
+NS_HWM_BEGIN
+
+class InterProcessSignal::Impl
+{
+public:
+    Impl(std::atomic<UInt32> &counter)
+    :   counter_(counter)
+    {}
+
+    std::atomic<UInt32> &counter_;
+#if defined(_MSC_VER)
+    HANDLE event_ = nullptr;
+#endif
+};
+
+InterProcessSignal::InterProcessSignal(std::atomic<UInt32> &counter, String const &name, bool create)
+:   pimpl_(std::make_unique<Impl>(counter))
+{
+#if defined(_MSC_VER)
+    auto const os_name = L"Local\\" + name;
+    if(create) {
+        pimpl_->event_ = CreateEventW(nullptr, FALSE, FALSE, os_name.c_str());
+    } else {
+        pimpl_->event_ = OpenEventW(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, os_name.c_str());
+    }
+
+    if(pimpl_->event_ == nullptr) {
+        throw std::runtime_error("failed to " + std::string(create ? "create" : "open")
+                                 + " the event [" + to_utf8(name) + "]: error code "
+                                 + std::to_string(GetLastError()));
+    }
+#else
+    (void)name;
+    (void)create;
+#endif
+}
+
+InterProcessSignal::~InterProcessSignal()
+{
+#if defined(_MSC_VER)
+    CloseHandle(pimpl_->event_);
+#endif
+}
+
+void InterProcessSignal::Notify()
+{
+    pimpl_->counter_.fetch_add(1);
+#if defined(_MSC_VER)
+    SetEvent(pimpl_->event_);
+#else
+    FutexWakeAllShared(pimpl_->counter_);
+#endif
+}
+
+UInt32 InterProcessSignal::GetCount() const
+{
+    return pimpl_->counter_.load();
+}
+
+bool InterProcessSignal::Wait(UInt32 last_count,
+                              std::chrono::microseconds timeout,
+                              std::chrono::microseconds spin)
+{
+    using namespace std::chrono;
+
+    auto &counter = pimpl_->counter_;
+    auto const start = steady_clock::now();
+    auto const spin_end = start + std::min(spin, timeout);
+    auto const deadline = start + timeout;
+
+    while(counter.load() == last_count) {
+        if(steady_clock::now() >= spin_end) { break; }
+        CpuRelax();
+    }
+
+    // 休止しているあいだに通知された場合も取りこぼさないように、
+    // 起こされるたびにカウンターを確認し直す
+    while(counter.load() == last_count) {
+        auto const now = steady_clock::now();
+        if(now >= deadline) { return false; }
+        auto const remaining = duration_cast<microseconds>(deadline - now);
+
+#if defined(_MSC_VER)
+        // イベントには以前の通知が残っている場合があるので、起こされてもカウンターを確認し直す
+        auto const msec = (DWORD)std::max<Int64>(1, (remaining.count() + 999) / 1000);
+        WaitForSingleObject(pimpl_->event_, msec);
+#else
+        FutexWaitShared(counter, last_count, remaining);
+#endif
+    }
+
+    return true;
+}
+
+NS_HWM_END
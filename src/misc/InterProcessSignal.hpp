@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+NS_HWM_BEGIN
+
+//! 共有メモリ上のカウンターを使って、別のプロセスのスレッドに通知を送るクラス
+/*! Notify() でカウンターを進め、 Wait() ではカウンターが進むまで待機する。
+ *  待機側は、はじめに少しだけスピンしてから、futex (macOSでは__ulock_wait) で休止する。
+ *  Windowsではプロセスをまたいだ WaitOnAddress が使えないので、名前付きのイベントオブジェクトで休止する。
+ *
+ *  Notify() はメモリの確保もロックも行わないので、オーディオスレッドから呼び出せる。
+ */
+class InterProcessSignal final
+{
+public:
+    //! @param counter 共有メモリ上に配置したカウンター。このオブジェクトより長く生存していること。
+    //! @param name 通知の名前。Windowsのイベントオブジェクトの名前に使う。
+    //! @param create 通知を作成する側ではtrue、作成済みの通知を開く側ではfalse
+    //! @exception std::runtime_error イベントオブジェクトの作成に失敗した場合
+    InterProcessSignal(std::atomic<UInt32> &counter, String const &name, bool create);
+    ~InterProcessSignal();
+
+    InterProcessSignal(InterProcessSignal const &) = delete;
+    InterProcessSignal & operator=(InterProcessSignal const &) = delete;
+
+    //! カウンターを進めて、待機しているスレッドを起こす。
+    void Notify();
+
+    //! 現在のカウンターの値
+    UInt32 GetCount() const;
+
+    //! カウンターが last_count から進むまで待機する。
+    /*! @param spin 休止する前にスピンして待つ時間。ブロックサイズ程度の短い間隔で通知を待つときに、休止と起床のコストを避ける。
+     *  @return timeout までにカウンターが進んだ場合はtrue
+     */
+    bool Wait(UInt32 last_count,
+              std::chrono::microseconds timeout,
+              std::chrono::microseconds spin = std::chrono::microseconds(20));
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl_;
+};
+
+NS_HWM_END
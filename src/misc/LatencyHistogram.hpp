@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cmath>
+
+NS_HWM_BEGIN
+
+//! 処理時間などの値の分布を記録するヒストグラム
+/*! Record() はロックもメモリの確保も行わないので、リアルタイムスレッドから呼び出せる。
+ *  また、Record() の実行中に別スレッドから GetSummary() などで分布を読み出せる。
+ *
+ *  値は、2のべき乗ごとの区間をさらに8つに分割したバケットに記録する。
+ *  そのため、パーセンタイル値の相対誤差は最大で12.5%程度になる。
+ *  値の単位は利用側で決める。（AudioDeviceManagerなどではマイクロ秒）
+ */
+class LatencyHistogram
+{
+public:
+    //! 分布の要約
+    struct Summary
+    {
+        UInt64 count_ = 0;  //!< 記録した値の数
+        UInt64 p50_ = 0;    //!< 中央値
+        UInt64 p99_ = 0;    //!< 99パーセンタイル値
+        UInt64 max_ = 0;    //!< 最大値
+        double mean_ = 0;   //!< 平均値
+    };
+
+    LatencyHistogram()
+    {
+        Reset();
+    }
+
+    LatencyHistogram(LatencyHistogram const &) = delete;
+    LatencyHistogram & operator=(LatencyHistogram const &) = delete;
+
+    //! 値を記録する。
+    void Record(UInt64 value)
+    {
+        buckets_[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+
+        auto cur_max = max_.load(std::memory_order_relaxed);
+        while(cur_max < value && !max_.compare_exchange_weak(cur_max, value, std::memory_order_relaxed)) {}
+    }
+
+    //! 記録した値をすべて破棄する。
+    /*! Record() と同時に呼び出した場合、その値が残ることがある。
+     */
+    void Reset()
+    {
+        for(auto &b: buckets_) { b.store(0, std::memory_order_relaxed); }
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    UInt64 GetCount() const { return count_.load(std::memory_order_relaxed); }
+    UInt64 GetMax() const { return max_.load(std::memory_order_relaxed); }
+
+    //! 指定した割合の値がそれ以下に収まる値を返す。
+    /*! @param ratio 0.0 〜 1.0 (0.99なら99パーセンタイル)
+     *  @return その値が含まれるバケットの上限値。（ただし最大値を超えない）
+     *  ひとつも値が記録されていない場合は0を返す。
+     */
+    UInt64 GetPercentile(double ratio) const
+    {
+        std::array<UInt64, kNumBuckets> counts;
+        UInt64 total = 0;
+        for(size_t i = 0; i < kNumBuckets; ++i) {
+            counts[i] = buckets_[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+
+        return GetPercentile(counts, total, ratio);
+    }
+
+    Summary GetSummary() const
+    {
+        std::array<UInt64, kNumBuckets> counts;
+        UInt64 total = 0;
+        for(size_t i = 0; i < kNumBuckets; ++i) {
+            counts[i] = buckets_[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+
+        Summary s;
+        s.count_ = total;
+        s.p50_ = GetPercentile(counts, total, 0.5);
+        s.p99_ = GetPercentile(counts, total, 0.99);
+        s.max_ = GetMax();
+        if(total > 0) {
+            s.mean_ = sum_.load(std::memory_order_relaxed) / (double)total;
+        }
+
+        return s;
+    }
+
+private:
+    static constexpr UInt32 kSubBucketBits = 3;
+    static constexpr UInt32 kNumSubBuckets = 1 << kSubBucketBits;
+    static constexpr size_t kNumBuckets = kNumSubBuckets * (64 - kSubBucketBits + 1);
+
+    std::array<std::atomic<UInt64>, kNumBuckets> buckets_;
+    std::atomic<UInt64> count_;
+    std::atomic<UInt64> sum_;
+    std::atomic<UInt64> max_;
+
+    static
+    size_t GetBucketIndex(UInt64 value)
+    {
+        if(value < kNumSubBuckets) { return (size_t)value; }
+
+        UInt32 msb = 0;
+        for(auto v = value; v > 1; v >>= 1) { ++msb; }
+
+        UInt32 const shift = msb - kSubBucketBits;
+        return (shift + 1) * kNumSubBuckets + ((value >> shift) & (kNumSubBuckets - 1));
+    }
+
+    //! バケットに含まれる最大の値
+    static
+    UInt64 GetBucketUpperBound(size_t index)
+    {
+        if(index < kNumSubBuckets) { return index; }
+
+        UInt32 const shift = (UInt32)(index / kNumSubBuckets) - 1;
+        UInt64 const sub = index % kNumSubBuckets;
+        UInt64 const lower = (kNumSubBuckets + sub) << shift;
+        return lower + ((UInt64(1) << shift) - 1);
+    }
+
+    UInt64 GetPercentile(std::array<UInt64, kNumBuckets> const &counts, UInt64 total, double ratio) const
+    {
+        if(total == 0) { return 0; }
+
+        auto const target = std::max<UInt64>(1, (UInt64)std::ceil(total * ratio));
+        UInt64 sum = 0;
+        for(size_t i = 0; i < kNumBuckets; ++i) {
+            sum += counts[i];
+            if(sum >= target) {
+                return std::min(GetBucketUpperBound(i), GetMax());
+            }
+        }
+
+        return GetMax();
+    }
+};
+
+NS_HWM_END
@@ -0,0 +1,117 @@
+#include "LevelMeter.hpp"
+#include "MathUtil.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HWM_LEVEL_METER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+NS_HWM_BEGIN
+
+SampleStatistics GetSampleStatistics(float const *data, SampleCount length)
+{
+    SampleStatistics st;
+    SampleCount i = 0;
+
+#if defined(HWM_LEVEL_METER_USE_SSE2)
+    __m128 const abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 const one = _mm_set1_ps(1.0f);
+    __m128 peak = _mm_setzero_ps();
+    __m128 sum = _mm_setzero_ps();
+    __m128i clipped = _mm_setzero_si128();
+
+    for( ; i + 4 <= length; i += 4) {
+        __m128 const x = _mm_loadu_ps(data + i);
+        __m128 const a = _mm_and_ps(x, abs_mask);
+        peak = _mm_max_ps(peak, a);
+        sum = _mm_add_ps(sum, _mm_mul_ps(x, x));
+        // 比較結果は真のレーンが-1になるので、引くとクリップしたサンプル数が加算される
+        clipped = _mm_sub_epi32(clipped, _mm_castps_si128(_mm_cmpge_ps(a, one)));
+    }
+
+    alignas(16) float peaks[4];
+    alignas(16) float sums[4];
+    alignas(16) Int32 clips[4];
+    _mm_store_ps(peaks, peak);
+    _mm_store_ps(sums, sum);
+    _mm_store_si128(reinterpret_cast<__m128i *>(clips), clipped);
+
+    for(int n = 0; n < 4; ++n) {
+        st.peak_ = std::max(st.peak_, peaks[n]);
+        st.sum_of_squares_ += sums[n];
+        st.num_clipped_ += clips[n];
+    }
+#endif
+
+    for( ; i < length; ++i) {
+        float const a = std::fabs(data[i]);
+        st.peak_ = std::max(st.peak_, a);
+        st.sum_of_squares_ += data[i] * data[i];
+        st.num_clipped_ += (a >= 1.0f ? 1 : 0);
+    }
+
+    return st;
+}
+
+LevelMeter::LevelMeter(double min_db, double release_speed, double peak_hold_seconds)
+:   min_db_(min_db)
+,   release_speed_(release_speed)
+,   peak_hold_seconds_(peak_hold_seconds)
+{}
+
+void LevelMeter::Reset(UInt32 num_channels, double sample_rate)
+{
+    assert(sample_rate > 0);
+    sample_rate_ = sample_rate;
+
+    LevelMeterValue init;
+    init.peak_db_ = min_db_;
+    init.rms_db_ = min_db_;
+    init.peak_hold_db_ = min_db_;
+
+    values_.assign(num_channels, init);
+    peak_hold_remaining_.assign(num_channels, 0);
+}
+
+void LevelMeter::Process(float const * const * data, UInt32 num_channels, SampleCount length)
+{
+    assert(num_channels == GetNumChannels());
+    if(length <= 0) { return; }
+
+    double const block_seconds = length / sample_rate_;
+    double const release = release_speed_ * block_seconds;
+
+    for(UInt32 ch = 0; ch < num_channels; ++ch) {
+        auto const st = GetSampleStatistics(data[ch], length);
+        auto &v = values_[ch];
+
+        auto const peak_db = LinearToDB(st.peak_);
+        auto const rms_db = LinearToDB(std::sqrt(st.sum_of_squares_ / length));
+
+        v.peak_db_ = std::max(peak_db, std::max(v.peak_db_ - release, min_db_));
+        v.rms_db_ = std::max(rms_db, std::max(v.rms_db_ - release, min_db_));
+        v.clip_count_ += st.num_clipped_;
+
+        auto &remaining = peak_hold_remaining_[ch];
+        if(peak_db >= v.peak_hold_db_) {
+            v.peak_hold_db_ = peak_db;
+            remaining = peak_hold_seconds_;
+        } else if(remaining > 0) {
+            remaining -= block_seconds;
+        } else {
+            v.peak_hold_db_ = std::max(v.peak_hold_db_ - release, v.peak_db_);
+        }
+    }
+}
+
+UInt32 LevelMeter::GetNumChannels() const
+{
+    return (UInt32)values_.size();
+}
+
+std::vector<LevelMeterValue> const & LevelMeter::GetValues() const
+{
+    return values_;
+}
+
+NS_HWM_END
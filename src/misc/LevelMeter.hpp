@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+
+NS_HWM_BEGIN
+
+//! オーディオデータのブロックごとの統計情報
+struct SampleStatistics
+{
+    float peak_ = 0;            //!< 絶対値の最大値
+    double sum_of_squares_ = 0; //!< 二乗和
+    UInt32 num_clipped_ = 0;    //!< 絶対値が1.0以上のサンプル数
+};
+
+//! オーディオデータの統計情報を計算する。
+/*! SSE2が利用できる環境では、4サンプルずつまとめて計算する。
+ */
+SampleStatistics GetSampleStatistics(float const *data, SampleCount length);
+
+//! レベルメーターの値
+struct LevelMeterValue
+{
+    double peak_db_ = -640;      //!< ピークレベル(dB値)
+    double rms_db_ = -640;       //!< RMSレベル(dB値)
+    double peak_hold_db_ = -640; //!< 一定時間保持されたピークレベル(dB値)
+    UInt32 clip_count_ = 0;      //!< Reset()以降にクリップしたサンプル数
+};
+
+//! オーディオデータからチャンネルごとのレベルメーターの値を計算するクラス
+/*! Process()はリアルタイムスレッドから呼び出せる。
+ *  (メモリの確保は Reset() でのみ行う)
+ */
+class LevelMeter
+{
+public:
+    /*! @param min_db レベルメーターの最小値(dB値)
+     *  @param release_speed 1秒あたりにレベルが下がる量(dB値)
+     *  @param peak_hold_seconds ピークレベルを保持する時間
+     */
+    LevelMeter(double min_db = -48.0,
+               double release_speed = 24.0,
+               double peak_hold_seconds = 1.0);
+
+    //! チャンネル数とサンプリングレートを設定し、すべての値を初期状態に戻す。
+    void Reset(UInt32 num_channels, double sample_rate);
+
+    //! オーディオデータのブロックを処理して、レベルメーターの値を更新する。
+    /*! @pre num_channels == GetNumChannels()
+     */
+    void Process(float const * const * data, UInt32 num_channels, SampleCount length);
+
+    UInt32 GetNumChannels() const;
+    std::vector<LevelMeterValue> const & GetValues() const;
+
+private:
+    double min_db_;
+    double release_speed_;
+    double peak_hold_seconds_;
+    double sample_rate_ = 44100.0;
+    std::vector<LevelMeterValue> values_;
+    std::vector<double> peak_hold_remaining_; //!< ピークレベルの保持を終えるまでの秒数
+};
+
+NS_HWM_END
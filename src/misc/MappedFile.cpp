@@ -0,0 +1,132 @@
+#include "MappedFile.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "StrCnv.hpp"
+
+NS_HWM_BEGIN
+
+namespace {
+
+#if defined(_MSC_VER)
+std::string GetLastErrorString()
+{
+    return "error code " + std::to_string(GetLastError());
+}
+#else
+std::string GetLastErrorString()
+{
+    return strerror(errno);
+}
+#endif
+
+} // namespace
+
+class MappedFile::Impl
+{
+public:
+    String path_;
+    char const *data_ = nullptr;
+    size_t size_ = 0;
+#if defined(_MSC_VER)
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+
+    ~Impl()
+    {
+#if defined(_MSC_VER)
+        if(data_) { UnmapViewOfFile(data_); }
+        if(mapping_) { CloseHandle(mapping_); }
+        if(file_ != INVALID_HANDLE_VALUE) { CloseHandle(file_); }
+#else
+        if(data_) { munmap((void *)data_, size_); }
+        if(fd_ != -1) { close(fd_); }
+#endif
+    }
+
+    void Map()
+    {
+        auto fail = [&](std::string const &what) {
+            throw std::runtime_error("failed to " + what + " the file [" + to_utf8(path_) + "]: "
+                                     + GetLastErrorString());
+        };
+
+#if defined(_MSC_VER)
+        // マップしている間も、同じパスへの保存（AtomicFileWriter による置き換え）や削除ができるようにする
+        file_ = CreateFileW(path_.c_str(), GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file_ == INVALID_HANDLE_VALUE) { fail("open"); }
+
+        LARGE_INTEGER size;
+        if(!GetFileSizeEx(file_, &size)) { fail("inspect"); }
+        size_ = (size_t)size.QuadPart;
+
+        // 空のファイルはマップできないので、空の領域として扱う
+        if(size_ == 0) { return; }
+
+        mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(!mapping_) { fail("map"); }
+
+        data_ = (char const *)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if(!data_) { fail("map"); }
+#else
+        fd_ = open(to_utf8(path_).c_str(), O_RDONLY);
+        if(fd_ == -1) { fail("open"); }
+
+        struct stat st;
+        if(fstat(fd_, &st) == -1) { fail("inspect"); }
+        size_ = (size_t)st.st_size;
+
+        // 空のファイルはマップできないので、空の領域として扱う
+        if(size_ == 0) { return; }
+
+        auto p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if(p == MAP_FAILED) { fail("map"); }
+        data_ = (char const *)p;
+#endif
+    }
+};
+
+MappedFile::MappedFile(std::unique_ptr<Impl> pimpl)
+:   pimpl_(std::move(pimpl))
+{}
+
+MappedFile::~MappedFile()
+{}
+
+std::unique_ptr<MappedFile> MappedFile::Open(String const &path)
+{
+    auto impl = std::make_unique<Impl>();
+    impl->path_ = path;
+    impl->Map();
+    return std::unique_ptr<MappedFile>(new MappedFile(std::move(impl)));
+}
+
+ArrayRef<char const> MappedFile::GetData() const
+{
+    if(!pimpl_->data_) { return ArrayRef<char const>(); }
+    return ArrayRef<char const>(pimpl_->data_, pimpl_->data_ + pimpl_->size_);
+}
+
+String const & MappedFile::GetPath() const
+{
+    return pimpl_->path_;
+}
+
+NS_HWM_END
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+
+#include "ArrayRef.hpp"
+
+NS_HWM_BEGIN
+
+//! ファイルを読み込み専用でメモリにマップするクラス
+/*! ファイルの内容はアクセスしたときにOSがページ単位で読み込むので、
+ *  大きなファイルでも開くだけならすぐに完了する。
+ */
+class MappedFile final
+{
+public:
+    //! ファイルを開いてマップする。
+    /*! @exception std::runtime_error
+     */
+    static std::unique_ptr<MappedFile> Open(String const &path);
+
+    ~MappedFile();
+
+    MappedFile(MappedFile const &) = delete;
+    MappedFile & operator=(MappedFile const &) = delete;
+
+    //! マップした領域。空のファイルの場合は空の ArrayRef を返す
+    ArrayRef<char const> GetData() const;
+    String const & GetPath() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl_;
+
+    MappedFile(std::unique_ptr<Impl> pimpl);
+};
+
+NS_HWM_END
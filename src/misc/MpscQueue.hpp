@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+NS_HWM_BEGIN
+
+//! 複数のスレッドからデータを追加し、ひとつのスレッドからデータを取り出す、固定容量のキュー
+/*! 内部バッファはコンストラクタで確保し、それ以降はメモリの確保もロックも行わない。
+ *  そのため、リアルタイムスレッドからもTryPush()/TryPop()を呼び出せる。
+ *
+ *  各要素にシーケンス番号を持たせ、書き込み位置だけをCASで奪い合う方式
+ *  (Dmitry Vyukov の Bounded MPMC queue) を、取り出し側をひとつのスレッドに限定して単純化したもの。
+ *
+ *  @tparam T デフォルト構築可能かつコピー代入可能な型
+ */
+template<class T>
+class MpscQueue final
+{
+public:
+    using value_type = T;
+
+    //! @param capacity 容量。2のべき乗に切り上げられる。
+    explicit
+    MpscQueue(UInt32 capacity)
+    {
+        assert(capacity > 0);
+
+        UInt32 size = 1;
+        while(size < capacity) { size <<= 1; }
+
+        cells_ = std::make_unique<Cell[]>(size);
+        for(UInt32 i = 0; i < size; ++i) {
+            cells_[i].sequence_.store(i, std::memory_order_relaxed);
+        }
+        mask_ = size - 1;
+    }
+
+    MpscQueue(MpscQueue const &) = delete;
+    MpscQueue & operator=(MpscQueue const &) = delete;
+
+    //! 全体の容量を返す
+    UInt32 GetCapacity() const { return (UInt32)(mask_ + 1); }
+
+    //! [書き込み側] データを追加する。
+    /*! 複数のスレッドから同時に呼び出せる。
+     *  キューが満杯の場合は、データを追加せずにfalseを返す。
+     */
+    bool TryPush(T const &value)
+    {
+        auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell *cell = nullptr;
+
+        for( ; ; ) {
+            cell = &cells_[pos & mask_];
+            auto const seq = cell->sequence_.load(std::memory_order_acquire);
+            auto const diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+
+            if(diff == 0) {
+                // この位置が空いているので、書き込み位置を確保する
+                if(enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                // 取り出し側がまだこの位置を読み終わっていない。つまり満杯。
+                num_overflows_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                // 他の書き込み側に先を越されたので、最新の書き込み位置からやり直す
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value_ = value;
+        cell->sequence_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! [読み込み側] データを取り出す。
+    /*! ひとつのスレッドからのみ呼び出せる。
+     *  取り出せるデータがない場合はfalseを返す。
+     */
+    bool TryPop(T &value)
+    {
+        auto &cell = cells_[dequeue_pos_ & mask_];
+        auto const seq = cell.sequence_.load(std::memory_order_acquire);
+        if((std::ptrdiff_t)seq - (std::ptrdiff_t)(dequeue_pos_ + 1) < 0) {
+            return false;
+        }
+
+        value = cell.value_;
+        cell.sequence_.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+        ++dequeue_pos_;
+        return true;
+    }
+
+    //! キューが満杯でTryPush()が失敗した回数を返す
+    UInt64 GetNumOverflows() const
+    {
+        return num_overflows_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence_ = { 0 };
+        T value_ = {};
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+
+    // 書き込み側と読み込み側が別々のキャッシュラインを使うようにする
+    alignas(64) std::atomic<size_t> enqueue_pos_ = { 0 };
+    alignas(64) size_t dequeue_pos_ = 0;
+    std::atomic<UInt64> num_overflows_ = { 0 };
+};
+
+NS_HWM_END
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include "./LockFactory.hpp"
+
+NS_HWM_BEGIN
+
+//! 非リアルタイムスレッドから値を差し替え、リアルタイムスレッドからはブロックせずに値を参照するためのクラス
+/*! RCU (Read-Copy-Update) 方式で値を公開する。
+ *  読み込み側は Read() で値を参照する。この操作はロックも待機も行わない。
+ *  書き込み側は Exchange() で値を差し替える。Exchange() は、差し替え前の値を参照している
+ *  読み込み側がいなくなるまで待機してから、古い値を返す。
+ *  そのため古い値の解放は、読み込み側のスレッドではなく、常に書き込み側のスレッドで行われる。
+ *
+ *  @note 読み込み側のスレッドは同時にひとつだけであることを想定している。
+ *  書き込み側は複数のスレッドから呼び出せる。（書き込み側同士は内部でロックする）
+ */
+template<class T>
+class RcuPointer final
+{
+public:
+    using EpochType = UInt64;
+    
+    RcuPointer()
+    {}
+    
+    RcuPointer(RcuPointer const &) = delete;
+    RcuPointer & operator=(RcuPointer const &) = delete;
+    
+    ~RcuPointer()
+    {
+        assert(reader_epoch_.load() == kQuiescent);
+    }
+    
+    //! 読み込み側が値を参照している間、その値が解放されないことを保証するクラス
+    class ReadLock final
+    {
+    public:
+        ReadLock(ReadLock const &) = delete;
+        ReadLock & operator=(ReadLock const &) = delete;
+        
+        ReadLock(ReadLock &&rhs)
+        :   ptr_(rhs.ptr_)
+        ,   owner_(rhs.owner_)
+        {
+            rhs.ptr_ = nullptr;
+            rhs.owner_ = nullptr;
+        }
+        
+        ~ReadLock()
+        {
+            if(owner_) { owner_->reader_epoch_.store(kQuiescent, std::memory_order_release); }
+        }
+        
+        T * get() const { return ptr_; }
+        T * operator->() const { assert(ptr_); return ptr_; }
+        T & operator*() const { assert(ptr_); return *ptr_; }
+        explicit operator bool() const { return ptr_ != nullptr; }
+        
+    private:
+        friend RcuPointer;
+        
+        ReadLock(T *ptr, RcuPointer *owner)
+        :   ptr_(ptr)
+        ,   owner_(owner)
+        {}
+        
+        T *ptr_ = nullptr;
+        RcuPointer *owner_ = nullptr;
+    };
+    
+    //! [読み込み側] 現在の値を参照する。
+    /*! 返されたReadLockが破棄されるまで、参照した値は解放されない。
+     *  ReadLockを保持したまま、さらにRead()を呼び出してはならない。
+     */
+    ReadLock Read()
+    {
+        assert(reader_epoch_.load(std::memory_order_relaxed) == kQuiescent);
+        
+        // 値を読み込む前に、読み込み開始時のエポックを公開する。
+        // 書き込み側は、このエポックが差し替え時のエポックより古い間は、古い値を解放しない。
+        auto const epoch = epoch_.load(std::memory_order_seq_cst);
+        reader_epoch_.store(epoch, std::memory_order_seq_cst);
+        auto *p = ptr_.load(std::memory_order_seq_cst);
+        
+        return ReadLock(p, this);
+    }
+    
+    //! [書き込み側] 値を差し替え、差し替え前の値を返す。
+    /*! 差し替え前の値を参照している読み込み側がいなくなるまで待機する。
+     *  読み込み側のスレッドから呼び出してはならない。
+     */
+    std::shared_ptr<T> Exchange(std::shared_ptr<T> new_value)
+    {
+        auto lock = lf_.make_lock();
+        
+        auto old_value = std::move(value_);
+        value_ = std::move(new_value);
+        
+        ptr_.store(value_.get(), std::memory_order_seq_cst);
+        auto const new_epoch = epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+        
+        // 読み込み側が、差し替え前のエポックで読み込みを開始した状態のままであれば、
+        // 古い値を参照している可能性があるので待機する。
+        for( ; ; ) {
+            auto const reader_epoch = reader_epoch_.load(std::memory_order_seq_cst);
+            if(reader_epoch == kQuiescent || reader_epoch >= new_epoch) { break; }
+            std::this_thread::yield();
+        }
+        
+        return old_value;
+    }
+    
+    //! [書き込み側] 現在の値を返す。
+    std::shared_ptr<T> Get() const
+    {
+        auto lock = lf_.make_lock();
+        return value_;
+    }
+    
+private:
+    static constexpr EpochType kQuiescent = 0;
+    
+    LockFactory lf_;
+    std::shared_ptr<T> value_;
+    std::atomic<T *> ptr_ = { nullptr };
+    std::atomic<EpochType> epoch_ = { 1 };
+    std::atomic<EpochType> reader_epoch_ = { kQuiescent };
+};
+
+NS_HWM_END
@@ -0,0 +1,273 @@
+#include "RealtimeWorkerPool.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "./Futex.hpp"
+#include "./WorkStealingDeque.hpp"
+
+NS_HWM_BEGIN
+
+namespace {
+
+//! 呼び出したスレッドをリアルタイム優先度に設定する。
+/*! 権限がない場合などは失敗して false を返す。
+ */
+bool SetCurrentThreadRealtimePriority()
+{
+#if defined(_MSC_VER)
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+#else
+    sched_param param = {};
+    // オーディオスレッドよりは低くする
+    param.sched_priority = std::max(sched_get_priority_max(SCHED_FIFO) - 1, sched_get_priority_min(SCHED_FIFO));
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+#endif
+}
+
+} // namespace
+
+struct RealtimeWorkerPool::Impl
+{
+    using clock_t = std::chrono::steady_clock;
+
+    //! タスクを実行するスレッドごとの状態。0番目は Run() を呼び出したスレッドが使う
+    struct Worker
+    {
+        Worker(UInt32 max_num_tasks)
+        :   deque_(max_num_tasks)
+        {
+            ready_.reserve(max_num_tasks);
+        }
+
+        WorkStealingDeque<UInt32> deque_;
+        //! 実行可能になった後続タスクを、キューに積む前に一時的に保持する
+        std::vector<UInt32> ready_;
+        std::thread thread_;
+    };
+
+    Options opts_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<UInt32> num_realtime_workers_ = { 0 };
+
+    //! Run() のたびに2ずつ増える。奇数の間はタスクを実行中
+    std::atomic<UInt32> epoch_ = { 0 };
+    //! epoch_ が奇数の間に、タスクの実行に参加しているワーカースレッドの数
+    std::atomic<UInt32> num_active_ = { 0 };
+    //! futex で休止しているワーカースレッドの数
+    std::atomic<UInt32> num_sleeping_ = { 0 };
+    //! まだ完了していないタスクの数
+    std::atomic<UInt32> num_remaining_ = { 0 };
+    std::atomic<bool> quit_ = { false };
+
+    // 以下は epoch_ を奇数にする前に書き込み、実行中は読み込みだけを行う
+    TaskGraph *graph_ = nullptr;
+    TaskCallback callback_ = nullptr;
+    void *context_ = nullptr;
+
+    static
+    bool IsOpen(UInt32 epoch) { return (epoch & 1) == 1; }
+
+    void ExecuteTask(UInt32 task, Worker &w)
+    {
+        auto const begin = clock_t::now();
+        callback_(context_, task);
+        auto const end = clock_t::now();
+        graph_->RecordCost(task, std::chrono::duration<double, std::nano>(end - begin).count());
+
+        // 後続タスクはクリティカルパスが短い順に並んでいるので、最も長いものが最後に積まれて、次に取り出される
+        w.ready_.clear();
+        for(auto s: graph_->tasks_[task].successors_) {
+            if(graph_->num_pending_[s].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                w.ready_.push_back(s);
+            }
+        }
+        for(auto s: w.ready_) {
+            [[maybe_unused]] bool const pushed = w.deque_.Push(s);
+            assert(pushed);
+        }
+
+        num_remaining_.fetch_sub(1, std::memory_order_release);
+    }
+
+    bool StealTask(UInt32 thief_index, UInt32 &task)
+    {
+        auto const num_workers = workers_.size();
+        for(UInt32 i = 1; i < num_workers; ++i) {
+            if(workers_[(thief_index + i) % num_workers]->deque_.Steal(task)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //! すべてのタスクが完了するまで、タスクを取り出して実行する
+    void RunTasks(UInt32 worker_index)
+    {
+        auto &w = *workers_[worker_index];
+        while(num_remaining_.load(std::memory_order_acquire) > 0) {
+            UInt32 task = 0;
+            if(w.deque_.Pop(task) || StealTask(worker_index, task)) {
+                ExecuteTask(task, w);
+            } else {
+                CpuRelax();
+            }
+        }
+    }
+
+    //! 前回とは異なる Run() が始まるか、終了が要求されるまで待機する。
+    /*! まず opts_.spin_usec_ の間スピンし、それでも始まらなければ futex で休止する。
+     */
+    UInt32 WaitForNextRun(UInt32 last_epoch)
+    {
+        auto is_ready = [&](UInt32 epoch) {
+            return (IsOpen(epoch) && epoch != last_epoch) || quit_.load(std::memory_order_relaxed);
+        };
+
+        auto const spin_end = clock_t::now() + std::chrono::microseconds(opts_.spin_usec_);
+        for(UInt32 i = 0; ; ++i) {
+            auto const epoch = epoch_.load(std::memory_order_acquire);
+            if(is_ready(epoch)) { return epoch; }
+            CpuRelax();
+            if(i % 64 == 63 && clock_t::now() >= spin_end) { break; }
+        }
+
+        for( ; ; ) {
+            num_sleeping_.fetch_add(1, std::memory_order_seq_cst);
+            auto epoch = epoch_.load(std::memory_order_seq_cst);
+            if(is_ready(epoch) == false) {
+                FutexWait(epoch_, epoch);
+            }
+            num_sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+
+            epoch = epoch_.load(std::memory_order_acquire);
+            if(is_ready(epoch)) { return epoch; }
+        }
+    }
+
+    void WorkerThread(UInt32 worker_index)
+    {
+        if(opts_.realtime_priority_ && SetCurrentThreadRealtimePriority()) {
+            num_realtime_workers_.fetch_add(1);
+        }
+
+        UInt32 last_epoch = 0;
+        for( ; ; ) {
+            auto const epoch = WaitForNextRun(last_epoch);
+            if(quit_.load()) { break; }
+            last_epoch = epoch;
+
+            // Run() 側で epoch_ を偶数に戻してから num_active_ が0になるのを待つので、
+            // 参加を表明した後にまだ同じ Run() の実行中であることを確認してからタスクに触れる。
+            num_active_.fetch_add(1, std::memory_order_seq_cst);
+            if(epoch_.load(std::memory_order_seq_cst) == epoch) {
+                RunTasks(worker_index);
+            }
+            num_active_.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    }
+};
+
+RealtimeWorkerPool::RealtimeWorkerPool(Options const &opts)
+:   pimpl_(std::make_unique<Impl>())
+{
+    pimpl_->opts_ = opts;
+
+    for(UInt32 i = 0; i < opts.num_workers_ + 1; ++i) {
+        pimpl_->workers_.push_back(std::make_unique<Impl::Worker>(opts.max_num_tasks_));
+    }
+
+    for(UInt32 i = 1; i < pimpl_->workers_.size(); ++i) {
+        pimpl_->workers_[i]->thread_ = std::thread([this, i] { pimpl_->WorkerThread(i); });
+    }
+}
+
+RealtimeWorkerPool::~RealtimeWorkerPool()
+{
+    pimpl_->quit_.store(true);
+    // 偶数のまま値を変えて、休止しているスレッドを起こす
+    pimpl_->epoch_.fetch_add(2);
+    FutexWakeAll(pimpl_->epoch_);
+
+    for(auto &w: pimpl_->workers_) {
+        if(w->thread_.joinable()) {
+            w->thread_.join();
+        }
+    }
+}
+
+UInt32 RealtimeWorkerPool::GetNumWorkers() const
+{
+    return pimpl_->opts_.num_workers_;
+}
+
+UInt32 RealtimeWorkerPool::GetMaxNumTasks() const
+{
+    return pimpl_->opts_.max_num_tasks_;
+}
+
+UInt32 RealtimeWorkerPool::GetNumRealtimeWorkers() const
+{
+    return pimpl_->num_realtime_workers_.load();
+}
+
+void RealtimeWorkerPool::RunImpl(TaskGraph &graph, TaskCallback callback, void *context)
+{
+    assert(graph.is_built_);
+    assert(graph.GetNumTasks() <= GetMaxNumTasks());
+
+    auto &p = *pimpl_;
+    auto const num_tasks = graph.GetNumTasks();
+    if(num_tasks == 0) { return; }
+
+    // どのワーカースレッドもキューに触れていないので、ここでは所有者以外のキューにも積める
+    for(auto &w: p.workers_) { w->deque_.Clear(); }
+    graph.ResetPendingCounts();
+    p.graph_ = &graph;
+    p.callback_ = callback;
+    p.context_ = context;
+    p.num_remaining_.store(num_tasks, std::memory_order_relaxed);
+
+    bool const runs_in_parallel = (graph.HasParallelism() && p.workers_.size() > 1);
+    if(runs_in_parallel) {
+        // クリティカルパスが長いものから順に各スレッドへ振り分ける。
+        // キューの末尾から取り出されるので、短いものから積む。
+        for(UInt32 i = graph.roots_.size(); i > 0; --i) {
+            p.workers_[(i - 1) % p.workers_.size()]->deque_.Push(graph.roots_[i - 1]);
+        }
+
+        p.epoch_.fetch_add(1, std::memory_order_seq_cst);
+        if(p.num_sleeping_.load(std::memory_order_seq_cst) > 0) {
+            FutexWakeAll(p.epoch_);
+        }
+    } else {
+        // 末尾から取り出されるので、クリティカルパスが短いものから積む
+        for(auto it = graph.roots_.rbegin(), end = graph.roots_.rend(); it != end; ++it) {
+            p.workers_[0]->deque_.Push(*it);
+        }
+    }
+
+    p.RunTasks(0);
+
+    if(runs_in_parallel) {
+        p.epoch_.fetch_add(1, std::memory_order_seq_cst);
+        while(p.num_active_.load(std::memory_order_seq_cst) > 0) {
+            CpuRelax();
+        }
+    }
+
+    graph.UpdateCriticalPaths();
+}
+
+NS_HWM_END
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+
+#include "./TaskGraph.hpp"
+
+NS_HWM_BEGIN
+
+//! TaskGraph のタスクを、あらかじめ起動しておいた複数のスレッドで並列に実行するクラス
+/*! Run() を呼び出したスレッド（オーディオスレッド）もタスクの実行に参加し、
+ *  すべてのタスクが完了してから Run() から戻る。
+ *  Run() はメモリの確保もロックも行わないので、オーディオコールバックの中で呼び出せる。
+ *
+ *  実行可能になったタスクは、実行したスレッドのワークスティーリングキューに積まれ、
+ *  手の空いたスレッドは他のスレッドのキューからタスクを盗んで実行する。
+ *  待機中のワーカースレッドは、しばらくスピンしてから futex で休止する。
+ */
+class RealtimeWorkerPool final
+{
+public:
+    struct Options
+    {
+        //! Run() を呼び出したスレッドのほかに起動するスレッドの数
+        UInt32 num_workers_ = 0;
+        //! 一度に実行できるタスクの最大数
+        UInt32 max_num_tasks_ = 256;
+        //! ワーカースレッドが休止する前に、次の Run() をスピンして待つ時間 [us]
+        UInt32 spin_usec_ = 50;
+        //! ワーカースレッドをリアルタイム優先度で実行するかどうか
+        bool realtime_priority_ = true;
+    };
+
+    explicit
+    RealtimeWorkerPool(Options const &opts);
+    ~RealtimeWorkerPool();
+
+    RealtimeWorkerPool(RealtimeWorkerPool const &) = delete;
+    RealtimeWorkerPool & operator=(RealtimeWorkerPool const &) = delete;
+
+    UInt32 GetNumWorkers() const;
+    UInt32 GetMaxNumTasks() const;
+    //! リアルタイム優先度の設定に成功したワーカースレッドの数
+    UInt32 GetNumRealtimeWorkers() const;
+
+    //! graph のすべてのタスクを実行する。
+    /*! タスクごとに、実行するスレッドから f(task_index) が呼び出される。
+     *  先行タスクで書き込んだデータは、後続のタスクから読み込める。
+     *  一度にひとつのスレッドからだけ呼び出すこと。
+     *  @pre graph.Build() に成功していること
+     *  @pre graph.GetNumTasks() <= GetMaxNumTasks()
+     */
+    template<class F>
+    void Run(TaskGraph &graph, F &&f)
+    {
+        RunImpl(graph, [](void *context, UInt32 task_index) {
+            (*static_cast<std::remove_reference_t<F> *>(context))(task_index);
+        }, &f);
+    }
+
+private:
+    using TaskCallback = void(*)(void *context, UInt32 task_index);
+    void RunImpl(TaskGraph &graph, TaskCallback callback, void *context);
+
+    struct Impl;
+    std::unique_ptr<Impl> pimpl_;
+};
+
+NS_HWM_END
@@ -0,0 +1,204 @@
+#include "SampleConversion.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HWM_SAMPLE_CONVERSION_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+NS_HWM_BEGIN
+
+namespace {
+
+float ClipSample(float x)
+{
+    return std::min(std::max(x, -1.0f), 1.0f);
+}
+
+//! begin フレーム目以降をスカラー演算で変換する
+void DeinterleaveScalarFrom(float const *src, float * const *dest,
+                            UInt32 num_channels, SampleCount begin, SampleCount length)
+{
+    for(UInt32 ch = 0; ch < num_channels; ++ch) {
+        auto *d = dest[ch];
+        for(SampleCount i = begin; i < length; ++i) {
+            d[i] = src[i * num_channels + ch];
+        }
+    }
+}
+
+//! begin フレーム目以降をスカラー演算で変換する
+void InterleaveWithClipScalarFrom(float const * const *src, float *dest,
+                                  UInt32 num_channels, SampleCount begin, SampleCount length)
+{
+    for(UInt32 ch = 0; ch < num_channels; ++ch) {
+        auto const *s = src[ch];
+        for(SampleCount i = begin; i < length; ++i) {
+            dest[i * num_channels + ch] = ClipSample(s[i]);
+        }
+    }
+}
+
+#if defined(HWM_SAMPLE_CONVERSION_USE_SSE2)
+
+__m128 ClipVector(__m128 x)
+{
+    return _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+}
+
+// 以下の関数は、4フレーム単位で変換できる範囲だけを変換して、変換したフレーム数を返す。
+
+SampleCount DeinterleaveStereo(float const *src, float * const *dest, SampleCount length)
+{
+    auto *d0 = dest[0];
+    auto *d1 = dest[1];
+
+    SampleCount i = 0;
+    for( ; i + 4 <= length; i += 4) {
+        __m128 const a = _mm_loadu_ps(src + i * 2);     // L0 R0 L1 R1
+        __m128 const b = _mm_loadu_ps(src + i * 2 + 4); // L2 R2 L3 R3
+        _mm_storeu_ps(d0 + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(d1 + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+
+    return i;
+}
+
+SampleCount InterleaveWithClipStereo(float const * const *src, float *dest, SampleCount length)
+{
+    auto const *s0 = src[0];
+    auto const *s1 = src[1];
+
+    SampleCount i = 0;
+    for( ; i + 4 <= length; i += 4) {
+        __m128 const l = ClipVector(_mm_loadu_ps(s0 + i));
+        __m128 const r = ClipVector(_mm_loadu_ps(s1 + i));
+        _mm_storeu_ps(dest + i * 2, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(dest + i * 2 + 4, _mm_unpackhi_ps(l, r));
+    }
+
+    return i;
+}
+
+//! 4チャンネル単位で、4フレーム x 4チャンネルの行列を転置して変換する
+template<UInt32 NumChannels>
+SampleCount DeinterleaveQuad(float const *src, float * const *dest, SampleCount length)
+{
+    static_assert(NumChannels % 4 == 0, "NumChannels must be a multiple of 4");
+
+    SampleCount i = 0;
+    for( ; i + 4 <= length; i += 4) {
+        auto const *frames = src + i * NumChannels;
+        for(UInt32 g = 0; g < NumChannels; g += 4) {
+            __m128 r0 = _mm_loadu_ps(frames + g);
+            __m128 r1 = _mm_loadu_ps(frames + g + NumChannels);
+            __m128 r2 = _mm_loadu_ps(frames + g + NumChannels * 2);
+            __m128 r3 = _mm_loadu_ps(frames + g + NumChannels * 3);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(dest[g] + i, r0);
+            _mm_storeu_ps(dest[g + 1] + i, r1);
+            _mm_storeu_ps(dest[g + 2] + i, r2);
+            _mm_storeu_ps(dest[g + 3] + i, r3);
+        }
+    }
+
+    return i;
+}
+
+template<UInt32 NumChannels>
+SampleCount InterleaveWithClipQuad(float const * const *src, float *dest, SampleCount length)
+{
+    static_assert(NumChannels % 4 == 0, "NumChannels must be a multiple of 4");
+
+    SampleCount i = 0;
+    for( ; i + 4 <= length; i += 4) {
+        auto *frames = dest + i * NumChannels;
+        for(UInt32 g = 0; g < NumChannels; g += 4) {
+            __m128 c0 = ClipVector(_mm_loadu_ps(src[g] + i));
+            __m128 c1 = ClipVector(_mm_loadu_ps(src[g + 1] + i));
+            __m128 c2 = ClipVector(_mm_loadu_ps(src[g + 2] + i));
+            __m128 c3 = ClipVector(_mm_loadu_ps(src[g + 3] + i));
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+            _mm_storeu_ps(frames + g, c0);
+            _mm_storeu_ps(frames + g + NumChannels, c1);
+            _mm_storeu_ps(frames + g + NumChannels * 2, c2);
+            _mm_storeu_ps(frames + g + NumChannels * 3, c3);
+        }
+    }
+
+    return i;
+}
+
+#endif
+
+} // namespace
+
+void Deinterleave(float const *src, float * const *dest, UInt32 num_channels, SampleCount length)
+{
+    if(num_channels == 1) {
+        std::copy_n(src, length, dest[0]);
+        return;
+    }
+
+    SampleCount i = 0;
+
+#if defined(HWM_SAMPLE_CONVERSION_USE_SSE2)
+    switch(num_channels) {
+        case 2: i = DeinterleaveStereo(src, dest, length); break;
+        case 4: i = DeinterleaveQuad<4>(src, dest, length); break;
+        case 8: i = DeinterleaveQuad<8>(src, dest, length); break;
+        default: break;
+    }
+#endif
+
+    DeinterleaveScalarFrom(src, dest, num_channels, i, length);
+}
+
+void InterleaveWithClip(float const * const *src, float *dest, UInt32 num_channels, SampleCount length)
+{
+    if(num_channels == 1) {
+        Clip(src[0], dest, length);
+        return;
+    }
+
+    SampleCount i = 0;
+
+#if defined(HWM_SAMPLE_CONVERSION_USE_SSE2)
+    switch(num_channels) {
+        case 2: i = InterleaveWithClipStereo(src, dest, length); break;
+        case 4: i = InterleaveWithClipQuad<4>(src, dest, length); break;
+        case 8: i = InterleaveWithClipQuad<8>(src, dest, length); break;
+        default: break;
+    }
+#endif
+
+    InterleaveWithClipScalarFrom(src, dest, num_channels, i, length);
+}
+
+void Clip(float const *src, float *dest, SampleCount length)
+{
+    SampleCount i = 0;
+
+#if defined(HWM_SAMPLE_CONVERSION_USE_SSE2)
+    for( ; i + 4 <= length; i += 4) {
+        _mm_storeu_ps(dest + i, ClipVector(_mm_loadu_ps(src + i)));
+    }
+#endif
+
+    for( ; i < length; ++i) {
+        dest[i] = ClipSample(src[i]);
+    }
+}
+
+void DeinterleaveScalar(float const *src, float * const *dest, UInt32 num_channels, SampleCount length)
+{
+    DeinterleaveScalarFrom(src, dest, num_channels, 0, length);
+}
+
+void InterleaveWithClipScalar(float const * const *src, float *dest, UInt32 num_channels, SampleCount length)
+{
+    InterleaveWithClipScalarFrom(src, dest, num_channels, 0, length);
+}
+
+NS_HWM_END
@@ -0,0 +1,28 @@
+#pragma once
+
+NS_HWM_BEGIN
+
+//! インターリーブされたサンプルを、チャンネルごとのバッファに分配する。
+/*! 1, 2, 4, 8チャンネルの場合は、SSE2が利用できる環境では4フレームずつまとめて変換する。
+ *  @param src num_channels * length 個のサンプルを持つインターリーブされたバッファ
+ *  @param dest num_channels 個のチャンネルのバッファ。各チャンネルは length 個以上のサンプルを持つこと
+ */
+void Deinterleave(float const *src, float * const *dest, UInt32 num_channels, SampleCount length);
+
+//! チャンネルごとのバッファのサンプルを、-1.0 〜 1.0 にクリップしながらインターリーブする。
+/*! 1, 2, 4, 8チャンネルの場合は、SSE2が利用できる環境では4フレームずつまとめて変換する。
+ */
+void InterleaveWithClip(float const * const *src, float *dest, UInt32 num_channels, SampleCount length);
+
+//! サンプルを -1.0 〜 1.0 にクリップする。
+/*! src と dest は同じバッファでもよい。
+ */
+void Clip(float const *src, float *dest, SampleCount length);
+
+//! Deinterleave() と同じ変換を、SIMD命令を使用せずに行う。（テストと性能比較用）
+void DeinterleaveScalar(float const *src, float * const *dest, UInt32 num_channels, SampleCount length);
+
+//! InterleaveWithClip() と同じ変換を、SIMD命令を使用せずに行う。（テストと性能比較用）
+void InterleaveWithClipScalar(float const * const *src, float *dest, UInt32 num_channels, SampleCount length);
+
+NS_HWM_END
@@ -0,0 +1,179 @@
+#include "SharedMemory.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "StrCnv.hpp"
+
+NS_HWM_BEGIN
+
+namespace {
+
+#if defined(_MSC_VER)
+std::wstring GetOsName(String const &name)
+{
+    // 同じログオンセッションの中だけで共有する
+    return L"Local\\" + name;
+}
+
+std::string GetLastErrorString()
+{
+    return "error code " + std::to_string(GetLastError());
+}
+#else
+std::string GetOsName(String const &name)
+{
+    return "/" + to_utf8(name);
+}
+
+std::string GetLastErrorString()
+{
+    return strerror(errno);
+}
+#endif
+
+} // namespace
+
+class SharedMemory::Impl
+{
+public:
+    String name_;
+    size_t size_ = 0;
+    void *data_ = nullptr;
+    bool is_owner_ = false;
+#if defined(_MSC_VER)
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+
+    ~Impl()
+    {
+#if defined(_MSC_VER)
+        if(data_) { UnmapViewOfFile(data_); }
+        if(mapping_) { CloseHandle(mapping_); }
+#else
+        if(data_) { munmap(data_, size_); }
+        if(fd_ != -1) { close(fd_); }
+        if(is_owner_) { shm_unlink(GetOsName(name_).c_str()); }
+#endif
+    }
+
+    void Map(bool create)
+    {
+        auto const os_name = GetOsName(name_);
+        auto fail = [&](std::string const &what) {
+            throw std::runtime_error("failed to " + what + " the shared memory [" + to_utf8(name_) + "]: "
+                                     + GetLastErrorString());
+        };
+
+#if defined(_MSC_VER)
+        if(create) {
+            auto const size = (UInt64)size_;
+            mapping_ = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                          (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF),
+                                          os_name.c_str());
+            if(mapping_ && GetLastError() == ERROR_ALREADY_EXISTS) {
+                CloseHandle(mapping_);
+                mapping_ = nullptr;
+                SetLastError(ERROR_ALREADY_EXISTS);
+            }
+        } else {
+            mapping_ = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, os_name.c_str());
+        }
+        if(!mapping_) { fail(create ? "create" : "open"); }
+
+        data_ = MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size_);
+        if(!data_) { fail("map"); }
+#else
+        if(create) {
+            fd_ = shm_open(os_name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+            if(fd_ == -1) { fail("create"); }
+            is_owner_ = true;
+            if(ftruncate(fd_, (off_t)size_) == -1) { fail("resize"); }
+        } else {
+            fd_ = shm_open(os_name.c_str(), O_RDWR, 0);
+            if(fd_ == -1) { fail("open"); }
+
+            struct stat st;
+            if(fstat(fd_, &st) == -1) { fail("inspect"); }
+            if((size_t)st.st_size < size_) {
+                throw std::runtime_error("the shared memory [" + to_utf8(name_) + "] is smaller than expected");
+            }
+        }
+
+        auto p = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if(p == MAP_FAILED) { fail("map"); }
+        data_ = p;
+#endif
+    }
+};
+
+SharedMemory::SharedMemory(std::unique_ptr<Impl> pimpl)
+:   pimpl_(std::move(pimpl))
+{}
+
+SharedMemory::~SharedMemory()
+{}
+
+std::unique_ptr<SharedMemory> SharedMemory::Create(String const &name, size_t size)
+{
+    assert(size > 0);
+    auto impl = std::make_unique<Impl>();
+    impl->name_ = name;
+    impl->size_ = size;
+    impl->Map(true);
+    return std::unique_ptr<SharedMemory>(new SharedMemory(std::move(impl)));
+}
+
+std::unique_ptr<SharedMemory> SharedMemory::Open(String const &name, size_t size)
+{
+    assert(size > 0);
+    auto impl = std::make_unique<Impl>();
+    impl->name_ = name;
+    impl->size_ = size;
+    impl->Map(false);
+    return std::unique_ptr<SharedMemory>(new SharedMemory(std::move(impl)));
+}
+
+String SharedMemory::MakeUniqueName()
+{
+    static std::atomic<UInt32> counter = { 0 };
+
+#if defined(_MSC_VER)
+    auto const pid = (UInt64)GetCurrentProcessId();
+#else
+    auto const pid = (UInt64)getpid();
+#endif
+
+    return L"hwm" + std::to_wstring(pid) + L"_" + std::to_wstring(counter.fetch_add(1));
+}
+
+void * SharedMemory::GetData() const
+{
+    return pimpl_->data_;
+}
+
+size_t SharedMemory::GetSize() const
+{
+    return pimpl_->size_;
+}
+
+String const & SharedMemory::GetName() const
+{
+    return pimpl_->name_;
+}
+
+NS_HWM_END
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+
+NS_HWM_BEGIN
+
+//! 名前を付けて、プロセス間で共有するメモリ領域
+/*! Windowsではページファイルをバックにしたファイルマッピングオブジェクト、
+ *  それ以外ではPOSIXの共有メモリ(shm_open)を使用する。
+ */
+class SharedMemory final
+{
+public:
+    //! 新しい共有メモリを作成する。領域はゼロで初期化されている。
+    /*! 同じ名前の共有メモリがすでに存在する場合は失敗する。
+     *  @exception std::runtime_error
+     */
+    static std::unique_ptr<SharedMemory> Create(String const &name, size_t size);
+
+    //! 別のプロセスが Create() で作成した共有メモリを開く。
+    /*! @exception std::runtime_error
+     */
+    static std::unique_ptr<SharedMemory> Open(String const &name, size_t size);
+
+    //! このプロセスの中で重複しない、共有メモリの名前を作成する。
+    /*! プロセスIDを含めるので、ほかのプロセスが作成した名前とも重複しない。
+     *  macOSの名前の長さの制限(31文字)に収まるように、短い名前にしている。
+     */
+    static String MakeUniqueName();
+
+    //! 領域をアンマップする。 Create() で作成した側では、名前も削除する。
+    /*! すでに開いている別のプロセスからは、そのプロセスが閉じるまで引き続き参照できる。
+     */
+    ~SharedMemory();
+
+    SharedMemory(SharedMemory const &) = delete;
+    SharedMemory & operator=(SharedMemory const &) = delete;
+
+    void * GetData() const;
+    size_t GetSize() const;
+    String const & GetName() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pimpl_;
+
+    SharedMemory(std::unique_ptr<Impl> pimpl);
+};
+
+NS_HWM_END
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+NS_HWM_BEGIN
+
+namespace SpscRingBufferDetail {
+
+//! SpscRingBuffer と MultiChannelSpscRingBuffer で共通の、書き込み位置と読み込み位置の管理
+/*! 位置は単調に増加させ、バッファのサイズ（2のべき乗）でマスクして要素の位置を求める。
+ *  書き込み側と読み込み側は、相手の位置をキャッシュしておき、
+ *  キャッシュした値では足りない場合にだけ相手の位置を読み直す。
+ *  それぞれの位置とキャッシュは別のキャッシュラインに配置して、偽共有を避ける。
+ */
+class Positions
+{
+public:
+    explicit
+    Positions(UInt32 capacity)
+    {
+        assert(capacity > 0);
+
+        size_t size = 1;
+        while(size < capacity) { size <<= 1; }
+        mask_ = size - 1;
+    }
+
+    size_t GetSize() const { return mask_ + 1; }
+    size_t GetMask() const { return mask_; }
+
+    //! [書き込み側] 書き込める要素数を返す
+    UInt32 GetNumPushable()
+    {
+        producer_.cached_ = read_pos_.load(std::memory_order_acquire);
+        return (UInt32)(GetSize() - (producer_.pos_ - producer_.cached_));
+    }
+
+    //! [書き込み側] 最大 max_count 個の要素を書き込む領域を確保する。
+    /*! @param [out] pos 書き込みを開始する位置
+     *  @return 確保できた要素数
+     */
+    UInt32 ReserveWrite(UInt32 max_count, size_t &pos)
+    {
+        pos = producer_.pos_;
+        auto available = GetSize() - (pos - producer_.cached_);
+        if(available < max_count) {
+            available = GetNumPushable();
+        }
+        return (UInt32)std::min<size_t>(available, max_count);
+    }
+
+    //! [書き込み側] 確保した領域のうち、count 個の要素を読み込み側に公開する。
+    void CommitWrite(UInt32 count)
+    {
+        producer_.pos_ += count;
+        write_pos_.store(producer_.pos_, std::memory_order_release);
+    }
+
+    //! [読み込み側] 読み込める要素数を返す
+    UInt32 GetNumPoppable()
+    {
+        consumer_.cached_ = write_pos_.load(std::memory_order_acquire);
+        return (UInt32)(consumer_.cached_ - consumer_.pos_);
+    }
+
+    //! [読み込み側] 最大 max_count 個の要素を読み込む。
+    /*! @param [out] pos 読み込みを開始する位置
+     *  @return 読み込める要素数
+     */
+    UInt32 ReserveRead(UInt32 max_count, size_t &pos)
+    {
+        pos = consumer_.pos_;
+        auto available = consumer_.cached_ - pos;
+        if(available < max_count) {
+            available = GetNumPoppable();
+        }
+        return (UInt32)std::min<size_t>(available, max_count);
+    }
+
+    //! [読み込み側] 読み込んだ count 個の要素の領域を、書き込み側に返す。
+    void CommitRead(UInt32 count)
+    {
+        consumer_.pos_ += count;
+        read_pos_.store(consumer_.pos_, std::memory_order_release);
+    }
+
+    //! pos から始まる length 個の要素を、バッファ上で連続した最大2つの区間に分けて f に渡す。
+    /*! @tparam F `void(size_t index, UInt32 length_of_span, UInt32 offset_in_request)`
+     */
+    template<class F>
+    void ForEachSpan(size_t pos, UInt32 length, F &&f) const
+    {
+        auto const index = pos & mask_;
+        auto const length1 = (UInt32)std::min<size_t>(length, GetSize() - index);
+        if(length1 > 0) { f(index, length1, 0); }
+        if(length1 < length) { f(0, length - length1, length1); }
+    }
+
+private:
+    //! 片方のスレッドだけが読み書きする状態
+    struct alignas(64) LocalState
+    {
+        size_t pos_ = 0;    //!< 自分の位置
+        size_t cached_ = 0; //!< 最後に読み込んだ相手の位置
+    };
+
+    size_t mask_ = 0;
+    LocalState producer_;
+    LocalState consumer_;
+    alignas(64) std::atomic<size_t> write_pos_ = { 0 };
+    alignas(64) std::atomic<size_t> read_pos_ = { 0 };
+};
+
+}   // SpscRingBufferDetail
+
+//! ひとつのスレッドからデータを追加し、別のひとつのスレッドからデータを取り出す、固定容量のリングバッファ
+/*! 内部バッファはコンストラクタで確保し、それ以降はメモリの確保もロックも行わない。
+ *  どちらの操作も相手のスレッドの状態に関わらず一定の手順で完了する（wait-free）ので、
+ *  リアルタイムスレッドから呼び出せる。
+ *
+ *  Write() / Read() を使うと、バッファ上で連続した区間を直接読み書きできる。
+ *
+ *  @tparam T デフォルト構築可能かつコピー代入可能な型
+ */
+template<class T>
+class SpscRingBuffer final
+{
+public:
+    using value_type = T;
+
+    //! @param capacity 容量。2のべき乗に切り上げられる。
+    explicit
+    SpscRingBuffer(UInt32 capacity)
+    :   positions_(capacity)
+    ,   data_(std::make_unique<T[]>(positions_.GetSize()))
+    {}
+
+    SpscRingBuffer(SpscRingBuffer const &) = delete;
+    SpscRingBuffer & operator=(SpscRingBuffer const &) = delete;
+
+    //! 全体の容量を返す
+    UInt32 GetCapacity() const { return (UInt32)positions_.GetSize(); }
+
+    //! [書き込み側] 書き込める要素数を返す
+    UInt32 GetNumPushable() { return positions_.GetNumPushable(); }
+
+    //! [読み込み側] 読み込める要素数を返す
+    UInt32 GetNumPoppable() { return positions_.GetNumPoppable(); }
+
+    //! [書き込み側] データを追加する。満杯の場合は追加せずにfalseを返す。
+    bool Push(T const &value)
+    {
+        size_t pos = 0;
+        if(positions_.ReserveWrite(1, pos) == 0) { return false; }
+
+        data_[pos & positions_.GetMask()] = value;
+        positions_.CommitWrite(1);
+        return true;
+    }
+
+    //! [書き込み側] length 個のデータをまとめて追加する。
+    /*! 空き領域が足りない場合は、何も追加せずにfalseを返す。
+     */
+    bool Push(T const *src, UInt32 length)
+    {
+        size_t pos = 0;
+        if(positions_.ReserveWrite(length, pos) < length) { return false; }
+
+        positions_.ForEachSpan(pos, length, [&](size_t index, UInt32 len, UInt32 offset) {
+            std::copy_n(src + offset, len, data_.get() + index);
+        });
+        positions_.CommitWrite(length);
+        return true;
+    }
+
+    //! [書き込み側] バッファ上の空き領域に直接書き込む。
+    /*! @tparam F `void(T *dest, UInt32 length, UInt32 offset)`
+     *  offset は、今回書き込む要素全体の中での dest の位置。
+     *  バッファ上で連続した区間ごとに、最大2回呼び出される。
+     *  @return 書き込んだ要素数。（空き領域が max_count より少ない場合は、空き領域の大きさ）
+     */
+    template<class F>
+    UInt32 Write(UInt32 max_count, F &&f)
+    {
+        size_t pos = 0;
+        auto const num = positions_.ReserveWrite(max_count, pos);
+        positions_.ForEachSpan(pos, num, [&](size_t index, UInt32 len, UInt32 offset) {
+            f(data_.get() + index, len, offset);
+        });
+        positions_.CommitWrite(num);
+        return num;
+    }
+
+    //! [読み込み側] データを取り出す。空の場合はfalseを返す。
+    bool Pop(T &value)
+    {
+        size_t pos = 0;
+        if(positions_.ReserveRead(1, pos) == 0) { return false; }
+
+        value = data_[pos & positions_.GetMask()];
+        positions_.CommitRead(1);
+        return true;
+    }
+
+    //! [読み込み側] length 個のデータをまとめて取り出す。
+    /*! 読み込めるデータが足りない場合は、何も取り出さずにfalseを返す。
+     */
+    bool Pop(T *dest, UInt32 length)
+    {
+        size_t pos = 0;
+        if(positions_.ReserveRead(length, pos) < length) { return false; }
+
+        positions_.ForEachSpan(pos, length, [&](size_t index, UInt32 len, UInt32 offset) {
+            std::copy_n(data_.get() + index, len, dest + offset);
+        });
+        positions_.CommitRead(length);
+        return true;
+    }
+
+    //! [読み込み側] バッファ上のデータを直接参照して取り出す。
+    /*! @tparam F `void(T const *src, UInt32 length, UInt32 offset)`
+     *  バッファ上で連続した区間ごとに、最大2回呼び出される。
+     *  f から戻った後は、その区間は書き込み側に返される。
+     *  @return 取り出した要素数
+     */
+    template<class F>
+    UInt32 Read(UInt32 max_count, F &&f)
+    {
+        size_t pos = 0;
+        auto const num = positions_.ReserveRead(max_count, pos);
+        positions_.ForEachSpan(pos, num, [&](size_t index, UInt32 len, UInt32 offset) {
+            f(static_cast<T const *>(data_.get() + index), len, offset);
+        });
+        positions_.CommitRead(num);
+        return num;
+    }
+
+private:
+    SpscRingBufferDetail::Positions positions_;
+    std::unique_ptr<T[]> data_;
+};
+
+//! 複数チャンネルのオーディオデータ用の SpscRingBuffer
+/*! すべてのチャンネルで、書き込み位置と読み込み位置を共有する。
+ */
+template<class T>
+class MultiChannelSpscRingBuffer final
+{
+public:
+    using value_type = T;
+
+    //! @param capacity 各チャンネルの容量。2のべき乗に切り上げられる。
+    MultiChannelSpscRingBuffer(UInt32 num_channels, UInt32 capacity)
+    :   positions_(capacity)
+    ,   data_(num_channels, std::vector<T>(positions_.GetSize()))
+    {
+        assert(num_channels > 0);
+    }
+
+    MultiChannelSpscRingBuffer(MultiChannelSpscRingBuffer const &) = delete;
+    MultiChannelSpscRingBuffer & operator=(MultiChannelSpscRingBuffer const &) = delete;
+
+    UInt32 GetNumChannels() const { return (UInt32)data_.size(); }
+    UInt32 GetCapacity() const { return (UInt32)positions_.GetSize(); }
+
+    //! [書き込み側] 書き込めるサンプル数を返す
+    UInt32 GetNumPushable() { return positions_.GetNumPushable(); }
+
+    //! [読み込み側] 読み込めるサンプル数を返す
+    UInt32 GetNumPoppable() { return positions_.GetNumPoppable(); }
+
+    //! [書き込み側] データを追加する。
+    /*! src のチャンネル数が足りない場合、残りのチャンネルには T{} を書き込む。
+     *  空き領域が足りない場合は、何も追加せずにfalseを返す。
+     */
+    template<class U>
+    bool Push(U const * const *src, UInt32 num_src_channels, UInt32 length)
+    {
+        size_t pos = 0;
+        if(positions_.ReserveWrite(length, pos) < length) { return false; }
+
+        positions_.ForEachSpan(pos, length, [&](size_t index, UInt32 len, UInt32 offset) {
+            for(UInt32 ch = 0; ch < data_.size(); ++ch) {
+                auto dest = data_[ch].begin() + index;
+                if(ch < num_src_channels) {
+                    std::copy_n(src[ch] + offset, len, dest);
+                } else {
+                    std::fill_n(dest, len, T{});
+                }
+            }
+        });
+        positions_.CommitWrite(length);
+        return true;
+    }
+
+    //! [読み込み側] データを取り出し、destに上書きする。
+    /*! 読み込めるデータが足りない場合は、何も取り出さずにfalseを返す。
+     */
+    template<class U>
+    bool PopOverwrite(U **dest, UInt32 num_dest_channels, UInt32 length)
+    {
+        return PopImpl(dest, num_dest_channels, length, [](auto src, auto len, auto dest) {
+            std::copy_n(src, len, dest);
+        });
+    }
+
+    //! [読み込み側] データを取り出し、destに加算する。
+    template<class U>
+    bool PopAdd(U **dest, UInt32 num_dest_channels, UInt32 length)
+    {
+        return PopImpl(dest, num_dest_channels, length, [](auto src, auto len, auto dest) {
+            std::transform(src, src + len, dest, dest, std::plus<>{});
+        });
+    }
+
+private:
+    SpscRingBufferDetail::Positions positions_;
+    std::vector<std::vector<T>> data_;
+
+    //! @tparam F `void(T const *src, UInt32 length, U *dest)`
+    template<class U, class F>
+    bool PopImpl(U **dest, UInt32 num_dest_channels, UInt32 length, F f)
+    {
+        size_t pos = 0;
+        if(positions_.ReserveRead(length, pos) < length) { return false; }
+
+        positions_.ForEachSpan(pos, length, [&](size_t index, UInt32 len, UInt32 offset) {
+            auto const num_channels = std::min<UInt32>(data_.size(), num_dest_channels);
+            for(UInt32 ch = 0; ch < num_channels; ++ch) {
+                f(data_[ch].data() + index, len, dest[ch] + offset);
+            }
+        });
+        positions_.CommitRead(length);
+        return true;
+    }
+};
+
+NS_HWM_END
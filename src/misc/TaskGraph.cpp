@@ -0,0 +1,165 @@
+#include "TaskGraph.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+NS_HWM_BEGIN
+
+namespace {
+    //! 処理時間の指数移動平均の係数
+    double const kCostSmoothingFactor = 0.1;
+    
+    //! 安定な挿入ソート。
+    /*! std::stable_sort() は一時領域を確保することがあるので、オーディオスレッドでは使用しない。
+     *  並べ替えるのは後続タスクの一覧なので、要素数は少なく、前回からの変化もわずかである。
+     */
+    template<class It, class Less>
+    void InsertionSort(It begin, It end, Less less)
+    {
+        if(begin == end) { return; }
+        
+        for(auto it = begin + 1; it != end; ++it) {
+            auto value = *it;
+            auto pos = it;
+            for( ; pos != begin && less(value, *(pos - 1)); --pos) {
+                *pos = *(pos - 1);
+            }
+            *pos = value;
+        }
+    }
+}
+
+TaskGraph::TaskGraph(UInt32 num_tasks)
+:   tasks_(num_tasks)
+,   num_pending_(std::make_unique<std::atomic<UInt32>[]>(num_tasks))
+{
+    topological_order_.reserve(num_tasks);
+    roots_.reserve(num_tasks);
+}
+
+TaskGraph::~TaskGraph()
+{}
+
+UInt32 TaskGraph::GetNumTasks() const
+{
+    return tasks_.size();
+}
+
+void TaskGraph::AddDependency(UInt32 before, UInt32 task)
+{
+    assert(is_built_ == false);
+    assert(before < tasks_.size());
+    assert(task < tasks_.size());
+
+    auto &succ = tasks_[before].successors_;
+    if(std::find(succ.begin(), succ.end(), task) != succ.end()) { return; }
+
+    succ.push_back(task);
+    tasks_[task].num_predecessors_ += 1;
+}
+
+bool TaskGraph::Build()
+{
+    assert(is_built_ == false);
+
+    // Kahn's algorithm
+    std::vector<UInt32> num_remaining(tasks_.size());
+    topological_order_.clear();
+    roots_.clear();
+    for(UInt32 i = 0; i < tasks_.size(); ++i) {
+        num_remaining[i] = tasks_[i].num_predecessors_;
+        if(num_remaining[i] == 0) {
+            roots_.push_back(i);
+            topological_order_.push_back(i);
+        }
+    }
+
+    for(UInt32 i = 0; i < topological_order_.size(); ++i) {
+        for(auto s: tasks_[topological_order_[i]].successors_) {
+            if(--num_remaining[s] == 0) {
+                topological_order_.push_back(s);
+            }
+        }
+    }
+
+    if(topological_order_.size() != tasks_.size()) {
+        return false;
+    }
+
+    has_parallelism_ = (roots_.size() > 1);
+    for(auto const &t: tasks_) {
+        if(t.successors_.size() > 1) { has_parallelism_ = true; }
+    }
+
+    is_built_ = true;
+    UpdateCriticalPaths();
+    return true;
+}
+
+bool TaskGraph::HasParallelism() const
+{
+    return has_parallelism_;
+}
+
+double TaskGraph::GetCost(UInt32 task) const
+{
+    assert(task < tasks_.size());
+    return tasks_[task].cost_;
+}
+
+void TaskGraph::SetCost(UInt32 task, double cost_ns)
+{
+    assert(task < tasks_.size());
+    tasks_[task].cost_ = cost_ns;
+}
+
+double TaskGraph::GetCriticalPathLength(UInt32 task) const
+{
+    assert(task < tasks_.size());
+    return tasks_[task].critical_path_;
+}
+
+void TaskGraph::UpdateCriticalPaths()
+{
+    assert(is_built_);
+
+    // 後続のタスクから順に、終端までの最長経路を求める
+    for(auto it = topological_order_.rbegin(), end = topological_order_.rend(); it != end; ++it) {
+        auto &t = tasks_[*it];
+        double longest = 0;
+        for(auto s: t.successors_) {
+            longest = std::max(longest, tasks_[s].critical_path_);
+        }
+        t.critical_path_ = t.cost_ + longest;
+    }
+
+    auto const by_critical_path = [this](UInt32 x, UInt32 y) {
+        return tasks_[x].critical_path_ < tasks_[y].critical_path_;
+    };
+
+    // 実行可能になった後続タスクは、この順にワーカーのキューに積まれ、末尾から取り出される。
+    for(auto &t: tasks_) {
+        InsertionSort(t.successors_.begin(), t.successors_.end(), by_critical_path);
+    }
+    InsertionSort(roots_.begin(), roots_.end(),
+                  [&](UInt32 x, UInt32 y) { return by_critical_path(y, x); });
+}
+
+void TaskGraph::ResetPendingCounts()
+{
+    for(UInt32 i = 0; i < tasks_.size(); ++i) {
+        num_pending_[i].store(tasks_[i].num_predecessors_, std::memory_order_relaxed);
+    }
+}
+
+void TaskGraph::RecordCost(UInt32 task, double cost_ns)
+{
+    auto &t = tasks_[task];
+    if(t.cost_ == 0) {
+        t.cost_ = cost_ns;
+    } else {
+        t.cost_ += (cost_ns - t.cost_) * kCostSmoothingFactor;
+    }
+}
+
+NS_HWM_END
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+NS_HWM_BEGIN
+
+class RealtimeWorkerPool;
+
+//! 依存関係のあるタスクの集合 (DAG)
+/*! 依存関係の構築は非リアルタイムスレッドで行い、 Build() 以降は RealtimeWorkerPool::Run() で繰り返し実行する。
+ *
+ *  実行するたびにタスクの処理時間を計測して、各タスクから終端までの最長経路（クリティカルパス）の長さを求める。
+ *  次回の実行では、クリティカルパスが長いタスクから優先して実行する。
+ */
+class TaskGraph final
+{
+public:
+    explicit
+    TaskGraph(UInt32 num_tasks);
+    ~TaskGraph();
+
+    TaskGraph(TaskGraph const &) = delete;
+    TaskGraph & operator=(TaskGraph const &) = delete;
+
+    UInt32 GetNumTasks() const;
+
+    //! task を before の完了後に実行するように、依存関係を追加する。
+    /*! Build() より前に呼び出すこと。
+     */
+    void AddDependency(UInt32 before, UInt32 task);
+
+    //! 依存関係を確定して、実行順序を計算する。
+    /*! @return 依存関係が循環している場合は false
+     */
+    bool Build();
+
+    //! 同時に実行できるタスクがあるかどうか。
+    /*! タスクが直列に並んでいるだけの場合は false を返す。
+     *  その場合 RealtimeWorkerPool はワーカースレッドを起こさずに、呼び出し元のスレッドだけで実行する。
+     */
+    bool HasParallelism() const;
+
+    //! タスクの処理時間の見積もり [ns]
+    /*! 実行するたびに、計測した処理時間の指数移動平均で更新される。
+     */
+    double GetCost(UInt32 task) const;
+    //! タスクの処理時間の見積もりを設定する。
+    void SetCost(UInt32 task, double cost_ns);
+
+    //! task から終端までの最長経路の長さ [ns]。 task 自身の処理時間を含む。
+    double GetCriticalPathLength(UInt32 task) const;
+
+    //! 処理時間の見積もりから、クリティカルパスの長さと実行の優先順位を計算し直す。
+    /*! メモリの確保を行わない。 RealtimeWorkerPool::Run() の終わりに呼び出される。
+     */
+    void UpdateCriticalPaths();
+
+private:
+    friend class RealtimeWorkerPool;
+
+    struct Task
+    {
+        //! このタスクの完了を待っているタスク。クリティカルパスが短い順に並べる
+        std::vector<UInt32> successors_;
+        UInt32 num_predecessors_ = 0;
+        double cost_ = 0;
+        double critical_path_ = 0;
+    };
+
+    std::vector<Task> tasks_;
+    //! 実行中に、まだ完了していない先行タスクの数
+    std::unique_ptr<std::atomic<UInt32>[]> num_pending_;
+    //! 先行タスクから順に並べたタスク
+    std::vector<UInt32> topological_order_;
+    //! 先行タスクを持たないタスク。クリティカルパスが長い順に並べる
+    std::vector<UInt32> roots_;
+    bool is_built_ = false;
+    bool has_parallelism_ = false;
+
+    //! 実行を始める前に、先行タスクの数を戻す
+    void ResetPendingCounts();
+    //! 計測した処理時間を記録する。タスクを実行したスレッドから呼び出される。
+    void RecordCost(UInt32 task, double cost_ns);
+};
+
+NS_HWM_END
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+NS_HWM_BEGIN
+
+//! ひとつの書き込みスレッドから、ひとつの読み込みスレッドへ、最新の値をロックなしで受け渡すクラス
+/*! 書き込み用・受け渡し用・読み込み用の3つのバッファを持ち、
+ *  Publish() と Update() では、バッファのインデックスをアトミックに交換するだけなので、
+ *  書き込み側と読み込み側のどちらもブロックしない。
+ *  読み込み側が Update() を呼び出す前に書き込み側が何度も Publish() した場合、
+ *  読み込み側は最後に公開された値だけを受け取る。
+ */
+template<class T>
+class TripleBuffer final
+{
+public:
+    TripleBuffer()
+    {}
+
+    TripleBuffer(TripleBuffer const &) = delete;
+    TripleBuffer & operator=(TripleBuffer const &) = delete;
+
+    //! [書き込み側] 次に公開する値を書き込むバッファを返す。
+    /*! このバッファの内容は、前回公開した値と同じとは限らない。
+     */
+    T & GetWriteBuffer() { return buffers_[write_index_]; }
+
+    //! [書き込み側] GetWriteBuffer() に書き込んだ値を公開する。
+    void Publish()
+    {
+        auto const prev = state_.exchange(write_index_ | kDirtyFlag, std::memory_order_acq_rel);
+        write_index_ = prev & kIndexMask;
+    }
+
+    //! [読み込み側] 新しく公開された値があれば、それを読み込み用のバッファにする。
+    /*! @return 新しく公開された値があった場合はtrue
+     */
+    bool Update()
+    {
+        if((state_.load(std::memory_order_relaxed) & kDirtyFlag) == 0) {
+            return false;
+        }
+
+        auto const prev = state_.exchange(read_index_, std::memory_order_acq_rel);
+        read_index_ = prev & kIndexMask;
+        return true;
+    }
+
+    //! [読み込み側] 最後に Update() で受け取った値を返す。
+    T const & GetReadBuffer() const { return buffers_[read_index_]; }
+
+    //! すべてのバッファに対してfを呼び出す。
+    /*! バッファの初期化やサイズ変更のためのもので、
+     *  書き込み側と読み込み側のどちらも動作していないときにだけ呼び出せる。
+     */
+    template<class F>
+    void ForEachBuffer(F f)
+    {
+        for(auto &buf: buffers_) { f(buf); }
+    }
+
+private:
+    static constexpr UInt8 kIndexMask = 0x03;
+    static constexpr UInt8 kDirtyFlag = 0x04;
+
+    std::array<T, 3> buffers_;
+    UInt8 write_index_ = 0;
+    //! 受け渡し用のバッファのインデックスと、新しい値が公開されたかどうかのフラグ
+    std::atomic<UInt8> state_ = { 1 };
+    UInt8 read_index_ = 2;
+};
+
+NS_HWM_END
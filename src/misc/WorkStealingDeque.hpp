@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <type_traits>
+
+NS_HWM_BEGIN
+
+//! 固定長のロックフリーなワークスティーリング用両端キュー (Chase-Lev deque)
+/*! 所有者のスレッドだけが Push() と Pop() で末尾に要素を出し入れし、
+ *  他のスレッドは Steal() で先頭から要素を盗む。
+ *  容量はコンストラクタで確保し、それ以降はメモリの確保を行わない。
+ *  容量を超えて Push() した場合は false を返す。
+ *
+ *  N. M. Lê et al., "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013)
+ *  の実装をもとに、スレッドフェンスの代わりにseq_cstの操作を使用している。
+ */
+template<class T>
+class WorkStealingDeque final
+{
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+    //! @param capacity 容量。2のべき乗に切り上げられる
+    explicit
+    WorkStealingDeque(UInt32 capacity)
+    {
+        capacity_ = 1;
+        while(capacity_ < capacity) { capacity_ *= 2; }
+        buffer_ = std::make_unique<std::atomic<T>[]>(capacity_);
+    }
+
+    WorkStealingDeque(WorkStealingDeque const &) = delete;
+    WorkStealingDeque & operator=(WorkStealingDeque const &) = delete;
+
+    UInt32 GetCapacity() const { return capacity_; }
+
+    //! 末尾に要素を追加する。所有者のスレッドからのみ呼び出すこと。
+    bool Push(T value)
+    {
+        auto const b = bottom_.load(std::memory_order_relaxed);
+        auto const t = top_.load(std::memory_order_acquire);
+        if(b - t >= (Int64)capacity_) {
+            return false;
+        }
+
+        buffer_[b & (capacity_ - 1)].store(value, std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! 末尾から要素を取り出す。所有者のスレッドからのみ呼び出すこと。
+    bool Pop(T &value)
+    {
+        auto const b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_seq_cst);
+        auto t = top_.load(std::memory_order_seq_cst);
+
+        if(t > b) {
+            // 空だった
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        value = buffer_[b & (capacity_ - 1)].load(std::memory_order_relaxed);
+        if(t == b) {
+            // 最後の要素は Steal() と取り合いになるので、先頭を進めて確保する
+            bool const won = top_.compare_exchange_strong(t, t + 1,
+                                                          std::memory_order_seq_cst,
+                                                          std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    //! 先頭から要素を盗む。どのスレッドから呼び出してもよい。
+    /*! 空の場合や、他のスレッドとの取り合いに負けた場合は false を返す。
+     */
+    bool Steal(T &value)
+    {
+        auto t = top_.load(std::memory_order_seq_cst);
+        auto const b = bottom_.load(std::memory_order_seq_cst);
+        if(t >= b) {
+            return false;
+        }
+
+        auto const tmp = buffer_[t & (capacity_ - 1)].load(std::memory_order_relaxed);
+        if(top_.compare_exchange_strong(t, t + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed) == false)
+        {
+            return false;
+        }
+        value = tmp;
+        return true;
+    }
+
+    //! 空かどうか。他のスレッドが操作している間は、目安にしかならない
+    bool IsEmpty() const
+    {
+        return top_.load(std::memory_order_relaxed) >= bottom_.load(std::memory_order_relaxed);
+    }
+
+    //! 空にする。どのスレッドもこのキューを操作していないときに呼び出すこと。
+    void Clear()
+    {
+        top_.store(0, std::memory_order_relaxed);
+        bottom_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    UInt32 capacity_ = 0;
+    std::unique_ptr<std::atomic<T>[]> buffer_;
+    alignas(64) std::atomic<Int64> top_ = { 0 };
+    alignas(64) std::atomic<Int64> bottom_ = { 0 };
+};
+
+NS_HWM_END
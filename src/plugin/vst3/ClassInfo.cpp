@@ -21,6 +21,14 @@ ClassInfo2Data::ClassInfo2Data(Steinberg::PClassInfoW const &info)
 {
 }
 
+ClassInfo2Data::ClassInfo2Data(String sub_categories, String vendor, String version, String sdk_version)
+:    sub_categories_(std::move(sub_categories))
+,    vendor_(std::move(vendor))
+,    version_(std::move(version))
+,    sdk_version_(std::move(sdk_version))
+{
+}
+
 bool ClassInfo2Data::HasSubCategory(String elem) const
 {
     wxArrayString list = wxSplit(sub_categories_, L'|');
@@ -64,6 +72,16 @@ ClassInfo::ClassInfo(Steinberg::PClassInfoW const &info)
     std::copy(info.cid, info.cid + kCIDLength, cid_.begin());
 }
 
+ClassInfo::ClassInfo(CID const &cid, String name, String category, Steinberg::int32 cardinality,
+                     std::optional<ClassInfo2Data> classinfo2_data)
+:    cid_(cid)
+,    name_(std::move(name))
+,    category_(std::move(category))
+,    cardinality_(cardinality)
+,    classinfo2_data_(std::move(classinfo2_data))
+{
+}
+
 bool ClassInfo::IsEffect() const
 {
     return HasClassInfo2() && GetClassInfo2().HasSubCategory(L"fx");
@@ -10,6 +10,7 @@ class ClassInfo2Data
 public:
     ClassInfo2Data(Steinberg::PClassInfo2 const &info);
     ClassInfo2Data(Steinberg::PClassInfoW const &info);
+    ClassInfo2Data(String sub_categories, String vendor, String version, String sdk_version);
     
     String const &    GetSubCategories() const { return sub_categories_; }
     String const &    GetVendor() const { return vendor_; }
@@ -35,6 +36,9 @@ public:
     ClassInfo(Steinberg::PClassInfo const &info);
     ClassInfo(Steinberg::PClassInfo2 const &info);
     ClassInfo(Steinberg::PClassInfoW const &info);
+    //! 保存しておいた情報から構築する。（モジュールをロードせずにプラグインの情報を扱うため）
+    ClassInfo(CID const &cid, String name, String category, Steinberg::int32 cardinality,
+              std::optional<ClassInfo2Data> classinfo2_data = std::nullopt);
     
     CID const &    GetCID() const { return cid_; }
     String const &    GetName() const { return name_; }
@@ -12,6 +12,13 @@ FactoryInfo::FactoryInfo(PFactoryInfo const &info)
 ,    flags_(info.flags)
 {}
 
+FactoryInfo::FactoryInfo(String vendor, String url, String email, Steinberg::int32 flags)
+:    vendor_(std::move(vendor))
+,    url_(std::move(url))
+,    email_(std::move(email))
+,    flags_(flags)
+{}
+
 bool FactoryInfo::IsDiscardable() const
 {
     return (flags_ & Steinberg::PFactoryInfo::FactoryFlags::kClassesDiscardable) != 0;
@@ -47,4 +54,9 @@ String    FactoryInfo::GetEmail() const
     return email_;
 }
 
+Steinberg::int32 FactoryInfo::GetFlags() const
+{
+    return flags_;
+}
+
 NS_HWM_END
@@ -15,16 +15,20 @@ public:
     String    GetVendor() const;
     String    GetURL() const;
     String    GetEmail() const;
+    //! PFactoryInfo::FactoryFlags の組み合わせ
+    Steinberg::int32 GetFlags() const;
     
 public:
     FactoryInfo() {}
     FactoryInfo(Steinberg::PFactoryInfo const &info);
+    //! 保存しておいた情報から構築する。
+    FactoryInfo(String vendor, String url, String email, Steinberg::int32 flags);
     
 private:
     String vendor_;
     String url_;
     String email_;
-    Steinberg::int32 flags_;
+    Steinberg::int32 flags_ = 0;
 };
 
 
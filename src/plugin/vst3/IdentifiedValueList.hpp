@@ -1,6 +1,8 @@
 #pragma once
 
 #include <algorithm>
+#include <functional>
+#include <optional>
 #include <vector>
 
 NS_HWM_BEGIN
@@ -12,6 +14,11 @@ struct DefaultExtractor
     id_type operator()(T const &info) const { return info.id_; }
 };
 
+//! IDを持つ値を、追加した順に保持するリスト
+/*! IDからインデックスへのハッシュインデックス（オープンアドレス法、線形探索）を
+ *  要素の追加に合わせて更新するので、IDによる検索は平均 O(1) で行える。
+ *  パラメータが数万個あるプラグインでも、構築とIDによる検索が遅くならないようにしている。
+ */
 template<class T, class Extractor = DefaultExtractor<T>>
 class IdentifiedValueList
 {
@@ -48,19 +55,37 @@ public:
     //! @return (size_type)-1 if not found.
     size_type GetIndexByID(id_type id) const
     {
-        auto found = std::find_if(list_.begin(),
-                                  list_.end(),
-                                  [id](auto &x) { return Extractor{}(x) == id; }
-                                  );
-        if(found == list_.end()) { return -1; }
-        else { return found - list_.begin(); }
+        if(slots_.empty()) { return -1; }
+        
+        for(size_type i = GetHomeSlot(id); ; i = (i + 1) & GetSlotMask()) {
+            auto const &slot = slots_[i];
+            if(slot.index_ == kEmpty) { return -1; }
+            if(slot.id_ == id) { return slot.index_; }
+        }
     }
     
+    //! 要素を末尾に追加する。
+    /*! IDは重複してはならない。
+     *  （リリースビルドで重複したIDを追加した場合は、先に追加した要素がIDによる検索の対象になる）
+     */
     void AddItem(T const &item)
     {
         auto new_id = Extractor{}(item);
         assert(GetIndexByID(new_id) == -1);
         list_.push_back(item);
+        
+        if(NeedsRehash(list_.size())) {
+            Rehash(list_.size());
+        } else {
+            InsertIndex(new_id, list_.size() - 1);
+        }
+    }
+    
+    //! 少なくとも num 個の要素を、リストとインデックスの再確保なしに追加できるようにする。
+    void reserve(size_type num)
+    {
+        list_.reserve(num);
+        if(NeedsRehash(num)) { Rehash(num); }
     }
     
     size_type size() const { return list_.size(); }
@@ -70,7 +95,58 @@ public:
     const_iterator end() const { return list_.end(); }
     
 private:
+    static constexpr size_type kEmpty = -1;
+    static constexpr size_type kMinNumSlots = 16;
+    
+    struct Slot
+    {
+        id_type id_ = {};
+        size_type index_ = kEmpty;
+    };
+    
     std::vector<T> list_;
+    //! 要素数は0か2のべき乗。使用率が1/2を超えないように拡張する。
+    std::vector<Slot> slots_;
+    
+    size_type GetSlotMask() const { return slots_.size() - 1; }
+    
+    size_type GetHomeSlot(id_type id) const
+    {
+        // 連番のIDでも偏らないように、ハッシュ値を黄金比の定数で拡散する
+        auto const h = (UInt64)std::hash<id_type>{}(id) * 0x9E3779B97F4A7C15ull;
+        return (size_type)(h >> 32) & GetSlotMask();
+    }
+    
+    bool NeedsRehash(size_type num_items) const
+    {
+        return num_items * 2 > slots_.size();
+    }
+    
+    void InsertIndex(id_type id, size_type index)
+    {
+        for(size_type i = GetHomeSlot(id); ; i = (i + 1) & GetSlotMask()) {
+            auto &slot = slots_[i];
+            if(slot.index_ == kEmpty) {
+                slot.id_ = id;
+                slot.index_ = index;
+                return;
+            }
+            
+            // 重複したIDは、先に追加した要素を優先する
+            if(slot.id_ == id) { return; }
+        }
+    }
+    
+    void Rehash(size_type num_items)
+    {
+        size_type num_slots = kMinNumSlots;
+        while(num_items * 2 > num_slots) { num_slots *= 2; }
+        
+        slots_.assign(num_slots, Slot{});
+        for(size_type i = 0; i < list_.size(); ++i) {
+            InsertIndex(Extractor{}(list_[i]), i);
+        }
+    }
 };
 
 NS_HWM_END
@@ -0,0 +1,243 @@
+#include "StateSnapshotStore.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+NS_HWM_BEGIN
+
+namespace {
+    UInt64 const kPrime1 = 0x9E3779B185EBCA87ULL;
+    UInt64 const kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+    UInt64 const kPrime3 = 0x165667B19E3779F9ULL;
+    UInt64 const kPrime4 = 0x85EBCA77C2B2AE63ULL;
+    UInt64 const kPrime5 = 0x27D4EB2F165667C5ULL;
+
+    UInt64 RotateLeft(UInt64 x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    UInt64 Load64(char const *p)
+    {
+        UInt64 x;
+        std::memcpy(&x, p, sizeof(x));
+        return x;
+    }
+
+    UInt64 Round(UInt64 acc, UInt64 input)
+    {
+        acc += input * kPrime2;
+        acc = RotateLeft(acc, 31);
+        return acc * kPrime1;
+    }
+
+    UInt64 MergeRound(UInt64 acc, UInt64 value)
+    {
+        acc ^= Round(0, value);
+        return acc * kPrime1 + kPrime4;
+    }
+}
+
+StateSnapshotStore::StateSnapshotStore(size_t capacity)
+:   capacity_(capacity)
+{}
+
+StateSnapshotStore::SnapshotID StateSnapshotStore::Add(String name,
+                                                       ArrayRef<char const> processor_data,
+                                                       ArrayRef<char const> edit_controller_data)
+{
+    Snapshot snapshot;
+    snapshot.id_ = ++last_id_;
+    snapshot.name_ = std::move(name);
+    snapshot.processor_data_ = Intern(processor_data);
+    snapshot.edit_controller_data_ = Intern(edit_controller_data);
+
+    snapshots_.push_back(std::move(snapshot));
+    Shrink();
+
+    return last_id_;
+}
+
+std::optional<StateSnapshotStore::Snapshot> StateSnapshotStore::Get(SnapshotID id)
+{
+    auto it = Find(id);
+    if(it == snapshots_.end()) { return std::nullopt; }
+
+    snapshots_.splice(snapshots_.end(), snapshots_, it);
+    return snapshots_.back();
+}
+
+bool StateSnapshotStore::Contains(SnapshotID id) const
+{
+    return Find(id) != snapshots_.end();
+}
+
+bool StateSnapshotStore::Remove(SnapshotID id)
+{
+    auto it = Find(id);
+    if(it == snapshots_.end()) { return false; }
+
+    Erase(it);
+    return true;
+}
+
+void StateSnapshotStore::Clear()
+{
+    snapshots_.clear();
+    blobs_.clear();
+    memory_usage_ = 0;
+}
+
+std::vector<StateSnapshotStore::SnapshotID> StateSnapshotStore::GetSnapshotIDs() const
+{
+    std::vector<SnapshotID> ids;
+    ids.reserve(snapshots_.size());
+    for(auto const &snapshot: snapshots_) { ids.push_back(snapshot.id_); }
+    return ids;
+}
+
+size_t StateSnapshotStore::GetNumSnapshots() const
+{
+    return snapshots_.size();
+}
+
+size_t StateSnapshotStore::GetMemoryUsage() const
+{
+    return memory_usage_;
+}
+
+size_t StateSnapshotStore::GetCapacity() const
+{
+    return capacity_;
+}
+
+void StateSnapshotStore::SetCapacity(size_t capacity)
+{
+    capacity_ = capacity;
+    Shrink();
+}
+
+UInt64 StateSnapshotStore::Hash(ArrayRef<char const> data)
+{
+    // 4つの独立したレーンで32バイトずつ処理する、xxHash64と同じ構造のハッシュ関数
+    auto p = data.data();
+    auto const size = data.size();
+    auto const end = p + size;
+    UInt64 h = 0;
+
+    if(size >= 32) {
+        UInt64 v1 = kPrime1 + kPrime2;
+        UInt64 v2 = kPrime2;
+        UInt64 v3 = 0;
+        UInt64 v4 = 0 - kPrime1;
+
+        for( ; p + 32 <= end; p += 32) {
+            v1 = Round(v1, Load64(p));
+            v2 = Round(v2, Load64(p + 8));
+            v3 = Round(v3, Load64(p + 16));
+            v4 = Round(v4, Load64(p + 24));
+        }
+
+        h = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        h = MergeRound(h, v1);
+        h = MergeRound(h, v2);
+        h = MergeRound(h, v3);
+        h = MergeRound(h, v4);
+    } else {
+        h = kPrime5;
+    }
+
+    h += (UInt64)size;
+
+    for( ; p + 8 <= end; p += 8) {
+        h ^= Round(0, Load64(p));
+        h = RotateLeft(h, 27) * kPrime1 + kPrime4;
+    }
+
+    for( ; p < end; ++p) {
+        h ^= (UInt64)(unsigned char)*p * kPrime5;
+        h = RotateLeft(h, 11) * kPrime1;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+StateSnapshotStore::BlobPtr StateSnapshotStore::Intern(ArrayRef<char const> data)
+{
+    auto const hash = Hash(data);
+
+    auto range = blobs_.equal_range(hash);
+    for(auto it = range.first; it != range.second; ++it) {
+        auto const &blob = it->second;
+        // ハッシュ値が衝突している可能性があるので、内容も比較する
+        if(std::equal(blob->data_.begin(), blob->data_.end(), data.begin(), data.end())) {
+            return blob;
+        }
+    }
+
+    auto blob = std::make_shared<Blob>();
+    blob->hash_ = hash;
+    blob->data_.assign(data.begin(), data.end());
+
+    memory_usage_ += blob->data_.size();
+    blobs_.emplace(hash, blob);
+    return blob;
+}
+
+void StateSnapshotStore::Release(BlobPtr const &blob)
+{
+    if(!blob) { return; }
+
+    // ほかのスナップショットが参照していなければ削除する。
+    // 外部で Snapshot を保持している場合も、そのデータはこのクラスの管理から外れて、参照がなくなったときに解放される
+    bool const is_referenced = std::any_of(snapshots_.begin(), snapshots_.end(), [&](auto const &snapshot) {
+        return snapshot.processor_data_ == blob || snapshot.edit_controller_data_ == blob;
+    });
+    if(is_referenced) { return; }
+
+    auto range = blobs_.equal_range(blob->hash_);
+    for(auto it = range.first; it != range.second; ++it) {
+        if(it->second == blob) {
+            memory_usage_ -= blob->data_.size();
+            blobs_.erase(it);
+            return;
+        }
+    }
+}
+
+void StateSnapshotStore::Erase(std::list<Snapshot>::iterator it)
+{
+    auto const processor_data = std::move(it->processor_data_);
+    auto const edit_controller_data = std::move(it->edit_controller_data_);
+    snapshots_.erase(it);
+
+    Release(processor_data);
+    Release(edit_controller_data);
+}
+
+void StateSnapshotStore::Shrink()
+{
+    while(memory_usage_ > capacity_ && snapshots_.size() > 1) {
+        Erase(snapshots_.begin());
+    }
+}
+
+std::list<StateSnapshotStore::Snapshot>::iterator StateSnapshotStore::Find(SnapshotID id)
+{
+    return std::find_if(snapshots_.begin(), snapshots_.end(),
+                        [id](auto const &snapshot) { return snapshot.id_ == id; });
+}
+
+std::list<StateSnapshotStore::Snapshot>::const_iterator StateSnapshotStore::Find(SnapshotID id) const
+{
+    return std::find_if(snapshots_.begin(), snapshots_.end(),
+                        [id](auto const &snapshot) { return snapshot.id_ == id; });
+}
+
+NS_HWM_END
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "../../misc/ArrayRef.hpp"
+
+NS_HWM_BEGIN
+
+//! プラグインの状態のスナップショットを、メモリ上に保持するクラス
+/*! Vst3Plugin::SaveData() で取得したプロセッサーとエディットコントローラーの状態を、
+ *  内容のハッシュ値をキーにして保持する（content-addressed）。
+ *  同じ内容のデータは複数のスナップショットで共有するので、
+ *  A/B比較やUndoのために変更の少ない状態を何度保存しても、メモリの使用量はほとんど増えない。
+ *
+ *  データの合計サイズが容量を超えた場合は、最も長く使われていないスナップショットから削除する。
+ *  ただし、最後に追加したスナップショットは容量を超えていても削除しない。
+ *
+ *  このクラスはスレッドセーフではない。
+ *  ただし、取得した Blob は変更されないので、そのデータはどのスレッドからでも参照できる。
+ */
+class StateSnapshotStore final
+{
+public:
+    //! スナップショットのID。0は無効なID
+    using SnapshotID = UInt64;
+
+    //! 共有される、変更されないデータ
+    struct Blob
+    {
+        UInt64 hash_ = 0;
+        std::vector<char> data_;
+    };
+    using BlobPtr = std::shared_ptr<Blob const>;
+
+    struct Snapshot
+    {
+        SnapshotID id_ = 0;
+        String name_;
+        BlobPtr processor_data_;
+        BlobPtr edit_controller_data_;
+    };
+
+    //! @param capacity データの合計サイズの上限（バイト）
+    explicit StateSnapshotStore(size_t capacity);
+
+    //! スナップショットを追加する。
+    /*! 既存のデータと同じ内容のデータは、コピーせずに既存のデータを共有する。
+     *  @return 追加したスナップショットのID
+     */
+    SnapshotID Add(String name,
+                   ArrayRef<char const> processor_data,
+                   ArrayRef<char const> edit_controller_data);
+
+    //! スナップショットを取得して、最近使われたものとして扱う。
+    /*! 見つからない（削除された）場合は std::nullopt を返す。
+     */
+    std::optional<Snapshot> Get(SnapshotID id);
+
+    bool Contains(SnapshotID id) const;
+    bool Remove(SnapshotID id);
+    void Clear();
+
+    //! 保持しているスナップショットのID。最も長く使われていないものから順に並ぶ
+    std::vector<SnapshotID> GetSnapshotIDs() const;
+    size_t GetNumSnapshots() const;
+    //! 共有しているデータを重複して数えない、データの合計サイズ
+    size_t GetMemoryUsage() const;
+
+    size_t GetCapacity() const;
+    //! 容量を変更する。容量を超えている場合は、スナップショットを削除する
+    void SetCapacity(size_t capacity);
+
+    //! データのハッシュ値を計算する
+    static UInt64 Hash(ArrayRef<char const> data);
+
+private:
+    size_t capacity_ = 0;
+    size_t memory_usage_ = 0;
+    SnapshotID last_id_ = 0;
+    std::list<Snapshot> snapshots_;
+    std::unordered_multimap<UInt64, BlobPtr> blobs_;
+
+    BlobPtr Intern(ArrayRef<char const> data);
+    void Release(BlobPtr const &blob);
+    void Erase(std::list<Snapshot>::iterator it);
+    void Shrink();
+    std::list<Snapshot>::iterator Find(SnapshotID id);
+    std::list<Snapshot>::const_iterator Find(SnapshotID id) const;
+};
+
+NS_HWM_END
@@ -242,6 +242,37 @@ void Vst3Plugin::SetSamplingRate(int sampling_rate)
     pimpl_->SetSamplingRate(sampling_rate);
 }
 
+void Vst3Plugin::SetProcessMode(Steinberg::Vst::ProcessModes mode)
+{
+    assert(!IsResumed());
+    pimpl_->SetProcessMode(mode);
+}
+
+Steinberg::Vst::ProcessModes Vst3Plugin::GetProcessMode() const
+{
+    return pimpl_->GetProcessMode();
+}
+
+bool Vst3Plugin::CanProcessSampleSize(Steinberg::Vst::SymbolicSampleSizes size) const
+{
+    return pimpl_->CanProcessSampleSize(size);
+}
+
+void Vst3Plugin::SetSymbolicSampleSize(Steinberg::Vst::SymbolicSampleSizes size)
+{
+    pimpl_->SetSymbolicSampleSize(size);
+}
+
+Steinberg::Vst::SymbolicSampleSizes Vst3Plugin::GetSymbolicSampleSize() const
+{
+    return pimpl_->GetSymbolicSampleSize();
+}
+
+Steinberg::Vst::SymbolicSampleSizes Vst3Plugin::GetProcessingSampleSize() const
+{
+    return pimpl_->GetProcessingSampleSize();
+}
+
 bool Vst3Plugin::HasEditor() const
 {
     return pimpl_->HasEditor();
@@ -337,16 +368,68 @@ void Vst3Plugin::Process(ProcessInfo &pi)
     pimpl_->Process(pi);
 }
 
+LatencyHistogram::Summary Vst3Plugin::GetProcessTimeSummary() const
+{
+    return pimpl_->GetProcessTimeSummary();
+}
+
+UInt32 Vst3Plugin::GetLatencySamples() const
+{
+    return pimpl_->GetLatencySamples();
+}
+
 std::optional<Vst3Plugin::DumpData> Vst3Plugin::SaveData() const
 {
     return pimpl_->SaveData();
 }
 
 void Vst3Plugin::LoadData(DumpData const &dump)
+{
+    pimpl_->LoadData(DumpDataRef(dump));
+}
+
+void Vst3Plugin::LoadData(DumpDataRef const &dump)
 {
     pimpl_->LoadData(dump);
 }
 
+class Vst3Plugin::PreparedDumpData::Impl
+{
+public:
+    //! 復元するたびに読み込み位置を先頭に戻すので、mutableにしている
+    mutable MemoryStream processor_stream_;
+    mutable MemoryStream edit_controller_stream_;
+    bool has_edit_controller_data_ = false;
+};
+
+Vst3Plugin::PreparedDumpData::~PreparedDumpData()
+{}
+
+std::shared_ptr<Vst3Plugin::PreparedDumpData const> Vst3Plugin::PrepareData(DumpDataRef const &dump)
+{
+    auto prepared = std::make_shared<PreparedDumpData>();
+    prepared->pimpl_ = std::make_unique<PreparedDumpData::Impl>();
+    
+    auto &impl = *prepared->pimpl_;
+    impl.processor_stream_.write((void *)dump.processor_data_.data(), dump.processor_data_.size(), nullptr);
+    if(dump.edit_controller_data_.empty() == false) {
+        impl.edit_controller_stream_.write((void *)dump.edit_controller_data_.data(),
+                                           dump.edit_controller_data_.size(),
+                                           nullptr);
+        impl.has_edit_controller_data_ = true;
+    }
+    
+    return prepared;
+}
+
+void Vst3Plugin::LoadData(PreparedDumpData const &prepared)
+{
+    assert(prepared.pimpl_);
+    auto &impl = *prepared.pimpl_;
+    pimpl_->LoadData(impl.processor_stream_,
+                     impl.has_edit_controller_data_ ? &impl.edit_controller_stream_ : nullptr);
+}
+
 Vst3Plugin::Vst3PluginListenerService & Vst3Plugin::GetVst3PluginListenerService()
 {
     return host_context_->vpls_;
@@ -357,4 +440,20 @@ Vst3Plugin::Vst3PluginDestructionListenerService & Vst3Plugin::GetVst3PluginDest
     return vpdls_;
 }
 
+void ActivateAllBuses(Vst3Plugin *plugin)
+{
+    using MT = Steinberg::Vst::MediaTypes;
+    using BD = Steinberg::Vst::BusDirections;
+    
+    auto activate_all_buses = [plugin](MT media, BD dir) {
+        auto const num = plugin->GetNumBuses(media, dir);
+        for(int i = 0; i < num; ++i) { plugin->SetBusActive(media, dir, i); }
+    };
+    
+    activate_all_buses(MT::kAudio, BD::kInput);
+    activate_all_buses(MT::kAudio, BD::kOutput);
+    activate_all_buses(MT::kEvent, BD::kInput);
+    activate_all_buses(MT::kEvent, BD::kOutput);
+}
+
 NS_HWM_END
@@ -13,6 +13,7 @@
 #include "../../misc/ListenerService.hpp"
 #include "../../misc/Buffer.hpp"
 #include "../../misc/ArrayRef.hpp"
+#include "../../misc/LatencyHistogram.hpp"
 #include "./IdentifiedValueList.hpp"
 #include "./Vst3PluginFactory.hpp"
 
@@ -308,6 +309,27 @@ public:
 	void	SetBlockSize(int block_size);
     //! サンプリングレートを設定する
 	void	SetSamplingRate(int sampling_rate);
+    //! 処理モードを設定する。デフォルトは kRealtime
+    /*! オフラインレンダリング時は kOffline を指定する。
+     *  SetBlockSize() などと同じく、次の Resume() 呼び出し時に反映される。
+     */
+    void    SetProcessMode(Steinberg::Vst::ProcessModes mode);
+    //! 処理モードを返す
+    Steinberg::Vst::ProcessModes GetProcessMode() const;
+    //! 指定したサンプルのビット数で処理できるかどうかを返す。
+    bool    CanProcessSampleSize(Steinberg::Vst::SymbolicSampleSizes size) const;
+    //! 処理に使用するサンプルのビット数を設定する。デフォルトは kSample32
+    /*! kSample64 を指定すると、 Process() では ProcessInfo の倍精度のバッファを使用する。
+     *  プラグインが kSample64 に対応していない場合は kSample32 で処理する。
+     *  SetBlockSize() などと同じく、次の Resume() 呼び出し時に反映される。
+     */
+    void    SetSymbolicSampleSize(Steinberg::Vst::SymbolicSampleSizes size);
+    //! SetSymbolicSampleSize() で設定したサンプルのビット数を返す
+    Steinberg::Vst::SymbolicSampleSizes GetSymbolicSampleSize() const;
+    //! 実際に処理に使用しているサンプルのビット数を返す。
+    /*! Resume() 後に有効な値を返す。
+     */
+    Steinberg::Vst::SymbolicSampleSizes GetProcessingSampleSize() const;
     
     //!　エディター画面を持っているかどうかを返す
     bool    HasEditor() const;
@@ -377,20 +399,79 @@ public:
 	void	RestartComponent(Steinberg::int32 flag);
 
     //! 1フレーム分の合成処理を行う
+    /*! GetProcessingSampleSize() が kSample64 の場合は、
+     *  ProcessInfo::input_audio_buffer64_ / output_audio_buffer64_ を使用する。
+     */
 	void Process(ProcessInfo &pi);
     
+    //! AudioProcessor::process() の処理時間の分布を返す。(単位はマイクロ秒)
+    /*! Resume() するたびにリセットされる。どのスレッドから呼び出してもよい。
+     */
+    LatencyHistogram::Summary GetProcessTimeSummary() const;
+    
+    //! プラグインが報告した処理のレイテンシー（サンプル数）を返す。
+    /*! Resume() したときに取得し、プラグインから kLatencyChanged が通知されたときは
+     *  プラグインを再開し直して取得し直す。どのスレッドから呼び出してもよい。
+     */
+    UInt32 GetLatencySamples() const;
+    
     struct DumpData
     {
         std::vector<char> processor_data_;
         std::vector<char> edit_controller_data_;
     };
     
+    //! DumpData と同じ内容を、データをコピーせずに参照する
+    /*! マップしたプロジェクトファイルの領域などから、直接状態を復元するために使用する。
+     */
+    struct DumpDataRef
+    {
+        DumpDataRef() = default;
+        DumpDataRef(ArrayRef<char const> processor_data, ArrayRef<char const> edit_controller_data)
+        :   processor_data_(processor_data)
+        ,   edit_controller_data_(edit_controller_data)
+        {}
+        
+        DumpDataRef(DumpData const &dump)
+        :   processor_data_(dump.processor_data_)
+        ,   edit_controller_data_(dump.edit_controller_data_)
+        {}
+        
+        ArrayRef<char const> processor_data_;
+        ArrayRef<char const> edit_controller_data_;
+    };
+    
+    //! LoadData() で状態を復元するためのストリームを、あらかじめ作成しておいたもの
+    /*! 大きな状態のストリームへのコピーを別スレッドで済ませておき、
+     *  GUIスレッドでは状態の復元だけを行うために使用する。
+     *  同じオブジェクトを何度でも LoadData() に渡せるが、同時に複数のスレッドから渡してはいけない。
+     */
+    class PreparedDumpData
+    {
+    public:
+        ~PreparedDumpData();
+        
+        class Impl;
+        std::unique_ptr<Impl> pimpl_;
+    };
+    
+    //! dump から PreparedDumpData を作成する。
+    /*! プラグインには触れないので、どのスレッドからでも呼び出せる。
+     */
+    static std::shared_ptr<PreparedDumpData const> PrepareData(DumpDataRef const &dump);
+    
     //! プラグイン状態を保存する
     std::optional<DumpData> SaveData() const;
     
     //! プラグイン状態を復元する
     void LoadData(DumpData const &dump);
     
+    //! プラグイン状態を復元する
+    void LoadData(DumpDataRef const &dump);
+    
+    //! PrepareData() で作成したストリームから、プラグイン状態を復元する
+    void LoadData(PreparedDumpData const &prepared);
+    
     using Vst3PluginListenerService = IListenerService<IVst3PluginListener>;
     Vst3PluginListenerService & GetVst3PluginListenerService();
     
@@ -403,4 +484,9 @@ private:
     ListenerService<IVst3PluginDestructionListener> vpdls_;
 };
 
+//! プラグインのすべてのバス(オーディオ／イベント、入力／出力)をアクティブにする
+/*! @exception std::exception
+ */
+void ActivateAllBuses(Vst3Plugin *plugin);
+
 NS_HWM_END
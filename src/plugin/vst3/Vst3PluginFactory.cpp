@@ -1,10 +1,12 @@
 #include "Vst3PluginFactory.hpp"
 
 #include <algorithm>
+#include <condition_variable>
 #include <memory>
 #include <stdexcept>
 #include <vector>
 #include <map>
+#include <set>
 
 #include <pluginterfaces/base/ftypes.h>
 #include <public.sdk/source/vst/hosting/module.h>
@@ -241,6 +243,16 @@ class Vst3PluginFactoryList::Impl
 public:
     LockFactory lf_;
     std::map<String, std::shared_ptr<Vst3PluginFactory>> table_;
+    //! ScanModule() が lf_ のロックの外で一時的にロードしているモジュールのパス
+    std::set<String> scanning_;
+    //! scanning_ からパスが取り除かれたことを通知する
+    std::condition_variable cv_;
+    
+    //! module_path のスキャンが終わるまで待機する
+    void WaitForScan(std::unique_lock<std::mutex> &lock, String const &module_path)
+    {
+        cv_.wait(lock, [&] { return scanning_.count(module_path) == 0; });
+    }
 };
 
 Vst3PluginFactoryList::Vst3PluginFactoryList()
@@ -253,6 +265,7 @@ Vst3PluginFactoryList::~Vst3PluginFactoryList()
 std::shared_ptr<Vst3PluginFactory> Vst3PluginFactoryList::FindOrCreateFactory(String module_path)
 {
     auto lock = pimpl_->lf_.make_lock();
+    pimpl_->WaitForScan(lock, module_path);
     
     auto found = pimpl_->table_.find(module_path);
     if(found == pimpl_->table_.end()) {
@@ -270,6 +283,50 @@ std::shared_ptr<Vst3PluginFactory> Vst3PluginFactoryList::FindOrCreateFactory(St
     return found->second;
 }
 
+bool Vst3PluginFactoryList::ScanModule(String module_path,
+                                       FactoryInfo &factory_info,
+                                       std::vector<ClassInfo> &class_info_list)
+{
+    auto lock = pimpl_->lf_.make_lock();
+    
+    auto scan = [&](Vst3PluginFactory &factory) {
+        factory_info = factory.GetFactoryInfo();
+        class_info_list.clear();
+        for(size_t i = 0, end = factory.GetComponentCount(); i < end; ++i) {
+            class_info_list.push_back(factory.GetComponentInfo(i));
+        }
+    };
+    
+    pimpl_->WaitForScan(lock, module_path);
+    
+    auto found = pimpl_->table_.find(module_path);
+    if(found != pimpl_->table_.end()) {
+        scan(*found->second);
+        return true;
+    }
+    
+    // モジュールのロードには時間がかかることがあるので、ロックを解放してからロードする。
+    // 同じモジュールを二重にロードしないように、スキャン中のパスとして登録しておく。
+    pimpl_->scanning_.insert(module_path);
+    lock.unlock();
+    
+    bool succeeded = true;
+    try {
+        Vst3PluginFactory factory(module_path);
+        scan(factory);
+    } catch(std::exception &e) {
+        HWM_WARN_LOG(L"Failed to scan the module [" << module_path << L"]: " << to_wstr(e.what()));
+        succeeded = false;
+    }
+    
+    lock.lock();
+    pimpl_->scanning_.erase(module_path);
+    lock.unlock();
+    pimpl_->cv_.notify_all();
+    
+    return succeeded;
+}
+
 String Vst3PluginFactoryList::GetModulePath(Vst3PluginFactory *p) const
 {
     for(auto const &entry: pimpl_->table_) {
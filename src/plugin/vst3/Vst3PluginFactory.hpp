@@ -4,6 +4,7 @@
 #include <memory>
 #include <functional>
 #include <string>
+#include <vector>
 
 #include <pluginterfaces/gui/iplugview.h>
 #include <pluginterfaces/base/ipluginbase.h>
@@ -56,6 +57,17 @@ public:
     
     std::shared_ptr<Vst3PluginFactory> FindOrCreateFactory(String module_path);
     
+    //! モジュールのFactoryInfoとClassInfoを取得する。
+    /*! ロード済みのモジュールはそのファクトリから取得し、そうでなければ一時的にロードして、取得後にアンロードする。
+     *  一時的なロードはこのリストのロックの外で行うので、その間も他のモジュールの検索や作成はブロックしない。
+     *  同じモジュールの FindOrCreateFactory() と ScanModule() はスキャンが終わるまで待機するので、
+     *  同じモジュールが同時に二重にロードされることはない。
+     *  VST3 の規約どおり、モジュールをロードするスレッド（通常はGUIスレッド）から呼び出すこと。
+     *  アプリケーションのプラグインスキャンでは、プラグインスキャンプロセスのメインスレッドから呼び出す。
+     *  @return モジュールのロードに失敗した場合はfalse
+     */
+    bool ScanModule(String module_path, FactoryInfo &factory_info, std::vector<ClassInfo> &class_info_list);
+    
     //! 指定したVst3PluginFactory（このVst3PluginFactoryListでロード済みのもの）のパスを返す
     String GetModulePath(Vst3PluginFactory *p) const;
     
@@ -15,6 +15,7 @@
 
 #include "../../misc/StrCnv.hpp"
 #include "../../misc/ScopeExit.hpp"
+#include "../../log/RealtimeLogger.hpp"
 
 #include "VstMAUtils.hpp"
 #include "Vst3Plugin.hpp"
@@ -427,8 +428,15 @@ void Vst3Plugin::Impl::Resume()
     Vst::ProcessSetup new_setup = {};
     new_setup.maxSamplesPerBlock = block_size_;
     new_setup.sampleRate = sampling_rate_;
-    new_setup.symbolicSampleSize = Vst::SymbolicSampleSizes::kSample32;
-    new_setup.processMode = Vst::ProcessModes::kRealtime;
+    new_setup.symbolicSampleSize = symbolic_sample_size_;
+    new_setup.processMode = process_mode_;
+    
+    if(new_setup.symbolicSampleSize == Vst::SymbolicSampleSizes::kSample64
+       && CanProcessSampleSize(Vst::SymbolicSampleSizes::kSample64) == false)
+    {
+        HWM_WARN_LOG(L"The plugin doesn't support 64-bit processing. Fall back to 32-bit processing.");
+        new_setup.symbolicSampleSize = Vst::SymbolicSampleSizes::kSample32;
+    }
     
     if(new_setup != applied_process_setup_) {
         res = GetAudioProcessor()->setupProcessing(new_setup);
@@ -441,10 +449,18 @@ void Vst3Plugin::Impl::Resume()
 
     status_ = Status::kSetupDone;
     
-    auto prepare_bus_buffers = [&](AudioBusesInfo &buses, UInt32 block_size, Buffer<float> &buffer) {
+    auto prepare_bus_buffers = [&](AudioBusesInfo &buses, UInt32 block_size,
+                                   auto &buffer, auto &channel_ptrs)
+    {
+        using SampleType = std::remove_pointer_t<typename std::decay_t<decltype(channel_ptrs)>::value_type>;
+        
         buffer.resize(buses.GetNumChannels(), block_size);
         
-        auto data = buffer.data();
+        // AudioBusBuffersにはchannel_ptrsの領域を渡しておき、
+        // Process()のたびに各チャンネルの割り当て先を書き換える。
+        channel_ptrs.assign(buffer.data(), buffer.data() + buffer.channels());
+        
+        auto data = channel_ptrs.data();
         auto *bus_buffers = buses.GetBusBuffers();
         for(int i = 0; i < buses.GetNumBuses(); ++i) {
             auto &buffer = bus_buffers[i];
@@ -453,14 +469,34 @@ void Vst3Plugin::Impl::Resume()
             // 試しにここで、非アクティブなBusのchannelBuffers32にnumChannels個のnullptrからなる有効な配列を渡しても、
             // hostcheckerプラグインでエラー扱いになってしまう。
             // 詳細が不明なため、すべてのBusのすべてのチャンネルに対して、有効なバッファを割り当てるようにする。
-            buffer.channelBuffers32 = data;
+            if constexpr(std::is_same_v<SampleType, double>) {
+                buffer.channelBuffers64 = data;
+            } else {
+                buffer.channelBuffers32 = data;
+            }
             buffer.silenceFlags = (buses.IsActive(i) ? 0 : -1);
             data += buffer.numChannels;
         }
     };
     
-    prepare_bus_buffers(input_audio_buses_info_, block_size_, input_buffer_);
-    prepare_bus_buffers(output_audio_buses_info_, block_size_, output_buffer_);
+    // 使用しない方の精度のバッファは解放しておく。
+    if(GetProcessingSampleSize() == Vst::SymbolicSampleSizes::kSample64) {
+        prepare_bus_buffers(input_audio_buses_info_, block_size_, input_buffer64_, input_channel_ptrs64_);
+        prepare_bus_buffers(output_audio_buses_info_, block_size_, output_buffer64_, output_channel_ptrs64_);
+        input_buffer_.resize(0, 0);
+        output_buffer_.resize(0, 0);
+        input_channel_ptrs_.clear();
+        output_channel_ptrs_.clear();
+    } else {
+        prepare_bus_buffers(input_audio_buses_info_, block_size_, input_buffer_, input_channel_ptrs_);
+        prepare_bus_buffers(output_audio_buses_info_, block_size_, output_buffer_, output_channel_ptrs_);
+        input_buffer64_.resize(0, 0);
+        output_buffer64_.resize(0, 0);
+        input_channel_ptrs64_.clear();
+        output_channel_ptrs64_.clear();
+    }
+    
+    process_time_.Reset();
 
     res = GetComponent()->setActive(true);
     if(res != kResultOk && res != kNotImplemented) {
@@ -468,8 +504,10 @@ void Vst3Plugin::Impl::Resume()
     }
     
     status_ = Status::kActivated;
-        
-    HWM_DEBUG_LOG(L"Latency samples : " << GetAudioProcessor()->getLatencySamples());
+    
+    // レイテンシーはアクティブにした後で問い合わせる。
+    latency_samples_.store(GetAudioProcessor()->getLatencySamples());
+    HWM_DEBUG_LOG(L"Latency samples : " << latency_samples_.load());
 
     auto lock = lf_processing_.make_lock(std::try_to_lock);
     
@@ -517,6 +555,37 @@ void Vst3Plugin::Impl::SetSamplingRate(int sampling_rate)
     sampling_rate_ = sampling_rate;
 }
 
+void Vst3Plugin::Impl::SetProcessMode(Vst::ProcessModes mode)
+{
+    process_mode_ = mode;
+}
+
+Vst::ProcessModes Vst3Plugin::Impl::GetProcessMode() const
+{
+    return process_mode_;
+}
+
+bool Vst3Plugin::Impl::CanProcessSampleSize(Vst::SymbolicSampleSizes size) const
+{
+    assert(audio_processor_);
+    return audio_processor_->canProcessSampleSize(size) == kResultTrue;
+}
+
+void Vst3Plugin::Impl::SetSymbolicSampleSize(Vst::SymbolicSampleSizes size)
+{
+    symbolic_sample_size_ = size;
+}
+
+Vst::SymbolicSampleSizes Vst3Plugin::Impl::GetSymbolicSampleSize() const
+{
+    return symbolic_sample_size_;
+}
+
+Vst::SymbolicSampleSizes Vst3Plugin::Impl::GetProcessingSampleSize() const
+{
+    return (Vst::SymbolicSampleSizes)applied_process_setup_.symbolicSampleSize;
+}
+
 void Vst3Plugin::Impl::RestartComponent(Steinberg::int32 flags)
 {
     //! `Controller`側のパラメータが変更された
@@ -542,6 +611,16 @@ void Vst3Plugin::Impl::RestartComponent(Steinberg::int32 flags)
             Resume();
         }
     }
+    
+    // 他のフラグと同時に通知されることもあるので、独立して処理する。
+    // VST3の仕様では、レイテンシーの変更はアクティブにし直したときに反映される。
+    if((flags & Vst::RestartFlags::kLatencyChanged)) {
+        HWM_DEBUG_LOG(L"Latency changed");
+        if(IsResumed()) {
+            Suspend();
+            Resume();
+        }
+    }
 }
 
 std::optional<ProcessInfo::MidiMessage> ToProcessEvent(Vst::Event const &ev)
@@ -570,13 +649,13 @@ std::optional<ProcessInfo::MidiMessage> ToProcessEvent(Vst::Event const &ev)
         msg.channel_ = ev.polyPressure.channel;
         msg.data_ = pre;
     } else if(ev.type == Vst::Event::kDataEvent) {
-        HWM_DEBUG_LOG(L"Plugin sends data events.");
+        HWM_RT_DEBUG_LOG(L"Plugin sends data events.");
         return std::nullopt;
     } else if(ev.type == Vst::Event::kChordEvent) {
-        HWM_DEBUG_LOG(L"Plugin sends chord events.");
+        HWM_RT_DEBUG_LOG(L"Plugin sends chord events.");
         return std::nullopt;
     } else if(ev.type == Vst::Event::kScaleEvent) {
-        HWM_DEBUG_LOG(L"Plugin sends scake events.");
+        HWM_RT_DEBUG_LOG(L"Plugin sends scale events.");
         return std::nullopt;
     }
     
@@ -594,11 +673,8 @@ std::optional<Vst::Event> const ToVstEvent(ProcessInfo::MidiMessage const &msg)
     using namespace MidiDataType;
     
     if(auto note_on = msg.As<NoteOn>()) {
-        HWM_DEBUG_LOG(L"Input Note On Event"
-                      << L" channel: " << msg.channel_
-                      << L" pitch:   " << note_on->pitch_
-                      << L" velocity:" << note_on->velocity_
-                      );
+        HWM_RT_DEBUG_LOG(L"Input Note On Event channel: {} pitch: {} velocity: {}",
+                         msg.channel_, note_on->pitch_, note_on->velocity_);
         e.type = Vst::Event::kNoteOnEvent;
         e.noteOn.channel = msg.channel_;
         e.noteOn.pitch = note_on->pitch_;
@@ -608,11 +684,8 @@ std::optional<Vst::Event> const ToVstEvent(ProcessInfo::MidiMessage const &msg)
         e.noteOn.noteId = -1;
         return e;
     } else if(auto note_off = msg.As<NoteOff>()){
-        HWM_DEBUG_LOG(L"Input Note Off Event"
-                      << L" channel: " << msg.channel_
-                      << L" pitch:   " << note_off->pitch_
-                      << L" velocity:" << note_off->off_velocity_
-                      );
+        HWM_RT_DEBUG_LOG(L"Input Note Off Event channel: {} pitch: {} velocity: {}",
+                         msg.channel_, note_off->pitch_, note_off->off_velocity_);
 
         e.type = Vst::Event::kNoteOffEvent;
         e.noteOff.channel = msg.channel_;
@@ -622,11 +695,8 @@ std::optional<Vst::Event> const ToVstEvent(ProcessInfo::MidiMessage const &msg)
         e.noteOff.noteId = -1;
         return e;
     } else if(auto poly_press = msg.As<PolyphonicKeyPressure>()) {
-        HWM_DEBUG_LOG(L"Input Polyphonic Key Pressure Event"
-                      << L" channel: " << msg.channel_
-                      << L" pitch:   " << poly_press->pitch_
-                      << L" pressure:" << poly_press->value_
-                      );
+        HWM_RT_DEBUG_LOG(L"Input Polyphonic Key Pressure Event channel: {} pitch: {} pressure: {}",
+                         msg.channel_, poly_press->pitch_, poly_press->value_);
         
         e.type = Vst::Event::kPolyPressureEvent;
         e.polyPressure.channel = msg.channel_;
@@ -701,9 +771,51 @@ void Vst3Plugin::Impl::OutputEvents(ProcessInfo::IEventBufferList *buffers,
     }
 }
 
+namespace {
+
+//! tresult を、リアルタイムログの書き出し用のスレッドで文字列に変換する
+String FormatTResult(Int64 value)
+{
+    return tresult_to_wstring((tresult)value);
+}
+
+template<class T>
+void BindInputChannels(BufferRef<T const> &src, Buffer<T> &buffer, std::vector<T *> &channel_ptrs, SampleCount length)
+{
+    assert(src.channels() == 0 || src.samples() >= length);
+    for(UInt32 ch = 0; ch < channel_ptrs.size(); ++ch) {
+        if(ch < src.channels()) {
+            // プラグインは入力バッファに書き込まないので、constを外して渡す。
+            channel_ptrs[ch] = const_cast<T *>(src.get_channel_data(ch));
+        } else {
+            channel_ptrs[ch] = buffer.data()[ch];
+            std::fill_n(channel_ptrs[ch], length, T(0));
+        }
+    }
+}
+
+template<class T>
+void BindOutputChannels(BufferRef<T> &dest, Buffer<T> &buffer, std::vector<T *> &channel_ptrs, SampleCount length)
+{
+    assert(dest.channels() == 0 || dest.samples() >= length);
+    for(UInt32 ch = 0; ch < channel_ptrs.size(); ++ch) {
+        if(ch < dest.channels()) {
+            channel_ptrs[ch] = dest.get_channel_data(ch);
+        } else {
+            // 呼び出し側に返さないチャンネル。プラグインが書き込むだけなのでクリアしない。
+            channel_ptrs[ch] = buffer.data()[ch];
+        }
+    }
+}
+
+} // namespace
+
 void Vst3Plugin::Impl::Process(ProcessInfo pi)
 {
-    auto lock = lf_processing_.make_lock();
+    // オーディオスレッドをブロックしないように、
+    // Suspend()などでロックされている場合はこのブロックの処理をスキップする。
+    auto lock = lf_processing_.make_lock(std::try_to_lock);
+    if(!lock) { return; }
     
     if(status_ != Status::kProcessing) { return; }
 
@@ -730,37 +842,26 @@ void Vst3Plugin::Impl::Process(ProcessInfo pi)
     output_events_.clear();
     input_params_.clearQueue();
     output_params_.clearQueue();
-    input_buffer_.fill();
-    output_buffer_.fill();
     
     InputEvents(pi.input_event_buffers_, ctx);
     
-    auto copy_buffer = [&](BufferRef<const float> src, BufferRef<float> dest,
-                           SampleCount length_to_copy)
-    {
-        size_t const min_ch = std::min(src.channels(), dest.channels());
-        if(min_ch == 0) { return; }
-
-        assert(src.samples() >= length_to_copy);
-        assert(dest.samples() >= length_to_copy);
-        
-        for(size_t ch = 0; ch < min_ch; ++ch) {
-            std::copy_n(src.get_channel_data(ch),
-                        length_to_copy,
-                        dest.get_channel_data(ch));
-        }
-    };
-    
-    copy_buffer(pi.input_audio_buffer_, input_buffer_,
-                sample_length
-                );
+    // 呼び出し側のバッファに対応するチャンネルがあれば、AudioBusBuffersのチャンネルにそのバッファを直接割り当てる。
+    // 対応するチャンネルがない場合だけ、内部バッファを使用する。
+    auto const sample_size = GetProcessingSampleSize();
+    if(sample_size == Vst::SymbolicSampleSizes::kSample64) {
+        BindInputChannels(pi.input_audio_buffer64_, input_buffer64_, input_channel_ptrs64_, sample_length);
+        BindOutputChannels(pi.output_audio_buffer64_, output_buffer64_, output_channel_ptrs64_, sample_length);
+    } else {
+        BindInputChannels(pi.input_audio_buffer_, input_buffer_, input_channel_ptrs_, sample_length);
+        BindOutputChannels(pi.output_audio_buffer_, output_buffer_, output_channel_ptrs_, sample_length);
+    }
 
     PopFrontParameterChanges(input_params_);
 
     Vst::ProcessData process_data;
     process_data.processContext = &ctx;
-    process_data.processMode = Vst::ProcessModes::kRealtime;
-    process_data.symbolicSampleSize = Vst::SymbolicSampleSizes::kSample32;
+    process_data.processMode = applied_process_setup_.processMode;
+    process_data.symbolicSampleSize = sample_size;
     process_data.numSamples = sample_length;
     process_data.numInputs = input_audio_buses_info_.GetNumBuses();
     process_data.numOutputs = output_audio_buses_info_.GetNumBuses();
@@ -771,66 +872,80 @@ void Vst3Plugin::Impl::Process(ProcessInfo pi)
     process_data.inputParameterChanges = &input_params_;
     process_data.outputParameterChanges = &output_params_;
 
+    auto const process_begin = std::chrono::steady_clock::now();
     auto const res = GetAudioProcessor()->process(process_data);
+    auto const process_end = std::chrono::steady_clock::now();
+    process_time_.Record(std::chrono::duration_cast<std::chrono::microseconds>(process_end - process_begin).count());
+    
     if(res != kResultOk) {
-        HWM_WARN_LOG(L"process failed: " << to_wstr(tresult_to_string(res)));
+        HWM_RT_WARN_LOG(L"process failed: {}", RealtimeLogFormattedInt { res, FormatTResult });
     }
     
     OutputEvents(pi.output_event_buffers_, ctx);
     
     static bool kOutputParameter = false;
 
-    
-    copy_buffer(output_buffer_, pi.output_audio_buffer_,
-                sample_length
-                );
-
     for(int i = 0; i < output_params_.getParameterCount(); ++i) {
         auto *queue = output_params_.getParameterData(i);
         if(queue && queue->getPointCount() > 0 && kOutputParameter) {
-            HWM_WARN_LOG(L"Output parameter count [" << i << L"] : " << queue->getPointCount());
+            HWM_RT_WARN_LOG(L"Output parameter count [{}] : {}", i, queue->getPointCount());
         }
     }
 }
 
 void Vst3Plugin::Impl::PushBackParameterChange(Vst::ParamID id, Vst::ParamValue value, SampleCount offset)
 {
-    auto lock = lf_parameter_queue_.make_lock();
-    
-    Steinberg::int32 parameter_index = 0;
-    auto *queue = param_changes_queue_.addParameterData(id, parameter_index);
-    Steinberg::int32 ref_point_index = 0;
-    queue->addPoint(offset, value, ref_point_index);
-    (void)ref_point_index; // currently unused.
+    ParameterChange pc;
+    pc.id_ = id;
+    pc.value_ = value;
+    pc.offset_ = (Steinberg::int32)offset;
+    
+    // 満杯の場合はキュー側で破棄した数が記録される。
+    // オーディオスレッドからも呼び出されるので、ここではログを出力しない。
+    param_changes_queue_.TryPush(pc);
 }
 
-void Vst3Plugin::Impl::PopFrontParameterChanges(Vst::ParameterChanges &dest)
+LatencyHistogram::Summary Vst3Plugin::Impl::GetProcessTimeSummary() const
 {
-    auto lock = lf_parameter_queue_.make_lock();
+    return process_time_.GetSummary();
+}
 
-    for(size_t i = 0; i < param_changes_queue_.getParameterCount(); ++i) {
-        auto *src_queue = param_changes_queue_.getParameterData(i);
-        auto const src_id = src_queue->getParameterId();
-        
-        if(src_id == Vst::kNoParamId || src_queue->getPointCount() == 0) {
-            continue;
-        }
+UInt32 Vst3Plugin::Impl::GetLatencySamples() const
+{
+    return latency_samples_.load();
+}
 
-        Steinberg::int32 ref_queue_index;
-        auto dest_queue = dest.addParameterData(src_queue->getParameterId(), ref_queue_index);
+UInt64 Vst3Plugin::Impl::GetNumDroppedParameterChanges() const
+{
+    return param_changes_queue_.GetNumOverflows();
+}
 
-        for(size_t v = 0; v < src_queue->getPointCount(); ++v) {
-            Steinberg::int32 ref_offset;
-            Vst::ParamValue ref_value;
-            tresult result = src_queue->getPoint(v, ref_offset, ref_value);
-            if(result != kResultTrue) { continue; }
-            
-            Steinberg::int32 ref_point_index;
-            dest_queue->addPoint(ref_offset, ref_value, ref_point_index);
+UInt64 Vst3Plugin::Impl::GetNumCoalescedParameterChanges() const
+{
+    return num_coalesced_parameter_changes_.load(std::memory_order_relaxed);
+}
+
+void Vst3Plugin::Impl::PopFrontParameterChanges(Vst::ParameterChanges &dest)
+{
+    // destはsetMaxParameters()でパラメータ数分のキューを確保済みで、ブロックごとにclearQueue()して使い回す。
+    // 各パラメータのキューの容量も解放されずに残るので、定常状態ではここでメモリの確保は発生しない。
+    ParameterChange pc;
+    while(param_changes_queue_.TryPop(pc)) {
+        if(pc.id_ == Vst::kNoParamId) { continue; }
+        
+        Steinberg::int32 ref_queue_index = 0;
+        auto dest_queue = dest.addParameterData(pc.id_, ref_queue_index);
+        if(!dest_queue) { continue; }
+        
+        auto const num_points = dest_queue->getPointCount();
+        Steinberg::int32 ref_point_index = 0;
+        dest_queue->addPoint(pc.offset_, pc.value_, ref_point_index);
+        
+        // 同じサンプル位置のポイントがすでにある場合、addPoint()はその値を上書きする
+        if(dest_queue->getPointCount() == num_points) {
+            num_coalesced_parameter_changes_.fetch_add(1, std::memory_order_relaxed);
         }
     }
-
-    param_changes_queue_.clearQueue();
 }
 
 void Vst3Plugin::Impl::LoadInterfaces(IPluginFactory *factory, ClassInfo const &info, FUnknown *host_context)
@@ -997,6 +1112,8 @@ void Vst3Plugin::Impl::Initialize()
 
 void Vst3Plugin::Impl::PrepareParameters()
 {
+    parameter_info_list_.reserve(std::max<Steinberg::int32>(edit_controller_->getParameterCount(), 0));
+    
     for(Steinberg::int32 i = 0; i < edit_controller_->getParameterCount(); ++i) {
         Vst::ParameterInfo vpi = {};
         edit_controller_->getParameterInfo(i, vpi);
@@ -1059,15 +1176,21 @@ Vst3Plugin::ProgramList CreateProgramList(Vst::IUnitInfo *unit_handler, Vst::Pro
     return pl;
 };
 
-Vst::ParamID FindProgramChangeParam(Vst3Plugin::Impl::ParameterInfoList &list, Vst::UnitID unit_id)
+//! ユニットごとに、最初に見つかったプログラムチェンジのパラメータを返す
+/*! ユニットごとにパラメータを走査すると、パラメータとユニットの多いプラグインで遅くなるので、
+ *  一度の走査でまとめて取得する。
+ */
+std::unordered_map<Vst::UnitID, Vst::ParamID>
+FindProgramChangeParams(Vst3Plugin::Impl::ParameterInfoList const &list)
 {
+    std::unordered_map<Vst::UnitID, Vst::ParamID> params;
     for(auto &entry: list) {
-        if(entry.unit_id_ == unit_id && entry.is_program_change_) {
-            return entry.id_;
+        if(entry.is_program_change_) {
+            params.emplace(entry.unit_id_, entry.id_);
         }
     }
     
-    return Vst::kNoParamId;
+    return params;
 }
 
 void Vst3Plugin::Impl::PrepareUnitInfo()
@@ -1076,6 +1199,9 @@ void Vst3Plugin::Impl::PrepareUnitInfo()
     
     size_t const num = unit_handler_->getUnitCount();
     assert(num >= 1); // 少なくとも、unitID = 0のunitは用意されているはず。
+    
+    unit_info_list_.reserve(num + 1);
+    auto const program_change_params = FindProgramChangeParams(parameter_info_list_);
 
     for(size_t i = 0; i < num; ++i) {
         Vst::UnitInfo vui;
@@ -1086,7 +1212,8 @@ void Vst3Plugin::Impl::PrepareUnitInfo()
         ui.parent_id_ = vui.parentUnitId;
         if(vui.programListId != Vst::kNoProgramListId) {
             ui.program_list_ = CreateProgramList(unit_handler_.get(), vui.programListId);
-            ui.program_change_param_ = FindProgramChangeParam(parameter_info_list_, vui.id);
+            auto found = program_change_params.find(vui.id);
+            ui.program_change_param_ = (found != program_change_params.end()) ? found->second : Vst::kNoParamId;
         }
         
         assert(unit_info_list_.GetIndexByID(ui.id_) == -1); // id should be unique.
@@ -1115,7 +1242,12 @@ void Vst3Plugin::Impl::UnloadPlugin()
     if(status_ == Status::kActivated || status_ == Status::kProcessing) {
         Suspend();
     }
-    
+
+    if(auto const n = GetNumDroppedParameterChanges()) {
+        HWM_WARN_LOG(L"Parameter changes dropped because the queue was full: " << n);
+    }
+    HWM_DEBUG_LOG(L"Coalesced parameter changes: " << GetNumCoalescedParameterChanges());
+
     auto cp_comp = queryInterface<Vst::IConnectionPoint>(component_);
     auto cp_edit = queryInterface<Vst::IConnectionPoint>(edit_controller_);
     
@@ -1168,26 +1300,35 @@ std::optional<Vst3Plugin::DumpData> Vst3Plugin::Impl::SaveData() const
     return ret;
 }
 
-void Vst3Plugin::Impl::LoadData(DumpData const &dump)
+void Vst3Plugin::Impl::LoadData(DumpDataRef const &dump)
 {
     //! Melodyne crashes if a non-owned version of MemoryStream is used.
-    MemoryStream stream;
-    stream.write((void *)dump.processor_data_.data(), dump.processor_data_.size(), nullptr);
-    stream.seek(0, Steinberg::IBStream::kIBSeekSet, nullptr);
+    MemoryStream processor_stream;
+    processor_stream.write((void *)dump.processor_data_.data(), dump.processor_data_.size(), nullptr);
+    
+    MemoryStream edit_controller_stream;
+    if(dump.edit_controller_data_.empty() == false) {
+        edit_controller_stream.write((void *)dump.edit_controller_data_.data(), dump.edit_controller_data_.size(), nullptr);
+    }
     
-    if(ShowError(component_->setState(&stream), L"setState") != kResultOk) {
+    LoadData(processor_stream,
+             dump.edit_controller_data_.empty() ? nullptr : &edit_controller_stream);
+}
+
+void Vst3Plugin::Impl::LoadData(MemoryStream &processor_stream, MemoryStream *edit_controller_stream)
+{
+    processor_stream.seek(0, Steinberg::IBStream::kIBSeekSet, nullptr);
+    
+    if(ShowError(component_->setState(&processor_stream), L"setState") != kResultOk) {
         return;
     }
     
-    stream.seek(0, Steinberg::IBStream::kIBSeekSet, nullptr);
-    ShowError(edit_controller_->setComponentState(&stream), L"setComponentState");
+    processor_stream.seek(0, Steinberg::IBStream::kIBSeekSet, nullptr);
+    ShowError(edit_controller_->setComponentState(&processor_stream), L"setComponentState");
     
-    if(dump.edit_controller_data_.empty() == false) {
-        stream = MemoryStream();
-        stream.write((void *)dump.edit_controller_data_.data(), dump.edit_controller_data_.size(), nullptr);
-        stream.seek(0, Steinberg::IBStream::kIBSeekSet, nullptr);
-        
-        ShowError(edit_controller_->setState(&stream), L"setState to IEditController");
+    if(edit_controller_stream) {
+        edit_controller_stream->seek(0, Steinberg::IBStream::kIBSeekSet, nullptr);
+        ShowError(edit_controller_->setState(edit_controller_stream), L"setState to IEditController");
     }
 }
 
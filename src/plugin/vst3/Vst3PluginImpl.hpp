@@ -19,6 +19,7 @@
 #include <pluginterfaces/vst/ivstevents.h>
 #include <pluginterfaces/base/ustring.h>
 #include <pluginterfaces/vst/vstpresetkeys.h>
+#include <public.sdk/source/common/memorystream.h>
 
 #include "VstMAUtils.hpp"
 #include "Vst3Plugin.hpp"
@@ -29,6 +30,7 @@
 #include "../../misc/Flag.hpp"
 #include "../../misc/Buffer.hpp"
 #include "../../misc/LockFactory.hpp"
+#include "../../misc/MpscQueue.hpp"
 
 NS_HWM_BEGIN
 
@@ -124,20 +126,43 @@ public:
 
 	void SetSamplingRate(int sampling_rate);
 
+    void SetProcessMode(Vst::ProcessModes mode);
+    Vst::ProcessModes GetProcessMode() const;
+    bool CanProcessSampleSize(Vst::SymbolicSampleSizes size) const;
+    void SetSymbolicSampleSize(Vst::SymbolicSampleSizes size);
+    Vst::SymbolicSampleSizes GetSymbolicSampleSize() const;
+    Vst::SymbolicSampleSizes GetProcessingSampleSize() const;
+
 	void	RestartComponent(Steinberg::int32 flags);
 
 	void    Process(ProcessInfo pi);
     
+    LatencyHistogram::Summary GetProcessTimeSummary() const;
+    
+    UInt32 GetLatencySamples() const;
+    
     std::optional<DumpData> SaveData() const;
-    void LoadData(DumpData const &dump);
+    void LoadData(DumpDataRef const &dump);
+    //! edit_controller_stream がnullptrの場合は、エディットコントローラーの状態は復元しない
+    void LoadData(Steinberg::MemoryStream &processor_stream, Steinberg::MemoryStream *edit_controller_stream);
 
 //! Parameter Change
 public:
-	//! PopFrontParameterChangesとの呼び出しはスレッドセーフ
+	//! パラメータの変更をキューに追加する。
+    /*! 複数のスレッドから同時に呼び出せる。ロックもメモリの確保も行わない。
+     *  キューが満杯の場合、その変更は破棄される。
+     */
 	void PushBackParameterChange(Vst::ParamID id, Vst::ParamValue value, SampleCount offset = 0);
     
+    //! キューが満杯で破棄されたパラメータの変更の数
+    UInt64 GetNumDroppedParameterChanges() const;
+    //! 同じパラメータ・同じサンプル位置の変更が、後の変更で上書きされた数
+    UInt64 GetNumCoalescedParameterChanges() const;
+    
 private:
-    //! PushBackParameterChangeとの呼び出しはスレッドセーフ
+    //! キューに溜まったパラメータの変更を取り出して、destに追加する。
+    /*! オーディオスレッドから呼び出す。
+     */
     void PopFrontParameterChanges(Vst::ParameterChanges &dest);
     
     void InputEvents(ProcessInfo::IEventBufferList const *buffers,
@@ -178,6 +203,8 @@ public:
 
 	int	sampling_rate_;
 	int block_size_;
+    Vst::ProcessModes process_mode_ = Vst::ProcessModes::kRealtime;
+    Vst::SymbolicSampleSizes symbolic_sample_size_ = Vst::SymbolicSampleSizes::kSample32;
     
     void UpdateBusBuffers();
     
@@ -209,17 +236,40 @@ public:
     MidiBusesInfo input_midi_buses_info_;
     MidiBusesInfo output_midi_buses_info_;
     
-    // Vst3Plugin側にバッファを持たせないで、外側にあるバッファを使い回すほうが、コピーの手間が減っていいが、
-    // ちょっと設計がややこしくなるので、いまはここにバッファを持たせるようにしておく。
+    // Process()では、ProcessInfoのバッファのチャンネルをAudioBusBuffersに直接割り当てる。
+    // ここのバッファは、ProcessInfoのバッファに対応するチャンネルがない場合にだけ使用する。
     Buffer<float> input_buffer_;
     Buffer<float> output_buffer_;
+    //! AudioBusBuffers::channelBuffers32が指すチャンネルのポインタの配列
+    std::vector<float *> input_channel_ptrs_;
+    std::vector<float *> output_channel_ptrs_;
+    // kSample64で処理する場合は、以下の倍精度のバッファを使用する。
+    Buffer<double> input_buffer64_;
+    Buffer<double> output_buffer64_;
+    //! AudioBusBuffers::channelBuffers64が指すチャンネルのポインタの配列
+    std::vector<double *> input_channel_ptrs64_;
+    std::vector<double *> output_channel_ptrs64_;
     
     std::atomic<Status> status_;
+    //! Resume() 時に IAudioProcessor::getLatencySamples() から取得したレイテンシー
+    std::atomic<UInt32> latency_samples_ = { 0 };
     
 private:
     LockFactory lf_processing_;
-    LockFactory lf_parameter_queue_;
-    Vst::ParameterChanges   param_changes_queue_;
+    
+    struct ParameterChange
+    {
+        Vst::ParamID id_ = Vst::kNoParamId;
+        Vst::ParamValue value_ = 0;
+        Steinberg::int32 offset_ = 0;
+    };
+    
+    static constexpr UInt32 kParameterChangeQueueCapacity = 4096;
+    MpscQueue<ParameterChange> param_changes_queue_ { kParameterChangeQueueCapacity };
+    std::atomic<UInt64> num_coalesced_parameter_changes_ = { 0 };
+    
+    //! AudioProcessor::process() の処理時間 [マイクロ秒]
+    LatencyHistogram process_time_;
     
     Vst::ParameterChanges input_params_;
     Vst::ParameterChanges output_params_;
@@ -3,174 +3,287 @@
 #include <cassert>
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <type_traits>
 #include <vector>
 
 #include "./ProcessInfo.hpp"
 
 NS_HWM_BEGIN
 
+static_assert(std::is_trivially_copyable<ProcessInfo::MidiMessage>::value,
+              "MidiMessage must be trivially copyable to be stored in the preallocated event buffer");
+
+//! 固定長のMIDIイベントバッファ
+/*! 容量はコンストラクタで確保し、それ以降はメモリの確保を行わない。
+ *  容量を超えて追加されたイベントは破棄して、 GetNumOverflowedEvents() で報告する。
+ *
+ *  キーボード、MIDIデバイス、キャッシュされたノートオフなど、イベントの追加元ごとには
+ *  時刻順に並んでいることを前提に、Sort() では昇順の区間同士をマージするだけで整列する。
+ */
 struct EventBuffer : public ProcessInfo::IEventBuffer
 {
     constexpr static UInt32 kNumMIDIPitches = 128;
     constexpr static UInt32 kNumMIDIChannels = 16;
-    
-    EventBuffer(UInt32 num_initial_size = 2048)
+    constexpr static UInt32 kDefaultCapacity = 2048;
+
+    EventBuffer(UInt32 capacity = kDefaultCapacity)
+    :   events_(capacity)
+    ,   scratch_(capacity)
+    ,   note_off_cache_(kNumMIDIPitches * kNumMIDIChannels)
     {
-        events_.reserve(num_initial_size);
-        std::for_each(note_stack_.begin(), note_stack_.end(), [](auto &x) { x.store(0); });
-        note_off_cache_.reserve(kNumMIDIPitches);
+        active_notes_.fill(0);
     }
-    
+
     EventBuffer(EventBuffer const &rhs)
-    {
-        events_ = rhs.events_;
-        note_off_cache_ = rhs.note_off_cache_;
-    }
-    
+    :   events_(rhs.events_)
+    ,   scratch_(rhs.scratch_.size())
+    ,   num_events_(rhs.num_events_)
+    ,   active_notes_(rhs.active_notes_)
+    ,   note_off_cache_(rhs.note_off_cache_)
+    ,   num_cached_note_offs_(rhs.num_cached_note_offs_)
+    ,   num_overflowed_events_(rhs.GetNumOverflowedEvents())
+    {}
+
     EventBuffer & operator=(EventBuffer const &rhs)
     {
         events_ = rhs.events_;
+        scratch_.resize(rhs.scratch_.size());
+        num_events_ = rhs.num_events_;
+        active_notes_ = rhs.active_notes_;
         note_off_cache_ = rhs.note_off_cache_;
-        std::for_each(note_stack_.begin(), note_stack_.end(), [](auto &x) { x.store(0); });
-        
+        num_cached_note_offs_ = rhs.num_cached_note_offs_;
+        num_overflowed_events_.store(rhs.GetNumOverflowedEvents());
+
         return *this;
     }
-    
+
     void AddEvent(ProcessInfo::MidiMessage const &msg) override
     {
+        if(num_events_ == events_.size()) {
+            num_overflowed_events_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
         if(auto p = msg.As<MidiDataType::NoteOn>()) {
-            GetNoteStack(p->pitch_, msg.channel_).fetch_add(1);
+            SetNoteActive(p->pitch_, msg.channel_, true);
         } else if(auto p = msg.As<MidiDataType::NoteOff>()) {
-            auto &ref = GetNoteStack(p->pitch_, msg.channel_);
-            for( ; ; ) {
-                auto current = ref.load();
-                if(current == 0) { break; }
-                if(ref.compare_exchange_strong(current, current - 1)) {
-                    break;
-                }
-            }
+            SetNoteActive(p->pitch_, msg.channel_, false);
         }
-        
-        events_.push_back(msg);
+
+        events_[num_events_++] = msg;
     }
-    
+
     ProcessInfo::MidiMessage const & GetEvent(UInt32 index) const override
     {
-        assert(index < events_.size());
+        assert(index < num_events_);
         return events_[index];
     }
-    
+
     UInt32 GetCount() const override
     {
-        return events_.size();
+        return num_events_;
     }
-    
+
     ArrayRef<ProcessInfo::MidiMessage const> GetRef() const override
     {
-        return events_;
+        return ArrayRef<ProcessInfo::MidiMessage const>(events_.data(), events_.data() + num_events_);
     }
-    
+
     void AddEvents(ArrayRef<ProcessInfo::MidiMessage const> ref)
     {
         for(auto m: ref) {
             AddEvent(m);
         }
     }
-    
+
     void Clear()
     {
-        events_.clear();
+        num_events_ = 0;
     }
-    
+
+    //! 保持できるイベントの数
+    UInt32 GetCapacity() const { return events_.size(); }
+
+    //! 容量を超えたために破棄したイベントの数
+    /*! どのスレッドから呼び出してもよい。
+     */
+    UInt64 GetNumOverflowedEvents() const
+    {
+        return num_overflowed_events_.load(std::memory_order_relaxed);
+    }
+
+    //! イベントを offset_ の順に整列する。（安定）
+    /*! 昇順に並んだ区間を見つけて、隣り合う区間同士をマージする。
+     *  区間が1つだけ（すでに整列済み）の場合はO(n)で終わる。
+     */
     void Sort()
     {
-        std::stable_sort(events_.begin(), events_.end(),
-                         [](auto const &x, auto const &y) {
-                             return x.offset_ < y.offset_;
-                         });
+        auto const less = [](auto const &x, auto const &y) { return x.offset_ < y.offset_; };
+
+        for( ; ; ) {
+            auto const *src = events_.data();
+            auto *dest = scratch_.data();
+
+            UInt32 num_runs = 0;
+            for(UInt32 begin = 0; begin < num_events_; ) {
+                auto const mid = FindRunEnd(begin);
+                if(begin == 0 && mid == num_events_) {
+                    // 整列済み
+                    return;
+                }
+                auto const end = FindRunEnd(mid);
+                std::merge(src + begin, src + mid, src + mid, src + end, dest + begin, less);
+                num_runs += 1;
+                begin = end;
+            }
+
+            events_.swap(scratch_);
+            if(num_runs <= 1) { return; }
+        }
     }
-    
+
+    //! PopNoteStack() で作成したノートオフを、バッファの先頭に追加する。
+    /*! キャッシュされたノートオフは offset_ が0なので、既存のイベントとマージするだけで先頭に配置できる。
+     */
     void ApplyCachedNoteOffs()
     {
-        if(note_off_cache_.empty() == false) {
-            events_.insert(events_.begin(), note_off_cache_.begin(), note_off_cache_.end());
-            note_off_cache_.clear();
-        }
+        if(num_cached_note_offs_ == 0) { return; }
+
+        auto const num_to_apply = std::min<UInt32>(num_cached_note_offs_, events_.size() - num_events_);
+        num_overflowed_events_.fetch_add(num_cached_note_offs_ - num_to_apply, std::memory_order_relaxed);
+
+        auto const less = [](auto const &x, auto const &y) { return x.offset_ < y.offset_; };
+        // 同じ位置のイベントは、先に渡した範囲（キャッシュされたノートオフ）が先になる
+        std::merge(note_off_cache_.begin(), note_off_cache_.begin() + num_to_apply,
+                   events_.begin(), events_.begin() + num_events_,
+                   scratch_.begin(), less);
+        events_.swap(scratch_);
+        num_events_ += num_to_apply;
+        num_cached_note_offs_ = 0;
     }
-    
+
+    //! 発音中のノートに対するノートオフを作成して、キャッシュする。
+    /*! 発音中のノートはビットマップで管理しているので、発音中のノートがある区間だけを調べる。
+     */
     void PopNoteStack()
     {
-        for(UInt8 pitch = 0; pitch < kNumMIDIPitches; ++pitch) {
-            for(UInt8 ch = 0; ch < kNumMIDIChannels; ++ch) {
-                auto &stack = GetNoteStack(pitch, ch);
-                
-                while(stack != 0) {
-                    ProcessInfo::MidiMessage msg;
-                    msg.offset_ = 0;
-                    msg.channel_ = ch;
-                    msg.ppq_pos_ = 0;
-                    msg.data_ = MidiDataType::NoteOff { (UInt8)pitch, (UInt8)64 };
-                    note_off_cache_.push_back(msg);
-                    --stack;
+        for(UInt32 wi = 0; wi < active_notes_.size(); ++wi) {
+            for(auto word = active_notes_[wi]; word != 0; word &= (word - 1)) {
+                UInt32 bit = 0;
+                while(((word >> bit) & 1) == 0) { ++bit; }
+
+                auto const index = wi * kNumBitsPerWord + bit;
+                ProcessInfo::MidiMessage msg;
+                msg.offset_ = 0;
+                msg.channel_ = (UInt8)(index / kNumMIDIPitches);
+                msg.ppq_pos_ = 0;
+                msg.data_ = MidiDataType::NoteOff { (UInt8)(index % kNumMIDIPitches), (UInt8)64 };
+
+                if(num_cached_note_offs_ == note_off_cache_.size()) {
+                    // ApplyCachedNoteOffs() を呼び出さずに繰り返し呼び出された場合
+                    num_overflowed_events_.fetch_add(1, std::memory_order_relaxed);
+                    continue;
                 }
+                note_off_cache_[num_cached_note_offs_++] = msg;
             }
+            active_notes_[wi] = 0;
         }
     }
-    
-    std::atomic<UInt32> & GetNoteStack(UInt32 pitch, UInt32 channel) {
-        assert(pitch < kNumMIDIPitches);
-        assert(channel < kNumMIDIChannels);
-        return note_stack_[channel * kNumMIDIPitches + pitch];
+
+    bool IsNoteActive(UInt32 pitch, UInt32 channel) const
+    {
+        auto const index = GetNoteIndex(pitch, channel);
+        return (active_notes_[index / kNumBitsPerWord] >> (index % kNumBitsPerWord)) & 1;
     }
-    
-    std::atomic<UInt32> const & GetNoteStack(UInt32 pitch, UInt32 channel) const {
+
+private:
+    constexpr static UInt32 kNumBitsPerWord = 64;
+
+    //! イベントを保持する領域。先頭の num_events_ 個が有効
+    std::vector<ProcessInfo::MidiMessage> events_;
+    //! Sort() などでマージするときの書き込み先。events_ と同じ大きさ
+    std::vector<ProcessInfo::MidiMessage> scratch_;
+    UInt32 num_events_ = 0;
+    //! 発音中のノート。 (channel * kNumMIDIPitches + pitch) 番目のビットが立っていれば発音中
+    std::array<UInt64, kNumMIDIPitches * kNumMIDIChannels / kNumBitsPerWord> active_notes_;
+    std::vector<ProcessInfo::MidiMessage> note_off_cache_;
+    UInt32 num_cached_note_offs_ = 0;
+    std::atomic<UInt64> num_overflowed_events_ = { 0 };
+
+    static
+    UInt32 GetNoteIndex(UInt32 pitch, UInt32 channel)
+    {
         assert(pitch < kNumMIDIPitches);
         assert(channel < kNumMIDIChannels);
-        return note_stack_[channel * kNumMIDIPitches + pitch];
+        return channel * kNumMIDIPitches + pitch;
+    }
+
+    void SetNoteActive(UInt32 pitch, UInt32 channel, bool active)
+    {
+        auto const index = GetNoteIndex(pitch, channel);
+        auto const mask = (UInt64)1 << (index % kNumBitsPerWord);
+        auto &word = active_notes_[index / kNumBitsPerWord];
+        word = (active ? (word | mask) : (word & ~mask));
+    }
+
+    //! begin から始まる、offset_ が昇順に並んだ区間の終端を返す
+    UInt32 FindRunEnd(UInt32 begin) const
+    {
+        if(begin == num_events_) { return begin; }
+
+        UInt32 i = begin + 1;
+        while(i < num_events_ && events_[i - 1].offset_ <= events_[i].offset_) {
+            ++i;
+        }
+        return i;
     }
-    
-    std::vector<ProcessInfo::MidiMessage> events_;
-    std::array<std::atomic<UInt32>, kNumMIDIPitches * kNumMIDIChannels> note_stack_;
-    std::vector<ProcessInfo::MidiMessage> note_off_cache_;
 };
 
 struct EventBufferList : ProcessInfo::IEventBufferList
 {
     std::vector<EventBuffer> buffers_;
-    
+
     UInt32 GetNumBuffers() const override {
         return buffers_.size();
     }
-    
+
     void SetNumBuffers(UInt32 num)
     {
         buffers_.resize(num);
     }
-    
+
     EventBuffer * GetBuffer(UInt32 index) override
     {
         assert(index < buffers_.size());
         return &buffers_[index];
     }
-    
+
     EventBuffer const * GetBuffer(UInt32 index) const override
     {
         assert(index < buffers_.size());
         return &buffers_[index];
     }
-    
+
     void Clear() {
         for(auto &b: buffers_) { b.Clear(); }
     }
-    
+
     void Sort() {
         for(auto &b: buffers_) { b.Sort(); }
     }
-    
+
     void ApplyCachedNoteOffs() {
         for(auto &b: buffers_) { b.ApplyCachedNoteOffs(); }
     }
-    
+
+    //! すべてのバッファで、容量を超えたために破棄したイベントの数の合計
+    UInt64 GetNumOverflowedEvents() const {
+        UInt64 sum = 0;
+        for(auto const &b: buffers_) { sum += b.GetNumOverflowedEvents(); }
+        return sum;
+    }
+
     ArrayRef<ProcessInfo::MidiMessage const> GetRef(UInt32 channel_index) const
     {
         return GetBuffer(channel_index)->GetRef();
@@ -139,6 +139,11 @@ struct ProcessInfo
     TimeInfo                    time_info_;
     BufferRef<float const>      input_audio_buffer_;
     BufferRef<float>            output_audio_buffer_;
+    //! 倍精度で処理する場合のオーディオバッファ
+    /*! Vst3Plugin が kSample64 で処理している場合は、input_audio_buffer_ / output_audio_buffer_ の代わりにこちらを使用する。
+     */
+    BufferRef<double const>     input_audio_buffer64_;
+    BufferRef<double>           output_audio_buffer64_;
     IEventBufferList const *    input_event_buffers_ = nullptr;
     IEventBufferList *          output_event_buffers_ = nullptr;
 };
@@ -9,6 +9,8 @@ constexpr wchar_t const * kVendorName = L"diatonic.jp";
 constexpr wchar_t const * kAppPrivateDirName = L"Vst3SampleHost";
 constexpr wchar_t const * kConfigFileName = L"Vst3SampleHost.conf";
 constexpr wchar_t const * kLogFileName = L"Vst3SampleHost.log";
+constexpr wchar_t const * kPluginScanCacheFileName = L"PluginScanCache.txt";
+constexpr wchar_t const * kAutosaveProjectFileName = L"Autosave.vst3proj";
 
 //! Get resource file path specified by the path hierarchy.
 String GetResourcePath(String path)
@@ -63,6 +65,26 @@ String GetConfigFilePath()
     return dir.GetFullPath().ToStdWstring();
 }
 
+String GetPluginScanCacheFilePath()
+{
+    auto dir = wxFileName::DirName(wxStandardPaths::Get().GetDocumentsDir());
+    dir.AppendDir(kVendorName);
+    dir.AppendDir(kAppPrivateDirName);
+    dir.SetFullName(kPluginScanCacheFileName);
+    
+    return dir.GetFullPath().ToStdWstring();
+}
+
+String GetAutosaveProjectFilePath()
+{
+    auto dir = wxFileName::DirName(wxStandardPaths::Get().GetDocumentsDir());
+    dir.AppendDir(kVendorName);
+    dir.AppendDir(kAppPrivateDirName);
+    dir.SetFullName(kAutosaveProjectFileName);
+    
+    return dir.GetFullPath().ToStdWstring();
+}
+
 String GetLogFilePath()
 {
     auto dir = wxFileName::DirName(wxStandardPaths::Get().GetDocumentsDir());
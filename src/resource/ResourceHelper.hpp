@@ -17,6 +17,20 @@ String GetResourcePath(std::vector<String> path_hierarchy);
  */
 String GetConfigFilePath();
 
+//! プラグインのスキャン結果を保存するキャッシュファイルの場所をフルパスで返す。
+/*! このファイルは、以下のパスに作成される。
+ *    * Win: "C:\Users\<UserName>\Documents\diatonic.jp\Vst3SampleHost\PluginScanCache.txt"
+ *    * Mac: "/Users/<UserName>/Documents/diatonic.jp/Vst3SampleHost/PluginScanCache.txt"
+ */
+String GetPluginScanCacheFilePath();
+
+//! 自動保存したプロジェクトファイルの場所をフルパスで返す。
+/*! このファイルは、以下のパスに作成される。
+ *    * Win: "C:\Users\<UserName>\Documents\diatonic.jp\Vst3SampleHost\Autosave.vst3proj"
+ *    * Mac: "/Users/<UserName>/Documents/diatonic.jp/Vst3SampleHost/Autosave.vst3proj"
+ */
+String GetAutosaveProjectFilePath();
+
 //! ログファイルの場所をフルパスで返す。
 /*! このファイルは、以下のパスに作成される。
  *    * Win: "C:\Users\<UserName>\Documents\diatonic.jp\Vst3SampleHost\Vst3SampleHost.log"
@@ -0,0 +1,88 @@
+#include "catch2/catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "../file/AtomicFileWriter.hpp"
+#include "../misc/MappedFile.hpp"
+#include "../misc/StrCnv.hpp"
+
+using namespace hwm;
+
+namespace {
+
+std::string const kPath = "atomic_file_writer_test.txt";
+
+std::string ReadAll(std::string const &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+bool Exists(std::string const &path)
+{
+    return std::ifstream(path).good();
+}
+
+void WriteFile(std::string const &path, std::string const &content)
+{
+    std::ofstream ofs(path, std::ios::binary);
+    ofs << content;
+}
+
+} // namespace
+
+TEST_CASE("AtomicFileWriter replaces the file when finished", "[atomic_file_writer]")
+{
+    WriteFile(kPath, "old content");
+
+    {
+        AtomicFileWriter writer(to_wstr(kPath));
+        writer.GetStream() << "new content";
+
+        // 置き換えるまでは元のファイルが残っている
+        writer.Sync();
+        CHECK(ReadAll(kPath) == "old content");
+        CHECK(Exists(to_utf8(writer.GetTemporaryPath())));
+
+        writer.Replace();
+        CHECK(Exists(to_utf8(writer.GetTemporaryPath())) == false);
+    }
+
+    CHECK(ReadAll(kPath) == "new content");
+    std::remove(kPath.c_str());
+}
+
+TEST_CASE("AtomicFileWriter keeps the file when not finished", "[atomic_file_writer]")
+{
+    WriteFile(kPath, "old content");
+
+    String tmp_path;
+    {
+        AtomicFileWriter writer(to_wstr(kPath));
+        tmp_path = writer.GetTemporaryPath();
+        writer.GetStream() << "half written";
+    }
+
+    CHECK(ReadAll(kPath) == "old content");
+    CHECK(Exists(to_utf8(tmp_path)) == false);
+    std::remove(kPath.c_str());
+}
+
+#if !defined(_MSC_VER)
+TEST_CASE("AtomicFileWriter does not break the mapped file", "[atomic_file_writer]")
+{
+    WriteFile(kPath, "old content");
+    auto mapped = MappedFile::Open(to_wstr(kPath));
+
+    AtomicFileWriter writer(to_wstr(kPath));
+    writer.GetStream() << "new content which is longer than the old one";
+    writer.Replace();
+
+    auto const data = mapped->GetData();
+    CHECK(std::string(data.begin(), data.end()) == "old content");
+    CHECK(ReadAll(kPath) == "new content which is longer than the old one");
+    std::remove(kPath.c_str());
+}
+#endif
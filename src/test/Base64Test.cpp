@@ -0,0 +1,205 @@
+#include "catch2/catch.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <wx/base64.h>
+#include "../misc/Base64.hpp"
+
+using namespace hwm;
+
+namespace {
+
+std::vector<Base64Impl> GetSupportedImpls()
+{
+    std::vector<Base64Impl> impls;
+    for(auto impl: { Base64Impl::kScalar, Base64Impl::kSSSE3, Base64Impl::kAVX2 }) {
+        if(IsBase64ImplSupported(impl)) { impls.push_back(impl); }
+    }
+    return impls;
+}
+
+std::vector<char> MakeData(size_t size, UInt32 seed)
+{
+    std::vector<char> data(size);
+    UInt32 x = seed * 2654435761u + 1;
+    for(auto &c: data) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        c = (char)(x >> 24);
+    }
+    return data;
+}
+
+std::string EncodeWithWx(std::vector<char> const &data)
+{
+    if(data.empty()) { return {}; }
+    return wxBase64Encode(data.data(), data.size()).ToStdString();
+}
+
+std::string Encode(std::vector<char> const &data, Base64Impl impl)
+{
+    std::string str(GetBase64EncodedLength(data.size()), '\0');
+    Base64Encode(data.data(), data.size(), &str[0], impl);
+    return str;
+}
+
+std::optional<std::vector<char>> Decode(std::string const &str, Base64Impl impl, size_t *error_pos = nullptr)
+{
+    std::vector<char> data(GetBase64DecodedMaxLength(str.size()));
+    auto const size = Base64Decode(str.data(), str.size(), data.data(), impl, error_pos);
+    if(!size) { return std::nullopt; }
+    data.resize(*size);
+    return data;
+}
+
+} // namespace
+
+TEST_CASE("Base64 round trip test", "[base64]")
+{
+    // SIMD版で処理される部分と、端数として処理される部分の両方を含む長さにする
+    for(size_t size = 0; size < 200; ++size) {
+        auto const data = MakeData(size, (UInt32)size);
+        auto const expected = EncodeWithWx(data);
+
+        for(auto impl: GetSupportedImpls()) {
+            CAPTURE(size, (int)impl);
+            auto const encoded = Encode(data, impl);
+            REQUIRE(encoded == expected);
+
+            auto const decoded = Decode(encoded, impl);
+            REQUIRE(decoded);
+            REQUIRE(*decoded == data);
+        }
+    }
+}
+
+TEST_CASE("Base64 decodes all characters", "[base64]")
+{
+    // すべての6ビットの値を含む文字列
+    std::string const str =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"
+    "/+9876543210zyxwvutsrqponmlkjihgfedcbaZYXWVUTSRQPONMLKJIHGFEDCBA";
+
+    std::optional<std::vector<char>> expected;
+    for(auto impl: GetSupportedImpls()) {
+        auto const decoded = Decode(str, impl);
+        REQUIRE(decoded);
+        REQUIRE(Encode(*decoded, impl) == str);
+
+        if(expected) { REQUIRE(*decoded == *expected); }
+        expected = decoded;
+    }
+}
+
+TEST_CASE("Base64 rejects invalid input", "[base64]")
+{
+    auto const valid = Encode(MakeData(150, 1), Base64Impl::kScalar);
+    REQUIRE(valid.size() == 200);
+
+    for(auto impl: GetSupportedImpls()) {
+        CAPTURE((int)impl);
+
+        // SIMD版で処理される位置と、スカラー版で処理される位置のそれぞれに不正な文字を置く
+        for(size_t pos: { 0, 5, 17, 40, 100, 150, 195, 198 }) {
+            for(char c: { '=', ' ', '\n', '-', '_', '\0', (char)0x80, (char)0xFF }) {
+                CAPTURE(pos, (int)c);
+                auto str = valid;
+                str[pos] = c;
+
+                size_t error_pos = -1;
+                REQUIRE_FALSE(Decode(str, impl, &error_pos));
+                REQUIRE(error_pos == pos);
+            }
+        }
+
+        size_t error_pos = -1;
+        REQUIRE_FALSE(Decode(valid.substr(0, 199), impl, &error_pos));
+        REQUIRE(error_pos == 196);
+        REQUIRE_FALSE(Decode("QUJD=ZGV", impl));
+        REQUIRE_FALSE(Decode("QUJDRA=A", impl));
+        REQUIRE_FALSE(Decode("QUJDR===", impl));
+
+        auto const padded = Decode("QUJDRA==", impl);
+        REQUIRE(padded);
+        REQUIRE(std::string(padded->begin(), padded->end()) == "ABCD");
+    }
+}
+
+TEST_CASE("Base64 streaming test", "[base64]")
+{
+    auto const data = MakeData(300 * 1000, 2);
+    auto const expected = EncodeWithWx(data);
+
+    for(size_t piece_size: { 1, 2, 7, 4096, 100 * 1000 }) {
+        CAPTURE(piece_size);
+
+        std::string encoded;
+        Base64Encoder encoder([&](char const *p, size_t n) { encoded.append(p, n); });
+        for(size_t i = 0; i < data.size(); i += piece_size) {
+            encoder.Write(data.data() + i, std::min(piece_size, data.size() - i));
+        }
+        encoder.Finish();
+        REQUIRE(encoded == expected);
+
+        std::vector<char> decoded;
+        Base64Decoder decoder([&](char const *p, size_t n) { decoded.insert(decoded.end(), p, p + n); });
+        for(size_t i = 0; i < encoded.size(); i += piece_size) {
+            REQUIRE(decoder.Write(encoded.data() + i, std::min(piece_size, encoded.size() - i)));
+        }
+        REQUIRE(decoder.Finish());
+        REQUIRE(decoded == data);
+    }
+
+    SECTION("reports errors") {
+        std::vector<char> decoded;
+        Base64Decoder decoder([&](char const *p, size_t n) { decoded.insert(decoded.end(), p, p + n); });
+        REQUIRE(decoder.Write("QUJD", 4));
+        REQUIRE(decoder.Write("RA", 2));
+        REQUIRE(decoder.Write("==", 2));
+        // パディングの後にデータは置けない
+        REQUIRE_FALSE(decoder.Write("QUJD", 4));
+        REQUIRE(decoder.GetErrorPosition() == 8);
+        REQUIRE_FALSE(decoder.Finish());
+        REQUIRE(std::string(decoded.begin(), decoded.end()) == "ABCD");
+
+        Base64Decoder incomplete([](char const *, size_t) {});
+        REQUIRE(incomplete.Write("QUJDR", 5));
+        REQUIRE_FALSE(incomplete.Finish());
+        REQUIRE(incomplete.GetErrorPosition() == 4);
+    }
+}
+
+TEST_CASE("Base64 benchmark", "[.][benchmark][base64]")
+{
+    using clock_t = std::chrono::steady_clock;
+    auto to_msec = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    char const *impl_names[] = { "scalar", "ssse3", "avx2" };
+    size_t const size = 16 * 1024 * 1024;
+    auto const data = MakeData(size, 3);
+
+    {
+        auto const begin = clock_t::now();
+        auto const encoded = EncodeWithWx(data);
+        auto const encoded_time = clock_t::now();
+        auto const decoded = wxBase64Decode(encoded.data(), encoded.size(),
+                                            wxBase64DecodeMode::wxBase64DecodeMode_Strict);
+        auto const end = clock_t::now();
+        REQUIRE(decoded.GetDataLen() == size);
+        std::cout << "wxBase64: encode " << to_msec(encoded_time - begin) << " msec"
+        << ", decode " << to_msec(end - encoded_time) << " msec" << std::endl;
+    }
+
+    for(auto impl: GetSupportedImpls()) {
+        auto const begin = clock_t::now();
+        auto const encoded = Encode(data, impl);
+        auto const encoded_time = clock_t::now();
+        auto const decoded = Decode(encoded, impl);
+        auto const end = clock_t::now();
+        REQUIRE(decoded);
+        REQUIRE(*decoded == data);
+        std::cout << impl_names[(int)impl] << ": encode " << to_msec(encoded_time - begin) << " msec"
+        << ", decode " << to_msec(end - encoded_time) << " msec" << std::endl;
+    }
+}
@@ -0,0 +1,137 @@
+#include "catch2/catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../file/ChunkedContainer.hpp"
+#include "../misc/MappedFile.hpp"
+#include "../misc/StrCnv.hpp"
+
+using namespace hwm;
+
+namespace {
+
+std::vector<char> MakeData(size_t size, int seed)
+{
+    std::vector<char> data(size);
+    for(size_t i = 0; i < size; ++i) { data[i] = (char)((i * 31 + seed) & 0xFF); }
+    return data;
+}
+
+std::string Write(std::vector<ContainerChunk> const &chunks)
+{
+    std::ostringstream ss;
+    WriteChunkedContainer(ss, chunks);
+    return ss.str();
+}
+
+bool Equals(ArrayRef<char const> lhs, std::vector<char> const &rhs)
+{
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+} // namespace
+
+TEST_CASE("ChunkedContainer restores the written chunks", "[chunked_container]")
+{
+    auto const a = MakeData(1, 1);
+    auto const b = MakeData(1000, 2);
+    std::vector<char> const empty;
+
+    std::vector<ContainerChunk> src(3);
+    src[0].id_ = MakeChunkID('A', 'A', 'A', 'A');
+    src[0].data_ = ArrayRef<char const>(a);
+    src[1].id_ = MakeChunkID('B', 'B', 'B', 'B');
+    src[1].data_ = ArrayRef<char const>(b);
+    src[2].id_ = MakeChunkID('E', 'M', 'P', 'T');
+    src[2].data_ = ArrayRef<char const>(empty);
+
+    auto const file = Write(src);
+    ArrayRef<char const> const data(file);
+    REQUIRE(HasChunkedContainerSignature(data));
+
+    auto const chunks = ReadChunkedContainer(data);
+    REQUIRE(chunks.size() == 3);
+
+    for(size_t i = 0; i < chunks.size(); ++i) {
+        CHECK(chunks[i].id_ == src[i].id_);
+        if(chunks[i].data_.empty()) { continue; }
+
+        // データはコピーされずに、読み込み元の領域を参照する
+        CHECK(chunks[i].data_.data() >= file.data());
+        CHECK(chunks[i].data_.data() + chunks[i].data_.size() <= file.data() + file.size());
+        CHECK((chunks[i].data_.data() - file.data()) % kChunkedContainerAlignment == 0);
+    }
+
+    CHECK(Equals(chunks[0].data_, a));
+    CHECK(Equals(chunks[1].data_, b));
+    CHECK(chunks[2].data_.empty());
+
+    REQUIRE(FindChunk(chunks, MakeChunkID('B', 'B', 'B', 'B')) != nullptr);
+    CHECK(FindChunk(chunks, MakeChunkID('B', 'B', 'B', 'B'))->data_.size() == b.size());
+    CHECK(FindChunk(chunks, MakeChunkID('N', 'O', 'N', 'E')) == nullptr);
+}
+
+TEST_CASE("ChunkedContainer rejects broken files", "[chunked_container]")
+{
+    auto const a = MakeData(100, 3);
+    std::vector<ContainerChunk> src(1);
+    src[0].id_ = MakeChunkID('A', 'A', 'A', 'A');
+    src[0].data_ = ArrayRef<char const>(a);
+
+    auto const file = Write(src);
+
+    SECTION("text file") {
+        std::string const text = "format = project_file_format_v1\n";
+        CHECK(HasChunkedContainerSignature(ArrayRef<char const>(text)) == false);
+        CHECK_THROWS_AS(ReadChunkedContainer(ArrayRef<char const>(text)), FailedToParseChunkedContainer);
+    }
+
+    SECTION("truncated") {
+        auto const truncated = file.substr(0, file.size() - 1);
+        CHECK(HasChunkedContainerSignature(ArrayRef<char const>(truncated)));
+        CHECK_THROWS_AS(ReadChunkedContainer(ArrayRef<char const>(truncated)), FailedToParseChunkedContainer);
+    }
+
+    SECTION("newer version") {
+        auto newer = file;
+        newer[8] = (char)(kChunkedContainerVersion + 1);
+        CHECK_THROWS_AS(ReadChunkedContainer(ArrayRef<char const>(newer)), FailedToParseChunkedContainer);
+    }
+
+    SECTION("chunk out of range") {
+        // 目次の先頭のエントリのサイズを書き換える
+        auto broken = file;
+        auto const toc_offset = file.size() - 24;
+        broken[toc_offset + 16 + 7] = (char)0x7F;
+        CHECK_THROWS_AS(ReadChunkedContainer(ArrayRef<char const>(broken)), FailedToParseChunkedContainer);
+    }
+}
+
+TEST_CASE("MappedFile maps a chunked container file", "[chunked_container]")
+{
+    auto const a = MakeData(3 * 1024 * 1024, 4);
+    std::vector<ContainerChunk> src(1);
+    src[0].id_ = MakeChunkID('P', 'R', 'O', 'C');
+    src[0].data_ = ArrayRef<char const>(a);
+
+    auto const path = std::string("chunked_container_test.bin");
+    {
+        std::ofstream ofs(path, std::ios::binary);
+        WriteChunkedContainer(ofs, src);
+        REQUIRE(ofs.good());
+    }
+
+    {
+        auto file = MappedFile::Open(to_wstr(path));
+        auto const chunks = ReadChunkedContainer(file->GetData());
+        REQUIRE(chunks.size() == 1);
+        CHECK(Equals(chunks[0].data_, a));
+    }
+
+    std::remove(path.c_str());
+
+    CHECK_THROWS_AS(MappedFile::Open(to_wstr(path)), std::runtime_error);
+}
@@ -0,0 +1,109 @@
+#include "catch2/catch.hpp"
+
+#include <vector>
+#include "../misc/DelayLine.hpp"
+
+using namespace hwm;
+
+namespace {
+
+//! 連番の信号を、 block_size ごとに区切ってディレイラインに通す
+std::vector<float> ProcessInBlocks(DelayLine<float> &dl, UInt32 length, UInt32 block_size, bool in_place)
+{
+    Buffer<float> src(1, length);
+    Buffer<float> dest(1, length);
+    for(UInt32 i = 0; i < length; ++i) { src.data()[0][i] = (float)(i + 1); }
+
+    for(UInt32 pos = 0; pos < length; pos += block_size) {
+        auto const n = std::min(block_size, length - pos);
+        if(in_place) {
+            BufferRef<float> ref(src, 0, 1, pos, n);
+            dl.Process(BufferRef<float const>(src, 0, 1, pos, n), ref);
+        } else {
+            dl.Process(BufferRef<float const>(src, 0, 1, pos, n), BufferRef<float>(dest, 0, 1, pos, n));
+        }
+    }
+
+    auto const &result = (in_place ? src : dest);
+    return std::vector<float>(result.data()[0], result.data()[0] + length);
+}
+
+} // namespace
+
+TEST_CASE("DelayLine delays the signal by the specified samples", "[delayline]")
+{
+    for(bool in_place: { false, true }) {
+        for(UInt32 block_size: { 1u, 3u, 5u, 16u }) {
+            DelayLine<float> dl(1, 5);
+            REQUIRE(dl.GetDelay() == 5);
+
+            auto const result = ProcessInBlocks(dl, 40, block_size, in_place);
+            for(UInt32 i = 0; i < 40; ++i) {
+                float const expected = (i < 5 ? 0.0f : (float)(i - 5 + 1));
+                REQUIRE(result[i] == expected);
+            }
+        }
+    }
+}
+
+TEST_CASE("DelayLine with zero delay passes the signal through", "[delayline]")
+{
+    DelayLine<float> dl(2, 0);
+    auto const result = ProcessInBlocks(dl, 10, 4, false);
+    for(UInt32 i = 0; i < 10; ++i) {
+        REQUIRE(result[i] == (float)(i + 1));
+    }
+}
+
+TEST_CASE("DelayLine adds the delayed signal to the destination", "[delayline]")
+{
+    DelayLine<float> dl(2, 2);
+
+    Buffer<float> src(2, 4);
+    Buffer<float> dest(2, 4);
+    for(UInt32 i = 0; i < 4; ++i) {
+        src.data()[0][i] = (float)(i + 1);
+        src.data()[1][i] = (float)(i + 1) * 10;
+    }
+    dest.fill(100);
+
+    dl.ProcessAdd(src, dest);
+    REQUIRE(dest.data()[0][0] == 100);
+    REQUIRE(dest.data()[0][1] == 100);
+    REQUIRE(dest.data()[0][2] == 101);
+    REQUIRE(dest.data()[0][3] == 102);
+    REQUIRE(dest.data()[1][0] == 100);
+    REQUIRE(dest.data()[1][3] == 120);
+
+    // Clear() で遅延中の信号が破棄される
+    dl.Clear();
+    dest.fill(0);
+    dl.ProcessAdd(src, dest);
+    REQUIRE(dest.data()[0][0] == 0);
+    REQUIRE(dest.data()[0][1] == 0);
+    REQUIRE(dest.data()[0][2] == 1);
+}
+
+TEST_CASE("DelayLine with zero delay adds the signal in place", "[delayline]")
+{
+    DelayLine<float> dl(2, 0);
+
+    Buffer<float> buf(2, 4);
+    for(UInt32 i = 0; i < 4; ++i) {
+        buf.data()[0][i] = (float)(i + 1);
+        buf.data()[1][i] = (float)(i + 1) * 10;
+    }
+
+    // src と dest が同じバッファでも、加算は省略されない
+    BufferRef<float> ref(buf);
+    dl.ProcessAdd(BufferRef<float const>(buf), ref);
+    for(UInt32 i = 0; i < 4; ++i) {
+        REQUIRE(buf.data()[0][i] == (float)(i + 1) * 2);
+        REQUIRE(buf.data()[1][i] == (float)(i + 1) * 20);
+    }
+
+    // コピーの場合は何も変わらない
+    dl.Process(BufferRef<float const>(buf), ref);
+    REQUIRE(buf.data()[0][3] == 8);
+    REQUIRE(buf.data()[1][3] == 80);
+}
@@ -0,0 +1,136 @@
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "../processor/EventBuffer.hpp"
+
+using namespace hwm;
+
+namespace {
+
+ProcessInfo::MidiMessage MakeNoteOn(SampleCount offset, UInt8 pitch, UInt8 channel = 0)
+{
+    return ProcessInfo::MidiMessage(offset, channel, 0, MidiDataType::NoteOn { pitch, 100 });
+}
+
+ProcessInfo::MidiMessage MakeNoteOff(SampleCount offset, UInt8 pitch, UInt8 channel = 0)
+{
+    return ProcessInfo::MidiMessage(offset, channel, 0, MidiDataType::NoteOff { pitch, 0 });
+}
+
+} // namespace
+
+TEST_CASE("EventBuffer merges presorted sources", "[eventbuffer]")
+{
+    EventBuffer buf;
+
+    // キーボードからの入力
+    buf.AddEvent(MakeNoteOn(0, 60));
+    buf.AddEvent(MakeNoteOn(0, 61));
+    // MIDIデバイスからの入力
+    buf.AddEvent(MakeNoteOn(0, 70));
+    buf.AddEvent(MakeNoteOn(10, 71));
+    buf.AddEvent(MakeNoteOn(20, 72));
+    // プラグインなど、その他の入力
+    buf.AddEvent(MakeNoteOn(5, 80));
+    buf.AddEvent(MakeNoteOn(20, 81));
+
+    buf.Sort();
+
+    std::vector<std::pair<SampleCount, UInt8>> actual;
+    for(auto const &ev: buf.GetRef()) {
+        actual.emplace_back(ev.offset_, ev.As<MidiDataType::NoteOn>()->pitch_);
+    }
+
+    // 同じ位置のイベントは、追加した順に並ぶ
+    std::vector<std::pair<SampleCount, UInt8>> const expected = {
+        { 0, 60 }, { 0, 61 }, { 0, 70 }, { 5, 80 }, { 10, 71 }, { 20, 72 }, { 20, 81 }
+    };
+    REQUIRE(actual == expected);
+}
+
+TEST_CASE("EventBuffer sort is stable for arbitrary input", "[eventbuffer]")
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(0, 15);
+
+    EventBuffer buf;
+    std::vector<ProcessInfo::MidiMessage> expected;
+    for(int i = 0; i < 500; ++i) {
+        auto msg = MakeNoteOn(dist(rng), i % 128, (i / 128) % 16);
+        buf.AddEvent(msg);
+        expected.push_back(msg);
+    }
+
+    buf.Sort();
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](auto const &x, auto const &y) { return x.offset_ < y.offset_; });
+
+    REQUIRE(buf.GetCount() == expected.size());
+    for(UInt32 i = 0; i < buf.GetCount(); ++i) {
+        auto const &ev = buf.GetEvent(i);
+        REQUIRE(ev.offset_ == expected[i].offset_);
+        REQUIRE(ev.channel_ == expected[i].channel_);
+        REQUIRE(ev.As<MidiDataType::NoteOn>()->pitch_ == expected[i].As<MidiDataType::NoteOn>()->pitch_);
+    }
+}
+
+TEST_CASE("EventBuffer reports overflow without growing", "[eventbuffer]")
+{
+    EventBuffer buf(4);
+    REQUIRE(buf.GetCapacity() == 4);
+
+    for(int i = 0; i < 6; ++i) {
+        buf.AddEvent(MakeNoteOn(i, 60 + i));
+    }
+
+    REQUIRE(buf.GetCount() == 4);
+    REQUIRE(buf.GetCapacity() == 4);
+    REQUIRE(buf.GetNumOverflowedEvents() == 2);
+
+    buf.Clear();
+    buf.AddEvent(MakeNoteOn(0, 60));
+    REQUIRE(buf.GetCount() == 1);
+    REQUIRE(buf.GetNumOverflowedEvents() == 2);
+}
+
+TEST_CASE("EventBuffer creates note-offs for active notes", "[eventbuffer]")
+{
+    EventBuffer buf;
+    buf.AddEvent(MakeNoteOn(0, 60, 0));
+    buf.AddEvent(MakeNoteOn(1, 64, 0));
+    buf.AddEvent(MakeNoteOn(2, 127, 15));
+    buf.AddEvent(MakeNoteOff(3, 64, 0));
+
+    REQUIRE(buf.IsNoteActive(60, 0));
+    REQUIRE(buf.IsNoteActive(64, 0) == false);
+    REQUIRE(buf.IsNoteActive(127, 15));
+
+    buf.PopNoteStack();
+    REQUIRE(buf.IsNoteActive(60, 0) == false);
+    REQUIRE(buf.IsNoteActive(127, 15) == false);
+
+    // 次のブロックのイベントの前に、キャッシュしたノートオフが配置される
+    buf.Clear();
+    buf.AddEvent(MakeNoteOn(0, 50));
+    buf.AddEvent(MakeNoteOn(8, 51));
+    buf.ApplyCachedNoteOffs();
+
+    REQUIRE(buf.GetCount() == 4);
+
+    auto const &e0 = buf.GetEvent(0);
+    auto const &e1 = buf.GetEvent(1);
+    REQUIRE(e0.As<MidiDataType::NoteOff>());
+    REQUIRE(e0.As<MidiDataType::NoteOff>()->pitch_ == 60);
+    REQUIRE(e0.channel_ == 0);
+    REQUIRE(e1.As<MidiDataType::NoteOff>());
+    REQUIRE(e1.As<MidiDataType::NoteOff>()->pitch_ == 127);
+    REQUIRE(e1.channel_ == 15);
+    REQUIRE(buf.GetEvent(2).As<MidiDataType::NoteOn>()->pitch_ == 50);
+    REQUIRE(buf.GetEvent(3).As<MidiDataType::NoteOn>()->pitch_ == 51);
+
+    // キャッシュは一度だけ適用される
+    buf.ApplyCachedNoteOffs();
+    REQUIRE(buf.GetCount() == 4);
+}
@@ -0,0 +1,137 @@
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "../plugin/vst3/IdentifiedValueList.hpp"
+
+using namespace hwm;
+
+namespace {
+
+struct Item
+{
+    UInt32 id_ = 0;
+    std::wstring name_;
+};
+
+//! JUCEなどのように、IDを文字列のハッシュ値から作るプラグインを想定した散らばったID
+UInt32 MakeScatteredID(UInt32 i)
+{
+    UInt32 x = i * 2654435761u + 12345;
+    x ^= x >> 15;
+    return x;
+}
+
+} // namespace
+
+TEST_CASE("IdentifiedValueList lookup test", "[identified_value_list]")
+{
+    IdentifiedValueList<Item> list;
+    REQUIRE(list.empty());
+    REQUIRE(list.GetIndexByID(0) == -1);
+    REQUIRE_FALSE(list.FindItemByID(0));
+
+    UInt32 const num = 1000;
+    for(UInt32 i = 0; i < num; ++i) {
+        list.AddItem(Item { MakeScatteredID(i), std::to_wstring(i) });
+
+        // 拡張の前後で、追加済みの要素を検索できる
+        REQUIRE(list.GetIndexByID(MakeScatteredID(i)) == i);
+        REQUIRE(list.GetIndexByID(MakeScatteredID(i / 2)) == i / 2);
+    }
+
+    REQUIRE(list.size() == num);
+    for(UInt32 i = 0; i < num; ++i) {
+        auto const id = MakeScatteredID(i);
+        REQUIRE(list.GetItemByIndex(i).id_ == id);
+        REQUIRE(list.GetItemByID(id).name_ == std::to_wstring(i));
+        REQUIRE(list.FindItemByID(id)->name_ == std::to_wstring(i));
+    }
+
+    REQUIRE(list.GetIndexByID(MakeScatteredID(num)) == -1);
+    REQUIRE_FALSE(list.FindItemByID(MakeScatteredID(num + 1)));
+
+    // 追加した順序を保持する
+    UInt32 i = 0;
+    for(auto const &item: list) {
+        REQUIRE(item.id_ == MakeScatteredID(i++));
+    }
+}
+
+TEST_CASE("IdentifiedValueList keeps the index consistent with the storage", "[identified_value_list]")
+{
+    using List = IdentifiedValueList<Item>;
+
+    List list;
+    list.reserve(100);
+    // 連番のIDや、同じスロットに集まりやすいIDを混ぜる
+    for(UInt32 i = 0; i < 50; ++i) { list.AddItem(Item { i }); }
+    for(UInt32 i = 1; i <= 50; ++i) { list.AddItem(Item { i << 16 }); }
+    list.reserve(10);
+    list.AddItem(Item { 0xFFFFFFFF });
+
+    auto check = [](List const &l) {
+        REQUIRE(l.size() == 101);
+        for(size_t i = 0; i < l.size(); ++i) {
+            REQUIRE(l.GetIndexByID(l.GetItemByIndex(i).id_) == i);
+        }
+        REQUIRE(l.GetIndexByID(50) == -1);
+    };
+
+    check(list);
+
+    List copied = list;
+    check(copied);
+
+    List moved = std::move(copied);
+    check(moved);
+
+    List assigned;
+    assigned.AddItem(Item { 12345 });
+    assigned = list;
+    check(assigned);
+    REQUIRE(assigned.GetIndexByID(12345) == -1);
+}
+
+TEST_CASE("IdentifiedValueList benchmark", "[.][benchmark][identified_value_list]")
+{
+    using clock_t = std::chrono::steady_clock;
+    auto to_msec = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    for(UInt32 num: { 1000, 5000, 30000 }) {
+        auto const begin = clock_t::now();
+
+        IdentifiedValueList<Item> list;
+        list.reserve(num);
+        for(UInt32 i = 0; i < num; ++i) {
+            list.AddItem(Item { MakeScatteredID(i) });
+        }
+
+        auto const built = clock_t::now();
+
+        size_t sum = 0;
+        for(UInt32 i = 0; i < num; ++i) {
+            sum += list.GetIndexByID(MakeScatteredID(i));
+        }
+
+        auto const end = clock_t::now();
+        REQUIRE(sum == (size_t)num * (num - 1) / 2);
+
+        // 比較用に、以前の実装と同じ線形探索で検索する
+        size_t linear_sum = 0;
+        for(UInt32 i = 0; i < num; ++i) {
+            auto const id = MakeScatteredID(i);
+            auto found = std::find_if(list.begin(), list.end(), [id](auto &x) { return x.id_ == id; });
+            linear_sum += found - list.begin();
+        }
+
+        auto const linear_end = clock_t::now();
+        REQUIRE(linear_sum == sum);
+
+        std::cout << num << " items: build " << to_msec(built - begin) << " msec"
+        << ", lookup all " << to_msec(end - built) << " msec"
+        << ", lookup all by linear search " << to_msec(linear_end - end) << " msec" << std::endl;
+    }
+}
@@ -0,0 +1,158 @@
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include "../misc/InterProcessSignal.hpp"
+#include "../misc/SharedMemory.hpp"
+
+using namespace hwm;
+
+namespace {
+
+//! 共有メモリに配置する、テスト用のデータ
+struct TestSharedData
+{
+    std::atomic<UInt32> request_counter_ = { 0 };
+    std::atomic<UInt32> response_counter_ = { 0 };
+    UInt32 value_ = 0;
+};
+
+} // namespace
+
+TEST_CASE("SharedMemory shares data between mappings", "[interprocess]")
+{
+    auto const name = SharedMemory::MakeUniqueName();
+    auto created = SharedMemory::Create(name, 4096);
+    REQUIRE(created->GetSize() == 4096);
+    REQUIRE(created->GetName() == name);
+
+    // 作成直後はゼロで初期化されている
+    auto const *p = static_cast<unsigned char const *>(created->GetData());
+    CHECK(std::all_of(p, p + 4096, [](auto x) { return x == 0; }));
+
+    // 同じ名前ではもう作成できない
+    CHECK_THROWS_AS(SharedMemory::Create(name, 4096), std::runtime_error);
+
+    auto opened = SharedMemory::Open(name, 4096);
+    static_cast<int *>(created->GetData())[10] = 12345;
+    CHECK(static_cast<int *>(opened->GetData())[10] == 12345);
+
+    created.reset();
+    // 作成した側が閉じると、名前は削除されるが、開いている領域は引き続き参照できる
+    CHECK(static_cast<int *>(opened->GetData())[10] == 12345);
+    CHECK_THROWS_AS(SharedMemory::Open(name, 4096), std::runtime_error);
+}
+
+TEST_CASE("InterProcessSignal exchanges requests and responses", "[interprocess]")
+{
+    auto const name = SharedMemory::MakeUniqueName();
+    auto parent_memory = SharedMemory::Create(name, sizeof(TestSharedData));
+    auto *parent_data = new(parent_memory->GetData()) TestSharedData();
+
+    // 別のプロセスの代わりに、別のスレッドで同じ共有メモリを開く
+    auto child_memory = SharedMemory::Open(name, sizeof(TestSharedData));
+    auto *child_data = static_cast<TestSharedData *>(child_memory->GetData());
+
+    InterProcessSignal parent_request(parent_data->request_counter_, name + L"_req", true);
+    InterProcessSignal parent_response(parent_data->response_counter_, name + L"_res", true);
+
+    UInt32 const kNumRequests = 2000;
+
+    std::thread child([&] {
+        InterProcessSignal request(child_data->request_counter_, name + L"_req", false);
+        InterProcessSignal response(child_data->response_counter_, name + L"_res", false);
+
+        // スレッドの開始前に通知される場合があるので、初期値から待機する
+        UInt32 last = 0;
+        for(UInt32 i = 0; i < kNumRequests; ++i) {
+            // 親が待機中にスピンを終えて休止する場合も確認できるように、スピンは短くする
+            while(request.Wait(last, std::chrono::seconds(1), std::chrono::microseconds(1)) == false) {}
+            last = request.GetCount();
+            child_data->value_ *= 2;
+            response.Notify();
+        }
+    });
+
+    bool ok = true;
+    for(UInt32 i = 0; i < kNumRequests; ++i) {
+        auto const last = parent_response.GetCount();
+        parent_data->value_ = i;
+        parent_request.Notify();
+        if(parent_response.Wait(last, std::chrono::seconds(10)) == false) {
+            ok = false;
+            break;
+        }
+        if(parent_data->value_ != i * 2) {
+            ok = false;
+            break;
+        }
+    }
+
+    child.join();
+    CHECK(ok);
+    CHECK(parent_request.GetCount() == kNumRequests);
+    CHECK(parent_response.GetCount() == kNumRequests);
+}
+
+TEST_CASE("InterProcessSignal times out without notification", "[interprocess]")
+{
+    auto const name = SharedMemory::MakeUniqueName();
+    auto memory = SharedMemory::Create(name, sizeof(TestSharedData));
+    auto *data = new(memory->GetData()) TestSharedData();
+
+    InterProcessSignal signal(data->request_counter_, name, true);
+    auto const begin = std::chrono::steady_clock::now();
+    CHECK(signal.Wait(signal.GetCount(), std::chrono::milliseconds(20)) == false);
+    CHECK(std::chrono::steady_clock::now() - begin >= std::chrono::milliseconds(20));
+
+    signal.Notify();
+    CHECK(signal.Wait(0, std::chrono::milliseconds(20)));
+}
+
+TEST_CASE("InterProcessSignal round trip benchmark", "[.][benchmark][interprocess]")
+{
+    using clock_t = std::chrono::steady_clock;
+
+    auto const name = SharedMemory::MakeUniqueName();
+    auto memory = SharedMemory::Create(name, sizeof(TestSharedData));
+    auto *data = new(memory->GetData()) TestSharedData();
+
+    InterProcessSignal request(data->request_counter_, name + L"_req", true);
+    InterProcessSignal response(data->response_counter_, name + L"_res", true);
+
+    // spin で指定した時間だけスピンしたときの、往復にかかる時間を計測する
+    auto measure = [&](std::chrono::microseconds spin) {
+        UInt32 const kNumPings = 20000;
+        std::atomic<bool> quit = { false };
+        std::atomic<bool> ready = { false };
+        std::thread child([&] {
+            UInt32 last = request.GetCount();
+            ready.store(true);
+            while(quit.load() == false) {
+                if(request.Wait(last, std::chrono::milliseconds(10), spin) == false) { continue; }
+                last = request.GetCount();
+                response.Notify();
+            }
+        });
+
+        while(ready.load() == false) { std::this_thread::yield(); }
+
+        auto const begin = clock_t::now();
+        for(UInt32 i = 0; i < kNumPings; ++i) {
+            auto const last = response.GetCount();
+            request.Notify();
+            response.Wait(last, std::chrono::seconds(1), spin);
+        }
+        auto const usec = std::chrono::duration<double, std::micro>(clock_t::now() - begin).count();
+
+        quit.store(true);
+        child.join();
+        return usec / kNumPings;
+    };
+
+    std::cout << "InterProcessSignal round trip (spin 0us): " << measure(std::chrono::microseconds(0)) << " us" << std::endl;
+    std::cout << "InterProcessSignal round trip (spin 20us): " << measure(std::chrono::microseconds(20)) << " us" << std::endl;
+}
@@ -0,0 +1,60 @@
+#include "catch2/catch.hpp"
+
+#include <thread>
+#include <vector>
+#include "../misc/LatencyHistogram.hpp"
+
+using namespace hwm;
+
+TEST_CASE("LatencyHistogram test", "[histogram]")
+{
+    LatencyHistogram h;
+
+    auto s = h.GetSummary();
+    REQUIRE(s.count_ == 0);
+    REQUIRE(s.p50_ == 0);
+    REQUIRE(s.max_ == 0);
+
+    // 小さい値はそのままのバケットに記録される
+    for(int i = 0; i < 8; ++i) { h.Record(i); }
+    REQUIRE(h.GetPercentile(0.5) == 3);
+    REQUIRE(h.GetPercentile(1.0) == 7);
+
+    h.Reset();
+    for(int i = 1; i <= 1000; ++i) { h.Record(i); }
+
+    s = h.GetSummary();
+    REQUIRE(s.count_ == 1000);
+    REQUIRE(s.max_ == 1000);
+    REQUIRE(s.mean_ == Approx(500.5));
+    // パーセンタイル値は、正しい値以上で、相対誤差が12.5%以内に収まる
+    REQUIRE(s.p50_ >= 500);
+    REQUIRE(s.p50_ <= 500 * 1.125);
+    REQUIRE(s.p99_ >= 990);
+    REQUIRE(s.p99_ <= 1000);
+
+    h.Record(123456789);
+    REQUIRE(h.GetMax() == 123456789);
+    REQUIRE(h.GetPercentile(1.0) == 123456789);
+}
+
+TEST_CASE("LatencyHistogram concurrent test", "[histogram]")
+{
+    LatencyHistogram h;
+
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; ++t) {
+        threads.emplace_back([&h, t] {
+            for(int i = 0; i < 10000; ++i) { h.Record(t * 10000 + i); }
+        });
+    }
+
+    // 記録中に読み出しても問題ない
+    for(int i = 0; i < 100; ++i) { h.GetSummary(); }
+
+    for(auto &th: threads) { th.join(); }
+
+    auto s = h.GetSummary();
+    REQUIRE(s.count_ == 40000);
+    REQUIRE(s.max_ == 39999);
+}
@@ -0,0 +1,68 @@
+#include "catch2/catch.hpp"
+
+#include <cmath>
+#include <vector>
+#include "../misc/LevelMeter.hpp"
+
+using namespace hwm;
+
+TEST_CASE("GetSampleStatistics test", "[levelmeter]")
+{
+    // SSE2で処理される部分と、端数として処理される部分の両方を含む長さにする
+    std::vector<float> data(37);
+    for(size_t i = 0; i < data.size(); ++i) {
+        data[i] = std::sin(i * 0.3) * 0.5f;
+    }
+    data[5] = -1.25f;
+    data[34] = 1.0f;
+
+    float expected_peak = 0;
+    double expected_sum = 0;
+    for(auto x: data) {
+        expected_peak = std::max(expected_peak, std::fabs(x));
+        expected_sum += x * x;
+    }
+
+    auto st = GetSampleStatistics(data.data(), data.size());
+    REQUIRE(st.peak_ == expected_peak);
+    REQUIRE(st.peak_ == 1.25f);
+    REQUIRE(st.sum_of_squares_ == Approx(expected_sum));
+    REQUIRE(st.num_clipped_ == 2);
+
+    auto empty = GetSampleStatistics(data.data(), 0);
+    REQUIRE(empty.peak_ == 0);
+    REQUIRE(empty.sum_of_squares_ == 0);
+    REQUIRE(empty.num_clipped_ == 0);
+}
+
+TEST_CASE("LevelMeter test", "[levelmeter]")
+{
+    LevelMeter meter(-48.0, 24.0, 1.0);
+    meter.Reset(2, 1000);
+    REQUIRE(meter.GetNumChannels() == 2);
+    REQUIRE(meter.GetValues()[0].peak_db_ == -48.0);
+
+    std::vector<float> left(100, 0.5f);
+    std::vector<float> right(100, 0.0f);
+    float const *data[] = { left.data(), right.data() };
+
+    meter.Process(data, 2, 100);
+    auto v = meter.GetValues()[0];
+    REQUIRE(v.peak_db_ == Approx(-6.0206).margin(0.001));
+    REQUIRE(v.rms_db_ == Approx(-6.0206).margin(0.001));
+    REQUIRE(v.peak_hold_db_ == v.peak_db_);
+    REQUIRE(v.clip_count_ == 0);
+    REQUIRE(meter.GetValues()[1].peak_db_ == -48.0);
+
+    // 無音のブロックでは、ピークレベルはリリース速度に従って下がり、ピークホールドは保持される。
+    std::fill(left.begin(), left.end(), 0.0f);
+    meter.Process(data, 2, 100);
+    v = meter.GetValues()[0];
+    REQUIRE(v.peak_db_ == Approx(-6.0206 - 2.4).margin(0.001));
+    REQUIRE(v.peak_hold_db_ == Approx(-6.0206).margin(0.001));
+
+    left[0] = 2.0f;
+    left[1] = -1.0f;
+    meter.Process(data, 2, 100);
+    REQUIRE(meter.GetValues()[0].clip_count_ == 2);
+}
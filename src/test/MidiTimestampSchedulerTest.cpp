@@ -0,0 +1,183 @@
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "../device/MidiTimestampScheduler.hpp"
+
+using namespace hwm;
+
+namespace {
+
+DeviceMidiMessage MakeMessage(double time_stamp, UInt8 pitch)
+{
+    DeviceMidiMessage msg;
+    msg.time_stamp_ = time_stamp;
+    msg.channel_ = 3;
+    msg.data_ = MidiDataType::NoteOn { pitch, 100 };
+    return msg;
+}
+
+AudioDeviceTimeInfo MakeTimeInfo(double callback_time, double output_latency)
+{
+    AudioDeviceTimeInfo ti;
+    ti.callback_time_ = callback_time;
+    ti.output_time_ = callback_time + output_latency;
+    return ti;
+}
+
+} // namespace
+
+TEST_CASE("MidiTimestampScheduler keeps intervals under callback jitter", "[midi]")
+{
+    double const sample_rate = 48000;
+    SampleCount const block_size = 256;
+    double const period = block_size / sample_rate;
+    double const output_latency = 0.010;
+    double const base_time = 1000.0;
+
+    MidiTimestampScheduler ms;
+    ms.Reset(sample_rate, block_size);
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> jitter(-0.0005, 0.0005);
+
+    // 0.7ミリ秒ごとに受信するメッセージ。（ブロックの長さとは同期しない）
+    double const message_interval = 0.0007;
+    double next_message_time = base_time;
+
+    int const kNumBlocks = 3000;
+    int const kWarmUpBlocks = 1000;
+
+    //! 受信した時刻に対する、再生位置のずれ [サンプル]
+    std::vector<double> deviations;
+
+    for(int k = 0; k < kNumBlocks; ++k) {
+        double const callback_time = base_time + k * period + jitter(rng);
+
+        while(next_message_time < callback_time) {
+            REQUIRE(ms.Push(MakeMessage(next_message_time, 60)));
+            next_message_time += message_interval;
+        }
+
+        ms.BeginBlock(MakeTimeInfo(callback_time, output_latency), block_size);
+        ms.PopEvents([&](DeviceMidiMessage const &msg, SampleCount offset) {
+            REQUIRE(offset >= 0);
+            REQUIRE(offset < block_size);
+            REQUIRE(msg.channel_ == 3);
+
+            if(k < kWarmUpBlocks) { return; }
+            double const pos = (double)k * block_size + offset;
+            deviations.push_back(pos - (msg.time_stamp_ - base_time) * sample_rate);
+        });
+    }
+
+    REQUIRE(deviations.size() > 1000);
+    CHECK(ms.GetNumLateEvents() == 0);
+    CHECK(ms.GetNumDroppedEvents() == 0);
+
+    auto const minmax = std::minmax_element(deviations.begin(), deviations.end());
+
+    // コールバックの時刻をそのまま使うと、ずれの幅にはコールバックの揺れ(1ミリ秒 = 48サンプル)がそのまま現れる。
+    // DLLで推定した時刻を使うので、整数への丸めと推定誤差の分だけに収まる。
+    CHECK(*minmax.second - *minmax.first < 16);
+
+    auto const summary = ms.GetJitterSummary();
+    CHECK(summary.count_ == kNumBlocks - 1);
+    CHECK(summary.max_ <= 1000);
+}
+
+TEST_CASE("MidiTimestampScheduler holds future events", "[midi]")
+{
+    double const sample_rate = 44100;
+    SampleCount const block_size = 441; // 10ミリ秒
+
+    MidiTimestampScheduler ms;
+    ms.SetLatency(0.025);
+    ms.Reset(sample_rate, block_size);
+    REQUIRE(ms.GetLatency() == Approx(0.025));
+
+    ms.Push(MakeMessage(10.0, 60));
+
+    std::vector<SampleCount> offsets;
+    std::vector<int> blocks;
+    for(int k = 0; k < 5; ++k) {
+        ms.BeginBlock(MakeTimeInfo(10.0 + k * 0.01, 0), block_size);
+        ms.PopEvents([&](DeviceMidiMessage const &, SampleCount offset) {
+            offsets.push_back(offset);
+            blocks.push_back(k);
+        });
+    }
+
+    // 10.025秒は、10.02秒から始まる3番目のブロックの中間
+    REQUIRE(offsets.size() == 1);
+    REQUIRE(blocks[0] == 2);
+    REQUIRE(std::abs(offsets[0] - 220) <= 1);
+    REQUIRE(ms.GetNumLateEvents() == 0);
+}
+
+TEST_CASE("MidiTimestampScheduler places late events at the head of the block", "[midi]")
+{
+    MidiTimestampScheduler ms;
+    ms.SetLatency(0.001);
+    ms.Reset(44100, 512);
+
+    ms.BeginBlock(MakeTimeInfo(5.0, 0), 512);
+    ms.Push(MakeMessage(4.9, 60));
+
+    std::vector<SampleCount> offsets;
+    ms.PopEvents([&](DeviceMidiMessage const &, SampleCount offset) { offsets.push_back(offset); });
+
+    REQUIRE(offsets == std::vector<SampleCount>{ 0 });
+    REQUIRE(ms.GetNumLateEvents() == 1);
+}
+
+TEST_CASE("MidiTimestampScheduler drops events over the capacity", "[midi]")
+{
+    MidiTimestampScheduler ms(4);
+    ms.SetLatency(1.0);
+    ms.Reset(44100, 512);
+    ms.BeginBlock(MakeTimeInfo(0, 0), 512);
+
+    for(int i = 0; i < 4; ++i) {
+        REQUIRE(ms.Push(MakeMessage(0, 60 + i)));
+    }
+    REQUIRE(ms.Push(MakeMessage(0, 64)) == false);
+    REQUIRE(ms.GetNumDroppedEvents() == 1);
+
+    // 取り出した後は、また追加できる
+    for(int k = 1; k <= 100; ++k) {
+        ms.BeginBlock(MakeTimeInfo(k * 512 / 44100.0, 0), 512);
+        ms.PopEvents([](DeviceMidiMessage const &, SampleCount) {});
+    }
+    REQUIRE(ms.Push(MakeMessage(0, 64)));
+}
+
+TEST_CASE("MidiTimestampScheduler schedules due events without holding them", "[midi]")
+{
+    MidiTimestampScheduler ms(1);
+    ms.SetLatency(0.005);
+    ms.Reset(44100, 441);
+    ms.BeginBlock(MakeTimeInfo(1.0, 0), 441);
+
+    std::vector<SampleCount> offsets;
+    auto f = [&](DeviceMidiMessage const &, SampleCount offset) { offsets.push_back(offset); };
+
+    // 再生位置が現在のブロックに含まれるメッセージは、容量を使わずに直接渡される
+    REQUIRE(ms.Schedule(MakeMessage(0.999, 60), f));
+    REQUIRE(ms.Schedule(MakeMessage(1.0, 61), f));
+    REQUIRE(offsets.size() == 2);
+    REQUIRE(std::abs(offsets[1] - 220) <= 1);
+
+    // 次のブロックのメッセージは保持される
+    REQUIRE(ms.Schedule(MakeMessage(1.007, 62), f));
+    REQUIRE(ms.Schedule(MakeMessage(1.008, 63), f) == false);
+    REQUIRE(offsets.size() == 2);
+    REQUIRE(ms.GetNumDroppedEvents() == 1);
+
+    ms.BeginBlock(MakeTimeInfo(1.01, 0), 441);
+    ms.PopEvents(f);
+    REQUIRE(offsets.size() == 3);
+    REQUIRE(std::abs(offsets[2] - 88) <= 1);
+}
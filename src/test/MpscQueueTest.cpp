@@ -0,0 +1,84 @@
+#include "catch2/catch.hpp"
+
+#include <thread>
+#include <vector>
+#include "../misc/MpscQueue.hpp"
+
+using namespace hwm;
+
+TEST_CASE("MpscQueue basic test", "[mpscqueue]")
+{
+    MpscQueue<int> q(3);
+    REQUIRE(q.GetCapacity() == 4);
+
+    int x = 0;
+    REQUIRE(q.TryPop(x) == false);
+
+    REQUIRE(q.TryPush(10));
+    REQUIRE(q.TryPush(11));
+    REQUIRE(q.TryPush(12));
+    REQUIRE(q.TryPush(13));
+    REQUIRE(q.TryPush(14) == false);
+    REQUIRE(q.GetNumOverflows() == 1);
+
+    REQUIRE(q.TryPop(x));
+    REQUIRE(x == 10);
+    REQUIRE(q.TryPush(14));
+
+    for(int i = 11; i <= 14; ++i) {
+        REQUIRE(q.TryPop(x));
+        REQUIRE(x == i);
+    }
+    REQUIRE(q.TryPop(x) == false);
+    REQUIRE(q.GetNumOverflows() == 1);
+}
+
+TEST_CASE("MpscQueue stress test", "[mpscqueue]")
+{
+    struct Item {
+        int producer_ = 0;
+        int value_ = 0;
+    };
+
+    int const kNumProducers = 4;
+    int const kNumItemsPerProducer = 100000;
+
+    MpscQueue<Item> q(256);
+
+    std::vector<std::thread> producers;
+    std::atomic<UInt64> num_retries = { 0 };
+    for(int p = 0; p < kNumProducers; ++p) {
+        producers.emplace_back([&, p] {
+            for(int i = 0; i < kNumItemsPerProducer; ++i) {
+                while(q.TryPush(Item { p, i }) == false) {
+                    num_retries.fetch_add(1);
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // 各書き込み側のデータは、追加した順番に取り出されなければならない
+    std::vector<int> next_values(kNumProducers, 0);
+    int num_errors = 0;
+    int num_popped = 0;
+    while(num_popped < kNumProducers * kNumItemsPerProducer) {
+        Item item;
+        if(q.TryPop(item) == false) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        if(item.value_ != next_values[item.producer_]) { ++num_errors; }
+        next_values[item.producer_] = item.value_ + 1;
+        ++num_popped;
+    }
+
+    for(auto &t: producers) { t.join(); }
+
+    Item item;
+    REQUIRE(q.TryPop(item) == false);
+    REQUIRE(num_errors == 0);
+    for(auto n: next_values) { REQUIRE(n == kNumItemsPerProducer); }
+    REQUIRE(q.GetNumOverflows() == num_retries.load());
+}
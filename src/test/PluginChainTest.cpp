@@ -0,0 +1,178 @@
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <vector>
+#include "../app/PluginChain.hpp"
+
+using namespace hwm;
+
+namespace {
+
+//! 入力をそのまま出力するプラグインの代わり。 skip_ が true のブロックでは何も書き込まない。
+struct PassThroughProcessor : IPluginChainNodeProcessor
+{
+    bool skip_ = false;
+
+    String GetPluginName() const override { return L"pass through"; }
+    UInt32 GetLatencySamples() const override { return 0; }
+    UInt32 GetNumAudioOutputs() const override { return 2; }
+
+    void Process(ProcessInfo &pi) override
+    {
+        if(skip_) { return; }
+
+        auto const &in = pi.input_audio_buffer_;
+        auto &out = pi.output_audio_buffer_;
+        auto const num_channels = std::min(in.channels(), out.channels());
+        for(UInt32 ch = 0; ch < num_channels; ++ch) {
+            std::copy_n(in.get_channel_data(ch), out.samples(), out.get_channel_data(ch));
+        }
+    }
+};
+
+//! 倍精度のバッファで処理するプラグインの代わり。入力に offset_ を加えて出力し、受け取った入力を記録する
+struct DoublePrecisionProcessor : IPluginChainNodeProcessor
+{
+    double offset_ = 0;
+    std::vector<double> received_;
+
+    String GetPluginName() const override { return L"double precision"; }
+    UInt32 GetLatencySamples() const override { return 0; }
+    UInt32 GetNumAudioOutputs() const override { return 2; }
+    bool UsesDoublePrecision() const override { return true; }
+
+    void Process(ProcessInfo &pi) override
+    {
+        REQUIRE(pi.input_audio_buffer_.channels() == 0);
+
+        auto const &in = pi.input_audio_buffer64_;
+        auto &out = pi.output_audio_buffer64_;
+        received_.assign(in.get_channel_data(0), in.get_channel_data(0) + in.samples());
+        for(UInt32 ch = 0; ch < out.channels(); ++ch) {
+            for(UInt32 i = 0; i < out.samples(); ++i) {
+                out.get_channel_data(ch)[i] = (ch < in.channels() ? in.get_channel_data(ch)[i] : 0) + offset_;
+            }
+        }
+    }
+};
+
+} // namespace
+
+TEST_CASE("PluginChainNode outputs silence when the plugin skips a block", "[plugin_chain]")
+{
+    UInt32 const num_channels = 2;
+    SampleCount const block_size = 64;
+
+    auto first_processor = std::make_unique<PassThroughProcessor>();
+    auto *first = first_processor.get();
+    PluginChainNode first_node(std::move(first_processor), true);
+    PluginChainNode second_node(std::make_unique<PassThroughProcessor>(), true);
+    first_node.PrepareBuffers(num_channels, block_size, false);
+    second_node.PrepareBuffers(num_channels, block_size, false);
+
+    Buffer<AudioSample> input(num_channels, block_size);
+    Buffer<AudioSample> output(num_channels, block_size);
+    for(UInt32 ch = 0; ch < num_channels; ++ch) {
+        std::fill_n(input.data()[ch], block_size, 0.5f);
+    }
+
+    DelayLine<AudioSample> first_delay(num_channels, 0);
+    DelayLine<AudioSample> second_delay(num_channels, 0);
+
+    auto process_chain = [&] {
+        ProcessInfo::TimeInfo time_info;
+        auto &first_output = first_node.GetOutputBuffer();
+        first_node.Process(time_info,
+                           BufferRef<AudioSample const>(input, 0, num_channels, 0, block_size),
+                           BufferRef<AudioSample>(first_output, 0, num_channels, 0, block_size),
+                           first_delay);
+        second_node.Process(time_info,
+                            BufferRef<AudioSample const>(first_output, 0, num_channels, 0, block_size),
+                            BufferRef<AudioSample>(output, 0, num_channels, 0, block_size),
+                            second_delay);
+    };
+
+    auto all_samples_equal = [&](AudioSample value) {
+        for(UInt32 ch = 0; ch < num_channels; ++ch) {
+            for(SampleCount i = 0; i < block_size; ++i) {
+                if(output.data()[ch][i] != value) { return false; }
+            }
+        }
+        return true;
+    };
+
+    process_chain();
+    REQUIRE(all_samples_equal(0.5f));
+
+    // 前のブロックの出力が、後段のノードに繰り返し渡されないこと
+    first->skip_ = true;
+    process_chain();
+    REQUIRE(all_samples_equal(0.0f));
+
+    first->skip_ = false;
+    process_chain();
+    REQUIRE(all_samples_equal(0.5f));
+}
+
+TEST_CASE("PluginChainNode passes double precision samples between nodes", "[plugin_chain]")
+{
+    UInt32 const num_channels = 2;
+    SampleCount const block_size = 16;
+    // 単精度では表せない値
+    double const kOffset = 1.0 + 1e-12;
+    REQUIRE((double)(float)kOffset != kOffset);
+
+    auto first_processor = std::make_unique<DoublePrecisionProcessor>();
+    first_processor->offset_ = kOffset;
+    auto second_processor = std::make_unique<DoublePrecisionProcessor>();
+    auto *second = second_processor.get();
+
+    PluginChainNode first_node(std::move(first_processor), true);
+    PluginChainNode second_node(std::move(second_processor), true);
+    first_node.PrepareBuffers(num_channels, block_size, true);
+    second_node.PrepareBuffers(num_channels, block_size, true);
+    REQUIRE(first_node.GetOutputBuffer<double>().samples() == block_size);
+    REQUIRE(first_node.GetOutputBuffer().samples() == 0);
+
+    Buffer<double> input(num_channels, block_size);
+    Buffer<double> output(num_channels, block_size);
+    DelayLine<double> first_delay(num_channels, 0);
+    DelayLine<double> second_delay(num_channels, 0);
+
+    ProcessInfo::TimeInfo time_info;
+    auto &first_output = first_node.GetOutputBuffer<double>();
+    first_node.Process(time_info,
+                       BufferRef<double const>(input, 0, num_channels, 0, block_size),
+                       BufferRef<double>(first_output, 0, num_channels, 0, block_size),
+                       first_delay);
+    second_node.Process(time_info,
+                        BufferRef<double const>(first_output, 0, num_channels, 0, block_size),
+                        BufferRef<double>(output, 0, num_channels, 0, block_size),
+                        second_delay);
+
+    // ノードの間で単精度に丸められていないこと
+    REQUIRE(second->received_.size() == block_size);
+    for(auto x: second->received_) {
+        REQUIRE(x == kOffset);
+    }
+    for(UInt32 ch = 0; ch < num_channels; ++ch) {
+        for(SampleCount i = 0; i < block_size; ++i) {
+            REQUIRE(output.data()[ch][i] == kOffset);
+        }
+    }
+
+    SECTION("single precision node in a double precision graph") {
+        // 単精度のノードだけが、ノードの中で精度を変換する
+        PluginChainNode float_node(std::make_unique<PassThroughProcessor>(), true);
+        float_node.PrepareBuffers(num_channels, block_size, true);
+
+        auto &float_output = float_node.GetOutputBuffer<double>();
+        DelayLine<double> float_delay(num_channels, 0);
+        float_node.Process(time_info,
+                           BufferRef<double const>(first_output, 0, num_channels, 0, block_size),
+                           BufferRef<double>(float_output, 0, num_channels, 0, block_size),
+                           float_delay);
+        REQUIRE(float_output.data()[0][0] == (double)(float)kOffset);
+        REQUIRE(float_output.data()[1][block_size - 1] == (double)(float)kOffset);
+    }
+}
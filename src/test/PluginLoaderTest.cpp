@@ -0,0 +1,322 @@
+#include "catch2/catch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../app/PluginLoader.hpp"
+
+using namespace hwm;
+
+namespace {
+
+using Stage = PluginLoader::Stage;
+
+//! GUIスレッドのイベント処理の代わりに、 Dispatcher で渡された関数をテストのスレッドで呼び出す
+class MainThreadQueue
+{
+public:
+    void Push(std::function<void()> f)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        queue_.push_back(std::move(f));
+    }
+
+    bool IsEmpty()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return queue_.empty();
+    }
+
+    //! キューにある関数を一つ呼び出す。キューが空の場合は false を返す
+    bool RunOne()
+    {
+        std::function<void()> f;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if(queue_.empty()) { return false; }
+            f = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        f();
+        return true;
+    }
+
+    //! キューが空になるまで関数を呼び出す
+    void RunAll()
+    {
+        while(RunOne()) {}
+    }
+
+    //! pred() が true を返すまで、関数を呼び出し続ける。時間内に true にならなければ false を返す
+    bool RunUntil(std::function<bool()> pred)
+    {
+        auto const end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while(pred() == false) {
+            if(std::chrono::steady_clock::now() > end) { return false; }
+            if(RunOne() == false) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+        }
+        return true;
+    }
+
+private:
+    std::mutex mtx_;
+    std::deque<std::function<void()>> queue_;
+};
+
+//! タスクの呼び出しの記録。ロード用のスレッドからも書き込まれる
+class TaskLog
+{
+public:
+    void Add(Stage stage)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stages_.push_back(stage);
+        if(stage == Stage::kPreparing) { prepare_thread_ = std::this_thread::get_id(); }
+    }
+
+    std::vector<Stage> GetStages()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return stages_;
+    }
+
+    std::thread::id GetPrepareThread()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return prepare_thread_;
+    }
+
+    std::atomic<bool> destroyed_ = { false };
+
+private:
+    std::mutex mtx_;
+    std::vector<Stage> stages_;
+    std::thread::id prepare_thread_;
+};
+
+class FakeTask : public PluginLoader::ITask
+{
+public:
+    FakeTask(TaskLog *log, bool has_state = true)
+    :   log_(log)
+    ,   has_state_(has_state)
+    {}
+
+    ~FakeTask() { log_->destroyed_ = true; }
+
+    //! 指定した場合は、 Prepare() の開始を通知して、 gate が準備できるまで待機する
+    std::promise<void> *started_ = nullptr;
+    std::shared_future<void> gate_;
+    //! この段階で例外を送出する
+    std::optional<Stage> fail_stage_;
+
+    bool HasStage(Stage stage) const override
+    {
+        if(stage == Stage::kPreparing || stage == Stage::kRestoringState) { return has_state_; }
+        return true;
+    }
+
+    void Prepare() override
+    {
+        log_->Add(Stage::kPreparing);
+        if(started_) { started_->set_value(); }
+        if(gate_.valid()) { gate_.wait(); }
+    }
+
+    void Run(Stage stage) override
+    {
+        log_->Add(stage);
+        if(stage == fail_stage_) { throw std::runtime_error("failed"); }
+    }
+
+private:
+    TaskLog *log_;
+    bool has_state_;
+};
+
+struct LoaderFixture
+{
+    MainThreadQueue queue_;
+    std::vector<std::pair<UInt64, Stage>> progress_;
+    std::vector<UInt64> finished_;
+    std::unique_ptr<PluginLoader> loader_;
+
+    LoaderFixture()
+    {
+        loader_ = std::make_unique<PluginLoader>(
+            [this](std::function<void()> f) { queue_.Push(std::move(f)); },
+            [this](UInt64 id, Stage stage) {
+                REQUIRE(std::this_thread::get_id() == main_thread_);
+                progress_.emplace_back(id, stage);
+            },
+            [this](UInt64 id) {
+                REQUIRE(std::this_thread::get_id() == main_thread_);
+                finished_.push_back(id);
+            });
+    }
+
+    bool WaitForFinished()
+    {
+        return queue_.RunUntil([this] { return finished_.empty() == false; });
+    }
+
+    std::thread::id main_thread_ = std::this_thread::get_id();
+};
+
+} // namespace
+
+TEST_CASE("PluginLoader runs the stages in order", "[plugin_loader]")
+{
+    LoaderFixture fx;
+
+    SECTION("with state") {
+        TaskLog log;
+        auto const id = fx.loader_->StartLoad(std::make_unique<FakeTask>(&log));
+        REQUIRE(fx.loader_->IsLoading());
+        REQUIRE(fx.WaitForFinished());
+
+        std::vector<Stage> const expected {
+            Stage::kPreparing, Stage::kCreating, Stage::kSettingUp, Stage::kRestoringState, Stage::kActivating
+        };
+        REQUIRE(log.GetStages() == expected);
+        // 準備だけをロード用のスレッドで行う
+        REQUIRE(log.GetPrepareThread() != fx.main_thread_);
+
+        REQUIRE(fx.progress_.size() == expected.size());
+        for(size_t i = 0; i < expected.size(); ++i) {
+            REQUIRE(fx.progress_[i].first == id);
+            REQUIRE(fx.progress_[i].second == expected[i]);
+        }
+
+        REQUIRE(fx.finished_ == std::vector<UInt64>{ id });
+        REQUIRE_FALSE(fx.loader_->IsLoading());
+
+        auto result = fx.loader_->TakeResult(id);
+        REQUIRE(result);
+        REQUIRE(result->task_);
+        REQUIRE(result->error_msg_.empty());
+        REQUIRE_FALSE(log.destroyed_);
+        REQUIRE_FALSE(fx.loader_->TakeResult(id));
+
+        result.reset();
+        REQUIRE(log.destroyed_);
+    }
+
+    SECTION("without state") {
+        TaskLog log;
+        auto const id = fx.loader_->StartLoad(std::make_unique<FakeTask>(&log, false));
+        REQUIRE(fx.WaitForFinished());
+
+        std::vector<Stage> const expected { Stage::kCreating, Stage::kSettingUp, Stage::kActivating };
+        REQUIRE(log.GetStages() == expected);
+        REQUIRE(fx.loader_->TakeResult(id));
+    }
+}
+
+TEST_CASE("PluginLoader reports failures", "[plugin_loader]")
+{
+    LoaderFixture fx;
+
+    TaskLog log;
+    auto task = std::make_unique<FakeTask>(&log);
+    task->fail_stage_ = Stage::kSettingUp;
+    auto const id = fx.loader_->StartLoad(std::move(task));
+    REQUIRE(fx.WaitForFinished());
+
+    std::vector<Stage> const expected { Stage::kPreparing, Stage::kCreating, Stage::kSettingUp };
+    REQUIRE(log.GetStages() == expected);
+    REQUIRE(log.destroyed_);
+
+    auto result = fx.loader_->TakeResult(id);
+    REQUIRE(result);
+    REQUIRE_FALSE(result->task_);
+    REQUIRE(result->error_msg_ == L"failed");
+}
+
+TEST_CASE("PluginLoader supersedes a running load", "[plugin_loader]")
+{
+    LoaderFixture fx;
+
+    SECTION("while preparing") {
+        TaskLog old_log;
+        std::promise<void> started;
+        std::promise<void> gate;
+        auto old_task = std::make_unique<FakeTask>(&old_log);
+        old_task->started_ = &started;
+        old_task->gate_ = gate.get_future().share();
+
+        auto const old_id = fx.loader_->StartLoad(std::move(old_task));
+        started.get_future().wait();
+
+        TaskLog new_log;
+        auto const new_id = fx.loader_->StartLoad(std::make_unique<FakeTask>(&new_log));
+        gate.set_value();
+        REQUIRE(fx.WaitForFinished());
+
+        REQUIRE(fx.finished_ == std::vector<UInt64>{ new_id });
+        REQUIRE(old_log.GetStages() == std::vector<Stage>{ Stage::kPreparing });
+        REQUIRE(old_log.destroyed_);
+        REQUIRE_FALSE(fx.loader_->TakeResult(old_id));
+        REQUIRE(fx.loader_->TakeResult(new_id));
+    }
+
+    SECTION("while running the stages on the main thread") {
+        TaskLog old_log;
+        auto const old_id = fx.loader_->StartLoad(std::make_unique<FakeTask>(&old_log));
+        REQUIRE(fx.queue_.RunUntil([&] { return old_log.GetStages().size() == 3; }));
+        REQUIRE(old_log.GetStages().back() == Stage::kSettingUp);
+
+        TaskLog new_log;
+        auto const new_id = fx.loader_->StartLoad(std::make_unique<FakeTask>(&new_log));
+        REQUIRE(fx.WaitForFinished());
+        fx.queue_.RunAll();
+
+        REQUIRE(fx.finished_ == std::vector<UInt64>{ new_id });
+        // 中断したロードは次の段階に進まない
+        REQUIRE(old_log.GetStages().size() == 3);
+        REQUIRE(old_log.destroyed_);
+        REQUIRE_FALSE(fx.loader_->TakeResult(old_id));
+        REQUIRE(new_log.GetStages().size() == 5);
+        REQUIRE(fx.loader_->TakeResult(new_id));
+    }
+}
+
+TEST_CASE("PluginLoader cancels a running load", "[plugin_loader]")
+{
+    LoaderFixture fx;
+
+    TaskLog log;
+    auto const id = fx.loader_->StartLoad(std::make_unique<FakeTask>(&log));
+    REQUIRE(fx.queue_.RunUntil([&] { return log.GetStages().size() == 2; }));
+
+    fx.loader_->Cancel();
+    REQUIRE_FALSE(fx.loader_->IsLoading());
+    fx.queue_.RunAll();
+
+    REQUIRE(fx.finished_.empty());
+    REQUIRE(log.GetStages() == std::vector<Stage>{ Stage::kPreparing, Stage::kCreating });
+    REQUIRE(log.destroyed_);
+    REQUIRE_FALSE(fx.loader_->TakeResult(id));
+}
+
+TEST_CASE("PluginLoader ignores dispatched calls after it is destroyed", "[plugin_loader]")
+{
+    LoaderFixture fx;
+
+    TaskLog log;
+    fx.loader_->StartLoad(std::make_unique<FakeTask>(&log));
+    REQUIRE(fx.queue_.RunUntil([&] { return fx.queue_.IsEmpty() == false; }));
+
+    fx.loader_.reset();
+    fx.queue_.RunAll();
+
+    REQUIRE(fx.finished_.empty());
+    REQUIRE(log.destroyed_);
+    REQUIRE(log.GetStages().size() <= 1);
+}
@@ -0,0 +1,119 @@
+#include "catch2/catch.hpp"
+
+#include <sstream>
+#include "../file/PluginScanCache.hpp"
+
+using namespace hwm;
+
+namespace {
+
+ClassInfo::CID MakeCID(Steinberg::int8 seed)
+{
+    ClassInfo::CID cid;
+    for(UInt32 i = 0; i < cid.size(); ++i) { cid[i] = (Steinberg::int8)(seed + i * 7); }
+    return cid;
+}
+
+} // namespace
+
+TEST_CASE("PluginScanCache restores the scanned entries", "[plugin_scan_cache]")
+{
+    PluginScanCache src;
+
+    PluginScanEntry loadable;
+    loadable.module_path_ = L"C:\\Program Files\\Common Files\\VST3\\Test \"Synth\".vst3";
+    loadable.modification_time_ = 1600000000123;
+    loadable.file_size_ = 12345678;
+    loadable.hash_ = 0xFEDCBA9876543210ull;
+    loadable.is_loadable_ = true;
+    loadable.factory_info_ = FactoryInfo(L"test vendor", L"https://example.com", L"info@example.com",
+                                         Steinberg::PFactoryInfo::kUnicode);
+    loadable.class_info_list_.emplace_back(MakeCID(1), L"シンセ", L"Audio Module Class", 0x7FFFFFFF,
+                                           ClassInfo2Data(L"Instrument|Synth", L"class vendor", L"1.0.0", L"VST 3.6.13"));
+    loadable.class_info_list_.emplace_back(MakeCID(-100), L"controller", L"Component Controller Class", 0);
+    src.entries_.push_back(loadable);
+
+    PluginScanEntry broken;
+    broken.module_path_ = L"/Library/Audio/Plug-Ins/VST3/Broken.vst3";
+    broken.modification_time_ = 42;
+    broken.file_size_ = 0;
+    broken.hash_ = 1;
+    broken.is_loadable_ = false;
+    src.entries_.push_back(broken);
+
+    std::stringstream ss;
+    ss << src;
+
+    PluginScanCache dest;
+    ss >> dest;
+
+    REQUIRE(dest.entries_.size() == 2);
+
+    auto const &e0 = dest.entries_[0];
+    CHECK(e0.module_path_ == loadable.module_path_);
+    CHECK(e0.modification_time_ == loadable.modification_time_);
+    CHECK(e0.file_size_ == loadable.file_size_);
+    CHECK(e0.hash_ == loadable.hash_);
+    CHECK(e0.is_loadable_);
+    CHECK(e0.factory_info_.GetVendor() == L"test vendor");
+    CHECK(e0.factory_info_.GetURL() == L"https://example.com");
+    CHECK(e0.factory_info_.GetEmail() == L"info@example.com");
+    CHECK(e0.factory_info_.IsUnicode());
+    CHECK(e0.factory_info_.IsDiscardable() == false);
+
+    REQUIRE(e0.class_info_list_.size() == 2);
+    auto const &c0 = e0.class_info_list_[0];
+    CHECK(c0.GetCID() == MakeCID(1));
+    CHECK(c0.GetName() == L"シンセ");
+    CHECK(c0.GetCategory() == L"Audio Module Class");
+    CHECK(c0.GetCardinality() == 0x7FFFFFFF);
+    REQUIRE(c0.HasClassInfo2());
+    CHECK(c0.GetClassInfo2().GetSubCategories() == L"Instrument|Synth");
+    CHECK(c0.GetClassInfo2().GetVendor() == L"class vendor");
+    CHECK(c0.GetClassInfo2().GetVersion() == L"1.0.0");
+    CHECK(c0.GetClassInfo2().GetSDKVersion() == L"VST 3.6.13");
+
+    auto const &c1 = e0.class_info_list_[1];
+    CHECK(c1.GetCID() == MakeCID(-100));
+    CHECK(c1.GetName() == L"controller");
+    CHECK(c1.HasClassInfo2() == false);
+
+    auto const &e1 = dest.entries_[1];
+    CHECK(e1.module_path_ == broken.module_path_);
+    CHECK(e1.modification_time_ == 42);
+    CHECK(e1.hash_ == 1);
+    CHECK(e1.is_loadable_ == false);
+    CHECK(e1.class_info_list_.empty());
+}
+
+TEST_CASE("PluginScanCache skips broken entries", "[plugin_scan_cache]")
+{
+    std::stringstream ss;
+    ss
+    << "format = plugin_scan_cache_format_v1\n"
+    << "[module]\n"
+    << "module_path = \"/a.vst3\"\n"
+    << "modification_time = \"1\"\n"
+    << "[module]\n"
+    << "module_path = \"/b.vst3\"\n"
+    << "modification_time = \"2\"\n"
+    << "file_size = \"3\"\n"
+    << "hash = \"4\"\n"
+    << "is_loadable = \"0\"\n"
+    ;
+
+    PluginScanCache cache;
+    ss >> cache;
+    REQUIRE(cache.entries_.size() == 1);
+    CHECK(cache.entries_[0].module_path_ == L"/b.vst3");
+    CHECK(cache.entries_[0].file_size_ == 3);
+}
+
+TEST_CASE("PluginScanCache rejects an unknown format", "[plugin_scan_cache]")
+{
+    std::stringstream ss;
+    ss << "format = config_file_format_v1\n";
+
+    PluginScanCache cache;
+    CHECK_THROWS_AS(ss >> cache, PluginScanCache::FailedToParse);
+}
@@ -0,0 +1,174 @@
+#include "catch2/catch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <wx/filename.h>
+#include <wx/utils.h>
+
+#include "../app/PluginScanner.hpp"
+#include "../misc/StrCnv.hpp"
+
+using namespace hwm;
+
+namespace {
+
+//! GUIスレッドのイベント処理の代わりに、 Dispatcher で渡された関数をテストのスレッドで呼び出す
+class MainThreadQueue
+{
+public:
+    void Push(std::function<void()> f)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        queue_.push_back(std::move(f));
+    }
+
+    //! pred() が true を返すまで、関数を呼び出し続ける。時間内に true にならなければ false を返す
+    bool RunUntil(std::function<bool()> pred)
+    {
+        auto const end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while(pred() == false) {
+            if(std::chrono::steady_clock::now() > end) { return false; }
+
+            std::function<void()> f;
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                if(queue_.empty() == false) {
+                    f = std::move(queue_.front());
+                    queue_.pop_front();
+                }
+            }
+
+            if(f) {
+                f();
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        return true;
+    }
+
+private:
+    std::mutex mtx_;
+    std::deque<std::function<void()>> queue_;
+};
+
+//! ModuleScanner の呼び出しの記録。スキャンスレッドからも参照される
+class ModuleScanLog
+{
+public:
+    void Add(String const &module_path)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        module_paths_.push_back(module_path);
+        thread_ids_.push_back(std::this_thread::get_id());
+    }
+
+    std::vector<String> GetModulePaths() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return module_paths_;
+    }
+
+    std::vector<std::thread::id> GetThreadIDs() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return thread_ids_;
+    }
+
+private:
+    std::mutex mutable mtx_;
+    std::vector<String> module_paths_;
+    std::vector<std::thread::id> thread_ids_;
+};
+
+void WriteFile(String const &path, std::string const &content)
+{
+    std::ofstream ofs(to_utf8(path), std::ios::binary);
+    ofs << content;
+}
+
+} // namespace
+
+TEST_CASE("PluginScanner loads modules only through the dispatcher", "[plugin_scanner]")
+{
+    auto const dir = wxFileName(wxFileName::GetTempDir(),
+                                L"hwm_plugin_scanner_test_" + std::to_wstring(wxGetProcessId())).GetFullPath().ToStdWstring();
+    REQUIRE(wxFileName::Mkdir(dir, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL));
+
+    auto const module_a = wxFileName(dir, L"A.vst3").GetFullPath().ToStdWstring();
+    auto const module_b = wxFileName(dir, L"B.vst3").GetFullPath().ToStdWstring();
+    auto const cache_file_path = wxFileName(dir + L"/cache", L"PluginScanCache.txt").GetFullPath().ToStdWstring();
+    WriteFile(module_a, "module a");
+    WriteFile(module_b, "module b");
+
+    MainThreadQueue queue;
+    ModuleScanLog log;
+    auto const main_thread_id = std::this_thread::get_id();
+
+    PluginScanner scanner(
+        [&queue](std::function<void()> f) { queue.Push(std::move(f)); },
+        [&log](String const &module_path, String const &output_path, std::function<void()> on_finished) {
+            log.Add(module_path);
+
+            PluginScanCache cache;
+            cache.entries_.emplace_back();
+            cache.entries_.back().module_path_ = module_path;
+            cache.entries_.back().is_loadable_ = (module_path.find(L"A.vst3") != String::npos);
+            std::ofstream ofs(to_utf8(output_path), std::ios::trunc);
+            ofs << cache;
+            ofs.close();
+
+            on_finished();
+        });
+
+    std::atomic<bool> finished = { false };
+    std::thread::id scan_thread_id;
+    auto start_scan = [&] {
+        finished.store(false);
+        scanner.StartScan({ dir }, cache_file_path, [&] {
+            scan_thread_id = std::this_thread::get_id();
+            finished.store(true);
+        });
+        REQUIRE(queue.RunUntil([&] { return finished.load(); }));
+    };
+
+    start_scan();
+
+    // モジュールのロードはスキャンスレッドではなく、 Dispatcher を呼び出したスレッドで行われる
+    CHECK(log.GetModulePaths().size() == 2);
+    for(auto id: log.GetThreadIDs()) {
+        CHECK(id == main_thread_id);
+        CHECK(id != scan_thread_id);
+    }
+
+    auto const entries = scanner.GetEntries();
+    REQUIRE(entries.size() == 2);
+    CHECK(entries[0].module_path_ == module_a);
+    CHECK(entries[0].is_loadable_);
+    CHECK(entries[0].file_size_ == 8);
+    CHECK(entries[1].module_path_ == module_b);
+    CHECK(entries[1].is_loadable_ == false);
+
+    SECTION("unchanged modules are not loaded again") {
+        start_scan();
+        CHECK(log.GetModulePaths().size() == 2);
+        CHECK(scanner.GetEntries().size() == 2);
+    }
+
+    SECTION("only the changed module is loaded again") {
+        WriteFile(module_b, "module b changed");
+        start_scan();
+        REQUIRE(log.GetModulePaths().size() == 3);
+        CHECK(log.GetModulePaths()[2] == module_b);
+        CHECK(log.GetThreadIDs()[2] == main_thread_id);
+    }
+
+    wxFileName::Rmdir(dir, wxPATH_RMDIR_RECURSIVE);
+}
@@ -0,0 +1,70 @@
+#include "catch2/catch.hpp"
+
+#include <thread>
+#include "../misc/RcuPointer.hpp"
+
+using namespace hwm;
+
+TEST_CASE("RcuPointer basic test", "[rcu]")
+{
+    RcuPointer<int> p;
+    
+    REQUIRE(p.Read().get() == nullptr);
+    
+    auto old = p.Exchange(std::make_shared<int>(10));
+    REQUIRE(old == nullptr);
+    
+    {
+        auto r = p.Read();
+        REQUIRE(r);
+        REQUIRE(*r == 10);
+    }
+    
+    old = p.Exchange(std::make_shared<int>(20));
+    REQUIRE(old);
+    REQUIRE(*old == 10);
+    REQUIRE(*p.Get() == 20);
+    REQUIRE(*p.Read() == 20);
+    
+    old = p.Exchange(nullptr);
+    REQUIRE(*old == 20);
+    REQUIRE(p.Read().get() == nullptr);
+}
+
+TEST_CASE("RcuPointer never releases a value while it is read", "[rcu]")
+{
+    struct Item {
+        Item(int v) : value_(v) {}
+        ~Item() { alive_ = false; }
+        int value_;
+        std::atomic<bool> alive_ = { true };
+    };
+    
+    RcuPointer<Item> p;
+    p.Exchange(std::make_shared<Item>(0));
+    
+    std::atomic<bool> finished = { false };
+    std::atomic<int> num_errors = { 0 };
+    
+    std::thread reader([&] {
+        while(finished.load() == false) {
+            auto r = p.Read();
+            if(!r) { continue; }
+            for(int i = 0; i < 100; ++i) {
+                if(r->alive_.load() == false) { num_errors.fetch_add(1); }
+            }
+        }
+    });
+    
+    for(int i = 1; i <= 10000; ++i) {
+        auto old = p.Exchange(std::make_shared<Item>(i));
+        REQUIRE(old);
+        REQUIRE(old->value_ == i - 1);
+        // ここで old が解放される
+    }
+    
+    finished = true;
+    reader.join();
+    
+    REQUIRE(num_errors.load() == 0);
+}
@@ -0,0 +1,163 @@
+#include "catch2/catch.hpp"
+
+#include <future>
+#include <thread>
+#include <vector>
+#include "../log/RealtimeLogger.hpp"
+#include "../log/LoggingStrategy.hpp"
+
+using namespace hwm;
+
+namespace {
+    struct TestLoggingStrategy
+    :   Logger::LoggingStrategy
+    {
+        Logger::Error OutputLog(String const &message) override
+        {
+            messages_.push_back(message);
+            return Logger::Error::NoError();
+        }
+        
+        std::vector<String> messages_;
+    };
+    
+    bool EndsWith(String const &str, String const &suffix)
+    {
+        return str.size() >= suffix.size() && std::equal(suffix.rbegin(), suffix.rend(), str.rbegin());
+    }
+}
+
+TEST_CASE("FormatRealtimeLogRecord test", "[log]")
+{
+    RealtimeLogRecord rec;
+    rec.format_ = L"int: {}, uint: {}, double: {}, bool: {}, str: {}, rest: {}";
+    rec.num_args_ = 5;
+    rec.args_[0] = MakeRealtimeLogArg(-10);
+    rec.args_[1] = MakeRealtimeLogArg((UInt8)200);
+    rec.args_[2] = MakeRealtimeLogArg(0.5);
+    rec.args_[3] = MakeRealtimeLogArg(true);
+    rec.args_[4] = MakeRealtimeLogArg(L"abc");
+    
+    REQUIRE(FormatRealtimeLogRecord(rec) == L"int: -10, uint: 200, double: 0.5, bool: true, str: abc, rest: {}");
+}
+
+TEST_CASE("FormatRealtimeLogRecord formats values with a formatter", "[log]")
+{
+    RealtimeLogRecord rec;
+    rec.format_ = L"result: {}, raw: {}";
+    rec.num_args_ = 2;
+    rec.args_[0] = MakeRealtimeLogArg(RealtimeLogFormattedInt { 1, [](Int64 v) -> String {
+        return v == 1 ? L"kResultFalse" : L"unknown";
+    } });
+    rec.args_[1] = MakeRealtimeLogArg(RealtimeLogFormattedInt { -3, nullptr });
+    
+    REQUIRE(FormatRealtimeLogRecord(rec) == L"result: kResultFalse, raw: -3");
+}
+
+TEST_CASE("RealtimeLogger test", "[log]")
+{
+    Logger logger;
+    logger.SetLoggingLevels({ L"Error", L"Warn", L"Info", L"Debug" });
+    logger.SetMostDetailedActiveLoggingLevel(L"Info");
+    auto st = std::make_shared<TestLoggingStrategy>();
+    logger.SetStrategy(st);
+    logger.StartLogging(true);
+    
+    RealtimeLogger::Options opts;
+    opts.num_rings_ = 2;
+    opts.ring_capacity_ = 4;
+    opts.logger_ = &logger;
+    
+    {
+        RealtimeLogger rt_logger(opts);
+        
+        HWM_RT_INFO_LOG(L"message {}", 1);
+        HWM_RT_DEBUG_LOG(L"debug message is not active");
+        
+        std::thread th([] {
+            HWM_RT_WARN_LOG(L"message {} from {}", 2, L"another thread");
+        });
+        th.join();
+        
+        // the ring is full. (its capacity is 4 and 2 records have been pushed from this thread.)
+        for(int i = 0; i < 3; ++i) {
+            HWM_RT_INFO_LOG(L"message {}", 3 + i);
+        }
+        REQUIRE(rt_logger.GetNumDroppedRecords() == 1);
+        
+        rt_logger.Start();
+        rt_logger.Stop();
+    }
+    
+    logger.StartLogging(false);
+    
+    auto const &messages = st->messages_;
+    REQUIRE(messages.size() == 5);
+    REQUIRE(EndsWith(messages[0], L"[Info] message 1"));
+    REQUIRE(EndsWith(messages[1], L"[Warn] message 2 from another thread"));
+    REQUIRE(EndsWith(messages[2], L"[Info] message 3"));
+    REQUIRE(EndsWith(messages[3], L"[Info] message 4"));
+    REQUIRE(EndsWith(messages[4], L"[Warn] 1 realtime log records were dropped."));
+}
+
+TEST_CASE("RealtimeLogger outlived by a logging thread", "[log]")
+{
+    std::promise<void> logged;
+    std::promise<void> logger_destroyed;
+    std::thread th;
+    
+    {
+        RealtimeLogger::Options opts;
+        opts.num_rings_ = 1;
+        opts.ring_capacity_ = 4;
+        RealtimeLogger rt_logger(opts);
+        
+        th = std::thread([&, destroyed = logger_destroyed.get_future()] {
+            HWM_RT_INFO_LOG(L"message from a thread which exits after the logger");
+            logged.set_value();
+            destroyed.wait();
+            // the ring assigned to this thread is returned when the thread exits.
+        });
+        logged.get_future().wait();
+        REQUIRE(rt_logger.GetNumDroppedRecords() == 0);
+    }
+    
+    logger_destroyed.set_value();
+    th.join();
+    
+    // a new logger can assign its rings to a thread which has used the previous logger.
+    RealtimeLogger::Options opts;
+    opts.num_rings_ = 1;
+    opts.ring_capacity_ = 4;
+    RealtimeLogger rt_logger(opts);
+    
+    std::thread([&] { HWM_RT_INFO_LOG(L"message"); }).join();
+    HWM_RT_INFO_LOG(L"message from this thread");
+    // the only ring has been returned by the thread which has exited, and is assigned to this thread.
+    REQUIRE(rt_logger.GetNumDroppedRecords() == 0);
+}
+
+TEST_CASE("Logger::OutputLogBatch skips entries with invalid levels", "[log]")
+{
+    Logger logger;
+    logger.SetLoggingLevels({ L"Error", L"Warn", L"Info" });
+    logger.SetMostDetailedActiveLoggingLevel(L"Info");
+    auto st = std::make_shared<TestLoggingStrategy>();
+    logger.SetStrategy(st);
+    logger.StartLogging(true);
+    
+    auto const now = std::chrono::system_clock::now();
+    std::vector<Logger::Entry> entries {
+        { L"Info", now, L"message 1" },
+        { L"Unknown", now, L"message 2" },
+        { L"Warn", now, L"message 3" },
+    };
+    auto err = logger.OutputLogBatch(entries);
+    logger.StartLogging(false);
+    
+    REQUIRE(err.has_error());
+    auto const &messages = st->messages_;
+    REQUIRE(messages.size() == 2);
+    REQUIRE(EndsWith(messages[0], L"[Info] message 1"));
+    REQUIRE(EndsWith(messages[1], L"[Warn] message 3"));
+}
@@ -0,0 +1,270 @@
+#include "catch2/catch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "../misc/RealtimeWorkerPool.hpp"
+#include "../misc/WorkStealingDeque.hpp"
+
+using namespace hwm;
+
+namespace {
+
+//! 指定した時間だけCPUを使い続ける
+void BusyWait(std::chrono::microseconds duration)
+{
+    auto const end = std::chrono::steady_clock::now() + duration;
+    while(std::chrono::steady_clock::now() < end) {}
+}
+
+} // namespace
+
+TEST_CASE("WorkStealingDeque basic test", "[workerpool]")
+{
+    WorkStealingDeque<UInt32> dq(3);
+    REQUIRE(dq.GetCapacity() == 4);
+    REQUIRE(dq.IsEmpty());
+
+    for(UInt32 i = 0; i < 4; ++i) {
+        REQUIRE(dq.Push(i));
+    }
+    REQUIRE(dq.Push(4) == false);
+
+    // 所有者は末尾から、他のスレッドは先頭から取り出す
+    UInt32 x = 0;
+    REQUIRE(dq.Pop(x));
+    REQUIRE(x == 3);
+    REQUIRE(dq.Steal(x));
+    REQUIRE(x == 0);
+    REQUIRE(dq.Pop(x));
+    REQUIRE(x == 2);
+    REQUIRE(dq.Pop(x));
+    REQUIRE(x == 1);
+    REQUIRE(dq.Pop(x) == false);
+    REQUIRE(dq.Steal(x) == false);
+    REQUIRE(dq.IsEmpty());
+}
+
+TEST_CASE("WorkStealingDeque hands out each item exactly once", "[workerpool]")
+{
+    UInt32 const kNumItems = 200000;
+    UInt32 const kNumThieves = 3;
+    WorkStealingDeque<UInt32> dq(64);
+
+    std::vector<std::atomic<UInt32>> taken(kNumItems);
+    std::atomic<UInt32> num_taken = { 0 };
+
+    std::vector<std::thread> thieves;
+    for(UInt32 i = 0; i < kNumThieves; ++i) {
+        thieves.emplace_back([&] {
+            while(num_taken.load() < kNumItems) {
+                UInt32 x = 0;
+                if(dq.Steal(x)) {
+                    taken[x].fetch_add(1);
+                    num_taken.fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    UInt32 next = 0;
+    while(num_taken.load() < kNumItems) {
+        if(next < kNumItems && dq.Push(next)) {
+            ++next;
+            continue;
+        }
+
+        UInt32 x = 0;
+        if(dq.Pop(x)) {
+            taken[x].fetch_add(1);
+            num_taken.fetch_add(1);
+        }
+    }
+
+    for(auto &t: thieves) { t.join(); }
+
+    UInt32 num_errors = 0;
+    for(auto &t: taken) {
+        if(t.load() != 1) { ++num_errors; }
+    }
+    REQUIRE(num_errors == 0);
+}
+
+TEST_CASE("TaskGraph computes critical paths", "[workerpool]")
+{
+    // 0 -> 1 -> 3
+    //   -> 2 ->
+    TaskGraph graph(5);
+    graph.AddDependency(0, 1);
+    graph.AddDependency(0, 2);
+    graph.AddDependency(1, 3);
+    graph.AddDependency(2, 3);
+    REQUIRE(graph.Build());
+    REQUIRE(graph.HasParallelism());
+
+    graph.SetCost(0, 10);
+    graph.SetCost(1, 50);
+    graph.SetCost(2, 20);
+    graph.SetCost(3, 5);
+    graph.SetCost(4, 30); // 独立したタスク
+    graph.UpdateCriticalPaths();
+
+    REQUIRE(graph.GetCriticalPathLength(3) == 5);
+    REQUIRE(graph.GetCriticalPathLength(1) == 55);
+    REQUIRE(graph.GetCriticalPathLength(2) == 25);
+    REQUIRE(graph.GetCriticalPathLength(0) == 65);
+    REQUIRE(graph.GetCriticalPathLength(4) == 30);
+
+    TaskGraph serial(3);
+    serial.AddDependency(0, 1);
+    serial.AddDependency(1, 2);
+    REQUIRE(serial.Build());
+    REQUIRE(serial.HasParallelism() == false);
+
+    TaskGraph cyclic(3);
+    cyclic.AddDependency(0, 1);
+    cyclic.AddDependency(1, 2);
+    cyclic.AddDependency(2, 1);
+    REQUIRE(cyclic.Build() == false);
+}
+
+TEST_CASE("RealtimeWorkerPool runs tasks after their predecessors", "[workerpool]")
+{
+    RealtimeWorkerPool::Options opts;
+    opts.num_workers_ = 3;
+    opts.realtime_priority_ = false;
+    RealtimeWorkerPool pool(opts);
+    REQUIRE(pool.GetNumWorkers() == 3);
+
+    // 4本の並列なチェインを最後のタスクで合流させる
+    UInt32 const kNumChains = 4;
+    UInt32 const kChainLength = 3;
+    UInt32 const kNumTasks = kNumChains * kChainLength + 1;
+    UInt32 const kSink = kNumTasks - 1;
+
+    TaskGraph graph(kNumTasks);
+    for(UInt32 c = 0; c < kNumChains; ++c) {
+        for(UInt32 i = 1; i < kChainLength; ++i) {
+            graph.AddDependency(c * kChainLength + i - 1, c * kChainLength + i);
+        }
+        graph.AddDependency(c * kChainLength + kChainLength - 1, kSink);
+    }
+    REQUIRE(graph.Build());
+
+    // 各タスクが実行された回数。タスクの実行中は、先行タスクがすでに同じ回数だけ実行されているはず
+    std::vector<UInt32> num_executed(kNumTasks);
+    UInt32 num_errors = 0;
+    std::atomic<UInt32> num_errors_in_workers = { 0 };
+
+    int const kNumRuns = 200;
+    for(int run = 0; run < kNumRuns; ++run) {
+        pool.Run(graph, [&](UInt32 task) {
+            UInt32 const expected = run + 1;
+            if(task == kSink) {
+                for(UInt32 c = 0; c < kNumChains; ++c) {
+                    if(num_executed[c * kChainLength + kChainLength - 1] != expected) {
+                        num_errors_in_workers.fetch_add(1);
+                    }
+                }
+            } else if(task % kChainLength != 0 && num_executed[task - 1] != expected) {
+                num_errors_in_workers.fetch_add(1);
+            }
+            BusyWait(std::chrono::microseconds(5));
+            num_executed[task] += 1;
+        });
+
+        // Run() から戻った時点で、すべてのタスクが完了している
+        for(auto n: num_executed) {
+            if(n != (UInt32)run + 1) { ++num_errors; }
+        }
+    }
+
+    REQUIRE(num_errors == 0);
+    REQUIRE(num_errors_in_workers.load() == 0);
+    for(UInt32 i = 0; i < kNumTasks; ++i) {
+        REQUIRE(graph.GetCost(i) > 0);
+    }
+}
+
+TEST_CASE("RealtimeWorkerPool runs a serial graph on the calling thread", "[workerpool]")
+{
+    RealtimeWorkerPool::Options opts;
+    opts.num_workers_ = 2;
+    opts.realtime_priority_ = false;
+    RealtimeWorkerPool pool(opts);
+
+    TaskGraph graph(4);
+    graph.AddDependency(0, 1);
+    graph.AddDependency(1, 2);
+    graph.AddDependency(2, 3);
+    REQUIRE(graph.Build());
+
+    auto const caller = std::this_thread::get_id();
+    std::vector<UInt32> order;
+    bool runs_on_caller = true;
+    pool.Run(graph, [&](UInt32 task) {
+        order.push_back(task);
+        if(std::this_thread::get_id() != caller) { runs_on_caller = false; }
+    });
+
+    REQUIRE(runs_on_caller);
+    REQUIRE(order == std::vector<UInt32>{ 0, 1, 2, 3 });
+}
+
+TEST_CASE("RealtimeWorkerPool starts the longest path first", "[workerpool]")
+{
+    // ワーカースレッドがない場合は、クリティカルパスの長い順に実行される
+    RealtimeWorkerPool pool(RealtimeWorkerPool::Options{});
+
+    TaskGraph graph(4);
+    graph.AddDependency(2, 3);
+    REQUIRE(graph.Build());
+    graph.SetCost(0, 10);
+    graph.SetCost(1, 30);
+    graph.SetCost(2, 5);
+    graph.SetCost(3, 40);
+    graph.UpdateCriticalPaths();
+
+    std::vector<UInt32> order;
+    pool.Run(graph, [&](UInt32 task) { order.push_back(task); });
+    REQUIRE(order.size() == 4);
+    REQUIRE(order[0] == 2);
+    REQUIRE(order[1] == 3);
+    REQUIRE(order[2] == 1);
+    REQUIRE(order[3] == 0);
+}
+
+TEST_CASE("RealtimeWorkerPool benchmark", "[.][benchmark][workerpool]")
+{
+    using clock_t = std::chrono::steady_clock;
+    UInt32 const kNumTasks = 8;
+    int const kNumRuns = 200;
+    auto const kTaskDuration = std::chrono::microseconds(200);
+
+    TaskGraph graph(kNumTasks);
+    REQUIRE(graph.Build());
+
+    auto measure = [&](UInt32 num_workers) {
+        RealtimeWorkerPool::Options opts;
+        opts.num_workers_ = num_workers;
+        RealtimeWorkerPool pool(opts);
+
+        auto const begin = clock_t::now();
+        for(int i = 0; i < kNumRuns; ++i) {
+            pool.Run(graph, [&](UInt32) { BusyWait(kTaskDuration); });
+        }
+        auto const usec = std::chrono::duration<double, std::micro>(clock_t::now() - begin).count();
+        return usec / kNumRuns;
+    };
+
+    auto const num_cpus = std::max<UInt32>(std::thread::hardware_concurrency(), 1);
+    for(UInt32 num_workers: { 0u, 1u, 3u, 7u }) {
+        if(num_workers >= num_cpus && num_workers > 0) { continue; }
+        std::cout << kNumTasks << " tasks x 200us with " << num_workers << " workers: "
+        << measure(num_workers) << "us per run" << std::endl;
+    }
+}
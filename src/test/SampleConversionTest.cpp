@@ -0,0 +1,114 @@
+#include "catch2/catch.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "../misc/Buffer.hpp"
+#include "../misc/SampleConversion.hpp"
+
+using namespace hwm;
+
+namespace {
+
+std::vector<float> MakeInterleavedData(UInt32 num_channels, SampleCount length)
+{
+    std::vector<float> data(num_channels * length);
+    for(size_t i = 0; i < data.size(); ++i) {
+        // クリップされるサンプルも含める
+        data[i] = std::sin(i * 0.37) * 1.5f;
+    }
+    return data;
+}
+
+} // namespace
+
+TEST_CASE("Deinterleave test", "[sampleconversion]")
+{
+    for(UInt32 num_channels: { 1, 2, 3, 4, 5, 8, 9 }) {
+        // SSE2で処理される部分と、端数として処理される部分の両方を含む長さにする
+        SampleCount const length = 37;
+        auto const src = MakeInterleavedData(num_channels, length);
+
+        Buffer<float> expected(num_channels, length);
+        Buffer<float> actual(num_channels, length);
+        DeinterleaveScalar(src.data(), expected.data(), num_channels, length);
+        Deinterleave(src.data(), actual.data(), num_channels, length);
+
+        for(UInt32 ch = 0; ch < num_channels; ++ch) {
+            for(SampleCount i = 0; i < length; ++i) {
+                REQUIRE(expected.data()[ch][i] == src[i * num_channels + ch]);
+                REQUIRE(actual.data()[ch][i] == expected.data()[ch][i]);
+            }
+        }
+    }
+}
+
+TEST_CASE("InterleaveWithClip test", "[sampleconversion]")
+{
+    for(UInt32 num_channels: { 1, 2, 3, 4, 5, 8, 9 }) {
+        SampleCount const length = 37;
+        auto const data = MakeInterleavedData(num_channels, length);
+
+        Buffer<float> src(num_channels, length);
+        DeinterleaveScalar(data.data(), src.data(), num_channels, length);
+
+        std::vector<float> expected(num_channels * length);
+        std::vector<float> actual(num_channels * length);
+        InterleaveWithClipScalar(src.data(), expected.data(), num_channels, length);
+        InterleaveWithClip(src.data(), actual.data(), num_channels, length);
+
+        for(size_t i = 0; i < expected.size(); ++i) {
+            REQUIRE(expected[i] == std::min(std::max(data[i], -1.0f), 1.0f));
+            REQUIRE(actual[i] == expected[i]);
+        }
+    }
+}
+
+TEST_CASE("Clip test", "[sampleconversion]")
+{
+    std::vector<float> data = { -2.0f, -1.0f, -0.5f, 0.0f, 0.5f, 1.0f, 2.0f };
+    Clip(data.data(), data.data(), data.size());
+
+    std::vector<float> const expected = { -1.0f, -1.0f, -0.5f, 0.0f, 0.5f, 1.0f, 1.0f };
+    REQUIRE(data == expected);
+}
+
+TEST_CASE("SampleConversion benchmark", "[.][benchmark][sampleconversion]")
+{
+    using clock_t = std::chrono::steady_clock;
+    int const kNumIterations = 2000;
+
+    auto measure = [&](auto f) {
+        auto const begin = clock_t::now();
+        for(int i = 0; i < kNumIterations; ++i) { f(); }
+        auto const end = clock_t::now();
+        return std::chrono::duration<double, std::micro>(end - begin).count() / kNumIterations;
+    };
+
+    for(UInt32 num_channels: { 1, 2, 4, 8 }) {
+        for(SampleCount length: { 32, 64, 128, 256, 512, 1024, 2048, 4096 }) {
+            auto const interleaved = MakeInterleavedData(num_channels, length);
+            std::vector<float> out_interleaved(interleaved.size());
+            Buffer<float> buffer(num_channels, length);
+
+            auto const deinterleave_scalar = measure([&] {
+                DeinterleaveScalar(interleaved.data(), buffer.data(), num_channels, length);
+            });
+            auto const deinterleave = measure([&] {
+                Deinterleave(interleaved.data(), buffer.data(), num_channels, length);
+            });
+            auto const interleave_scalar = measure([&] {
+                InterleaveWithClipScalar(buffer.data(), out_interleaved.data(), num_channels, length);
+            });
+            auto const interleave = measure([&] {
+                InterleaveWithClip(buffer.data(), out_interleaved.data(), num_channels, length);
+            });
+
+            std::cout << num_channels << "ch, " << length << " frames: "
+            << "deinterleave " << deinterleave_scalar << "us -> " << deinterleave << "us, "
+            << "interleave+clip " << interleave_scalar << "us -> " << interleave << "us"
+            << std::endl;
+        }
+    }
+}
@@ -0,0 +1,265 @@
+#include "catch2/catch.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "../misc/SpscRingBuffer.hpp"
+#include "./ThreadSafeRingBuffer.hpp"
+#include "../misc/LatencyHistogram.hpp"
+
+using namespace hwm;
+
+TEST_CASE("SpscRingBuffer basic test", "[spscringbuffer]")
+{
+    SpscRingBuffer<int> rb(5);
+
+    // 容量は2のべき乗に切り上げられる
+    REQUIRE(rb.GetCapacity() == 8);
+    REQUIRE(rb.GetNumPoppable() == 0);
+    REQUIRE(rb.GetNumPushable() == 8);
+
+    int x = 0;
+    REQUIRE(rb.Pop(x) == false);
+    REQUIRE(rb.Push(10));
+    REQUIRE(rb.GetNumPoppable() == 1);
+    REQUIRE(rb.GetNumPushable() == 7);
+    REQUIRE(rb.Pop(x));
+    REQUIRE(x == 10);
+
+    int xs[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+    REQUIRE(rb.Push(xs, 9) == false);
+    REQUIRE(rb.GetNumPoppable() == 0);
+    REQUIRE(rb.Push(xs, 8));
+    REQUIRE(rb.Push(100) == false);
+
+    int ys[9] = {};
+    REQUIRE(rb.Pop(ys, 9) == false);
+    REQUIRE(rb.Pop(ys, 8));
+    for(int i = 0; i < 8; ++i) { REQUIRE(ys[i] == i); }
+    REQUIRE(rb.GetNumPoppable() == 0);
+}
+
+TEST_CASE("SpscRingBuffer spans test", "[spscringbuffer]")
+{
+    SpscRingBuffer<int> rb(8);
+
+    // 書き込み位置を末尾近くまで進めておく
+    int xs[6] = {};
+    REQUIRE(rb.Push(xs, 6));
+    REQUIRE(rb.Pop(xs, 6));
+
+    std::vector<std::pair<UInt32, UInt32>> spans;
+    auto const num_written = rb.Write(5, [&](int *dest, UInt32 len, UInt32 offset) {
+        spans.emplace_back(len, offset);
+        for(UInt32 i = 0; i < len; ++i) { dest[i] = 100 + offset + i; }
+    });
+
+    // 末尾をまたぐので、2つの区間に分けて書き込まれる
+    REQUIRE(num_written == 5);
+    REQUIRE(spans == std::vector<std::pair<UInt32, UInt32>>{ { 2, 0 }, { 3, 2 } });
+
+    std::vector<int> read;
+    auto const num_read = rb.Read(100, [&](int const *src, UInt32 len, UInt32 offset) {
+        REQUIRE(offset == read.size());
+        read.insert(read.end(), src, src + len);
+    });
+    REQUIRE(num_read == 5);
+    REQUIRE(read == std::vector<int>{ 100, 101, 102, 103, 104 });
+
+    // 空き領域より多く要求した場合は、書き込める分だけ書き込む
+    REQUIRE(rb.Write(100, [](int *, UInt32, UInt32) {}) == 8);
+    REQUIRE(rb.Write(1, [](int *, UInt32, UInt32) { FAIL(); }) == 0);
+}
+
+TEST_CASE("MultiChannelSpscRingBuffer test", "[spscringbuffer]")
+{
+    MultiChannelSpscRingBuffer<float> rb(2, 4);
+    REQUIRE(rb.GetNumChannels() == 2);
+    REQUIRE(rb.GetCapacity() == 4);
+
+    float l[] = { 1, 2, 3 };
+    float const *src[] = { l };
+    // 足りないチャンネルは0で埋められる
+    REQUIRE(rb.Push(src, 1, 3));
+    REQUIRE(rb.Push(src, 1, 3) == false);
+
+    float dl[4] = {};
+    float dr[4] = { 10, 10, 10, 10 };
+    float *dest[] = { dl, dr };
+    REQUIRE(rb.PopOverwrite(dest, 2, 2));
+    REQUIRE(dl[0] == 1);
+    REQUIRE(dl[1] == 2);
+    REQUIRE(dr[0] == 0);
+    REQUIRE(dr[1] == 0);
+
+    // 末尾をまたいで書き込み、加算して取り出す
+    REQUIRE(rb.Push(src, 1, 3));
+    std::fill_n(dl, 4, 100.0f);
+    REQUIRE(rb.PopAdd(dest, 1, 4));
+    REQUIRE(dl[0] == 103);
+    REQUIRE(dl[1] == 101);
+    REQUIRE(dl[2] == 102);
+    REQUIRE(dl[3] == 103);
+    REQUIRE(rb.GetNumPoppable() == 0);
+}
+
+TEST_CASE("MultiChannelSpscRingBuffer single channel test", "[spscringbuffer]")
+{
+    MultiChannelSpscRingBuffer<int> rb(1, 8);
+
+    REQUIRE(rb.GetCapacity() == 8);
+    REQUIRE(rb.GetNumPoppable() == 0);
+    REQUIRE(rb.GetNumPushable() == 8);
+
+    int x = 10;
+    int const *px = &x;
+    REQUIRE(rb.Push(&px, 1, 1));
+    REQUIRE(rb.GetNumPoppable() == 1);
+    REQUIRE(rb.GetNumPushable() == 7);
+
+    int y = 0;
+    int *py = &y;
+    REQUIRE(rb.PopOverwrite(&py, 1, 1));
+    REQUIRE(rb.GetNumPoppable() == 0);
+    REQUIRE(rb.GetNumPushable() == 8);
+    REQUIRE(y == 10);
+
+    int xs[] = { 20, 21, 22, 23, 24, 25, 26, 27 };
+    int const *pxs = xs;
+    REQUIRE(rb.Push(&pxs, 1, 8));
+    REQUIRE(rb.GetNumPoppable() == 8);
+    REQUIRE(rb.GetNumPushable() == 0);
+    REQUIRE(rb.Push(&px, 1, 1) == false);
+
+    int ys[3] = { 100, 100, 100 };
+    int *pys = ys;
+    REQUIRE(rb.PopAdd(&pys, 1, 3));
+    REQUIRE(ys[0] == xs[0] + 100);
+    REQUIRE(ys[1] == xs[1] + 100);
+    REQUIRE(ys[2] == xs[2] + 100);
+    REQUIRE(rb.GetNumPoppable() == 5);
+    REQUIRE(rb.GetNumPushable() == 3);
+}
+
+TEST_CASE("SpscRingBuffer stress test", "[spscringbuffer]")
+{
+    UInt32 const kNumItems = 1000000;
+    SpscRingBuffer<UInt32> rb(64);
+
+    std::thread producer([&] {
+        UInt32 next = 0;
+        UInt32 chunk[7];
+        while(next < kNumItems) {
+            // 1つずつの追加とまとめての追加を混ぜる
+            if(next % 3 == 0) {
+                if(rb.Push(next)) { ++next; }
+            } else {
+                auto const n = std::min<UInt32>(7, kNumItems - next);
+                for(UInt32 i = 0; i < n; ++i) { chunk[i] = next + i; }
+                if(rb.Push(chunk, n)) { next += n; }
+            }
+        }
+    });
+
+    UInt32 expected = 0;
+    int num_errors = 0;
+    while(expected < kNumItems) {
+        rb.Read(16, [&](UInt32 const *src, UInt32 len, UInt32) {
+            for(UInt32 i = 0; i < len; ++i) {
+                if(src[i] != expected) { ++num_errors; }
+                ++expected;
+            }
+        });
+    }
+
+    producer.join();
+    REQUIRE(num_errors == 0);
+    REQUIRE(rb.GetNumPoppable() == 0);
+}
+
+// SpscRingBuffer に置き換える前の実装（ThreadSafeRingBufferImpl）と、スループットとレイテンシーを比較する
+TEST_CASE("SpscRingBuffer benchmark", "[.][benchmark][spscringbuffer]")
+{
+    using clock_t = std::chrono::steady_clock;
+    UInt32 const kNumItems = 10000000;
+    UInt32 const kCapacity = 4096;
+
+    // 書き込み側と読み込み側のスレッドで、chunk_size 個ずつ受け渡したときの時間を計測する
+    auto measure_throughput = [&](UInt32 chunk_size, auto push, auto pop) {
+        auto const begin = clock_t::now();
+        std::thread producer([&] {
+            std::vector<float> chunk(chunk_size);
+            for(UInt32 n = 0; n < kNumItems; ) {
+                if(push(chunk.data(), chunk_size)) { n += chunk_size; }
+                else { std::this_thread::yield(); }
+            }
+        });
+
+        std::vector<float> chunk(chunk_size);
+        for(UInt32 n = 0; n < kNumItems; ) {
+            if(pop(chunk.data(), chunk_size)) { n += chunk_size; }
+            else { std::this_thread::yield(); }
+        }
+        producer.join();
+
+        auto const sec = std::chrono::duration<double>(clock_t::now() - begin).count();
+        return kNumItems / sec / 1000000.0;
+    };
+
+    // 書き込んでから読み込み側で取り出されるまでの時間を計測する
+    auto measure_latency = [&](auto push, auto pop) {
+        UInt32 const kNumPings = 100000;
+        LatencyHistogram hist;
+        std::atomic<bool> received = { true };
+
+        std::thread producer([&] {
+            for(UInt32 i = 0; i < kNumPings; ++i) {
+                while(received.load() == false) { std::this_thread::yield(); }
+                received.store(false);
+                clock_t::rep const now = clock_t::now().time_since_epoch().count();
+                while(push(now) == false) { std::this_thread::yield(); }
+            }
+        });
+
+        for(UInt32 i = 0; i < kNumPings; ++i) {
+            clock_t::rep sent = 0;
+            while(pop(sent) == false) { std::this_thread::yield(); }
+            auto const elapsed = clock_t::duration(clock_t::now().time_since_epoch().count() - sent);
+            auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+            hist.Record((UInt64)ns.count());
+            received.store(true);
+        }
+        producer.join();
+        return hist.GetSummary();
+    };
+
+    for(UInt32 chunk_size: { 1, 16, 64, 256 }) {
+        ThreadSafeRingBufferImpl<float> old_rb(1, kCapacity);
+        auto const old_result = measure_throughput(chunk_size,
+            [&](float const *src, UInt32 n) { return (bool)old_rb.Push(&src, 1, n); },
+            [&](float *dest, UInt32 n) { return (bool)old_rb.PopOverwrite(&dest, 1, n); });
+
+        SpscRingBuffer<float> new_rb(kCapacity);
+        auto const new_result = measure_throughput(chunk_size,
+            [&](float const *src, UInt32 n) { return new_rb.Push(src, n); },
+            [&](float *dest, UInt32 n) { return new_rb.Pop(dest, n); });
+
+        std::cout << "chunk " << chunk_size << ": ThreadSafeRingBuffer " << old_result
+        << " Mitems/s -> SpscRingBuffer " << new_result << " Mitems/s" << std::endl;
+    }
+
+    using rep_t = clock_t::rep;
+    SingleChannelThreadSafeRingBuffer<rep_t> old_rb(kCapacity);
+    auto const old_latency = measure_latency([&](rep_t v) { return (bool)old_rb.Push(&v, 1); },
+                                             [&](rep_t &v) { return (bool)old_rb.PopOverwrite(&v, 1); });
+    SpscRingBuffer<rep_t> new_rb(kCapacity);
+    auto const new_latency = measure_latency([&](rep_t v) { return new_rb.Push(v); },
+                                             [&](rep_t &v) { return new_rb.Pop(v); });
+
+    auto print = [](char const *label, LatencyHistogram::Summary const &s) {
+        std::cout << label << ": p50 " << s.p50_ << "ns, p99 " << s.p99_ << "ns, max " << s.max_ << "ns" << std::endl;
+    };
+    print("ThreadSafeRingBuffer latency", old_latency);
+    print("SpscRingBuffer latency", new_latency);
+}
@@ -0,0 +1,149 @@
+#include "catch2/catch.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "../plugin/vst3/StateSnapshotStore.hpp"
+
+using namespace hwm;
+
+namespace {
+
+std::vector<char> MakeState(size_t size, int seed)
+{
+    std::vector<char> data(size);
+    for(size_t i = 0; i < size; ++i) { data[i] = (char)((i * 131 + seed * 7) & 0xFF); }
+    return data;
+}
+
+ArrayRef<char const> ToRef(std::vector<char> const &v)
+{
+    return ArrayRef<char const>(v);
+}
+
+} // namespace
+
+TEST_CASE("StateSnapshotStore shares identical data", "[state_snapshot_store]")
+{
+    StateSnapshotStore store(1024 * 1024);
+
+    auto const proc_a = MakeState(1000, 1);
+    auto const proc_b = MakeState(1000, 2);
+    auto const edit = MakeState(100, 3);
+
+    auto const id1 = store.Add(L"A", ToRef(proc_a), ToRef(edit));
+    REQUIRE(id1 != 0);
+    REQUIRE(store.GetMemoryUsage() == 1100);
+
+    // 同じ内容のデータを追加してもメモリの使用量は増えない
+    auto const id2 = store.Add(L"A'", ToRef(proc_a), ToRef(edit));
+    REQUIRE(id2 != id1);
+    REQUIRE(store.GetNumSnapshots() == 2);
+    REQUIRE(store.GetMemoryUsage() == 1100);
+
+    auto const s1 = store.Get(id1);
+    auto const s2 = store.Get(id2);
+    REQUIRE(s1);
+    REQUIRE(s2);
+    CHECK(s1->processor_data_ == s2->processor_data_);
+    CHECK(s1->edit_controller_data_ == s2->edit_controller_data_);
+    CHECK(s1->name_ == L"A");
+
+    // プロセッサーの状態だけ異なる場合は、その分だけ増える
+    auto const id3 = store.Add(L"B", ToRef(proc_b), ToRef(edit));
+    REQUIRE(store.GetMemoryUsage() == 2100);
+    auto const s3 = store.Get(id3);
+    REQUIRE(s3);
+    CHECK(s3->processor_data_->data_ == proc_b);
+    CHECK(s3->edit_controller_data_ == s1->edit_controller_data_);
+
+    // 共有しているデータは、参照するスナップショットがなくなるまで削除されない
+    REQUIRE(store.Remove(id1));
+    CHECK(store.GetMemoryUsage() == 2100);
+    CHECK(store.Contains(id1) == false);
+    CHECK(store.Get(id1) == std::nullopt);
+
+    REQUIRE(store.Remove(id3));
+    CHECK(store.GetMemoryUsage() == 1100);
+    CHECK(store.Remove(id3) == false);
+
+    store.Clear();
+    CHECK(store.GetNumSnapshots() == 0);
+    CHECK(store.GetMemoryUsage() == 0);
+}
+
+TEST_CASE("StateSnapshotStore evicts the least recently used snapshots", "[state_snapshot_store]")
+{
+    StateSnapshotStore store(3000);
+    std::vector<char> const empty;
+
+    auto const id1 = store.Add(L"1", ToRef(MakeState(1000, 1)), ToRef(empty));
+    auto const id2 = store.Add(L"2", ToRef(MakeState(1000, 2)), ToRef(empty));
+    auto const id3 = store.Add(L"3", ToRef(MakeState(1000, 3)), ToRef(empty));
+    REQUIRE(store.GetMemoryUsage() == 3000);
+
+    // id1 を使用したので、次に追加したときには id2 が削除される
+    REQUIRE(store.Get(id1));
+    auto const id4 = store.Add(L"4", ToRef(MakeState(1000, 4)), ToRef(empty));
+    CHECK(store.GetSnapshotIDs() == std::vector<StateSnapshotStore::SnapshotID>{ id3, id1, id4 });
+    CHECK(store.GetMemoryUsage() == 3000);
+    CHECK(store.Contains(id2) == false);
+
+    // 容量を超えるスナップショットでも、最後に追加したものは残る
+    auto const id5 = store.Add(L"5", ToRef(MakeState(5000, 5)), ToRef(empty));
+    CHECK(store.GetSnapshotIDs() == std::vector<StateSnapshotStore::SnapshotID>{ id5 });
+    CHECK(store.GetMemoryUsage() == 5000);
+
+    store.SetCapacity(100);
+    CHECK(store.GetNumSnapshots() == 1);
+}
+
+TEST_CASE("StateSnapshotStore handles shared processor and controller data", "[state_snapshot_store]")
+{
+    StateSnapshotStore store(1024 * 1024);
+    auto const data = MakeState(500, 1);
+
+    auto const id = store.Add(L"same", ToRef(data), ToRef(data));
+    CHECK(store.GetMemoryUsage() == 500);
+    REQUIRE(store.Remove(id));
+    CHECK(store.GetMemoryUsage() == 0);
+}
+
+TEST_CASE("StateSnapshotStore hash", "[state_snapshot_store]")
+{
+    // 長さや1バイトの違いでハッシュ値が変わる
+    for(size_t size: { 0, 1, 7, 8, 31, 32, 33, 100, 1000 }) {
+        auto const data = MakeState(size, 1);
+        auto modified = data;
+        if(size > 0) { modified[size / 2] ^= 1; }
+
+        auto const h = StateSnapshotStore::Hash(ToRef(data));
+        CHECK(h == StateSnapshotStore::Hash(ToRef(data)));
+        if(size > 0) {
+            CHECK(h != StateSnapshotStore::Hash(ToRef(modified)));
+            CHECK(h != StateSnapshotStore::Hash(ArrayRef<char const>(data.data(), data.data() + size - 1)));
+        }
+    }
+}
+
+TEST_CASE("StateSnapshotStore benchmark", "[.][benchmark][state_snapshot_store]")
+{
+    using clock_t = std::chrono::steady_clock;
+
+    for(size_t size_mb: { 1, 16, 64 }) {
+        auto const proc = MakeState(size_mb * 1024 * 1024, 1);
+        std::vector<char> const empty;
+        StateSnapshotStore store(size_mb * 4 * 1024 * 1024);
+
+        auto const begin = clock_t::now();
+        store.Add(L"first", ToRef(proc), ToRef(empty));
+        auto const first = clock_t::now();
+        // 変更のない状態は、ハッシュの計算と比較だけで追加できる
+        store.Add(L"second", ToRef(proc), ToRef(empty));
+        auto const second = clock_t::now();
+
+        auto to_msec = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+        std::cout << size_mb << "MB: first add " << to_msec(first - begin) << " msec"
+        << ", deduplicated add " << to_msec(second - first) << " msec" << std::endl;
+    }
+}
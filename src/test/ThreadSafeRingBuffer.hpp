@@ -12,6 +12,9 @@
 
 NS_HWM_BEGIN
 
+// SpscRingBuffer に置き換える前のリングバッファ。
+// ベンチマークで比較するためだけに、テストのディレクトリにコピーを残している。
+
 enum class ThreadSafeRingBufferErrorCode
 {
     kSuccessful,            //!< 非エラーを表す
@@ -0,0 +1,64 @@
+#include "catch2/catch.hpp"
+
+#include <thread>
+#include "../misc/TripleBuffer.hpp"
+
+using namespace hwm;
+
+TEST_CASE("TripleBuffer basic test", "[triplebuffer]")
+{
+    TripleBuffer<int> tb;
+    tb.ForEachBuffer([](int &x) { x = 0; });
+
+    REQUIRE(tb.Update() == false);
+    REQUIRE(tb.GetReadBuffer() == 0);
+
+    tb.GetWriteBuffer() = 1;
+    tb.Publish();
+    tb.GetWriteBuffer() = 2;
+    tb.Publish();
+
+    // 最後に公開された値だけを受け取る
+    REQUIRE(tb.Update());
+    REQUIRE(tb.GetReadBuffer() == 2);
+    REQUIRE(tb.Update() == false);
+    REQUIRE(tb.GetReadBuffer() == 2);
+
+    tb.GetWriteBuffer() = 3;
+    tb.Publish();
+    REQUIRE(tb.Update());
+    REQUIRE(tb.GetReadBuffer() == 3);
+}
+
+TEST_CASE("TripleBuffer concurrent test", "[triplebuffer]")
+{
+    struct Item {
+        int a_ = 0;
+        int b_ = 0;
+    };
+
+    TripleBuffer<Item> tb;
+    int const kNumItems = 200000;
+
+    std::thread writer([&] {
+        for(int i = 1; i <= kNumItems; ++i) {
+            auto &item = tb.GetWriteBuffer();
+            item.a_ = i;
+            item.b_ = -i;
+            tb.Publish();
+        }
+    });
+
+    int last = 0;
+    int num_errors = 0;
+    while(last != kNumItems) {
+        if(tb.Update() == false) { continue; }
+        auto const &item = tb.GetReadBuffer();
+        if(item.a_ != -item.b_) { ++num_errors; }
+        if(item.a_ <= last) { ++num_errors; }
+        last = item.a_;
+    }
+
+    writer.join();
+    REQUIRE(num_errors == 0);
+}
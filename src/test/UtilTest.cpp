@@ -0,0 +1,54 @@
+#include "catch2/catch.hpp"
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../file/Util.hpp"
+
+using namespace hwm;
+
+TEST_CASE("read_lines decodes base64 values while reading", "[util]")
+{
+    std::vector<char> data(100 * 1000);
+    for(size_t i = 0; i < data.size(); ++i) { data[i] = (char)(i * 7); }
+
+    std::ostringstream os;
+    os << "format = \"test\"\n";
+    write_base64_line(os, "state", data.data(), data.size()) << "\n";
+    os << "  empty =  \"\"\n";
+    os << "name = \"value\"";
+
+    std::map<std::string, std::optional<std::vector<char>>> values {
+        { "state", std::nullopt },
+        { "empty", std::nullopt },
+        { "missing", std::nullopt },
+    };
+    std::istringstream is(os.str());
+    auto const lines = read_lines(is, values);
+
+    REQUIRE(lines == std::vector<std::string>{ "format = \"test\"", "name = \"value\"" });
+    REQUIRE(find_value(lines, "name") == std::string("value"));
+    REQUIRE(values["state"] == data);
+    REQUIRE(values["empty"] == std::vector<char>{});
+    REQUIRE_FALSE(values["missing"]);
+}
+
+TEST_CASE("read_lines skips base64 values that fail to decode", "[util]")
+{
+    std::istringstream is(
+        "state = \"QUJD*A==\"\n"
+        "unterminated = \"QUJD\n"
+        "name = \"value\"\n"
+    );
+
+    std::map<std::string, std::optional<std::vector<char>>> values {
+        { "state", std::nullopt },
+        { "unterminated", std::nullopt },
+    };
+    auto const lines = read_lines(is, values);
+
+    REQUIRE_FALSE(values["state"]);
+    REQUIRE_FALSE(values["unterminated"]);
+    // 失敗した行の後の行も読み込まれる
+    REQUIRE(lines == std::vector<std::string>{ "name = \"value\"" });
+}